@@ -363,6 +363,11 @@ void* avl_iter_current(avl_iter_t* iter)
     return iter->head->node->data;
 }
 
+avl_key_t avl_iter_current_key(avl_iter_t* iter)
+{
+    return iter->head->node->key;
+}
+
 static void add_link_node(avl_iter_t* iter, avl_node_t* anode)
 {
     if (anode)
@@ -67,6 +67,7 @@ typedef struct avl_iter_s {
 
 void avl_iter_begin( avl_iter_t* iter,avl_tree_t* tree);
 void* avl_iter_current(avl_iter_t* iter);
+avl_key_t avl_iter_current_key(avl_iter_t* iter);
 void avl_iter_increment(avl_iter_t* iter);
 int avl_iter_done(avl_iter_t* iter);
 void avl_iter_cleanup(avl_iter_t* iter); // call if end iteration early
@@ -22,6 +22,13 @@ END_LEGAL */
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#if defined(_WIN32)
+# include <windows.h>
+#else
+# include <pthread.h>
+#endif
 
 #include "xed-asmparse.h"
 
@@ -30,6 +37,12 @@ END_LEGAL */
 
 static xed_uint_t intel_asm_emits=0;
 
+/* bulk mode knobs */
+static char const* bulk_input_fn = 0;
+static char const* bulk_output_fn = 0;
+static xed_uint_t bulk_nthreads = 1;
+#define BULK_MAX_THREADS 256
+
 static xed_bool_t test_has_relbr(const xed_inst_t* p);
 static xed_bool_t has_relbr(xed_iclass_enum_t iclass);
 static xed_bool_t test_has_absbr(const xed_inst_t* p);
@@ -74,9 +87,14 @@ static xed_str_list_t* process_args(int argc, char** argv,
     // return value.  Also sets intel_asm_emits.
     
     const char* usage = "Usage: %s [-16|-32|-64] [--emit] [-v|-q] <assembly line>\n" 
+                        "       %s [-16|-32|-64] [--emit] [-v|-q] -f <file> [-j <threads>] [-o <output>]\n"
                         "\tThe assembly line can have semicolon separators " 
                         "to allow for multiple instructions.\n"
                         "\tThe --emit option changes output to Intel compiler __emit lines.\n"
+                        "\tThe -f option assembles a file with one or more instructions per\n"
+                        "\tline ('#' starts a comment). Errors are reported per line and do\n"
+                        "\tnot stop the run. With -o the encodings are written to <output>\n"
+                        "\tas raw bytes. -j splits the lines across threads.\n"
                         "\n\n";
     
     xed_str_list_t* string_list;
@@ -89,7 +107,7 @@ static xed_str_list_t* process_args(int argc, char** argv,
     int mode_found = 0;
     int first_arg = 1;
     if (argc<=1) {
-        asp_error_printf(usage, argv[0]);
+        asp_error_printf(usage, argv[0], argv[0]);
         exit(1);
     }
     *mode = 32;
@@ -142,8 +160,35 @@ static xed_str_list_t* process_args(int argc, char** argv,
             keep_going = 1;
             first_arg++;
         }
+        else if (strcmp("-f", argv[first_arg])== 0 && first_arg+1 < argc) {
+            bulk_input_fn = argv[first_arg+1];
+            keep_going = 1;
+            first_arg += 2;
+        }
+        else if (strcmp("-o", argv[first_arg])== 0 && first_arg+1 < argc) {
+            bulk_output_fn = argv[first_arg+1];
+            keep_going = 1;
+            first_arg += 2;
+        }
+        else if (strcmp("-j", argv[first_arg])== 0 && first_arg+1 < argc) {
+            bulk_nthreads = XED_STATIC_CAST(xed_uint_t,
+                                            atoi(argv[first_arg+1]));
+            if (bulk_nthreads == 0 || bulk_nthreads > BULK_MAX_THREADS) {
+                asp_error_printf("Bad thread count: %s\n", argv[first_arg+1]);
+                exit(1);
+            }
+            keep_going = 1;
+            first_arg += 2;
+        }
 
     }
+    if (bulk_input_fn) {
+        if (first_arg < argc) {
+            asp_error_printf("Cannot mix -f with an assembly line\n");
+            exit(1);
+        }
+        return 0;
+    }
     for(i=first_arg;i<argc;i++) {
         // add one for trailing space or null at end
         len = len + xed_strlen(argv[i]) + 1;
@@ -187,8 +232,7 @@ static void set_state(xed_state_t* dstate, xed_enc_line_parsed_t* v) {
         dstate->mmode=XED_MACHINE_MODE_LONG_64;
     }
     else {
-        asp_error_printf("Invalid mode: %d\n", v->mode);
-        exit(1);
+        asp_fail(v, "Invalid mode: %d\n", v->mode);
     }
 
 }
@@ -201,7 +245,7 @@ static xed_bool_t probe_iclass_string(const char *p1, const char *p2,
     xed_strncpy(result, p1, maxlen);
     xed_strncat(result, "_", maxlen);
     xed_strncat(result, p2, maxlen);
-    xed_iclass_enum_t valid_iclass = str2xed_iclass_enum_t(result);
+    xed_iclass_enum_t valid_iclass = asp_str2iclass(result);
     return (valid_iclass != XED_ICLASS_INVALID);
 }
 
@@ -245,8 +289,7 @@ static void process_prefixes(xed_enc_line_parsed_t* v,
             //FIXME: rexw
         }
         else {
-            asp_error_printf("Unhandled prefix: %s\n", q->s);
-            exit(1);
+            asp_fail(v, "Unhandled prefix: %s\n", q->s);
         }
         q = q->next;
     }
@@ -268,7 +311,8 @@ static const bcast_info_t bcast[] = {
     { 0, 0, 0} 
 };
 
-static void process_mem_decorator(slist_t* decos, xed_encoder_operand_t* operand, xed_uint_t* pos)
+static void process_mem_decorator(xed_enc_line_parsed_t* v, slist_t* decos,
+                                  xed_encoder_operand_t* operand, xed_uint_t* pos)
 {
 
     slist_t* d = decos;
@@ -290,66 +334,63 @@ static void process_mem_decorator(slist_t* decos, xed_encoder_operand_t* operand
     *pos = i;
     
     if (decos && !found_a_bcast_decorator) {
-        asp_error_printf("Bad memory decorator: ");
-        d = decos;
-        while (d) {
-            asp_error_printf("%s ", d->s);
-            d = d->next;
+        char buf[100] = { 0 };
+        for (d = decos; d; d = d->next) {
+            xed_strncat(buf, d->s, sizeof(buf));
+            xed_strncat(buf, " ", sizeof(buf));
         }
-        exit(1);
+        asp_fail(v, "Bad memory decorator: %s\n", buf);
     }
 }
 
-static void check_too_many_operands(int op_pos) {
+static void check_too_many_operands(xed_enc_line_parsed_t* v, int op_pos) {
     if (op_pos >= XED_ENCODER_OPERANDS_MAX) {
-        asp_error_printf("Too many operands\n");
-        exit(1);
+        asp_fail(v, "Too many operands\n");
     }
 }
 
-static int process_rc_sae(char const* s,xed_encoder_operand_t* operand, xed_uint_t* pos)
+static int process_rc_sae(xed_enc_line_parsed_t* v, char const* s,
+                          xed_encoder_operand_t* operand, xed_uint_t* pos)
 {
 #if defined(XED_SUPPORTS_AVX512)
     xed_uint_t i = *pos;
     if (strcmp("{RNE-SAE}",s)==0) {
-        check_too_many_operands(i+1);
+        check_too_many_operands(v, i+1);
         operand[i++] = xed_other(XED_OPERAND_ROUNDC,1);
         operand[i++] = xed_other(XED_OPERAND_SAE,1);
         *pos = i;
         return 1;
     }
     else if (strcmp("{RD-SAE}",s)==0) {
-        check_too_many_operands(i+1);
+        check_too_many_operands(v, i+1);
         operand[i++] = xed_other(XED_OPERAND_ROUNDC,2);
         operand[i++] = xed_other(XED_OPERAND_SAE,1);
         *pos = i;
         return 1;
     }
     else if (strcmp("{RU-SAE}",s)==0) {
-        check_too_many_operands(i+1);
+        check_too_many_operands(v, i+1);
         operand[i++] = xed_other(XED_OPERAND_ROUNDC,3);
         operand[i++] = xed_other(XED_OPERAND_SAE,1);
         *pos = i;
         return 1;
     }
     else if (strcmp("{RZ-SAE}",s)==0) {
-        check_too_many_operands(i+1);
+        check_too_many_operands(v, i+1);
         operand[i++] = xed_other(XED_OPERAND_ROUNDC,4);
         operand[i++] = xed_other(XED_OPERAND_SAE,1);
         *pos = i;
         return 1;
     }
     else if (strcmp("{SAE}",s)==0) {
-        check_too_many_operands(i);
+        check_too_many_operands(v, i);
         operand[i++] = xed_other(XED_OPERAND_SAE,1);
         *pos = i;
         return 1;
     }
 #endif
-    asp_error_printf("Unhandled decorator: %s\n",s);
     (void) operand; (void) pos;
-    exit(1);
-    return 0;
+    asp_fail(v, "Unhandled decorator: %s\n",s);
 }
 
 
@@ -520,23 +561,21 @@ static void process_operand(xed_enc_line_parsed_t* v,
     case OPND_REG: {
         xed_reg_enum_t reg = q->reg;
         if (reg == XED_REG_INVALID) {
-            asp_error_printf("Bad register: %s\n", q->s);
-            exit(1);
+            asp_fail(v, "Bad register: %s\n", q->s);
         }
 
-        check_too_many_operands(i);
+        check_too_many_operands(v, i);
         operands[i++] = xed_reg(reg);
         set_eosz(reg, eosz);
         set_mode_vec(reg, &(v->mode));
     }
         break;
     case OPND_DECORATOR: {
-        if (process_rc_sae(q->s, operands, &i))  {
-            check_too_many_operands(i);
+        if (process_rc_sae(v, q->s, operands, &i))  {
+            check_too_many_operands(v, i);
         }
         else {
-            asp_error_printf("Bad decorator: %s\n", q->s);
-            exit(1);
+            asp_fail(v, "Bad decorator: %s\n", q->s);
         }
     }
         break;
@@ -546,27 +585,26 @@ static void process_operand(xed_enc_line_parsed_t* v,
 
         if (has_relbr(v->iclass_e)) {
             asp_dbg_printf("The literal is treated as relbranch\n");
-            check_too_many_operands(i);
+            check_too_many_operands(v, i);
             operands[i++] = xed_relbr(literal_val, nbits);
         }
         else if (has_absbr(v->iclass_e)) {
             asp_dbg_printf("The literal is treated as absolute branch\n");
-            check_too_many_operands(i);
+            check_too_many_operands(v, i);
             operands[i++] = xed_absbr(literal_val, nbits);
         }
         else { // literal immediate
             if (*has_imm0 == 0) {
-                check_too_many_operands(i);
+                check_too_many_operands(v, i);
                 operands[i++] = xed_imm0(literal_val, nbits); //FIXME: cast or make imm0 signed?
                 *has_imm0 = 1;
             }
             else {
                 if (nbits != 8) {
-                    asp_error_printf(
+                    asp_fail(v,
                         "The second literal constant can only be 8 bit wide\n");
-                    exit(1);
                 }
-                check_too_many_operands(i);
+                check_too_many_operands(v, i);
                 operands[i++] = xed_imm1(XED_STATIC_CAST(xed_uint8_t, q->imm));
             }
         }
@@ -582,25 +620,23 @@ static void process_operand(xed_enc_line_parsed_t* v,
         xed_uint_t width_bits = q->mem.mem_bits;
 
         if (q->mem.base) 
-            base = str2xed_reg_enum_t(q->mem.base);
+            base = asp_str2reg(q->mem.base);
         if (q->mem.index) 
-            indx = str2xed_reg_enum_t(q->mem.index);
+            indx = asp_str2reg(q->mem.index);
         if (q->mem.seg) 
-            seg = str2xed_reg_enum_t(q->mem.seg);
+            seg = asp_str2reg(q->mem.seg);
         
         set_mode(base, &(v->mode));
         set_mode(indx, &(v->mode));
         set_mode_vec(indx, &(v->mode)); // for AVX512 gathers, scatters
-        check_too_many_operands(i);
+        check_too_many_operands(v, i);
         operands[i++] = xed_mem_gbisd(seg, base, indx, scale, disp, width_bits);
-        process_mem_decorator(q->decorators, operands, &i);
+        process_mem_decorator(v, q->decorators, operands, &i);
     }
         break;
     case OPND_FARPTR: {
         if (*has_imm0) {
-            asp_error_printf(
-                "Long pointer cannot follow immediate operand\n");
-            exit(1);
+            asp_fail(v, "Long pointer cannot follow immediate operand\n");
         }
         xed_uint16_t seg = (xed_uint16_t)q->farptr.seg_value;
         xed_uint32_t offset = (xed_uint32_t)q->farptr.offset_value;
@@ -611,15 +647,11 @@ static void process_operand(xed_enc_line_parsed_t* v,
 
         seg_bits = seg_bits < 16 ? 16 : seg_bits;
         if (seg_bits != 16) {
-            asp_error_printf(
-                "Segment value in far pointer must be 16 bits\n");
-            exit(1);
+            asp_fail(v, "Segment value in far pointer must be 16 bits\n");
         }
         
         if (offset_bits > 32) {
-            asp_error_printf(
-                "Far pointer offset must be either 16 or 32 bits");
-            exit(1);
+            asp_fail(v, "Far pointer offset must be either 16 or 32 bits\n");
         }
 
         if (offset_bits <= 16) 
@@ -628,18 +660,17 @@ static void process_operand(xed_enc_line_parsed_t* v,
             offset_bits = 32;
         *eosz = offset_bits;
         
-        check_too_many_operands(i);
+        check_too_many_operands(v, i);
         operands[i++] = xed_ptr(offset, offset_bits);
 
         /* segment is encoded as immediate and must follow offset */
-        check_too_many_operands(i);
+        check_too_many_operands(v, i);
         operands[i++] = xed_imm0(seg, seg_bits);
         *has_imm0 = 1;
     }
         break;
     default:
-        asp_error_printf("Bad operand encountered: %s", q->s);
-        exit(1);
+        asp_fail(v, "Bad operand encountered: %s\n", q->s);
     } // switch (q->type)
 
     //Add k-mask decorators as operands.
@@ -650,7 +681,7 @@ static void process_operand(xed_enc_line_parsed_t* v,
         for(j=0;kmasks[j];j++) {
             if (strcmp(kmasks[j],d->s)==0) {
                 xed_reg_enum_t kreg = XED_REG_K0 + j;
-                check_too_many_operands(i);
+                check_too_many_operands(v, i);
                 operands[i++] = xed_reg(kreg);
                 found_a_kmask = 1;
                 break;
@@ -663,37 +694,32 @@ static void process_operand(xed_enc_line_parsed_t* v,
 
 
 
-static xed_uint_t encode(xed_encoder_instruction_t* inst)
+static xed_uint_t encode(xed_enc_line_parsed_t* v,
+                         xed_encoder_instruction_t* inst,
+                         xed_uint8_t* itext)
 {
     xed_error_enum_t xed_error = XED_ERROR_NONE;
-    xed_bool_t convert_ok = 0;
-    xed_encoder_request_t enc_req;
-    xed_uint8_t itext[XED_MAX_INSTRUCTION_BYTES];
     unsigned int ilen = XED_MAX_INSTRUCTION_BYTES;
     unsigned int olen = 0;
 
-
-    xed_encoder_request_zero_set_mode(&enc_req, &(inst->mode));
-    convert_ok = xed_convert_to_encoder_request(&enc_req, inst);
-    if (!convert_ok) {
-        asp_error_printf("Conversion to encode request failed\n");
-        exit(1);
-    }
-    xed_error = xed_encode(&enc_req, itext, ilen, &olen);
+    xed_error = xed_encode_instruction(inst, itext, ilen, &olen);
     if (xed_error != XED_ERROR_NONE) {
-        asp_error_printf("Failed to encode input: %s\n",
-                xed_error_enum_t2str(xed_error));
-        exit(1);
+        asp_fail(v, "Failed to encode input: %s\n",
+                 xed_error_enum_t2str(xed_error));
     }
+    return olen;
+}
 
+static void print_encoding(xed_uint8_t const* itext, xed_uint_t olen)
+{
     if (intel_asm_emits)
         xed_print_intel_asm_emit(itext,olen);
     else 
         xed_print_bytes_pseudo_op(itext,olen);
-    return olen;
 }
 
-static void process_other_decorator(char const* s,
+static void process_other_decorator(xed_enc_line_parsed_t* v,
+                                    char const* s,
                                     xed_uint_t* noperand,
                                     xed_encoder_operand_t* operands)
 
@@ -708,7 +734,7 @@ static void process_other_decorator(char const* s,
     xed_uint_t i = *noperand;
     
     if (strcmp("{Z}",s) == 0) {
-        check_too_many_operands(i);
+        check_too_many_operands(v, i);
         operands[i++] = xed_other(XED_OPERAND_ZEROING,1);
     }
     else {
@@ -733,14 +759,13 @@ static void process_other_decorator(char const* s,
         }
 
         if (!found)  {
-            asp_error_printf("Unhandled decorator: %s\n",s);
-            exit(1);
+            asp_fail(v, "Unhandled decorator: %s\n",s);
         }
     }
 
     *noperand = i;
 #else
-    (void) s; (void) noperand; (void)operands;    
+    (void) v; (void) s; (void) noperand; (void)operands;    
 #endif
 
 }
@@ -900,7 +925,8 @@ static void revise_mnemonic(xed_enc_line_parsed_t *v, char* result, int maxlen)
     xed_strncpy(result, orig, maxlen);
 }
 
-static xed_uint_t encode_with_xed(xed_enc_line_parsed_t* v)
+/* Encode into itext (XED_MAX_INSTRUCTION_BYTES long), return the length */
+static xed_uint_t encode_with_xed(xed_enc_line_parsed_t* v, xed_uint8_t* itext)
 {
     xed_encoder_instruction_t inst;
     xed_state_t dstate;
@@ -911,8 +937,7 @@ static xed_uint_t encode_with_xed(xed_enc_line_parsed_t* v)
     xed_uint_t has_imm0 = 0;
 
     if (v->iclass_str == 0) {
-        asp_error_printf("Did not find an instruction\n");
-        exit(1);
+        asp_fail(v, "Did not find an instruction\n");
     }
 
     process_prefixes(v, &inst);
@@ -922,19 +947,18 @@ static xed_uint_t encode_with_xed(xed_enc_line_parsed_t* v)
        Use operand knowledge to adjust the mnemonic if needed */
     char revised_mnemonic[100] = { 0 };
     revise_mnemonic(v, revised_mnemonic, sizeof(revised_mnemonic));
-    v->iclass_e = str2xed_iclass_enum_t(revised_mnemonic);
+    v->iclass_e = asp_str2iclass(revised_mnemonic);
 
     // handle operands
     q = v->opnds;
     while(q) {
         process_operand(v, q, &noperand, operand_array, &has_imm0, &eosz);
-        check_too_many_operands(noperand);
+        check_too_many_operands(v, noperand);
         q = q->next;
     }
 
     if (v->iclass_e == XED_ICLASS_INVALID) {
-        asp_error_printf("Bad instruction name: '%s'\n", revised_mnemonic);
-        exit(1);
+        asp_fail(v, "Bad instruction name: '%s'\n", revised_mnemonic);
     }
 
     asp_dbg_printf("ICLASS [%s]\n", xed_iclass_enum_t2str(v->iclass_e));
@@ -944,8 +968,8 @@ static xed_uint_t encode_with_xed(xed_enc_line_parsed_t* v)
     while(q) {
         slist_t* r = q->decorators;
         while(r) {
-            process_other_decorator(r->s, &noperand, operand_array);
-            check_too_many_operands(noperand);
+            process_other_decorator(v, r->s, &noperand, operand_array);
+            check_too_many_operands(v, noperand);
             r = r->next;
         }
         q = q->next;
@@ -964,7 +988,7 @@ static xed_uint_t encode_with_xed(xed_enc_line_parsed_t* v)
     asp_dbg_printf("#MODE=%d, EOSZ=%d\n", v->mode, eosz);
     set_state(&dstate, v);
     xed_inst(&inst, dstate, v->iclass_e, eosz, noperand, operand_array);
-    return encode(&inst);
+    return encode(v, &inst, itext);
 }
 
 /* Return true if the instruction accepts relative branch as an operand */
@@ -1011,6 +1035,7 @@ static xed_bool_t has_absbr(xed_iclass_enum_t iclass) {
 
 static void setup(void) {
     memset(brdisp_table, 0, sizeof(xed_bool_t)*XED_ICLASS_LAST);
+    asp_init_name_lookup();
     
     for (unsigned i = 0; i < XED_MAX_INST_TABLE_NODES; i++) {
         const xed_inst_t *inst = xed_inst_table_base() + i;
@@ -1023,6 +1048,225 @@ static void setup(void) {
     }
 }
 
+////////////////////////////////////////////////////////////////////////////
+// bulk mode: assemble a mapped file in batches. Each worker parses its
+// share of a batch with nodes from its own arena, and each line's error
+// is kept with the line. After a batch, the encodings are appended in
+// order to one output buffer, errors are reported, and the arenas are
+// reset.
+
+#define BULK_BATCH (64*1024)
+
+typedef struct {
+    char const* text;   // points into the mapped file, not null terminated
+    xed_uint32_t len;
+    xed_uint32_t line;  // 1-based
+    xed_uint32_t olen;
+    char const* error;  // from the worker arena, valid until the reset
+    xed_uint8_t itext[XED_MAX_INSTRUCTION_BYTES];
+} bulk_stmt_t;
+
+typedef struct {
+    bulk_stmt_t* stmts;
+    xed_uint_t n;
+    xed_uint_t mode;
+    asp_arena_t arena;
+} bulk_worker_t;
+
+typedef struct {
+    char const* p;      // next unread byte
+    char const* end;
+    xed_uint32_t line;  // line number of p
+} bulk_cursor_t;
+
+/* Find the next statement. Statements are separated by newlines or ';',
+   and a '#' comments out the rest of the line. Returns 0 at the end. */
+static xed_bool_t bulk_next_stmt(bulk_cursor_t* c, bulk_stmt_t* st)
+{
+    while (c->p < c->end) {
+        char const* b = c->p;
+        char const* e = b;
+        xed_uint32_t line = c->line;
+        while (e < c->end && *e != '\n' && *e != ';' && *e != '#')
+            e++;
+        c->p = e;
+        if (c->p < c->end && *c->p == '#')
+            while (c->p < c->end && *c->p != '\n')
+                c->p++;
+        if (c->p < c->end) {
+            if (*c->p == '\n')
+                c->line++;
+            c->p++;
+        }
+        while (b < e && isspace((unsigned char)*b))
+            b++;
+        while (e > b && isspace((unsigned char)e[-1]))
+            e--;
+        if (e > b) {
+            st->text = b;
+            st->len = XED_STATIC_CAST(xed_uint32_t, e - b);
+            st->line = line;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void bulk_assemble_stmt(bulk_worker_t* w, bulk_stmt_t* st)
+{
+    jmp_buf on_error;
+    xed_enc_line_parsed_t* v = asp_get_xed_enc_node_arena(&w->arena);
+    v->mode = XED_STATIC_CAST(int, w->mode);
+    v->input = asp_arena_strndup(&w->arena, st->text, st->len);
+    v->on_error = &on_error;
+    st->olen = 0;
+    st->error = 0;
+    if (setjmp(on_error) == 0) {
+        asp_parse_line(v);
+        st->olen = encode_with_xed(v, st->itext);
+    }
+    else
+        st->error = v->error;
+}
+
+static void bulk_assemble_stmts(bulk_worker_t* w)
+{
+    xed_uint_t i;
+    for (i = 0; i < w->n; i++)
+        bulk_assemble_stmt(w, w->stmts + i);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI bulk_thread(LPVOID arg)
+{
+    bulk_assemble_stmts((bulk_worker_t*)arg);
+    return 0;
+}
+#else
+static void* bulk_thread(void* arg)
+{
+    bulk_assemble_stmts((bulk_worker_t*)arg);
+    return 0;
+}
+#endif
+
+static void bulk_run_workers(bulk_worker_t* workers, xed_uint_t nthreads)
+{
+    xed_uint_t i;
+    if (nthreads == 1) {
+        bulk_assemble_stmts(workers);
+        return;
+    }
+    {
+#if defined(_WIN32)
+        HANDLE tids[BULK_MAX_THREADS];
+        for (i = 0; i < nthreads; i++) {
+            tids[i] = CreateThread(0, 0, bulk_thread, workers + i, 0, 0);
+            assert(tids[i] != 0);
+        }
+        WaitForMultipleObjects(nthreads, tids, TRUE, INFINITE);
+        for (i = 0; i < nthreads; i++)
+            CloseHandle(tids[i]);
+#else
+        pthread_t tids[BULK_MAX_THREADS];
+        for (i = 0; i < nthreads; i++) {
+            int r = pthread_create(tids + i, 0, bulk_thread, workers + i);
+            assert(r == 0);
+            (void)r;
+        }
+        for (i = 0; i < nthreads; i++)
+            pthread_join(tids[i], 0);
+#endif
+    }
+}
+
+static int bulk_assemble(xed_uint_t mode, int verbose)
+{
+    void* region = 0;
+    unsigned int region_len = 0;
+    bulk_cursor_t cursor;
+    bulk_stmt_t* stmts = 0;
+    bulk_worker_t workers[BULK_MAX_THREADS];
+    xed_uint8_t* out = 0;
+    size_t out_len = 0;
+    size_t out_cap = 0;
+    xed_uint_t nthreads = bulk_nthreads;
+    xed_uint_t i = 0;
+    xed_uint64_t nstmts = 0;
+    xed_uint64_t nerrors = 0;
+
+    xed_map_region(bulk_input_fn, &region, &region_len);
+    cursor.p = (char const*)region;
+    cursor.end = cursor.p + region_len;
+    cursor.line = 1;
+
+    stmts = (bulk_stmt_t*)malloc(BULK_BATCH * sizeof(bulk_stmt_t));
+    assert(stmts != 0);
+    for (i = 0; i < nthreads; i++)
+        asp_arena_init(&workers[i].arena);
+
+    while (1) {
+        xed_uint_t n = 0;
+        xed_uint_t start = 0;
+        while (n < BULK_BATCH && bulk_next_stmt(&cursor, stmts + n))
+            n++;
+        if (n == 0)
+            break;
+
+        // contiguous slices, so the nodes of a line stay in one arena
+        for (i = 0; i < nthreads; i++) {
+            xed_uint_t stop = XED_STATIC_CAST(xed_uint_t,
+                                  (XED_STATIC_CAST(xed_uint64_t, n) * (i + 1)) / nthreads);
+            workers[i].stmts = stmts + start;
+            workers[i].n = stop - start;
+            workers[i].mode = mode;
+            start = stop;
+        }
+        bulk_run_workers(workers, nthreads);
+
+        if (out_len + n * XED_MAX_INSTRUCTION_BYTES > out_cap) {
+            out_cap = 2 * (out_len + n * XED_MAX_INSTRUCTION_BYTES);
+            out = (xed_uint8_t*)realloc(out, out_cap);
+            assert(out != 0);
+        }
+        for (i = 0; i < n; i++) {
+            bulk_stmt_t* st = stmts + i;
+            if (st->error) {
+                fprintf(stderr, "ERROR: line %u: %s", st->line, st->error);
+                nerrors++;
+                continue;
+            }
+            memcpy(out + out_len, st->itext, st->olen);
+            if (!bulk_output_fn)
+                print_encoding(out + out_len, st->olen);
+            out_len += st->olen;
+        }
+        nstmts += n;
+        for (i = 0; i < nthreads; i++)
+            asp_arena_reset(&workers[i].arena);
+    }
+
+    if (bulk_output_fn) {
+        FILE* f = fopen(bulk_output_fn, "wb");
+        if (f == 0 || fwrite(out, 1, out_len, f) != out_len) {
+            asp_error_printf("Could not write %s\n", bulk_output_fn);
+            exit(1);
+        }
+        fclose(f);
+    }
+    if (verbose > 0) {
+        printf("#lines = " XED_FMT_LU "\n", nstmts);
+        printf("#errors = " XED_FMT_LU "\n", nerrors);
+        printf("#nbytes = " XED_FMT_SIZET "\n", out_len);
+    }
+
+    for (i = 0; i < nthreads; i++)
+        asp_arena_free(&workers[i].arena);
+    free(stmts);
+    free(out);
+    return nerrors ? 1 : 0;
+}
+
 int main(int argc, char** argv)
 {
     int verbose  = 1;
@@ -1035,11 +1279,17 @@ int main(int argc, char** argv)
     xed_tables_init();
 
     p = string_list = process_args(argc, argv, &mode, &verbose);
+    if (bulk_input_fn) {
+        // the per-line notes would interleave across threads
+        asp_set_verbosity(0);
+        return bulk_assemble(mode, verbose);
+    }
     asp_set_verbosity(verbose);
 
     while(p) {
         xed_uint_t olen = 0;
         xed_enc_line_parsed_t* v = 0;
+        xed_uint8_t itext[XED_MAX_INSTRUCTION_BYTES];
 
         v = asp_get_xed_enc_node();
         v->mode = mode;
@@ -1056,7 +1306,8 @@ int main(int argc, char** argv)
         if (verbose > 1)
             asp_print_parsed_line(v);
 
-        olen = encode_with_xed(v);
+        olen = encode_with_xed(v, itext);
+        print_encoding(itext, olen);
         length += olen;
 
         asp_delete_xed_enc_line_parsed_t(v);
@@ -32,14 +32,15 @@ END_LEGAL */
 static int asp_dbg_verbosity = 1;
 
 /* PROTOTYPES */
-static char* asp_strdup(const char* s);
+static char* asp_strdup(xed_enc_line_parsed_t* v, const char* s);
+static void asp_free(xed_enc_line_parsed_t* v, void* p);
 static void upcase(char* s);
 static void delete_slist_t(slist_t* s);
-static slist_t* get_slist_node(void);
+static slist_t* get_slist_node(xed_enc_line_parsed_t* v);
 static void clean_out_memparse_rec_t(memparse_rec_t* p);
 static void delete_opnd_list_t(opnd_list_t* s);
-static opnd_list_t* get_opnd_list_node(void);
-static void add_decorator(opnd_list_t* onode, char* d);
+static opnd_list_t* get_opnd_list_node(xed_enc_line_parsed_t* v);
+static void add_decorator(xed_enc_line_parsed_t* v, opnd_list_t* onode, char* d);
 static void grab_prefixes(char**p, xed_enc_line_parsed_t* v);
 static void study_prefixes(xed_enc_line_parsed_t* v);
 static void grab_inst(char**p, xed_enc_line_parsed_t* v);
@@ -48,13 +49,16 @@ static void grab_operand(char**p, xed_enc_line_parsed_t* v);
 static int isreg(char* s);
 static int isdecorator(char* s);
 static int64_t letter_cvt(char a, char base);
-static int asm_isnumber(char* s, int64_t* onum, int arg_negative);
+static int asm_isnumber(xed_enc_line_parsed_t* v, char* s, int64_t* onum,
+                        int arg_negative);
 static int ismemref(char* s);
 static int valid_decorator(char const* s);
-static int grab_decorator(char* s, unsigned int pos, char** optr);
+static int grab_decorator(xed_enc_line_parsed_t* v, char* s, unsigned int pos,
+                          char** optr);
 static void parse_reg(xed_enc_line_parsed_t* v, char* s, opnd_list_t* onode);
-static void parse_decorator(char* s, opnd_list_t* onode);
-static void parse_memref(char* s, opnd_list_t* onode);
+static void parse_decorator(xed_enc_line_parsed_t* v, char* s,
+                            opnd_list_t* onode);
+static void parse_memref(xed_enc_line_parsed_t* v, char* s, opnd_list_t* onode);
 static void refine_operand(xed_enc_line_parsed_t* v, char* s);
 static void refine_operands(xed_enc_line_parsed_t* v);
 static unsigned int skip_spaces(char *s, unsigned int offset);
@@ -62,10 +66,82 @@ static unsigned int skip_spaces(char *s, unsigned int offset);
 /////////////////////////
 
 
-static char* asp_strdup(char const* s) {
+#define ASP_ARENA_ALIGN 16
+#define ASP_ARENA_BLOCK (64*1024)
+/* keeps the block payload aligned */
+#define ASP_ARENA_HDR ((sizeof(asp_arena_block_t) + ASP_ARENA_ALIGN - 1) & \
+                       ~(size_t)(ASP_ARENA_ALIGN - 1))
+
+void asp_arena_init(asp_arena_t* a) {
+    a->head = 0;
+    a->cur = 0;
+    a->used = 0;
+}
+
+static asp_arena_block_t* asp_arena_new_block(size_t size) {
+    asp_arena_block_t* b = (asp_arena_block_t*)malloc(ASP_ARENA_HDR + size);
+    assert(b != 0);
+    b->next = 0;
+    b->size = size;
+    return b;
+}
+
+void* asp_arena_alloc(asp_arena_t* a, size_t n) {
+    n = (n + ASP_ARENA_ALIGN - 1) & ~(size_t)(ASP_ARENA_ALIGN - 1);
+    if (a->cur == 0) {
+        if (a->head == 0)
+            a->head = asp_arena_new_block(n > ASP_ARENA_BLOCK ? n : ASP_ARENA_BLOCK);
+        a->cur = a->head;
+        a->used = 0;
+    }
+    if (a->used + n > a->cur->size) {
+        asp_arena_block_t* b = a->cur->next;
+        if (b == 0 || b->size < n) {
+            // splice a fresh block in after the current one
+            b = asp_arena_new_block(n > ASP_ARENA_BLOCK ? n : ASP_ARENA_BLOCK);
+            b->next = a->cur->next;
+            a->cur->next = b;
+        }
+        a->cur = b;
+        a->used = 0;
+    }
+    a->used += n;
+    return (char*)a->cur + ASP_ARENA_HDR + a->used - n;
+}
+
+char* asp_arena_strndup(asp_arena_t* a, const char* s, size_t n) {
+    char* p = (char*)asp_arena_alloc(a, n + 1);
+    memcpy(p, s, n);
+    p[n] = 0;
+    return p;
+}
+
+void asp_arena_reset(asp_arena_t* a) {
+    a->cur = a->head;
+    a->used = 0;
+}
+
+void asp_arena_free(asp_arena_t* a) {
+    asp_arena_block_t* b = a->head;
+    while (b) {
+        asp_arena_block_t* t = b->next;
+        free(b);
+        b = t;
+    }
+    asp_arena_init(a);
+}
+
+static char* asp_strdup(xed_enc_line_parsed_t* v, char const* s) {
+    if (v->arena)
+        return asp_arena_strndup(v->arena, s, xed_strlen(s));
     return xed_strdup(s);
 }
 
+static void asp_free(xed_enc_line_parsed_t* v, void* p) {
+    if (v->arena == 0)
+        free(p);
+}
+
 /* Verbosity levels:
    0 - only errors and end result
    1 - informational messages about implicit decision made by encoder,
@@ -102,10 +178,85 @@ void asp_error_printf(const char* format, ...) {
     va_end(args);
 }
 
+/* Abandon the line. In bulk mode the message is kept in v->error for the
+   caller to report in order, otherwise print it and exit. */
+void asp_fail(xed_enc_line_parsed_t* v, const char* format, ...) {
+    char buf[200];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (v->on_error) {
+        v->error = asp_strdup(v, buf);
+        longjmp(*v->on_error, 1);
+    }
+    fprintf(stderr, "ERROR: %s", buf);
+    exit(1);
+}
+
 static void upcase(char* s) {
     (void)xed_upcase_buf(s);
 }
 
+/* Sorted name indexes for the iclass and register lookups. The
+   generated str2xed_*_enum_t() functions scan their tables linearly and
+   the mnemonic revision probes several spellings per line. */
+typedef struct {
+    char const* name;
+    unsigned int value;
+} asp_name_t;
+
+static asp_name_t asp_iclass_names[XED_ICLASS_LAST];
+static asp_name_t asp_reg_names[XED_REG_LAST];
+
+static int asp_name_cmp(const void* a, const void* b) {
+    asp_name_t const* x = (asp_name_t const*)a;
+    asp_name_t const* y = (asp_name_t const*)b;
+    int c = strcmp(x->name, y->name);
+    if (c == 0) // keep the first of any duplicates first, like the scan
+        return (x->value > y->value) - (x->value < y->value);
+    return c;
+}
+
+static unsigned int asp_name_lookup(asp_name_t const* names, unsigned int n,
+                                    char const* s, unsigned int notfound) {
+    unsigned int lo = 0, hi = n;
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        if (strcmp(names[mid].name, s) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < n && strcmp(names[lo].name, s) == 0)
+        return names[lo].value;
+    return notfound;
+}
+
+void asp_init_name_lookup(void) {
+    unsigned int i;
+    for (i = 0; i < XED_ICLASS_LAST; i++) {
+        asp_iclass_names[i].name = xed_iclass_enum_t2str((xed_iclass_enum_t)i);
+        asp_iclass_names[i].value = i;
+    }
+    qsort(asp_iclass_names, XED_ICLASS_LAST, sizeof(asp_name_t), asp_name_cmp);
+    for (i = 0; i < XED_REG_LAST; i++) {
+        asp_reg_names[i].name = xed_reg_enum_t2str((xed_reg_enum_t)i);
+        asp_reg_names[i].value = i;
+    }
+    qsort(asp_reg_names, XED_REG_LAST, sizeof(asp_name_t), asp_name_cmp);
+}
+
+xed_iclass_enum_t asp_str2iclass(char const* s) {
+    return (xed_iclass_enum_t)asp_name_lookup(asp_iclass_names, XED_ICLASS_LAST,
+                                              s, XED_ICLASS_INVALID);
+}
+
+xed_reg_enum_t asp_str2reg(char const* s) {
+    return (xed_reg_enum_t)asp_name_lookup(asp_reg_names, XED_REG_LAST,
+                                           s, XED_REG_INVALID);
+}
+
 
 static void delete_slist_t(slist_t* s) {
     slist_t* p = s;
@@ -118,8 +269,12 @@ static void delete_slist_t(slist_t* s) {
     }
 }
 
-static slist_t* get_slist_node(void) {
-    slist_t* node = (slist_t*)malloc(sizeof(slist_t));
+static slist_t* get_slist_node(xed_enc_line_parsed_t* v) {
+    slist_t* node;
+    if (v->arena)
+        node = (slist_t*)asp_arena_alloc(v->arena, sizeof(slist_t));
+    else
+        node = (slist_t*)malloc(sizeof(slist_t));
     assert(node != 0);
     node->s = 0;
     node->next = 0;
@@ -166,7 +321,17 @@ xed_enc_line_parsed_t* asp_get_xed_enc_node(void) {
     return v;
 }
 
+xed_enc_line_parsed_t* asp_get_xed_enc_node_arena(asp_arena_t* a) {
+    xed_enc_line_parsed_t*  v = (xed_enc_line_parsed_t*)
+                           asp_arena_alloc(a, sizeof(xed_enc_line_parsed_t));
+    memset(v, 0, sizeof(xed_enc_line_parsed_t));
+    v->arena = a;
+    return v;
+}
+
 void asp_delete_xed_enc_line_parsed_t(xed_enc_line_parsed_t* v) {
+    if (v->arena) // released by asp_arena_reset()
+        return;
     if (v->iclass_str)
         free(v->iclass_str);
     if (v->input) 
@@ -178,16 +343,20 @@ void asp_delete_xed_enc_line_parsed_t(xed_enc_line_parsed_t* v) {
     free(v);
 }
 
-static opnd_list_t* get_opnd_list_node(void) {
-    opnd_list_t* p  = (opnd_list_t*)malloc(sizeof(opnd_list_t));
+static opnd_list_t* get_opnd_list_node(xed_enc_line_parsed_t* v) {
+    opnd_list_t* p;
+    if (v->arena)
+        p = (opnd_list_t*)asp_arena_alloc(v->arena, sizeof(opnd_list_t));
+    else
+        p = (opnd_list_t*)malloc(sizeof(opnd_list_t));
     assert(p != 0);
     memset(p, 0, sizeof(opnd_list_t));
     p->type = OPND_INVALID;
     return p;
 }
 
-static void add_decorator(opnd_list_t* onode, char* d) {
-    slist_t* dnode = get_slist_node();
+static void add_decorator(xed_enc_line_parsed_t* v, opnd_list_t* onode, char* d) {
+    slist_t* dnode = get_slist_node(v);
     dnode->s = d;
     dnode->next = onode->decorators;
     onode->decorators = dnode;
@@ -260,7 +429,7 @@ static void grab_prefixes(char**p, xed_enc_line_parsed_t* v)
                                "LOCK",
                                "REP", "REPE", "REPNE", 
                                0 };
-    char* h = asp_strdup(*p);
+    char* h = asp_strdup(v, *p);
     char* q = h;
     char* r = h;
     
@@ -286,8 +455,8 @@ static void grab_prefixes(char**p, xed_enc_line_parsed_t* v)
                 found = 1;
                 //grab the string, pointed to by r
                 asp_dbg_printf("PREFIX [%s]\n",r);
-                node = get_slist_node();
-                node->s = asp_strdup(r);
+                node = get_slist_node(v);
+                node->s = asp_strdup(v, r);
                 if (v->prefixes) 
                     node->next = v->prefixes;
                 v->prefixes = node;
@@ -303,7 +472,7 @@ static void grab_prefixes(char**p, xed_enc_line_parsed_t* v)
 
     // r-h is the distance in the copy of the string we've advanced through so far.
     *p = *p + (r-h);
-    free(h);
+    asp_free(v, h);
 }
 
 static void grab_inst(char**p, xed_enc_line_parsed_t* v)
@@ -319,7 +488,7 @@ static void grab_inst(char**p, xed_enc_line_parsed_t* v)
         }
         q++;
     }
-    v->iclass_str = asp_strdup(*p);
+    v->iclass_str = asp_strdup(v, *p);
     /* Note that it is not the final iclass as it may require mangling */
     asp_dbg_printf("MNEMONIC [%s]\n",v->iclass_str);
     *p = q;
@@ -359,8 +528,8 @@ static void grab_operand(char**p, xed_enc_line_parsed_t* v)
         }
     }
     asp_dbg_printf("OPERAND: [%s]\n", r);
-    node = get_slist_node();
-    node->s = asp_strdup(r);
+    node = get_slist_node(v);
+    node->s = asp_strdup(v, r);
     if (v->operands) 
         node->next = v->operands;
     v->operands = node;
@@ -448,7 +617,7 @@ static int isdecorator(char* s) {
 }
 
 /* Return true if s matches pattern "num:num" */
-static int islongptr(char *s) {
+static int islongptr(xed_enc_line_parsed_t* v, char *s) {
     if (!s)
         return 0;
     /* skip optional "far" */
@@ -470,8 +639,8 @@ static int islongptr(char *s) {
     char *second = s + column_pos + 1;
     s[column_pos] = '\0'; // temporarily split the string
     int64_t unused = 0;
-    int res = asm_isnumber(first, &unused, 0) 
-              && asm_isnumber(second, &unused, 0); // both parts are numbers
+    int res = asm_isnumber(v, first, &unused, 0) 
+              && asm_isnumber(v, second, &unused, 0); // both parts are numbers
     s[column_pos] = ':'; // restore the separator
     return res;
 }
@@ -481,7 +650,8 @@ static int64_t letter_cvt(char a, char base) {
 }
 
 
-static int asm_isnumber(char* s, int64_t* onum, int arg_negative) {
+static int asm_isnumber(xed_enc_line_parsed_t* v, char* s, int64_t* onum,
+                        int arg_negative) {
     // return 1/0 if the string s is a number, and store the number in
     // onum. Handles base10, binary (0b prefix), octal (0 prefix) and hex
     // (0x prefix) number strings.
@@ -567,8 +737,7 @@ static int asm_isnumber(char* s, int64_t* onum, int arg_negative) {
         asp_dbg_printf("IMM value 0x%016llx\n",val);
         if (negative)  {
             if ((val >> 63ULL) == 1) {
-                asp_error_printf("Bad immediate operand - too big to be negative: %s\n",s);
-                exit(1);
+                asp_fail(v, "Bad immediate operand - too big to be negative: %s\n",s);
             }
             else {
                 val  = - val;  // FIXME: 2018-11-30 wcvt. error negeating unsigned value...
@@ -630,7 +799,8 @@ static int valid_decorator(char const* s) {
     }
     return 0;
 }
-static int grab_decorator(char* s, unsigned int pos, char** optr)
+static int grab_decorator(xed_enc_line_parsed_t* v, char* s, unsigned int pos,
+                          char** optr)
 {
     char tbuf[BLEN];
     int tpos=0;
@@ -646,12 +816,11 @@ static int grab_decorator(char* s, unsigned int pos, char** optr)
             if (*p == '}') {
                 tbuf[tpos]=0;
                 if (valid_decorator(tbuf)) {
-                    *optr = asp_strdup(tbuf);
+                    *optr = asp_strdup(v, tbuf);
                     return (int)(pos+1);
                 }
                 else {
-                    asp_error_printf("Bad decorator: %s\n", tbuf);
-                    exit(1);
+                    asp_fail(v, "Bad decorator: %s\n", tbuf);
                 }
             }
         }
@@ -663,9 +832,8 @@ static int grab_decorator(char* s, unsigned int pos, char** optr)
     }
     *optr = 0;
     if (start) {  // we started something but didn't finish it.  
-        asp_error_printf("Bad decorator: %s\n", tbuf);
-        exit(1);
-        return -1; //notreached
+        tbuf[tpos] = 0;
+        asp_fail(v, "Bad decorator: %s\n", tbuf);
     }
     return 0;
 }
@@ -684,9 +852,9 @@ static void parse_reg(xed_enc_line_parsed_t* v, char* s, opnd_list_t* onode)
     }
     tbuf[i]=0;
     asp_dbg_printf("REGISTER: %s\n",tbuf);
-    onode->s = asp_strdup(tbuf);
+    onode->s = asp_strdup(v, tbuf);
     onode->type = OPND_REG;
-    onode->reg = str2xed_reg_enum_t(onode->s);
+    onode->reg = asp_str2reg(onode->s);
 
     if (onode->reg >= XED_REG_CR0 && onode->reg <= XED_REG_CR15) {
         v->seen_cr = 1;
@@ -699,7 +867,7 @@ static void parse_reg(xed_enc_line_parsed_t* v, char* s, opnd_list_t* onode)
     while (i<len && s[i] == '{') {
         char* d = 0;
         int r;
-        r = grab_decorator(s,i, &d);
+        r = grab_decorator(v, s, i, &d);
 
         if (r<0) {
             asp_error_printf("Decorator parsing error\n");
@@ -708,7 +876,7 @@ static void parse_reg(xed_enc_line_parsed_t* v, char* s, opnd_list_t* onode)
         i = (unsigned int)r;
         if (d)  {
             asp_dbg_printf("DECORATOR: %s\n",d);
-            add_decorator(onode,d);
+            add_decorator(v, onode, d);
         }
         if (d==0)
             break;
@@ -716,7 +884,8 @@ static void parse_reg(xed_enc_line_parsed_t* v, char* s, opnd_list_t* onode)
 }
 
 
-static void parse_decorator(char* s, opnd_list_t* onode)
+static void parse_decorator(xed_enc_line_parsed_t* v, char* s,
+                            opnd_list_t* onode)
 {
     unsigned int i=0;
     unsigned int len=0;
@@ -727,7 +896,7 @@ static void parse_decorator(char* s, opnd_list_t* onode)
     while (i<len && s[i] == '{') {
         char* d = 0;
         int r;
-        r = grab_decorator(s,i, &d);
+        r = grab_decorator(v, s, i, &d);
 
         if (r<0) {
             asp_error_printf("DECORATOR PARSING ERROR\n");
@@ -741,20 +910,18 @@ static void parse_decorator(char* s, opnd_list_t* onode)
                 //add_decorator(onode,d);
             }
             else  {
-                asp_error_printf("Too many lone decorators %s\n",s);
-                exit(1);
+                asp_fail(v, "Too many lone decorators %s\n",s);
             }
         }
         if (d==0)
             break;
     }
     if (onode->s == 0) {
-        asp_dbg_printf("No decorators: %s\n",s);
-        exit(1);
+        asp_fail(v, "No decorators: %s\n",s);
     }
 }
 
-static void parse_memref(char* s, opnd_list_t* onode)
+static void parse_memref(xed_enc_line_parsed_t* v, char* s, opnd_list_t* onode)
 {
     // [ seg:reg + index * [1,2,4,8]  +/- disp ]
     memparse_rec_t r = { 0 };
@@ -807,7 +974,7 @@ static void parse_memref(char* s, opnd_list_t* onode)
             plusses++;
             tbuf[p++]=0;
             p=0;
-            q = asp_strdup(tbuf);
+            q = asp_strdup(v, tbuf);
             if (r.base && r.index)
                 r.scale=q;
             else if (r.base)
@@ -820,7 +987,7 @@ static void parse_memref(char* s, opnd_list_t* onode)
             r.minus++;
             tbuf[p++]=0;
             p=0;
-            q = asp_strdup(tbuf);
+            q = asp_strdup(v, tbuf);
             if (r.index)
                 r.scale=q;
             else
@@ -830,30 +997,29 @@ static void parse_memref(char* s, opnd_list_t* onode)
             tbuf[p++]=0;
             p=0;
             if (r.seg)
-                free(r.seg);
-            r.seg = asp_strdup(tbuf);
+                asp_free(v, r.seg);
+            r.seg = asp_strdup(v, tbuf);
         }
         else if (stmp[i] == '*') { // can end index
             tbuf[p++]=0;
             p=0;
             last_star=1;
             if (r.index)
-                free(r.index);
-            r.index=asp_strdup(tbuf);
+                asp_free(v, r.index);
+            r.index=asp_strdup(v, tbuf);
             continue;  // skip loop bottom
         }
         else if (stmp[i] == ']') {  // can end base, index, scale or disp
             int start_digit;
             tbuf[p++]=0;
             p=0;
-            q = asp_strdup(tbuf);
+            q = asp_strdup(v, tbuf);
             start_digit = isdigit(q[0]);
             if (start_digit && (r.scale || r.minus || plusses==2 || last_star==0))  {
                 r.disp = q;
                     
-                if (!asm_isnumber(q, &r.ndisp, r.minus)) {
-                    asp_error_printf("Bad displacement: %s\n", q);
-                    exit(1);
+                if (!asm_isnumber(v, q, &r.ndisp, r.minus)) {
+                    asp_fail(v, "Bad displacement: %s\n", q);
                 }
             }
             else if (last_star && start_digit)
@@ -863,8 +1029,7 @@ static void parse_memref(char* s, opnd_list_t* onode)
             else if (r.index==0 && start_digit==0)
                 r.index=q;
             else {
-                asp_error_printf("Internal error parsing memory operand\n");
-                exit(1); // FIXME: better error handling
+                asp_fail(v, "Internal error parsing memory operand\n");
             }
             i++; // skip over ']'
             break; // done parsing memref
@@ -874,8 +1039,7 @@ static void parse_memref(char* s, opnd_list_t* onode)
         }
 
         else {
-            asp_error_printf("Internal error parsing SIB\n");
-            exit(1); // FIXME: better error handling
+            asp_fail(v, "Internal error parsing SIB\n");
         }
         // loop bottom
         last_star=0;
@@ -884,7 +1048,7 @@ static void parse_memref(char* s, opnd_list_t* onode)
     while (i<r.len && stmp[i] == '{') {
         char* d = 0;
         int rr;
-        rr = grab_decorator(stmp,i, &d);
+        rr = grab_decorator(v, stmp, i, &d);
         if (rr<0) {
             asp_error_printf("Decorator parsing error\n");
             break;
@@ -893,7 +1057,7 @@ static void parse_memref(char* s, opnd_list_t* onode)
         
         if (d)  {
             asp_dbg_printf("DECORATOR: %s\n",d);
-            add_decorator(onode, d);
+            add_decorator(v, onode, d);
         }
         if (d==0)
             break;
@@ -907,8 +1071,7 @@ static void parse_memref(char* s, opnd_list_t* onode)
             }
         }
         if (!found) {
-            asp_error_printf("bad scale: %s\n",r.scale);
-            exit(1);
+            asp_fail(v, "bad scale: %s\n",r.scale);
         }
     }
 
@@ -927,7 +1090,8 @@ static void parse_memref(char* s, opnd_list_t* onode)
 }
 
 /* Extract semantic values from string: "far number:number" */
-static void parse_long_pointer(char* s, opnd_list_t* onode)
+static void parse_long_pointer(xed_enc_line_parsed_t* v, char* s,
+                               opnd_list_t* onode)
 {
     /* skip optional "far" part */
     if (s[0] == 'F' && s[1] == 'A' && s[2] == 'R') {
@@ -947,8 +1111,8 @@ static void parse_long_pointer(char* s, opnd_list_t* onode)
     char *second = s + column_pos + 1;
     s[column_pos] = '\0'; // split the string
     int64_t first_num, second_num;
-    asm_isnumber(first, &first_num, 0);
-    asm_isnumber(second, &second_num, 0);
+    asm_isnumber(v, first, &first_num, 0);
+    asm_isnumber(v, second, &second_num, 0);
 
     onode->farptr.seg = s;
     onode->farptr.offset = s + column_pos + 1;
@@ -959,7 +1123,7 @@ static void parse_long_pointer(char* s, opnd_list_t* onode)
 
 static void refine_operand(xed_enc_line_parsed_t* v, char* s)
 {
-    opnd_list_t* onode = get_opnd_list_node();
+    opnd_list_t* onode = get_opnd_list_node(v);
     int64_t num = 0;
     
     asp_dbg_printf("REFINE OPERAND [%s]\n", s);
@@ -967,30 +1131,29 @@ static void refine_operand(xed_enc_line_parsed_t* v, char* s)
         asp_dbg_printf("REGISTER-ish: %s\n",s);
         parse_reg(v,s,onode);
     }
-    else if (asm_isnumber(s,&num,0)) {
+    else if (asm_isnumber(v, s, &num, 0)) {
         /* Actual meaning depends on opcode */
         asp_dbg_printf("Immediate or displacement: %s\n",s);
         onode->type = OPND_IMM;
-        onode->s = asp_strdup(s);
+        onode->s = asp_strdup(v, s);
         onode->imm = num;
     }
     else if (ismemref(s)) {
          // [ seg:reg + index * [1,2,4,8]  + disp ]
         asp_dbg_printf("MEMREF-ish\n");
-        parse_memref(s,onode);
+        parse_memref(v, s, onode);
     }
     else if (isdecorator(s)) {
         asp_dbg_printf("LONE DECORATOR\n");
-        parse_decorator(s,onode);
+        parse_decorator(v, s, onode);
     }
-    else if (islongptr(s)) {
+    else if (islongptr(v, s)) {
         asp_dbg_printf("LONG POINTER\n");
         v->seen_far_ptr = 1;
-        parse_long_pointer(s,onode);
+        parse_long_pointer(v, s, onode);
     }
     else {
-        asp_error_printf("Bad operand: %s\n",s);
-        exit(1);
+        asp_fail(v, "Bad operand: %s\n",s);
     }
     // add onode to list
     onode->next = v->opnds;
@@ -1013,7 +1176,7 @@ static void refine_operands(xed_enc_line_parsed_t* v)
 
 void asp_parse_line(xed_enc_line_parsed_t* v)
 {
-    char* p  = asp_strdup(v->input);
+    char* p  = asp_strdup(v, v->input);
     char* q  = p; // for deletion
     int inst = 0;
     int prefixes = 0;
@@ -1041,7 +1204,7 @@ void asp_parse_line(xed_enc_line_parsed_t* v)
     }
 
     refine_operands(v);
-    free(q);
+    asp_free(v, q);
 }
 
 
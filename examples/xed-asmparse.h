@@ -18,9 +18,31 @@ END_LEGAL */
 
 #include <stdint.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
 
 #include "xed/xed-interface.h"
 
+/* Bump allocator for the parse nodes of a batch of lines. The blocks
+   are kept by asp_arena_reset() so that a steady stream of batches does
+   not call malloc or free. */
+typedef struct asp_arena_block_s {
+    struct asp_arena_block_s* next;
+    size_t size; // usable bytes after the header
+} asp_arena_block_t;
+
+typedef struct {
+    asp_arena_block_t* head;
+    asp_arena_block_t* cur;
+    size_t used; // bytes used in cur
+} asp_arena_t;
+
+void asp_arena_init(asp_arena_t* a);
+void* asp_arena_alloc(asp_arena_t* a, size_t n);
+char* asp_arena_strndup(asp_arena_t* a, const char* s, size_t n);
+void asp_arena_reset(asp_arena_t* a);
+void asp_arena_free(asp_arena_t* a);
+
 typedef struct slist_s {
     char* s;
     struct slist_s* next;
@@ -86,14 +108,29 @@ typedef struct {
     xed_bool_t seen_dr;
     xed_bool_t seen_far_ptr;
     int deduced_vector_length;
+
+    /* Bulk mode. When arena is set, all nodes and strings come from it
+       and nothing is freed individually. When on_error is set,
+       asp_fail() stores the message in error and longjmps there instead
+       of exiting. */
+    asp_arena_t* arena;
+    jmp_buf* on_error;
+    char* error;
 } xed_enc_line_parsed_t;
 
 void asp_set_verbosity(int v);
 void asp_error_printf(const char* format, ...);
 void asp_printf(const char* format, ...);
 void asp_dbg_printf(const char* format, ...);
+void XED_NORETURN asp_fail(xed_enc_line_parsed_t* v, const char* format, ...);
+
+/* call once before parsing */
+void asp_init_name_lookup(void);
+xed_iclass_enum_t asp_str2iclass(char const* s);
+xed_reg_enum_t asp_str2reg(char const* s);
 
 xed_enc_line_parsed_t* asp_get_xed_enc_node(void);
+xed_enc_line_parsed_t* asp_get_xed_enc_node_arena(asp_arena_t* a);
 void asp_delete_xed_enc_line_parsed_t(xed_enc_line_parsed_t* v);
 void asp_parse_line(xed_enc_line_parsed_t* v);
 void asp_print_parsed_line(xed_enc_line_parsed_t* v);
@@ -0,0 +1,928 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-cfg.c
+
+#include "xed/xed-interface.h"
+#if defined(XED_DECODER)
+#include "xed-cfg.h"
+#include "xed-dot.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+# include <windows.h>
+#else
+# include <pthread.h>
+# include <unistd.h>
+#endif
+
+#define XED_CFG_MAX_THREADS 256
+
+/* internal terminator value for instructions that do not end a block */
+#define TERM_NONE XED_CFG_TERM_LAST
+
+////////////////////////////////////////////////////////////////////////////
+// growable arrays and an address -> index hash map
+
+static void* grow(void* p, xed_uint32_t* cap, xed_uint32_t need, size_t elsz)
+{
+    xed_uint32_t ncap = *cap ? *cap : 16;
+    if (need <= *cap)
+        return p;
+    while (ncap < need)
+        ncap *= 2;
+    p = realloc(p, ncap * elsz);
+    assert(p != 0);
+    *cap = ncap;
+    return p;
+}
+
+typedef struct {
+    xed_uint64_t* keys;
+    xed_uint32_t* vals;   /* XED_CFG_NONE marks an empty slot */
+    xed_uint32_t cap;     /* power of 2 */
+    xed_uint32_t n;
+} addr_map_t;
+
+static xed_uint32_t addr_hash(xed_uint64_t a, xed_uint32_t mask)
+{
+    a ^= a >> 29;
+    a *= XED_STATIC_CAST(xed_uint64_t, 0xBF58476D1CE4E5B9ULL);
+    a ^= a >> 32;
+    return XED_STATIC_CAST(xed_uint32_t, a) & mask;
+}
+
+static void addr_map_alloc(addr_map_t* m, xed_uint32_t cap)
+{
+    m->cap = cap;
+    m->n = 0;
+    m->keys = (xed_uint64_t*)malloc(cap * sizeof(xed_uint64_t));
+    m->vals = (xed_uint32_t*)malloc(cap * sizeof(xed_uint32_t));
+    assert(m->keys != 0 && m->vals != 0);
+    memset(m->vals, 0xFF, cap * sizeof(xed_uint32_t));
+}
+
+static void addr_map_free(addr_map_t* m)
+{
+    free(m->keys);
+    free(m->vals);
+    m->keys = 0;
+    m->vals = 0;
+    m->cap = m->n = 0;
+}
+
+static void addr_map_clear(addr_map_t* m)
+{
+    if (m->n)
+        memset(m->vals, 0xFF, m->cap * sizeof(xed_uint32_t));
+    m->n = 0;
+}
+
+static xed_uint32_t addr_map_get(addr_map_t const* m, xed_uint64_t key)
+{
+    xed_uint32_t mask = m->cap - 1;
+    xed_uint32_t i = addr_hash(key, mask);
+    while (m->vals[i] != XED_CFG_NONE) {
+        if (m->keys[i] == key)
+            return m->vals[i];
+        i = (i + 1) & mask;
+    }
+    return XED_CFG_NONE;
+}
+
+static void addr_map_put(addr_map_t* m, xed_uint64_t key, xed_uint32_t val);
+
+static void addr_map_rehash(addr_map_t* m)
+{
+    addr_map_t old = *m;
+    xed_uint32_t i;
+    addr_map_alloc(m, old.cap * 2);
+    for (i = 0; i < old.cap; i++)
+        if (old.vals[i] != XED_CFG_NONE)
+            addr_map_put(m, old.keys[i], old.vals[i]);
+    addr_map_free(&old);
+}
+
+/* inserts or overwrites */
+static void addr_map_put(addr_map_t* m, xed_uint64_t key, xed_uint32_t val)
+{
+    xed_uint32_t mask, i;
+    if (2 * (m->n + 1) > m->cap)
+        addr_map_rehash(m);
+    mask = m->cap - 1;
+    i = addr_hash(key, mask);
+    while (m->vals[i] != XED_CFG_NONE) {
+        if (m->keys[i] == key) {
+            m->vals[i] = val;
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    m->keys[i] = key;
+    m->vals[i] = val;
+    m->n++;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// threads
+
+#if defined(_WIN32)
+typedef CRITICAL_SECTION cfg_mutex_t;
+typedef CONDITION_VARIABLE cfg_cond_t;
+static void cfg_mutex_init(cfg_mutex_t* m) { InitializeCriticalSection(m); }
+static void cfg_mutex_destroy(cfg_mutex_t* m) { DeleteCriticalSection(m); }
+static void cfg_lock(cfg_mutex_t* m) { EnterCriticalSection(m); }
+static void cfg_unlock(cfg_mutex_t* m) { LeaveCriticalSection(m); }
+static void cfg_cond_init(cfg_cond_t* c) { InitializeConditionVariable(c); }
+static void cfg_cond_destroy(cfg_cond_t* c) { (void)c; }
+static void cfg_wait(cfg_cond_t* c, cfg_mutex_t* m) {
+    SleepConditionVariableCS(c, m, INFINITE);
+}
+static void cfg_broadcast(cfg_cond_t* c) { WakeAllConditionVariable(c); }
+static xed_uint32_t cfg_online_cpus(void) {
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return XED_STATIC_CAST(xed_uint32_t, si.dwNumberOfProcessors);
+}
+#else
+typedef pthread_mutex_t cfg_mutex_t;
+typedef pthread_cond_t cfg_cond_t;
+static void cfg_mutex_init(cfg_mutex_t* m) { pthread_mutex_init(m, 0); }
+static void cfg_mutex_destroy(cfg_mutex_t* m) { pthread_mutex_destroy(m); }
+static void cfg_lock(cfg_mutex_t* m) { pthread_mutex_lock(m); }
+static void cfg_unlock(cfg_mutex_t* m) { pthread_mutex_unlock(m); }
+static void cfg_cond_init(cfg_cond_t* c) { pthread_cond_init(c, 0); }
+static void cfg_cond_destroy(cfg_cond_t* c) { pthread_cond_destroy(c); }
+static void cfg_wait(cfg_cond_t* c, cfg_mutex_t* m) {
+    pthread_cond_wait(c, m);
+}
+static void cfg_broadcast(cfg_cond_t* c) { pthread_cond_broadcast(c); }
+static xed_uint32_t cfg_online_cpus(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? XED_STATIC_CAST(xed_uint32_t, n) : 1;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////
+// per-function traversal
+
+typedef struct {
+    xed_uint64_t addr;
+    xed_uint64_t target;  /* direct branch/call target */
+    xed_uint8_t len;      /* 0 for undecodable */
+    xed_uint8_t term;     /* TERM_NONE or xed_cfg_term_enum_t */
+    xed_uint8_t leader;
+    xed_uint8_t direct;   /* target is valid */
+} inst_rec_t;
+
+/* result of one function, block addresses and edge dsts are local */
+typedef struct {
+    xed_cfg_block_t* blocks;
+    xed_uint32_t nblocks;
+    xed_cfg_edge_t* edges;
+    xed_uint32_t nedges;
+    xed_uint32_t entry_block;
+} func_result_t;
+
+typedef struct {
+    xed_cfg_t* cfg;
+    cfg_mutex_t lock;
+    cfg_cond_t cond;
+    addr_map_t known;        /* every entry added so far */
+    addr_map_t initial;      /* entries added before the build (read only) */
+    func_result_t** results; /* parallel to cfg->entries */
+    xed_uint32_t results_cap;
+    xed_uint32_t next;       /* next entry to process */
+    xed_uint32_t active;     /* busy workers */
+} cfg_shared_t;
+
+/* scratch storage reused by a worker for every function it processes */
+typedef struct {
+    cfg_shared_t* sh;
+    inst_rec_t* recs;
+    xed_uint32_t nrecs, recs_cap;
+    addr_map_t visited;      /* instruction address -> rec index */
+    addr_map_t leaders;      /* addresses that must start a block */
+    xed_uint64_t* work;
+    xed_uint32_t nwork, work_cap;
+    xed_uint64_t* calls;     /* direct call targets in this function */
+    xed_uint32_t ncalls, calls_cap;
+} cfg_worker_t;
+
+static xed_bool_t in_region(xed_cfg_t const* cfg, xed_uint64_t a)
+{
+    return a >= cfg->runtime_vaddr &&
+           a - cfg->runtime_vaddr < cfg->region_len;
+}
+
+static void push_work(cfg_worker_t* w, xed_uint64_t a)
+{
+    w->work = (xed_uint64_t*)grow(w->work, &w->work_cap, w->nwork + 1,
+                                  sizeof(xed_uint64_t));
+    w->work[w->nwork++] = a;
+}
+
+/* a direct branch target: becomes a leader and is traversed unless it is
+   the entry of another function. */
+static void branch_to(cfg_worker_t* w, xed_uint64_t entry, xed_uint64_t a)
+{
+    if (!in_region(w->sh->cfg, a))
+        return;
+    if (a != entry && addr_map_get(&w->sh->initial, a) != XED_CFG_NONE)
+        return;
+    addr_map_put(&w->leaders, a, 1);
+    push_work(w, a);
+}
+
+static void classify(xed_decoded_inst_t const* xedd,
+                     xed_uint64_t addr,
+                     inst_rec_t* r)
+{
+    xed_category_enum_t cat = xed_decoded_inst_get_category(xedd);
+    xed_iclass_enum_t iclass = xed_decoded_inst_get_iclass(xedd);
+    xed_bool_t direct =
+        xed_decoded_inst_get_branch_displacement_width(xedd) != 0;
+
+    r->term = TERM_NONE;
+    r->direct = 0;
+    r->target = 0;
+    if (direct) {
+        xed_uint64_t t = addr + r->len +
+            XED_STATIC_CAST(xed_uint64_t,
+                            xed_decoded_inst_get_branch_displacement(xedd));
+        if (xed_decoded_inst_get_machine_mode_bits(xedd) != 64) {
+            if (xed_operand_values_get_effective_operand_width(xedd) == 16)
+                t &= 0xFFFF;
+            else
+                t &= 0xFFFFFFFF;
+        }
+        r->target = t;
+    }
+    switch (cat) {
+      case XED_CATEGORY_COND_BR:
+        r->term = XED_CFG_TERM_COND_BRANCH;
+        r->direct = direct;
+        break;
+      case XED_CATEGORY_UNCOND_BR:
+        r->term = direct ? XED_CFG_TERM_JUMP : XED_CFG_TERM_INDIRECT_JUMP;
+        r->direct = direct;
+        break;
+      case XED_CATEGORY_CALL:
+        r->term = direct ? XED_CFG_TERM_CALL : XED_CFG_TERM_INDIRECT_CALL;
+        r->direct = direct;
+        break;
+      case XED_CATEGORY_RET:
+      case XED_CATEGORY_SYSRET:
+        r->term = XED_CFG_TERM_RETURN;
+        break;
+      default:
+        if (iclass == XED_ICLASS_HLT || iclass == XED_ICLASS_UD0 ||
+            iclass == XED_ICLASS_UD1 || iclass == XED_ICLASS_UD2)
+            r->term = XED_CFG_TERM_HALT;
+        break;
+    }
+}
+
+static xed_uint32_t add_rec(cfg_worker_t* w, xed_uint64_t a)
+{
+    inst_rec_t* r;
+    w->recs = (inst_rec_t*)grow(w->recs, &w->recs_cap, w->nrecs + 1,
+                                sizeof(inst_rec_t));
+    r = w->recs + w->nrecs;
+    memset(r, 0, sizeof(*r));
+    r->addr = a;
+    r->term = TERM_NONE;
+    addr_map_put(&w->visited, a, w->nrecs);
+    return w->nrecs++;
+}
+
+static void traverse(cfg_worker_t* w, xed_uint64_t entry)
+{
+    xed_cfg_t* cfg = w->sh->cfg;
+    xed_decoded_inst_t xedd;
+
+    addr_map_put(&w->leaders, entry, 1);
+    push_work(w, entry);
+    while (w->nwork) {
+        xed_uint64_t a = w->work[--w->nwork];
+        for (;;) {
+            inst_rec_t* r;
+            xed_uint32_t ri;
+            xed_uint64_t off;
+            unsigned int ilim;
+            xed_error_enum_t err;
+
+            if (addr_map_get(&w->visited, a) != XED_CFG_NONE) {
+                // reached an already decoded instruction by a second path
+                addr_map_put(&w->leaders, a, 1);
+                break;
+            }
+            ri = add_rec(w, a);  // may move w->recs
+            r = w->recs + ri;
+            if (!in_region(cfg, a)) {
+                r->term = XED_CFG_TERM_INVALID;
+                break;
+            }
+            off = a - cfg->runtime_vaddr;
+            ilim = XED_MAX_INSTRUCTION_BYTES;
+            if (cfg->region_len - off < ilim)
+                ilim = XED_STATIC_CAST(unsigned int, cfg->region_len - off);
+
+            xed_decoded_inst_zero_set_mode(&xedd, &cfg->dstate);
+            xed_decoded_inst_set_input_chip(&xedd, cfg->chip);
+            err = xed_decode(&xedd, cfg->region + off, ilim);
+            if (err != XED_ERROR_NONE) {
+                r->term = XED_CFG_TERM_INVALID;
+                break;
+            }
+            r->len = XED_STATIC_CAST(xed_uint8_t,
+                                     xed_decoded_inst_get_length(&xedd));
+            classify(&xedd, a, r);
+            if (r->term == TERM_NONE) {
+                a += r->len;
+                continue;
+            }
+
+            switch (r->term) {
+              case XED_CFG_TERM_COND_BRANCH:
+                if (r->direct)
+                    branch_to(w, entry, r->target);
+                push_work(w, a + r->len);
+                break;
+              case XED_CFG_TERM_JUMP:
+                branch_to(w, entry, r->target);
+                break;
+              case XED_CFG_TERM_CALL:
+                if (in_region(cfg, r->target)) {
+                    w->calls = (xed_uint64_t*)grow(w->calls, &w->calls_cap,
+                                                   w->ncalls + 1,
+                                                   sizeof(xed_uint64_t));
+                    w->calls[w->ncalls++] = r->target;
+                }
+                push_work(w, a + r->len);
+                break;
+              case XED_CFG_TERM_INDIRECT_CALL:
+                push_work(w, a + r->len);
+                break;
+              default:
+                break;
+            }
+            break;
+        }
+    }
+}
+
+static int rec_cmp(const void* x, const void* y)
+{
+    inst_rec_t const* a = (inst_rec_t const*)x;
+    inst_rec_t const* b = (inst_rec_t const*)y;
+    if (a->addr < b->addr) return -1;
+    if (a->addr > b->addr) return 1;
+    return 0;
+}
+
+static void add_edge(func_result_t* fr, xed_uint32_t* cap,
+                     xed_cfg_block_t* b,
+                     xed_cfg_edge_enum_t kind, xed_uint64_t target)
+{
+    xed_cfg_edge_t* e;
+    fr->edges = (xed_cfg_edge_t*)grow(fr->edges, cap, fr->nedges + 1,
+                                      sizeof(xed_cfg_edge_t));
+    e = fr->edges + fr->nedges++;
+    e->target = target;
+    e->dst = XED_CFG_NONE;
+    e->kind = kind;
+    b->nedges++;
+}
+
+static void add_successors(cfg_worker_t* w, func_result_t* fr,
+                           xed_uint32_t* ecap, xed_cfg_block_t* b,
+                           inst_rec_t const* last, xed_uint64_t entry)
+{
+    xed_uint64_t next = last->addr + last->len;
+    b->first_edge = fr->nedges;
+    b->nedges = 0;
+    switch (b->term) {
+      case XED_CFG_TERM_FALLTHROUGH:
+        add_edge(fr, ecap, b, XED_CFG_EDGE_FALLTHROUGH, next);
+        break;
+      case XED_CFG_TERM_COND_BRANCH:
+        if (last->direct)
+            add_edge(fr, ecap, b, XED_CFG_EDGE_TAKEN, last->target);
+        add_edge(fr, ecap, b, XED_CFG_EDGE_FALLTHROUGH, next);
+        break;
+      case XED_CFG_TERM_JUMP:
+        if (last->target != entry &&
+            addr_map_get(&w->sh->initial, last->target) != XED_CFG_NONE)
+            add_edge(fr, ecap, b, XED_CFG_EDGE_TAIL_CALL, last->target);
+        else
+            add_edge(fr, ecap, b, XED_CFG_EDGE_JUMP, last->target);
+        break;
+      case XED_CFG_TERM_CALL:
+        add_edge(fr, ecap, b, XED_CFG_EDGE_CALL, last->target);
+        add_edge(fr, ecap, b, XED_CFG_EDGE_CALL_RETURN, next);
+        break;
+      case XED_CFG_TERM_INDIRECT_CALL:
+        add_edge(fr, ecap, b, XED_CFG_EDGE_CALL_RETURN, next);
+        break;
+      default:
+        break;
+    }
+}
+
+/* group the sorted instruction records in to blocks */
+static func_result_t* form_blocks(cfg_worker_t* w, xed_uint64_t entry)
+{
+    func_result_t* fr;
+    xed_uint32_t bcap = 0, ecap = 0;
+    xed_uint32_t i;
+    xed_cfg_block_t* b = 0;
+
+    fr = (func_result_t*)calloc(1, sizeof(func_result_t));
+    assert(fr != 0);
+    fr->entry_block = XED_CFG_NONE;
+    qsort(w->recs, w->nrecs, sizeof(inst_rec_t), rec_cmp);
+
+    for (i = 0; i < w->nrecs; i++) {
+        inst_rec_t const* r = w->recs + i;
+        inst_rec_t const* p = i ? r - 1 : 0;
+        if (p == 0 || p->term != TERM_NONE ||
+            p->addr + p->len != r->addr ||
+            addr_map_get(&w->leaders, r->addr) != XED_CFG_NONE)
+        {
+            if (b && b->term == TERM_NONE) {
+                b->term = XED_CFG_TERM_FALLTHROUGH;
+                add_successors(w, fr, &ecap, b, p, entry);
+            }
+            fr->blocks = (xed_cfg_block_t*)grow(fr->blocks, &bcap,
+                                                fr->nblocks + 1,
+                                                sizeof(xed_cfg_block_t));
+            b = fr->blocks + fr->nblocks;
+            memset(b, 0, sizeof(*b));
+            b->start = r->addr;
+            b->term = TERM_NONE;
+            if (r->addr == entry)
+                fr->entry_block = fr->nblocks;
+            fr->nblocks++;
+        }
+        if (r->len) {
+            b->length += r->len;
+            b->ninst++;
+        }
+        if (r->term != TERM_NONE) {
+            b->term = r->term;
+            add_successors(w, fr, &ecap, b, r, entry);
+        }
+    }
+    // the traversal always ends a path with a terminator or an
+    // already visited instruction, which starts its own block.
+    assert(b == 0 || b->term != TERM_NONE);
+    return fr;
+}
+
+static func_result_t* process_function(cfg_worker_t* w, xed_uint64_t entry)
+{
+    w->nrecs = 0;
+    w->nwork = 0;
+    w->ncalls = 0;
+    addr_map_clear(&w->visited);
+    addr_map_clear(&w->leaders);
+    traverse(w, entry);
+    return form_blocks(w, entry);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// function queue
+
+static void append_entry(xed_cfg_t* cfg, xed_uint64_t addr, char const* name)
+{
+    xed_uint32_t cap = cfg->entries_cap;
+    cfg->entries = (xed_uint64_t*)grow(cfg->entries, &cfg->entries_cap,
+                                       cfg->nentries + 1,
+                                       sizeof(xed_uint64_t));
+    if (cfg->entries_cap != cap || cfg->entry_names == 0) {
+        cfg->entry_names = (char const**)realloc(
+            XED_CAST(void*, cfg->entry_names),
+            cfg->entries_cap * sizeof(char const*));
+        assert(cfg->entry_names != 0);
+    }
+    cfg->entries[cfg->nentries] = addr;
+    cfg->entry_names[cfg->nentries] = name;
+    cfg->nentries++;
+}
+
+/* called with the lock held */
+static void add_discovered_entry(cfg_shared_t* sh, xed_uint64_t addr)
+{
+    if (addr_map_get(&sh->known, addr) != XED_CFG_NONE)
+        return;
+    addr_map_put(&sh->known, addr, sh->cfg->nentries);
+    append_entry(sh->cfg, addr, 0);
+}
+
+static void worker_loop(cfg_worker_t* w)
+{
+    cfg_shared_t* sh = w->sh;
+    xed_cfg_t* cfg = sh->cfg;
+
+    cfg_lock(&sh->lock);
+    for (;;) {
+        if (sh->next < cfg->nentries) {
+            xed_uint32_t idx = sh->next++;
+            xed_uint64_t entry = cfg->entries[idx];
+            func_result_t* fr;
+            xed_uint32_t i, before;
+
+            sh->active++;
+            cfg_unlock(&sh->lock);
+            fr = process_function(w, entry);
+            cfg_lock(&sh->lock);
+
+            before = cfg->nentries;
+            for (i = 0; i < w->ncalls; i++)
+                add_discovered_entry(sh, w->calls[i]);
+            sh->results = (func_result_t**)grow(sh->results,
+                                                &sh->results_cap,
+                                                cfg->nentries,
+                                                sizeof(func_result_t*));
+            for (i = before; i < cfg->nentries; i++)
+                sh->results[i] = 0;
+            sh->results[idx] = fr;
+            sh->active--;
+            if (cfg->nentries > before ||
+                (sh->active == 0 && sh->next == cfg->nentries))
+                cfg_broadcast(&sh->cond);
+        }
+        else if (sh->active == 0)
+            break;
+        else
+            cfg_wait(&sh->cond, &sh->lock);
+    }
+    cfg_unlock(&sh->lock);
+}
+
+static void worker_free(cfg_worker_t* w)
+{
+    free(w->recs);
+    free(w->work);
+    free(w->calls);
+    addr_map_free(&w->visited);
+    addr_map_free(&w->leaders);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI worker_thread(LPVOID arg)
+{
+    worker_loop((cfg_worker_t*)arg);
+    return 0;
+}
+#else
+static void* worker_thread(void* arg)
+{
+    worker_loop((cfg_worker_t*)arg);
+    return 0;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////
+// public interface
+
+void xed_cfg_init(xed_cfg_t* cfg,
+                  xed_state_t const* dstate,
+                  xed_chip_enum_t chip,
+                  xed_uint8_t const* region,
+                  xed_uint64_t region_len,
+                  xed_uint64_t runtime_vaddr)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->dstate = *dstate;
+    cfg->chip = chip;
+    cfg->region = region;
+    cfg->region_len = region_len;
+    cfg->runtime_vaddr = runtime_vaddr;
+}
+
+void xed_cfg_add_entry(xed_cfg_t* cfg, xed_uint64_t addr, char const* name)
+{
+    xed_uint32_t i;
+    // called before the build; the entry list is small, a scan will do.
+    if (!in_region(cfg, addr))
+        return;
+    for (i = 0; i < cfg->nentries; i++)
+        if (cfg->entries[i] == addr) {
+            if (cfg->entry_names[i] == 0)
+                cfg->entry_names[i] = name;
+            return;
+        }
+    append_entry(cfg, addr, name);
+}
+
+typedef struct {
+    xed_uint64_t entry;
+    xed_uint32_t idx;
+} entry_order_t;
+
+static int entry_cmp(const void* x, const void* y)
+{
+    entry_order_t const* a = (entry_order_t const*)x;
+    entry_order_t const* b = (entry_order_t const*)y;
+    if (a->entry < b->entry) return -1;
+    if (a->entry > b->entry) return 1;
+    return 0;
+}
+
+/* exact match on a block start within a function */
+static xed_uint32_t find_block_start(xed_cfg_t const* cfg,
+                                     xed_cfg_function_t const* f,
+                                     xed_uint64_t addr)
+{
+    xed_uint32_t lo = f->first_block;
+    xed_uint32_t hi = f->first_block + f->nblocks;
+    while (lo < hi) {
+        xed_uint32_t mid = lo + (hi - lo) / 2;
+        if (cfg->blocks[mid].start < addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < f->first_block + f->nblocks && cfg->blocks[lo].start == addr)
+        return lo;
+    return XED_CFG_NONE;
+}
+
+/* concatenate the per-function results ordered by entry address so that
+   the output does not depend on scheduling. */
+static void assemble(xed_cfg_t* cfg, cfg_shared_t* sh)
+{
+    entry_order_t* order;
+    xed_uint32_t i, j, nb = 0, ne = 0;
+    addr_map_t fmap;
+
+    order = (entry_order_t*)malloc((cfg->nentries + 1) * sizeof(entry_order_t));
+    assert(order != 0);
+    for (i = 0; i < cfg->nentries; i++) {
+        order[i].entry = cfg->entries[i];
+        order[i].idx = i;
+        nb += sh->results[i]->nblocks;
+        ne += sh->results[i]->nedges;
+    }
+    qsort(order, cfg->nentries, sizeof(entry_order_t), entry_cmp);
+
+    cfg->nfuncs = cfg->nentries;
+    cfg->funcs = (xed_cfg_function_t*)malloc(
+        (cfg->nfuncs + 1) * sizeof(xed_cfg_function_t));
+    cfg->blocks = (xed_cfg_block_t*)malloc((nb + 1) * sizeof(xed_cfg_block_t));
+    cfg->edges = (xed_cfg_edge_t*)malloc((ne + 1) * sizeof(xed_cfg_edge_t));
+    assert(cfg->funcs != 0 && cfg->blocks != 0 && cfg->edges != 0);
+    addr_map_alloc(&fmap, 16);
+
+    nb = ne = 0;
+    for (i = 0; i < cfg->nfuncs; i++) {
+        func_result_t* fr = sh->results[order[i].idx];
+        xed_cfg_function_t* f = cfg->funcs + i;
+        f->entry = order[i].entry;
+        f->name = cfg->entry_names[order[i].idx];
+        f->first_block = nb;
+        f->nblocks = fr->nblocks;
+        f->entry_block = nb + fr->entry_block;
+        addr_map_put(&fmap, f->entry, i);
+        for (j = 0; j < fr->nblocks; j++) {
+            xed_cfg_block_t* b = cfg->blocks + nb + j;
+            *b = fr->blocks[j];
+            b->first_edge += ne;
+            b->func = i;
+        }
+        if (fr->nedges)
+            memcpy(cfg->edges + ne, fr->edges,
+                   fr->nedges * sizeof(xed_cfg_edge_t));
+        nb += fr->nblocks;
+        ne += fr->nedges;
+    }
+    cfg->nblocks = nb;
+    cfg->nedges = ne;
+
+    // resolve edge destinations: local blocks first, then function entries
+    for (i = 0; i < cfg->nblocks; i++) {
+        xed_cfg_block_t const* b = cfg->blocks + i;
+        xed_cfg_function_t const* f = cfg->funcs + b->func;
+        for (j = 0; j < b->nedges; j++) {
+            xed_cfg_edge_t* e = cfg->edges + b->first_edge + j;
+            xed_uint32_t fi;
+            if (e->kind != XED_CFG_EDGE_CALL &&
+                e->kind != XED_CFG_EDGE_TAIL_CALL) {
+                e->dst = find_block_start(cfg, f, e->target);
+                if (e->dst != XED_CFG_NONE)
+                    continue;
+            }
+            fi = addr_map_get(&fmap, e->target);
+            if (fi != XED_CFG_NONE)
+                e->dst = cfg->funcs[fi].entry_block;
+        }
+    }
+    addr_map_free(&fmap);
+    free(order);
+}
+
+void xed_cfg_build(xed_cfg_t* cfg, xed_uint32_t nthreads)
+{
+    cfg_shared_t sh;
+    cfg_worker_t* workers;
+    xed_uint32_t i;
+
+    memset(&sh, 0, sizeof(sh));
+    sh.cfg = cfg;
+    cfg_mutex_init(&sh.lock);
+    cfg_cond_init(&sh.cond);
+    addr_map_alloc(&sh.known, 64);
+    addr_map_alloc(&sh.initial, 64);
+    for (i = 0; i < cfg->nentries; i++) {
+        addr_map_put(&sh.known, cfg->entries[i], i);
+        addr_map_put(&sh.initial, cfg->entries[i], i);
+    }
+    sh.results = (func_result_t**)grow(0, &sh.results_cap,
+                                       cfg->nentries + 1,
+                                       sizeof(func_result_t*));
+    memset(sh.results, 0, sh.results_cap * sizeof(func_result_t*));
+
+    if (nthreads == 0)
+        nthreads = cfg_online_cpus();
+    if (nthreads > XED_CFG_MAX_THREADS)
+        nthreads = XED_CFG_MAX_THREADS;
+
+    workers = (cfg_worker_t*)calloc(nthreads, sizeof(cfg_worker_t));
+    assert(workers != 0);
+    for (i = 0; i < nthreads; i++) {
+        workers[i].sh = &sh;
+        addr_map_alloc(&workers[i].visited, 1024);
+        addr_map_alloc(&workers[i].leaders, 256);
+    }
+
+    if (nthreads == 1)
+        worker_loop(workers);
+    else {
+#if defined(_WIN32)
+        HANDLE* tids = (HANDLE*)malloc(nthreads * sizeof(HANDLE));
+        assert(tids != 0);
+        for (i = 0; i < nthreads; i++) {
+            tids[i] = CreateThread(0, 0, worker_thread, workers + i, 0, 0);
+            assert(tids[i] != 0);
+        }
+        WaitForMultipleObjects(nthreads, tids, TRUE, INFINITE);
+        for (i = 0; i < nthreads; i++)
+            CloseHandle(tids[i]);
+#else
+        pthread_t* tids = (pthread_t*)malloc(nthreads * sizeof(pthread_t));
+        assert(tids != 0);
+        for (i = 0; i < nthreads; i++) {
+            int r = pthread_create(tids + i, 0, worker_thread, workers + i);
+            assert(r == 0);
+            (void)r;
+        }
+        for (i = 0; i < nthreads; i++)
+            pthread_join(tids[i], 0);
+#endif
+        free(tids);
+    }
+
+    assemble(cfg, &sh);
+
+    for (i = 0; i < nthreads; i++)
+        worker_free(workers + i);
+    free(workers);
+    for (i = 0; i < cfg->nentries; i++) {
+        free(sh.results[i]->blocks);
+        free(sh.results[i]->edges);
+        free(sh.results[i]);
+    }
+    free(sh.results);
+    addr_map_free(&sh.known);
+    addr_map_free(&sh.initial);
+    cfg_cond_destroy(&sh.cond);
+    cfg_mutex_destroy(&sh.lock);
+}
+
+xed_uint32_t xed_cfg_find_block(xed_cfg_t const* cfg,
+                                xed_uint32_t func,
+                                xed_uint64_t addr)
+{
+    xed_cfg_function_t const* f;
+    xed_uint32_t lo, hi;
+    if (func >= cfg->nfuncs)
+        return XED_CFG_NONE;
+    f = cfg->funcs + func;
+    // last block starting at or before addr
+    lo = f->first_block;
+    hi = f->first_block + f->nblocks;
+    while (lo < hi) {
+        xed_uint32_t mid = lo + (hi - lo) / 2;
+        if (cfg->blocks[mid].start <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == f->first_block)
+        return XED_CFG_NONE;
+    lo--;
+    if (addr == cfg->blocks[lo].start ||
+        addr - cfg->blocks[lo].start < cfg->blocks[lo].length)
+        return lo;
+    return XED_CFG_NONE;
+}
+
+void xed_cfg_free(xed_cfg_t* cfg)
+{
+    free(cfg->funcs);
+    free(cfg->blocks);
+    free(cfg->edges);
+    free(cfg->entries);
+    free(XED_CAST(void*, cfg->entry_names));
+    cfg->funcs = 0;
+    cfg->blocks = 0;
+    cfg->edges = 0;
+    cfg->entries = 0;
+    cfg->entry_names = 0;
+    cfg->nfuncs = cfg->nblocks = cfg->nedges = 0;
+    cfg->nentries = cfg->entries_cap = 0;
+}
+
+char const* xed_cfg_term_enum_t2str(xed_cfg_term_enum_t t)
+{
+    static char const* const names[] = {
+        "FALLTHROUGH", "COND_BRANCH", "JUMP", "INDIRECT_JUMP", "CALL",
+        "INDIRECT_CALL", "RETURN", "HALT", "INVALID" };
+    if (t < XED_CFG_TERM_LAST)
+        return names[t];
+    return "???";
+}
+
+char const* xed_cfg_edge_enum_t2str(xed_cfg_edge_enum_t t)
+{
+    static char const* const names[] = {
+        "FALLTHROUGH", "TAKEN", "JUMP", "TAIL_CALL", "CALL", "CALL_RETURN" };
+    if (t < XED_CFG_EDGE_LAST)
+        return names[t];
+    return "???";
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+void xed_cfg_dot(FILE* f, xed_cfg_t const* cfg)
+{
+    xed_dot_graph_t* g = xed_dot_graph();
+    xed_dot_node_t** nodes;
+    xed_uint32_t i, j;
+    char buf[128];
+
+    nodes = (xed_dot_node_t**)malloc(
+        (cfg->nblocks + 1) * sizeof(xed_dot_node_t*));
+    assert(nodes != 0);
+    // node names must be unique; blocks may repeat across functions.
+    for (i = 0; i < cfg->nblocks; i++) {
+        xed_cfg_block_t const* b = cfg->blocks + i;
+        xed_cfg_function_t const* fn = cfg->funcs + b->func;
+        char const* term = xed_cfg_term_enum_t2str(
+            XED_STATIC_CAST(xed_cfg_term_enum_t, b->term));
+        if (fn->name && i == fn->entry_block)
+            snprintf(buf, sizeof(buf), "B%u %s\\n" XED_FMT_LX "\\n%s",
+                     i, fn->name, b->start, term);
+        else
+            snprintf(buf, sizeof(buf), "B%u\\n" XED_FMT_LX "\\n%s",
+                     i, b->start, term);
+        nodes[i] = xed_dot_node(g, buf);
+    }
+    for (i = 0; i < cfg->nblocks; i++) {
+        xed_cfg_block_t const* b = cfg->blocks + i;
+        for (j = 0; j < b->nedges; j++) {
+            xed_cfg_edge_t const* e = cfg->edges + b->first_edge + j;
+            xed_dot_edge_style_t style = XED_DOT_EDGE_SOLID;
+            if (e->dst == XED_CFG_NONE)
+                continue;
+            if (e->kind == XED_CFG_EDGE_CALL ||
+                e->kind == XED_CFG_EDGE_TAIL_CALL)
+                style = XED_DOT_EDGE_DASHED;
+            else if (e->kind == XED_CFG_EDGE_CALL_RETURN)
+                style = XED_DOT_EDGE_DOTTED;
+            xed_dot_edge(g, nodes[i], nodes[e->dst], style);
+        }
+    }
+    xed_dot_dump(f, g);
+    xed_dot_graph_deallocate(g);
+    free(nodes);
+}
+#endif
@@ -0,0 +1,141 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-cfg.h
+
+/* Basic block and control flow graph construction by recursive traversal
+   of a code region. Decoding starts at a set of function entry points
+   (typically symbols) and follows the direct branch targets that XED
+   decodes. Direct call targets that land in the region become new
+   functions. Functions are processed in parallel.
+
+   The result is stored in flat arrays: functions own a contiguous range
+   of blocks and blocks own a contiguous range of edges (CSR form). Blocks
+   are not shared between functions; code reachable from two functions
+   appears in both. */
+
+#if !defined(XED_CFG_H)
+# define XED_CFG_H
+
+#include "xed/xed-interface.h"
+#include <stdio.h>
+
+#define XED_CFG_NONE 0xFFFFFFFFU
+
+/* How a basic block ends */
+typedef enum {
+    XED_CFG_TERM_FALLTHROUGH,    /* next instruction is a branch target */
+    XED_CFG_TERM_COND_BRANCH,
+    XED_CFG_TERM_JUMP,
+    XED_CFG_TERM_INDIRECT_JUMP,
+    XED_CFG_TERM_CALL,
+    XED_CFG_TERM_INDIRECT_CALL,
+    XED_CFG_TERM_RETURN,
+    XED_CFG_TERM_HALT,           /* hlt, ud2, ... no successors */
+    XED_CFG_TERM_INVALID,        /* decode error or end of region */
+    XED_CFG_TERM_LAST
+} xed_cfg_term_enum_t;
+
+typedef enum {
+    XED_CFG_EDGE_FALLTHROUGH,
+    XED_CFG_EDGE_TAKEN,          /* taken side of a conditional branch */
+    XED_CFG_EDGE_JUMP,
+    XED_CFG_EDGE_TAIL_CALL,      /* jump to another function entry */
+    XED_CFG_EDGE_CALL,           /* call to a function entry */
+    XED_CFG_EDGE_CALL_RETURN,    /* fallthrough after a call */
+    XED_CFG_EDGE_LAST
+} xed_cfg_edge_enum_t;
+
+typedef struct {
+    xed_uint64_t target;  /* runtime address of the successor */
+    xed_uint32_t dst;     /* block index or XED_CFG_NONE if not in region */
+    xed_uint32_t kind;    /* xed_cfg_edge_enum_t */
+} xed_cfg_edge_t;
+
+typedef struct {
+    xed_uint64_t start;   /* runtime address */
+    xed_uint32_t length;  /* bytes */
+    xed_uint32_t ninst;
+    xed_uint32_t first_edge;
+    xed_uint32_t nedges;
+    xed_uint32_t func;
+    xed_uint32_t term;    /* xed_cfg_term_enum_t */
+} xed_cfg_block_t;
+
+typedef struct {
+    xed_uint64_t entry;
+    char const* name;     /* not owned; 0 for discovered functions */
+    xed_uint32_t entry_block;
+    xed_uint32_t first_block;
+    xed_uint32_t nblocks;
+} xed_cfg_function_t;
+
+typedef struct {
+    /* inputs */
+    xed_state_t dstate;
+    xed_chip_enum_t chip;
+    xed_uint8_t const* region;
+    xed_uint64_t region_len;
+    xed_uint64_t runtime_vaddr;  /* address of region[0] */
+
+    /* outputs, valid after xed_cfg_build() */
+    xed_cfg_function_t* funcs;
+    xed_uint32_t nfuncs;
+    xed_cfg_block_t* blocks;
+    xed_uint32_t nblocks;
+    xed_cfg_edge_t* edges;
+    xed_uint32_t nedges;
+
+    /* entry points, in the order added */
+    xed_uint64_t* entries;
+    char const** entry_names;
+    xed_uint32_t nentries;
+    xed_uint32_t entries_cap;
+} xed_cfg_t;
+
+void xed_cfg_init(xed_cfg_t* cfg,
+                  xed_state_t const* dstate,
+                  xed_chip_enum_t chip,
+                  xed_uint8_t const* region,
+                  xed_uint64_t region_len,
+                  xed_uint64_t runtime_vaddr);
+
+/* add a function entry point. Entries outside the region and duplicates
+   are ignored.  The name is not copied. */
+void xed_cfg_add_entry(xed_cfg_t* cfg, xed_uint64_t addr, char const* name);
+
+/* Build the graph using nthreads worker threads; 0 means one per online
+   processor. The output does not depend on the number of threads. */
+void xed_cfg_build(xed_cfg_t* cfg, xed_uint32_t nthreads);
+
+/* returns the index of the block containing addr or XED_CFG_NONE. Blocks
+   are sorted by function and then by address; the search is within the
+   given function. */
+xed_uint32_t xed_cfg_find_block(xed_cfg_t const* cfg,
+                                xed_uint32_t func,
+                                xed_uint64_t addr);
+
+void xed_cfg_free(xed_cfg_t* cfg);
+
+char const* xed_cfg_term_enum_t2str(xed_cfg_term_enum_t t);
+char const* xed_cfg_edge_enum_t2str(xed_cfg_edge_enum_t t);
+
+/* Graphviz output of the blocks and intra-function edges; calls are
+   drawn dashed. */
+void xed_cfg_dot(FILE* f, xed_cfg_t const* cfg);
+
+#endif
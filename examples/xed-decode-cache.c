@@ -0,0 +1,713 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-decode-cache.c
+
+#include "xed/xed-interface.h"
+#if defined(XED_DECODER)
+#include "xed-decode-cache.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+# include <windows.h>
+# include <process.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#define DC_HEADER_BYTES 64
+#define DC_BYTE_ORDER 0x01020304u
+
+static char const dc_magic[8] = { 'X','E','D','D','C','A','C','H' };
+
+typedef struct {
+    char magic[8];
+    xed_uint32_t version;
+    xed_uint32_t byte_order;
+    xed_uint64_t key;
+    xed_uint64_t len;
+    xed_uint32_t ninst;
+    xed_uint32_t iform_last;
+    xed_uint32_t mmode;
+    xed_uint32_t stack_addr_width;
+    xed_uint32_t chip;
+    xed_uint32_t reserved[3];
+} dc_header_t;
+
+////////////////////////////////////////////////////////////////////////////
+// keys
+
+static XED_INLINE xed_uint64_t mix(xed_uint64_t h, xed_uint64_t v)
+{
+    h = (h ^ v) * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 32);
+}
+
+static xed_uint64_t hash_bytes(xed_uint64_t h,
+                               xed_uint8_t const* p,
+                               xed_uint64_t n)
+{
+    xed_uint64_t w;
+    for (; n >= 8; p += 8, n -= 8) {
+        memcpy(&w, p, 8);
+        h = mix(h, w);
+    }
+    if (n) {
+        w = 0;
+        memcpy(&w, p, XED_STATIC_CAST(size_t, n));
+        h = mix(h, w ^ (n << 56));
+    }
+    return h;
+}
+
+xed_uint64_t xed_decode_cache_key(xed_state_t const* dstate,
+                                  xed_chip_enum_t chip,
+                                  xed_uint8_t const* region,
+                                  xed_uint64_t len)
+{
+    char const* v = xed_get_version();
+    xed_uint64_t h = 0xCBF29CE484222325ULL;
+    h = mix(h, XED_DECODE_CACHE_VERSION);
+    h = mix(h, XED_IFORM_LAST);
+    h = mix(h, xed_state_get_machine_mode(dstate));
+    h = mix(h, xed_state_get_stack_address_width(dstate));
+    h = mix(h, chip);
+    h = hash_bytes(h, XED_REINTERPRET_CAST(xed_uint8_t const*, v), strlen(v));
+    h = mix(h, len);
+    h = hash_bytes(h, region, len);
+    /* final avalanche, from MurmurHash3 */
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    return h ^ (h >> 33);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// images
+
+static XED_INLINE xed_uint64_t align8(xed_uint64_t n)
+{
+    return (n + 7) & ~XED_STATIC_CAST(xed_uint64_t, 7);
+}
+
+/* Offsets of the offset, iform, length and summary arrays. Returns the
+   size of the image. */
+static xed_uint64_t layout(xed_uint32_t ninst, xed_uint64_t pos[4])
+{
+    pos[0] = DC_HEADER_BYTES;
+    pos[1] = pos[0] + align8(4 * XED_STATIC_CAST(xed_uint64_t, ninst));
+    pos[2] = pos[1] + align8(2 * XED_STATIC_CAST(xed_uint64_t, ninst));
+    pos[3] = pos[2] + align8(ninst);
+    return pos[3] + align8(ninst);
+}
+
+/* Point the arrays of c at its image */
+static void attach(xed_decode_cache_t* c)
+{
+    dc_header_t const* h = XED_STATIC_CAST(dc_header_t const*, c->image);
+    xed_uint8_t const* b = XED_STATIC_CAST(xed_uint8_t const*, c->image);
+    xed_uint64_t pos[4];
+
+    layout(h->ninst, pos);
+    c->key = h->key;
+    c->len = h->len;
+    c->ninst = h->ninst;
+    c->mmode = h->mmode;
+    c->stack_addr_width = h->stack_addr_width;
+    c->chip = h->chip;
+    c->offset = XED_REINTERPRET_CAST(xed_uint32_t const*, b + pos[0]);
+    c->iform = XED_REINTERPRET_CAST(xed_uint16_t const*, b + pos[1]);
+    c->length = b + pos[2];
+    c->summary = b + pos[3];
+    c->stale_region = 0;
+}
+
+static xed_uint8_t summarize(xed_decoded_inst_t const* xedd)
+{
+    xed_uint_t nmem = xed_decoded_inst_number_of_memory_operands(xedd);
+    xed_uint_t i;
+    xed_uint8_t s = XED_STATIC_CAST(xed_uint8_t,
+                                    nmem < XED_DECODE_CACHE_NMEM ?
+                                    nmem : XED_DECODE_CACHE_NMEM);
+    for (i = 0; i < nmem; i++) {
+        if (xed_decoded_inst_mem_read(xedd, i))
+            s |= XED_DECODE_CACHE_MEM_READ;
+        if (xed_decoded_inst_mem_written(xedd, i))
+            s |= XED_DECODE_CACHE_MEM_WRITE;
+    }
+    if (xed_operand_values_has_immediate(
+            xed_decoded_inst_operands_const(xedd)))
+        s |= XED_DECODE_CACHE_IMM;
+    switch (xed_decoded_inst_get_category(xedd)) {
+      case XED_CATEGORY_COND_BR:
+      case XED_CATEGORY_UNCOND_BR:
+      case XED_CATEGORY_CALL:
+      case XED_CATEGORY_RET:
+        s |= XED_DECODE_CACHE_BRANCH;
+        break;
+      default:
+        break;
+    }
+    return s;
+}
+
+/* Instruction records, growing or pointing into an image */
+typedef struct {
+    xed_uint32_t* offset;
+    xed_uint16_t* iform;
+    xed_uint8_t* length;
+    xed_uint8_t* summary;
+    xed_uint32_t n;
+    xed_uint32_t cap;
+} dc_records_t;
+
+static void records_free(dc_records_t* r)
+{
+    free(r->offset);
+    free(r->iform);
+    free(r->length);
+    free(r->summary);
+}
+
+static void records_copy(dc_records_t* d,
+                         xed_uint32_t const* offset,
+                         xed_uint16_t const* iform,
+                         xed_uint8_t const* length,
+                         xed_uint8_t const* summary,
+                         xed_uint32_t n)
+{
+    if (n == 0)
+        return;
+    memcpy(d->offset + d->n, offset, n * sizeof(*offset));
+    memcpy(d->iform + d->n, iform, n * sizeof(*iform));
+    memcpy(d->length + d->n, length, n);
+    memcpy(d->summary + d->n, summary, n);
+    d->n += n;
+}
+
+/* Decode at off and append the instruction to r. Returns its length, or
+   0 if the bytes there do not decode. */
+static xed_uint_t decode_at(dc_records_t* r,
+                            xed_state_t const* dstate,
+                            xed_chip_enum_t chip,
+                            xed_uint8_t const* region,
+                            xed_uint64_t len,
+                            xed_uint64_t off)
+{
+    xed_decoded_inst_t xedd;
+    unsigned int ilim = XED_MAX_INSTRUCTION_BYTES;
+    xed_uint_t n;
+
+    if (len - off < ilim)
+        ilim = XED_STATIC_CAST(unsigned int, len - off);
+    xed_decoded_inst_zero_set_mode(&xedd, dstate);
+    xed_decoded_inst_set_input_chip(&xedd, chip);
+    if (xed_decode(&xedd, region + off, ilim) != XED_ERROR_NONE)
+        return 0;
+    if (r->n == r->cap) {
+        r->cap = r->cap ? 2 * r->cap : 1024;
+        r->offset = (xed_uint32_t*) realloc(r->offset,
+                                            r->cap * sizeof(*r->offset));
+        r->iform = (xed_uint16_t*) realloc(r->iform,
+                                           r->cap * sizeof(*r->iform));
+        r->length = (xed_uint8_t*) realloc(r->length, r->cap);
+        r->summary = (xed_uint8_t*) realloc(r->summary, r->cap);
+        assert(r->offset && r->iform && r->length && r->summary);
+    }
+    n = xed_decoded_inst_get_length(&xedd);
+    r->offset[r->n] = XED_STATIC_CAST(xed_uint32_t, off);
+    r->iform[r->n] = XED_STATIC_CAST(xed_uint16_t,
+                                     xed_decoded_inst_get_iform_enum(&xedd));
+    r->length[r->n] = XED_STATIC_CAST(xed_uint8_t, n);
+    r->summary[r->n] = summarize(&xedd);
+    r->n++;
+    return n;
+}
+
+/* Empty records pointing at the arrays of an image */
+static dc_records_t image_records(void* image, xed_uint32_t ninst)
+{
+    dc_records_t r;
+    xed_uint64_t pos[4];
+    xed_uint8_t* b = XED_STATIC_CAST(xed_uint8_t*, image);
+
+    layout(ninst, pos);
+    r.offset = XED_REINTERPRET_CAST(xed_uint32_t*, b + pos[0]);
+    r.iform = XED_REINTERPRET_CAST(xed_uint16_t*, b + pos[1]);
+    r.length = b + pos[2];
+    r.summary = b + pos[3];
+    r.n = 0;
+    r.cap = ninst;
+    return r;
+}
+
+/* Allocate an image for ninst instructions and fill its header */
+static dc_records_t new_image(xed_decode_cache_t* c,
+                              xed_state_t const* dstate,
+                              xed_chip_enum_t chip,
+                              xed_uint64_t key,
+                              xed_uint64_t len,
+                              xed_uint32_t ninst)
+{
+    xed_uint64_t pos[4];
+    dc_header_t* h;
+
+    c->image_len = layout(ninst, pos);
+    c->image = calloc(1, XED_STATIC_CAST(size_t, c->image_len));
+    assert(c->image != 0);
+    c->mapped = 0;
+    h = XED_STATIC_CAST(dc_header_t*, c->image);
+    memcpy(h->magic, dc_magic, sizeof(dc_magic));
+    h->version = XED_DECODE_CACHE_VERSION;
+    h->byte_order = DC_BYTE_ORDER;
+    h->key = key;
+    h->len = len;
+    h->ninst = ninst;
+    h->iform_last = XED_IFORM_LAST;
+    h->mmode = xed_state_get_machine_mode(dstate);
+    h->stack_addr_width = xed_state_get_stack_address_width(dstate);
+    h->chip = chip;
+    return image_records(c->image, ninst);
+}
+
+void xed_decode_cache_build(xed_decode_cache_t* c,
+                            xed_state_t const* dstate,
+                            xed_chip_enum_t chip,
+                            xed_uint8_t const* region,
+                            xed_uint64_t len)
+{
+    dc_records_t r, out;
+    xed_uint64_t off = 0;
+
+    assert(len <= 0xFFFFFFFFu);
+    memset(&r, 0, sizeof(r));
+    while (off < len) {
+        xed_uint_t n = decode_at(&r, dstate, chip, region, len, off);
+        off += n ? n : 1;
+    }
+    out = new_image(c, dstate, chip,
+                    xed_decode_cache_key(dstate, chip, region, len),
+                    len, r.n);
+    records_copy(&out, r.offset, r.iform, r.length, r.summary, r.n);
+    records_free(&r);
+    attach(c);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// patching
+
+/* A decode can look at up to this many bytes after its start */
+#define DC_WINDOW (XED_MAX_INSTRUCTION_BYTES - 1)
+
+/* The instructions from old instruction old_begin up to old_end are
+   replaced by the new_n decoded ones starting at new_begin */
+typedef struct {
+    xed_uint32_t old_begin;
+    xed_uint32_t old_end;
+    xed_uint32_t new_begin;
+    xed_uint32_t new_n;
+} dc_splice_t;
+
+/* The first cached instruction starting at or after off */
+static xed_uint32_t lower_bound(xed_decode_cache_t const* c, xed_uint64_t off)
+{
+    xed_uint32_t lo = 0, hi = c->ninst;
+    while (lo < hi) {
+        xed_uint32_t mid = lo + (hi - lo) / 2;
+        if (c->offset[mid] < off)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* 1 if the linear decode tried to decode at off: an instruction starts
+   there or off is in a gap between instructions */
+static xed_bool_t decoded_at(xed_decode_cache_t const* c, xed_uint64_t off)
+{
+    xed_uint32_t i = lower_bound(c, off);
+    if (i < c->ninst && c->offset[i] == off)
+        return 1;
+    return i == 0 || c->offset[i-1] + c->length[i-1] <= off;
+}
+
+/* The last offset at or before off where the linear decode tried */
+static xed_uint64_t decoded_before(xed_decode_cache_t const* c,
+                                   xed_uint64_t off)
+{
+    xed_uint32_t i = lower_bound(c, off + 1);
+    if (i > 0 && c->offset[i-1] + c->length[i-1] > off)
+        return c->offset[i-1];
+    return off;
+}
+
+static int cmp_range(void const* a, void const* b)
+{
+    xed_decode_cache_range_t const* x = (xed_decode_cache_range_t const*)a;
+    xed_decode_cache_range_t const* y = (xed_decode_cache_range_t const*)b;
+    if (x->offset != y->offset)
+        return x->offset < y->offset ? -1 : 1;
+    return 0;
+}
+
+xed_uint64_t xed_decode_cache_patch(xed_decode_cache_t* c,
+                                    xed_uint8_t const* region,
+                                    xed_decode_cache_range_t const* ranges,
+                                    xed_uint32_t nranges)
+{
+    xed_decode_cache_t old = *c;
+    xed_decode_cache_range_t* sorted;
+    dc_splice_t* splices;
+    dc_records_t r, out;
+    xed_state_t dstate;
+    xed_chip_enum_t chip = XED_STATIC_CAST(xed_chip_enum_t, c->chip);
+    xed_uint32_t i = 0, j, nsplices = 0, ninst = c->ninst, src = 0;
+    xed_uint64_t redecoded = 0;
+    xed_bool_t in_place = !c->mapped;
+
+    if (nranges == 0)
+        return 0;
+    xed_state_init2(&dstate,
+                    XED_STATIC_CAST(xed_machine_mode_enum_t, c->mmode),
+                    XED_STATIC_CAST(xed_address_width_enum_t,
+                                    c->stack_addr_width));
+    sorted = (xed_decode_cache_range_t*) malloc(
+        nranges * sizeof(xed_decode_cache_range_t));
+    splices = (dc_splice_t*) malloc(nranges * sizeof(dc_splice_t));
+    assert(sorted != 0 && splices != 0);
+    memcpy(sorted, ranges, nranges * sizeof(xed_decode_cache_range_t));
+    qsort(sorted, nranges, sizeof(xed_decode_cache_range_t), cmp_range);
+    memset(&r, 0, sizeof(r));
+
+    /* Every decode that can see a patched byte is redone. Decoding
+       restarts at the last position before the first such decode and
+       stops at the first position past the patches that the old decode
+       also reached; from there on the old instructions are unchanged. */
+    while (i < nranges) {
+        xed_uint64_t begin, off, end;
+        dc_splice_t* s;
+        if (sorted[i].len == 0 || sorted[i].offset >= c->len) {
+            i++;
+            continue;
+        }
+        begin = sorted[i].offset > DC_WINDOW ?
+            decoded_before(&old, sorted[i].offset - DC_WINDOW) : 0;
+        end = sorted[i].offset + sorted[i].len;
+        i++;
+        s = splices + nsplices++;
+        s->old_begin = lower_bound(&old, begin);
+        s->new_begin = r.n;
+        off = begin;
+        while (off < c->len) {
+            xed_uint_t n;
+            for (; i < nranges && sorted[i].offset <= off + DC_WINDOW; i++)
+                if (sorted[i].offset + sorted[i].len > end)
+                    end = sorted[i].offset + sorted[i].len;
+            if (off >= end && decoded_at(&old, off))
+                break;
+            n = decode_at(&r, &dstate, chip, region, c->len, off);
+            off += n ? n : 1;
+        }
+        s->old_end = lower_bound(&old, off);
+        s->new_n = r.n - s->new_begin;
+        if (s->new_n != s->old_end - s->old_begin)
+            in_place = 0;
+        ninst += s->new_n;
+        ninst -= s->old_end - s->old_begin;
+        redecoded += off - begin;
+    }
+
+    if (in_place) {
+        /* every splice keeps the number of instructions: overwrite them
+           in our own image */
+        out = image_records(c->image, c->ninst);
+        for (j = 0; j < nsplices; j++) {
+            dc_splice_t const* s = splices + j;
+            xed_uint32_t b = s->new_begin;
+            out.n = s->old_begin;
+            records_copy(&out, r.offset + b, r.iform + b, r.length + b,
+                         r.summary + b, s->new_n);
+        }
+        attach(c);
+    }
+    else {
+        out = new_image(c, &dstate, chip, old.key, c->len, ninst);
+        for (j = 0; j < nsplices; j++) {
+            dc_splice_t const* s = splices + j;
+            xed_uint32_t b = s->new_begin;
+            records_copy(&out, old.offset + src, old.iform + src,
+                         old.length + src, old.summary + src,
+                         s->old_begin - src);
+            records_copy(&out, r.offset + b, r.iform + b, r.length + b,
+                         r.summary + b, s->new_n);
+            src = s->old_end;
+        }
+        records_copy(&out, old.offset + src, old.iform + src,
+                     old.length + src, old.summary + src, old.ninst - src);
+        assert(out.n == ninst);
+        attach(c);
+        xed_decode_cache_release(&old);
+    }
+    c->stale_region = region;
+    records_free(&r);
+    free(sorted);
+    free(splices);
+    return redecoded;
+}
+
+xed_uint64_t xed_decode_cache_update_key(xed_decode_cache_t* c)
+{
+    xed_state_t dstate;
+    if (c->stale_region == 0)
+        return c->key;
+    /* patch leaves an image of our own, never a mapped one */
+    assert(!c->mapped);
+    xed_state_init2(&dstate,
+                    XED_STATIC_CAST(xed_machine_mode_enum_t, c->mmode),
+                    XED_STATIC_CAST(xed_address_width_enum_t,
+                                    c->stack_addr_width));
+    c->key = xed_decode_cache_key(
+        &dstate, XED_STATIC_CAST(xed_chip_enum_t, c->chip),
+        c->stale_region, c->len);
+    XED_STATIC_CAST(dc_header_t*, c->image)->key = c->key;
+    c->stale_region = 0;
+    return c->key;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// files
+
+/* dir/KEY.xdc, with the suffix appended. The caller frees it. */
+static char* entry_path(char const* dir, xed_uint64_t key,
+                        char const* suffix)
+{
+    size_t n = strlen(dir) + strlen(suffix) + 32;
+    char* fn = (char*) malloc(n);
+    assert(fn != 0);
+    sprintf(fn, "%s/%08x%08x.xdc%s", dir,
+            XED_STATIC_CAST(unsigned int, key >> 32),
+            XED_STATIC_CAST(unsigned int, key & 0xFFFFFFFFu),
+            suffix);
+    return fn;
+}
+
+static FILE* dc_fopen(char const* fn, char const* mode)
+{
+#if defined(XED_MSVC8_OR_LATER) && !defined(PIN_CRT)
+    FILE* f;
+    if (fopen_s(&f, fn, mode) != 0)
+        return 0;
+    return f;
+#else
+    return fopen(fn, mode);
+#endif
+}
+
+xed_bool_t xed_decode_cache_store(xed_decode_cache_t* c,
+                                  char const* dir)
+{
+    char* fn = entry_path(dir, xed_decode_cache_update_key(c), "");
+    char* tmp;
+    char suffix[48];
+    xed_bool_t ok;
+    FILE* f;
+#if defined(_WIN32)
+    unsigned long pid = XED_STATIC_CAST(unsigned long, _getpid());
+#else
+    unsigned long pid = XED_STATIC_CAST(unsigned long, getpid());
+#endif
+
+    /* unique among processes and among threads of this one */
+    sprintf(suffix, ".%lu.%lx.tmp", pid,
+            XED_STATIC_CAST(unsigned long, XED_REINTERPRET_CAST(size_t, c)));
+    tmp = entry_path(dir, c->key, suffix);
+    f = dc_fopen(tmp, "wb");
+    if (!f) {
+        free(fn);
+        free(tmp);
+        return 0;
+    }
+    ok = fwrite(c->image, 1, XED_STATIC_CAST(size_t, c->image_len), f) ==
+        c->image_len;
+    if (fclose(f) != 0)
+        ok = 0;
+#if defined(_WIN32)
+    if (ok)
+        ok = MoveFileExA(tmp, fn, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    if (ok)
+        ok = rename(tmp, fn) == 0;
+#endif
+    if (!ok)
+        remove(tmp);
+    free(fn);
+    free(tmp);
+    return ok;
+}
+
+/* Check the header and size of an image against what the caller wants */
+static xed_bool_t valid_image(void const* image,
+                              xed_uint64_t image_len,
+                              xed_state_t const* dstate,
+                              xed_chip_enum_t chip,
+                              xed_uint64_t key,
+                              xed_uint64_t len)
+{
+    dc_header_t const* h = XED_STATIC_CAST(dc_header_t const*, image);
+    xed_uint64_t pos[4];
+    if (image_len < DC_HEADER_BYTES)
+        return 0;
+    if (memcmp(h->magic, dc_magic, sizeof(dc_magic)) != 0 ||
+        h->version != XED_DECODE_CACHE_VERSION ||
+        h->byte_order != DC_BYTE_ORDER ||
+        h->iform_last != XED_IFORM_LAST)
+        return 0;
+    if (h->key != key || h->len != len ||
+        h->mmode != XED_STATIC_CAST(xed_uint32_t,
+                                    xed_state_get_machine_mode(dstate)) ||
+        h->stack_addr_width != XED_STATIC_CAST(
+            xed_uint32_t, xed_state_get_stack_address_width(dstate)) ||
+        h->chip != XED_STATIC_CAST(xed_uint32_t, chip))
+        return 0;
+    return layout(h->ninst, pos) == image_len;
+}
+
+xed_bool_t xed_decode_cache_load(xed_decode_cache_t* c,
+                                 char const* dir,
+                                 xed_state_t const* dstate,
+                                 xed_chip_enum_t chip,
+                                 xed_uint64_t key,
+                                 xed_uint64_t len)
+{
+    char* fn = entry_path(dir, key, "");
+    void* image;
+    xed_uint64_t image_len;
+#if defined(_WIN32)
+    FILE* f = dc_fopen(fn, "rb");
+    long n;
+    free(fn);
+    if (!f)
+        return 0;
+    if (fseek(f, 0, SEEK_END) != 0 || (n = ftell(f)) < DC_HEADER_BYTES ||
+        fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return 0;
+    }
+    image_len = XED_STATIC_CAST(xed_uint64_t, n);
+    image = malloc(XED_STATIC_CAST(size_t, image_len));
+    assert(image != 0);
+    if (fread(image, 1, XED_STATIC_CAST(size_t, image_len), f) !=
+        image_len) {
+        fclose(f);
+        free(image);
+        return 0;
+    }
+    fclose(f);
+#else
+    struct stat st;
+    int fd = open(fn, O_RDONLY);
+    free(fn);
+    if (fd == -1)
+        return 0;
+    if (fstat(fd, &st) != 0 || st.st_size < DC_HEADER_BYTES) {
+        close(fd);
+        return 0;
+    }
+    image_len = XED_STATIC_CAST(xed_uint64_t, st.st_size);
+    image = mmap(0, XED_STATIC_CAST(size_t, image_len), PROT_READ,
+                 MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED)
+        return 0;
+#endif
+    if (!valid_image(image, image_len, dstate, chip, key, len)) {
+#if defined(_WIN32)
+        free(image);
+#else
+        munmap(image, XED_STATIC_CAST(size_t, image_len));
+#endif
+        return 0;
+    }
+    c->image = image;
+    c->image_len = image_len;
+#if defined(_WIN32)
+    c->mapped = 0;
+#else
+    c->mapped = 1;
+#endif
+    attach(c);
+    return 1;
+}
+
+/* Say once per process, from whichever thread sees it first, that
+   entries are not being kept. */
+static void warn_store_failed(void)
+{
+    static volatile long warned = 0;
+#if defined(_WIN32)
+    if (InterlockedExchange(&warned, 1) != 0)
+        return;
+#elif defined(__GNUC__)
+    if (__sync_lock_test_and_set(&warned, 1) != 0)
+        return;
+#else
+    if (warned)
+        return;
+    warned = 1;
+#endif
+    fprintf(stderr, "WARNING: could not store decode cache entries. "
+            "Is the cache directory writable?\n");
+}
+
+xed_bool_t xed_decode_cache_get(xed_decode_cache_t* c,
+                                char const* dir,
+                                xed_state_t const* dstate,
+                                xed_chip_enum_t chip,
+                                xed_uint8_t const* region,
+                                xed_uint64_t len)
+{
+    xed_uint64_t key = xed_decode_cache_key(dstate, chip, region, len);
+    if (xed_decode_cache_load(c, dir, dstate, chip, key, len))
+        return 1;
+    xed_decode_cache_build(c, dstate, chip, region, len);
+    if (!xed_decode_cache_store(c, dir))
+        warn_store_failed();
+    return 0;
+}
+
+void xed_decode_cache_release(xed_decode_cache_t* c)
+{
+#if !defined(_WIN32)
+    if (c->mapped)
+        munmap(c->image, XED_STATIC_CAST(size_t, c->image_len));
+    else
+#endif
+        free(c->image);
+    c->image = 0;
+    c->image_len = 0;
+    c->ninst = 0;
+}
+
+#endif
@@ -0,0 +1,134 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-decode-cache.h
+
+/* Persistent decode cache. The result of a linear decode of a code
+   region -- the offset, length, iform and an operand summary of every
+   instruction -- is kept in a file named by a 64-bit key. The key hashes
+   the region bytes together with the machine mode, stack address width,
+   chip and XED version, so a changed section or a different XED simply
+   misses. Later runs map the file read-only and skip decoding. A file
+   that is truncated, written by another cache version, byte order or
+   iform table, or whose header does not match the key, is treated as a
+   miss and rewritten.
+
+   The file is a 64 byte header followed by the four arrays, each
+   starting on an 8 byte boundary. Bytes that did not decode are the gaps
+   between offset[i]+length[i] and offset[i+1]; the linear decode skips
+   them one at a time, as the disassembler does. Regions must be smaller
+   than 4GB. */
+
+#if !defined(XED_DECODE_CACHE_H)
+# define XED_DECODE_CACHE_H
+
+#include "xed/xed-interface.h"
+
+#define XED_DECODE_CACHE_VERSION 1
+
+/* operand summary bits */
+#define XED_DECODE_CACHE_NMEM       0x03 /* number of memory operands */
+#define XED_DECODE_CACHE_MEM_READ   0x04
+#define XED_DECODE_CACHE_MEM_WRITE  0x08
+#define XED_DECODE_CACHE_IMM        0x10
+#define XED_DECODE_CACHE_BRANCH     0x20 /* jump, call or return */
+
+typedef struct {
+    xed_uint64_t key;              /* see xed_decode_cache_update_key() */
+    xed_uint64_t len;              /* bytes in the region */
+    xed_uint32_t ninst;
+    xed_uint32_t const* offset;    /* instruction starts, ascending */
+    xed_uint16_t const* iform;     /* xed_iform_enum_t */
+    xed_uint8_t const* length;
+    xed_uint8_t const* summary;
+
+    /* the file image: mapped, or allocated by build or on Windows */
+    void* image;
+    xed_uint64_t image_len;
+    xed_bool_t mapped;
+    xed_uint32_t mmode;
+    xed_uint32_t stack_addr_width;
+    xed_uint32_t chip;
+    xed_uint8_t const* stale_region; /* patched, key not recomputed yet */
+} xed_decode_cache_t;
+
+xed_uint64_t xed_decode_cache_key(xed_state_t const* dstate,
+                                  xed_chip_enum_t chip,
+                                  xed_uint8_t const* region,
+                                  xed_uint64_t len);
+
+/* Decode the region linearly */
+void xed_decode_cache_build(xed_decode_cache_t* c,
+                            xed_state_t const* dstate,
+                            xed_chip_enum_t chip,
+                            xed_uint8_t const* region,
+                            xed_uint64_t len);
+
+/* Bytes of the region that were overwritten */
+typedef struct {
+    xed_uint64_t offset;
+    xed_uint64_t len;
+} xed_decode_cache_range_t;
+
+/* Update c, the linear decode of the region before it was patched in
+   place, to the current bytes of the region. Only the decodes that can
+   see a patched byte are redone: decoding restarts at the last position
+   before the first of them and stops at the first position past the
+   patch that the old decode also reached, where the instruction stream
+   is back in sync. The new instructions are spliced in. When every
+   splice keeps its number of instructions and the entry is not mapped
+   they overwrite the old ones in place; otherwise the records are
+   copied to a new image, which is the only step that still takes time
+   proportional to the region. The key hashes the whole region, so it is
+   only marked stale here. The region must stay valid, and change only
+   through further patches, until xed_decode_cache_update_key() or
+   xed_decode_cache_store() hashes it. The ranges may be in any order.
+   Returns the number of bytes decoded again. */
+xed_uint64_t xed_decode_cache_patch(xed_decode_cache_t* c,
+                                    xed_uint8_t const* region,
+                                    xed_decode_cache_range_t const* ranges,
+                                    xed_uint32_t nranges);
+
+/* Recompute the key of a patched entry, if it is stale. Returns the key. */
+xed_uint64_t xed_decode_cache_update_key(xed_decode_cache_t* c);
+
+/* Write the entry to dir, replacing any older file atomically. Updates a
+   stale key first. Returns 0 on error. */
+xed_bool_t xed_decode_cache_store(xed_decode_cache_t* c,
+                                  char const* dir);
+
+/* Map the entry for key from dir. Returns 0 if it is missing or stale. */
+xed_bool_t xed_decode_cache_load(xed_decode_cache_t* c,
+                                 char const* dir,
+                                 xed_state_t const* dstate,
+                                 xed_chip_enum_t chip,
+                                 xed_uint64_t key,
+                                 xed_uint64_t len);
+
+/* Load the entry for the region from dir, or decode the region and store
+   it there. The first entry that cannot be stored prints a warning.
+   Returns 1 if the entry came from the cache. */
+xed_bool_t xed_decode_cache_get(xed_decode_cache_t* c,
+                                char const* dir,
+                                xed_state_t const* dstate,
+                                xed_chip_enum_t chip,
+                                xed_uint8_t const* region,
+                                xed_uint64_t len);
+
+void xed_decode_cache_release(xed_decode_cache_t* c);
+
+#endif
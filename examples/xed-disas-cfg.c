@@ -0,0 +1,125 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-disas-cfg.c
+
+#include "xed/xed-interface.h"
+#if defined(XED_DECODER)
+#include "xed-examples-util.h"
+#include "xed-disas-cfg.h"
+#include "xed-cfg.h"
+#include "avltree.h"
+
+static void add_symbols(xed_cfg_t* cfg, xed_local_symbol_table_t* ltab)
+{
+    avl_iter_t it;
+    xed_uint32_t i;
+    if (ltab == 0)
+        return;
+    for (avl_iter_begin(&it, &ltab->atree);
+         !avl_iter_done(&it);
+         avl_iter_increment(&it))
+    {
+        xed_cfg_add_entry(cfg, avl_iter_current_key(&it),
+                          (char const*)avl_iter_current(&it));
+    }
+    for (i = 0; i < ltab->nsyms; i++)
+        xed_cfg_add_entry(cfg, ltab->syms[i].addr, ltab->syms[i].name);
+}
+
+static void print_block(xed_disas_info_t* fi,
+                        xed_cfg_t const* cfg,
+                        xed_uint32_t bi)
+{
+    xed_cfg_block_t const* b = cfg->blocks + bi;
+    xed_uint64_t a = b->start;
+    xed_uint32_t i;
+    xed_decoded_inst_t xedd;
+    char buf[1024];
+
+    printf("  BLOCK %u 0x" XED_FMT_LX " len=%u ninst=%u %s\n",
+           bi, b->start, b->length, b->ninst,
+           xed_cfg_term_enum_t2str((xed_cfg_term_enum_t)b->term));
+    for (i = 0; i < b->ninst; i++) {
+        xed_uint64_t off = a - cfg->runtime_vaddr;
+        unsigned int ilim = XED_MAX_INSTRUCTION_BYTES;
+        if (cfg->region_len - off < ilim)
+            ilim = XED_STATIC_CAST(unsigned int, cfg->region_len - off);
+        init_xedd(&xedd, fi);
+        if (xed_decode(&xedd, cfg->region + off, ilim) != XED_ERROR_NONE)
+            break;
+        disassemble(fi, buf, sizeof(buf), &xedd, a,
+                    fi->caller_symbol_data);
+        printf("    0x" XED_FMT_LX " %s\n", a, buf);
+        a += xed_decoded_inst_get_length(&xedd);
+    }
+    for (i = 0; i < b->nedges; i++) {
+        xed_cfg_edge_t const* e = cfg->edges + b->first_edge + i;
+        char const* kind =
+            xed_cfg_edge_enum_t2str((xed_cfg_edge_enum_t)e->kind);
+        if (e->dst == XED_CFG_NONE)
+            printf("    -> ? %s 0x" XED_FMT_LX "\n", kind, e->target);
+        else
+            printf("    -> %u %s 0x" XED_FMT_LX "\n", e->dst, kind, e->target);
+    }
+}
+
+void xed_disas_cfg_add_entries(xed_disas_info_t* fi,
+                               xed_cfg_t* cfg,
+                               xed_symbol_table_t* symtab)
+{
+    xed_uint32_t i;
+    for (i = 0; i < fi->cfg_nentries; i++)
+        xed_cfg_add_entry(cfg, fi->cfg_entries[i], 0);
+    if (symtab) {
+        add_symbols(cfg, &symtab->gtab);
+        add_symbols(cfg, symtab->curtab);
+    }
+    if (cfg->nentries == 0) {
+        xed_uint64_t start = fi->runtime_vaddr;
+        if (fi->runtime_vaddr_disas_start > start)
+            start = fi->runtime_vaddr_disas_start;
+        xed_cfg_add_entry(cfg, start, 0);
+    }
+}
+
+void xed_disas_cfg(xed_disas_info_t* fi, xed_symbol_table_t* symtab)
+{
+    xed_cfg_t cfg;
+    xed_uint32_t i, j;
+    xed_uint64_t nbytes = XED_STATIC_CAST(xed_uint64_t, fi->q - fi->a);
+
+    xed_cfg_init(&cfg, &fi->dstate, fi->chip, fi->a, nbytes,
+                 fi->runtime_vaddr);
+    xed_disas_cfg_add_entries(fi, &cfg, symtab);
+    xed_cfg_build(&cfg, fi->cfg_threads);
+
+    printf("# CFG: %u functions, %u blocks, %u edges\n",
+           cfg.nfuncs, cfg.nblocks, cfg.nedges);
+    for (i = 0; i < cfg.nfuncs; i++) {
+        xed_cfg_function_t const* f = cfg.funcs + i;
+        printf("FUNCTION 0x" XED_FMT_LX " %s blocks=%u entry=%u\n",
+               f->entry, f->name ? f->name : "-", f->nblocks,
+               f->entry_block);
+        for (j = 0; j < f->nblocks; j++)
+            print_block(fi, &cfg, f->first_block + j);
+    }
+    if (fi->cfg_dot_output)
+        xed_cfg_dot(fi->cfg_dot_output, &cfg);
+    xed_cfg_free(&cfg);
+}
+#endif
@@ -0,0 +1,38 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+
+#if !defined(XED_DISAS_CFG_H)
+# define XED_DISAS_CFG_H
+
+#include "xed/xed-interface.h"
+#include "xed-examples-util.h"
+#include "xed-symbol-table.h"
+#include "xed-cfg.h"
+
+/* Build and print the control flow graph of the region described by fi.
+   Entry points are fi->cfg_entries and the symbols of symtab that fall in
+   the region. If there are none, the start of the region is used.
+   symtab may be 0. */
+void xed_disas_cfg(xed_disas_info_t* fi, xed_symbol_table_t* symtab);
+
+/* Add the entry points xed_disas_cfg() would use to an initialized cfg */
+void xed_disas_cfg_add_entries(xed_disas_info_t* fi,
+                               xed_cfg_t* cfg,
+                               xed_symbol_table_t* symtab);
+
+#endif
@@ -40,6 +40,8 @@ END_LEGAL */
 #include "xed/xed-interface.h"
 #include "xed-examples-util.h"
 #include "xed-symbol-table.h"
+#include "xed-disas-cfg.h"
+#include "xed-disas-index.h"
 #include "avltree.h"
 
 #include <string.h>
@@ -58,48 +60,278 @@ static void dwarf_handler(Dwarf_Error err, Dwarf_Ptr errarg)
     (void)errarg;
 }
 
-/* file 0 does not exist */
+/* Line numbers are loaded lazily. read_dwarf_line_numbers() only walks
+ * the compilation unit (CU) headers and .debug_aranges to build a sorted
+ * index of CU address ranges. A CU's line program is decoded the first
+ * time disassembly asks for an address in one of its ranges; its rows are
+ * kept in an array sorted by address and searched with a cursor that
+ * follows the mostly-sequential disassembly. Memory is bounded by the CUs
+ * actually touched.
+ *
+ * CU ranges can overlap: a CU indexed by the span of its rows covers any
+ * code linked between its functions. A lookup tries every CU whose range
+ * covers the address. A CU whose range only ends at the address (its
+ * end_sequence row) loses to one that contains it; otherwise, as when all
+ * rows went in one table, the row from the last CU wins. */
+
 typedef struct {
+    xed_uint64_t addr;
     xed_uint32_t line;
-    xed_uint32_t file;
-} line_number_entry_t;
+    xed_uint32_t file; /* CU-local file number, 0 means no file */
+} line_row_t;
+
+typedef struct {
+    Dwarf_Off die_offset;
+    xed_bool_t indexed; /* has at least one entry in the range index */
+    xed_bool_t loaded;
+    line_row_t* rows;
+    xed_uint32_t nrows;
+    char** files;       /* CU-local file number -> name */
+    xed_uint32_t nfiles;
+} line_cu_t;
+
+typedef struct {
+    xed_uint64_t lo;
+    xed_uint64_t hi; /* inclusive, to catch end_sequence rows */
+    xed_uint64_t max_hi; /* greatest hi of this and all earlier ranges */
+    xed_uint32_t cu;
+} line_range_t;
+
+static Dwarf_Debug line_dbg;
+static Elf* line_elf;
+static line_cu_t* line_cus;
+static xed_uint32_t line_ncus;
+static line_range_t* line_ranges;
+static xed_uint32_t line_nranges;
+static xed_uint32_t line_ranges_cap;
+
+/* sequential cursor */
+static xed_uint32_t cursor_range;
+static xed_uint32_t cursor_row;
+
+static char const* unknown = "Unknown";
+
+static void* line_realloc(void* p, size_t n)
+{
+    p = realloc(p, n ? n : 1);
+    if (p == 0) {
+        fprintf(stderr, "ERROR: Could not malloc\n");
+        exit(1);
+    }
+    return p;
+}
 
-void line_number_entry_init(line_number_entry_t*p,
-                            xed_uint32_t a_line,
-                            xed_uint32_t a_file)
+static void add_line_range(xed_uint64_t lo, xed_uint64_t hi, xed_uint32_t cu)
 {
-    p->line=a_line;
-    p->file=a_file;
+    if (line_nranges == line_ranges_cap) {
+        line_ranges_cap = line_ranges_cap ? 2*line_ranges_cap : 64;
+        line_ranges = (line_range_t*) line_realloc(
+            line_ranges, line_ranges_cap * sizeof(line_range_t));
+    }
+    line_ranges[line_nranges].lo = lo;
+    line_ranges[line_nranges].hi = hi;
+    line_ranges[line_nranges].cu = cu;
+    line_nranges++;
+    line_cus[cu].indexed = 1;
 }
 
-/* addresses  -> line_number_entry_t values */
-static avl_tree_t line_number_table; //xed_uint64_t -> line_number_entry_t*
+static int line_range_cmp(void const* a, void const* b)
+{
+    line_range_t const* x = (line_range_t const*)a;
+    line_range_t const* y = (line_range_t const*)b;
+    if (x->lo != y->lo)
+        return x->lo < y->lo ? -1 : 1;
+    if (x->hi != y->hi)
+        return x->hi < y->hi ? -1 : 1;
+    /* later CUs win, as they did when all rows went in one table */
+    return x->cu < y->cu ? -1 : (x->cu > y->cu);
+}
 
-/* start at 1, 0 means no file */
-static xed_uint32_t global_file_num = 1;
+typedef struct {
+    line_row_t row;
+    xed_uint32_t seq;
+} line_sort_row_t;
 
-/* global file num -> string */
-static avl_tree_t global_file_name_table; // xed_uint64_t -> char*
+static int line_sort_row_cmp(void const* a, void const* b)
+{
+    line_sort_row_t const* x = (line_sort_row_t const*)a;
+    line_sort_row_t const* y = (line_sort_row_t const*)b;
+    if (x->row.addr != y->row.addr)
+        return x->row.addr < y->row.addr ? -1 : 1;
+    return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
 
-/* local file num -> global file num. This one is restarted for each
- * compilation unit. */
-static avl_tree_t file_name_table; // xed_uint64_t -> xed_uint64_t
+static xed_int64_t find_cu_by_offset(Dwarf_Off off)
+{
+    xed_uint32_t lo = 0, hi = line_ncus;
+    while (lo < hi) {
+        xed_uint32_t mid = lo + (hi - lo) / 2;
+        if (line_cus[mid].die_offset < off)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < line_ncus && line_cus[lo].die_offset == off)
+        return lo;
+    return -1;
+}
 
-static char const* unknown = "Unknown";
+/* decode one CU's line program into its sorted row array */
+static void load_line_cu(line_cu_t* cu)
+{
+    Dwarf_Die cu_die;
+    Dwarf_Line* line_buf;
+    Dwarf_Signed line_count;
+    Dwarf_Signed i;
+    line_sort_row_t* tmp;
+    xed_uint32_t n = 0, k, c;
+
+    cu->loaded = 1;
+    if (dwarf_offdie(line_dbg, cu->die_offset, &cu_die, 0) != DW_DLV_OK)
+        return;
+    if (dwarf_srclines(cu_die, &line_buf, &line_count, 0) != DW_DLV_OK) {
+        dwarf_dealloc(line_dbg, cu_die, DW_DLA_DIE);
+        return;
+    }
+    tmp = (line_sort_row_t*) line_realloc(0, line_count *
+                                          sizeof(line_sort_row_t));
+    for (i = 0; i < line_count; i++)
+    {
+        Dwarf_Addr line_addr;
+        Dwarf_Unsigned line_num, file_num;
+        char* file_name;
+
+        dwarf_lineaddr(line_buf[i], &line_addr, 0);
+        dwarf_lineno(line_buf[i], &line_num, 0);
+        dwarf_line_srcfileno(line_buf[i], &file_num, 0);
+
+        if (file_num &&
+            (file_num >= cu->nfiles || cu->files[file_num] == 0) &&
+            dwarf_linesrc(line_buf[i], &file_name, 0) == DW_DLV_OK)
+        {
+            if (file_num >= cu->nfiles) {
+                xed_uint32_t nf = XED_STATIC_CAST(xed_uint32_t, file_num+1);
+                cu->files = (char**) line_realloc(cu->files,
+                                                  nf * sizeof(char*));
+                memset(cu->files + cu->nfiles, 0,
+                       (nf - cu->nfiles) * sizeof(char*));
+                cu->nfiles = nf;
+            }
+            cu->files[file_num] = xed_strdup(file_name);
+            dwarf_dealloc(line_dbg, file_name, DW_DLA_STRING);
+        }
+        tmp[n].row.addr = line_addr;
+        tmp[n].row.line = XED_STATIC_CAST(xed_uint32_t, line_num);
+        tmp[n].row.file = file_num < cu->nfiles
+                              ? XED_STATIC_CAST(xed_uint32_t, file_num) : 0;
+        tmp[n].seq = n;
+        n++;
+    }
+    dwarf_srclines_dealloc(line_dbg, line_buf, line_count);
+    dwarf_dealloc(line_dbg, cu_die, DW_DLA_DIE);
+
+    cu->rows = (line_row_t*) line_realloc(0, n * sizeof(line_row_t));
+    /* sequences need not be in address order. The last row at an
+       address wins. */
+    qsort(tmp, n, sizeof(line_sort_row_t), line_sort_row_cmp);
+    for (k = 0, c = 0; k < n; k++) {
+        if (k+1 < n && tmp[k+1].row.addr == tmp[k].row.addr)
+            continue;
+        cu->rows[c++] = tmp[k].row;
+    }
+    free(tmp);
+    cu->nrows = c;
+}
+
+/* one past the last range starting at or below addr */
+static xed_uint32_t find_line_ranges_end(xed_uint64_t addr)
+{
+    xed_uint32_t lo = 0, hi = line_nranges;
+    if (cursor_range < line_nranges &&
+        line_ranges[cursor_range].lo <= addr &&
+        (cursor_range+1 == line_nranges ||
+         addr < line_ranges[cursor_range+1].lo))
+        return cursor_range + 1;
+    while (lo < hi) {
+        xed_uint32_t mid = lo + (hi - lo) / 2;
+        if (line_ranges[mid].lo <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static line_row_t* find_line_row(line_cu_t* cu, xed_uint64_t addr)
+{
+    xed_uint32_t lo = 0, hi = cu->nrows, steps;
+    if (cursor_row < cu->nrows && cu->rows[cursor_row].addr <= addr) {
+        /* sequential disassembly moves forward a few rows at a time */
+        for (steps = 0;
+             steps < 8 && cursor_row+1 < cu->nrows &&
+                 cu->rows[cursor_row+1].addr <= addr;
+             steps++)
+            cursor_row++;
+        if (cursor_row+1 == cu->nrows || cu->rows[cursor_row+1].addr > addr)
+            lo = hi = cursor_row + 1;
+        else
+            lo = cursor_row + 1;
+    }
+    while (lo < hi) {
+        xed_uint32_t mid = lo + (hi - lo) / 2;
+        if (cu->rows[mid].addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return 0;
+    cursor_row = lo - 1;
+    if (cu->rows[cursor_row].addr != addr)
+        return 0;
+    return cu->rows + cursor_row;
+}
 
 static int find_line_number(xed_uint64_t addr,
                             char** file,
                             xed_uint32_t* line)
 {
-    line_number_entry_t* p =
-        (line_number_entry_t*) avl_find(&line_number_table,
-                                        addr);
+    line_row_t* p = 0;
+    line_cu_t* cu = 0;
+    xed_bool_t p_inside = 0;
+    xed_uint32_t i;
+
+    /* walk back over the ranges that start at or below addr until none
+       of the earlier ones can reach it */
+    for (i = find_line_ranges_end(addr);
+         i > 0 && line_ranges[i-1].max_hi >= addr;
+         i--)
+    {
+        line_range_t* r = line_ranges + i - 1;
+        line_cu_t* c = line_cus + r->cu;
+        line_row_t* q;
+        xed_bool_t inside = addr < r->hi;
+        if (addr > r->hi)
+            continue;
+        if (cu && (inside < p_inside || (inside == p_inside && c <= cu)))
+            continue;
+        if (!c->loaded)
+            load_line_cu(c);
+        if (cursor_range >= line_nranges ||
+            line_ranges[cursor_range].cu != r->cu)
+            cursor_row = 0;
+        cursor_range = i - 1;
+        q = find_line_row(c, addr);
+        if (q) {
+            p = q;
+            cu = c;
+            p_inside = inside;
+        }
+    }
     if (!p)
         return 0;
-
-    char *q = (char*) avl_find(&global_file_name_table,p->file);
-    if (q)
-        *file = q;
+    if (p->file && cu->files[p->file])
+        *file = cu->files[p->file];
     else
         *file = (char*)unknown;
     *line = p->line;
@@ -119,104 +351,111 @@ void find_line_number_info(xed_uint64_t addr)
     }
 }
 
-
+/* index the CU address ranges. .debug_aranges is used where present;
+ * CUs it does not cover fall back to their DW_AT_low_pc/DW_AT_high_pc.
+ * CUs with neither are decoded now and indexed by their row span. */
 static void read_dwarf_line_numbers(void* region,
                                     unsigned int region_bytes)
 {
     int dres;
-    Dwarf_Debug dbg;
-    Dwarf_Unsigned next_cu_offset;;
+    Dwarf_Unsigned next_cu_offset;
+    Dwarf_Arange* aranges;
+    Dwarf_Signed naranges, i;
+    xed_uint32_t c, cus_cap = 0;
     
     elf_version(EV_CURRENT);
 
-    Elf* elf = elf_memory(XED_STATIC_CAST(char*,region), region_bytes);
-    dres = dwarf_elf_init(elf, DW_DLC_READ, dwarf_handler, 0, &dbg, 0);
+    line_elf = elf_memory(XED_STATIC_CAST(char*,region), region_bytes);
+    dres = dwarf_elf_init(line_elf, DW_DLC_READ, dwarf_handler, 0,
+                          &line_dbg, 0);
     if (dres != DW_DLV_OK) 
         return;
 
-    avl_tree_init(&line_number_table);
-    avl_tree_init(&global_file_name_table);
-    avl_tree_init(&file_name_table);
-
+    /* CU headers only; the line programs are not touched here */
     while (1)
     {
-        int i;
         Dwarf_Die cu_die;
         Dwarf_Half tag;
-        Dwarf_Line* line_buf;
-        Dwarf_Signed line_count;
+        Dwarf_Off off;
 
-        dres = dwarf_next_cu_header(dbg, 0, 0, 0, 0, &next_cu_offset, 0);
+        dres = dwarf_next_cu_header(line_dbg, 0, 0, 0, 0, &next_cu_offset, 0);
         if (dres != DW_DLV_OK) 
             break;
         // Doc says first die is compilation unit
-        if (dwarf_siblingof(dbg, 0, &cu_die, 0) != DW_DLV_OK)
+        if (dwarf_siblingof(line_dbg, 0, &cu_die, 0) != DW_DLV_OK)
             continue;
         if ( (dwarf_tag(cu_die, &tag, 0) != DW_DLV_OK) ||
-             (tag != DW_TAG_compile_unit))
+             (tag != DW_TAG_compile_unit) ||
+             dwarf_dieoffset(cu_die, &off, 0) != DW_DLV_OK)
         {
-            dwarf_dealloc(dbg, cu_die, DW_DLA_DIE);
+            dwarf_dealloc(line_dbg, cu_die, DW_DLA_DIE);
             continue;
         }
-        dres = dwarf_srclines(cu_die, &line_buf, &line_count, 0);
-        if (dres != DW_DLV_OK)
-        {
-            dwarf_dealloc(dbg, cu_die, DW_DLA_DIE);
-            continue;
+        dwarf_dealloc(line_dbg, cu_die, DW_DLA_DIE);
+        if (line_ncus == cus_cap) {
+            cus_cap = cus_cap ? 2*cus_cap : 64;
+            line_cus = (line_cu_t*) line_realloc(line_cus,
+                                                 cus_cap * sizeof(line_cu_t));
         }
-        for (i = 0; i < line_count; i++)
-        {
-            Dwarf_Addr line_addr;
-            Dwarf_Unsigned line_num, file_num;
-            Dwarf_Signed line_off;
-            Dwarf_Bool line_end;
-            char* file_name;
-            
-            dwarf_lineaddr(line_buf[i], &line_addr, 0);
-            dwarf_lineno(line_buf[i], &line_num, 0);
-            dwarf_line_srcfileno(line_buf[i], &file_num, 0);
-            dwarf_lineoff(line_buf[i], &line_off, 0);
-            dwarf_lineendsequence(line_buf[i], &line_end, 0);
+        memset(line_cus + line_ncus, 0, sizeof(line_cu_t));
+        line_cus[line_ncus++].die_offset = off;
+    }
 
-            if (file_num)
+    if (dwarf_get_aranges(line_dbg, &aranges, &naranges, 0) == DW_DLV_OK) {
+        for (i = 0; i < naranges; i++) {
+            Dwarf_Addr start;
+            Dwarf_Unsigned length;
+            Dwarf_Off cu_off;
+            xed_int64_t cu;
+            if (dwarf_get_arange_info(aranges[i], &start, &length,
+                                      &cu_off, 0) == DW_DLV_OK &&
+                length != 0 &&
+                (cu = find_cu_by_offset(cu_off)) >= 0)
             {
-                dres = dwarf_linesrc(line_buf[i], &file_name, 0);
-                if (dres == DW_DLV_OK) {
-                    
-                    if ( avl_find(&file_name_table, file_num) == 0)
-                    {
-                        avl_insert(&file_name_table,
-                                   file_num,
-                                   (void*)(xed_addr_t)global_file_num,0);
-                        
-                        avl_insert(&global_file_name_table,
-                                   global_file_num,
-                                   xed_strdup(file_name),1);
-                        global_file_num++;
-                    }
-                    dwarf_dealloc(dbg, file_name, DW_DLA_STRING);
-                }
+                add_line_range(start, start + length,
+                               XED_STATIC_CAST(xed_uint32_t, cu));
             }
-            xed_uint32_t gfn = (xed_uint32_t) (xed_addr_t) avl_find(
-                                                  &file_name_table, file_num);
-            line_number_entry_t* p =
-                 (line_number_entry_t*)malloc(sizeof(line_number_entry_t));
-            if (p == 0) {
-                fprintf(stderr, "ERROR: Could not malloc\n");
-                exit(1);
+            dwarf_dealloc(line_dbg, aranges[i], DW_DLA_ARANGE);
+        }
+        dwarf_dealloc(line_dbg, aranges, DW_DLA_LIST);
+    }
+
+    for (c = 0; c < line_ncus; c++) {
+        line_cu_t* cu = line_cus + c;
+        Dwarf_Die cu_die;
+        Dwarf_Addr low, high;
+        Dwarf_Half form;
+        enum Dwarf_Form_Class fclass;
+        if (cu->indexed)
+            continue;
+        if (dwarf_offdie(line_dbg, cu->die_offset, &cu_die, 0) == DW_DLV_OK)
+        {
+            if (dwarf_lowpc(cu_die, &low, 0) == DW_DLV_OK &&
+                dwarf_highpc_b(cu_die, &high, &form, &fclass, 0) == DW_DLV_OK)
+            {
+                if (fclass == DW_FORM_CLASS_CONSTANT)
+                    high += low;
+                if (high > low)
+                    add_line_range(low, high, c);
             }
-            line_number_entry_init(p, line_num, gfn);
-            avl_insert(&line_number_table, line_addr, p, 1);
-
-        } /* for */
-        avl_tree_clear(&file_name_table,0);
-        dwarf_srclines_dealloc(dbg, line_buf, line_count);
-        dwarf_dealloc(dbg, cu_die, DW_DLA_DIE);
-    }  /* while */
-    dwarf_finish(dbg, 0);
-    elf_end(elf);
+            dwarf_dealloc(line_dbg, cu_die, DW_DLA_DIE);
+        }
+        if (!cu->indexed) {
+            load_line_cu(cu);
+            if (cu->nrows)
+                add_line_range(cu->rows[0].addr,
+                               cu->rows[cu->nrows-1].addr, c);
+        }
+    }
+    qsort(line_ranges, line_nranges, sizeof(line_range_t), line_range_cmp);
+    for (c = 0; c < line_nranges; c++) {
+        line_ranges[c].max_hi = line_ranges[c].hi;
+        if (c && line_ranges[c-1].max_hi > line_ranges[c].hi)
+            line_ranges[c].max_hi = line_ranges[c-1].max_hi;
+    }
+    /* the line tables are used until exit; dwarf_finish() and elf_end()
+       are left to process teardown */
 }
-
 #endif
 ////////////////////////////////////////////////////////////////////////////
 
@@ -251,8 +490,8 @@ lookup64(Elf64_Word stoffset,
   return q;
 }
 
-void xed_disas_elf_init(void) {
-    xed_register_disassembly_callback(xed_disassembly_callback_function);
+void xed_disas_elf_init(xed_disas_info_t* fi) {
+    xed_disas_info_set_formatter(fi, xed_disassembly_callback_function);
 }
 
 
@@ -289,6 +528,14 @@ disas_test32(xed_disas_info_t* fi,
 #if defined(XED_DWARF)
   fi->line_number_info_fn = find_line_number_info;
 #endif
+  if (fi->index_set) {
+      xed_disas_index_add(fi, symbol_table);
+      return;
+  }
+  if (fi->cfg) {
+      xed_disas_cfg(fi, symbol_table);
+      return;
+  }
   // pass in a function to retrieve valid symbol names
   xed_disas_test(fi);
 }
@@ -327,6 +574,14 @@ disas_test64(xed_disas_info_t* fi,
 #if defined(XED_DWARF)
   fi->line_number_info_fn = find_line_number_info;
 #endif
+  if (fi->index_set) {
+      xed_disas_index_add(fi, symbol_table);
+      return;
+  }
+  if (fi->cfg) {
+      xed_disas_cfg(fi, symbol_table);
+      return;
+  }
   // pass in a function to retrieve valid symbol names
   xed_disas_test(fi);
 }
@@ -517,11 +772,10 @@ void read_symbols64(void* start,
     while(p<q) {
         if (ELF64_ST_TYPE(p->st_info) == STT_FUNC) {
             char* name = lookup64(p->st_name, start, len, string_table_offset);
-            if (name && xed_strlen(name) > 0) {
-                xst_add_local_symbol(
-                    symtab,
-                    XED_STATIC_CAST(xed_uint64_t,p->st_value), 
-                    name, p->st_shndx);
+            if (name && name[0]) {
+                xst_bulk_add(symtab,
+                             XED_STATIC_CAST(xed_uint64_t,p->st_value),
+                             name, p->st_shndx);
             }
         }
         p++; 
@@ -563,6 +817,7 @@ symbols_elf64(xed_disas_info_t* fi,
     Elf64_Half sect_strings  = elf_hdr->e_shstrndx;
     Elf64_Off string_table_offset=0;
     Elf64_Off dynamic_string_table_offset=0;
+    xed_uint64_t nsyms = 0;
     unsigned char* hard_limit = (unsigned char*)start + len;
 
     /* find the string_table_offset and the dynamic_string_table_offset */
@@ -597,6 +852,16 @@ symbols_elf64(xed_disas_info_t* fi,
             }
         }
     }
+    /* size the bulk symbol array from the section headers */
+    for( i=0;i<nsect;i++)  {
+        if (range_check(shp+i, sizeof(Elf64_Shdr), start, hard_limit))
+            break;
+        if (shp[i].sh_type == SHT_SYMTAB || shp[i].sh_type == SHT_DYNSYM)
+            nsyms += shp[i].sh_size / sizeof(Elf64_Sym);
+    }
+    if (nsyms < len / sizeof(Elf64_Sym))
+        xst_bulk_reserve(symtab, nsyms);
+
     /* now read the symbols */
     for( i=0;i<nsect;i++)  {
         if (range_check(shp+i, sizeof(Elf64_Shdr), start, hard_limit))
@@ -617,6 +882,7 @@ symbols_elf64(xed_disas_info_t* fi,
                            dynamic_string_table_offset, symtab);
         }
     }
+    xst_bulk_finish(symtab, fi->cfg_threads);
 }
 
 
@@ -644,11 +910,10 @@ read_symbols32(void* start,
     while(p<q) {
         if (ELF32_ST_TYPE(p->st_info) == STT_FUNC) {
             char* name = lookup32(p->st_name, start, len, string_table_offset);
-            if (name && xed_strlen(name) > 0) {
-                xst_add_local_symbol(
-                    symtab,
-                    XED_STATIC_CAST(xed_uint64_t,p->st_value), 
-                    name, p->st_shndx);
+            if (name && name[0]) {
+                xst_bulk_add(symtab,
+                             XED_STATIC_CAST(xed_uint64_t,p->st_value),
+                             name, p->st_shndx);
             }
         }
         p++; 
@@ -673,6 +938,7 @@ symbols_elf32(xed_disas_info_t* fi,
     Elf32_Off string_table_offset=0;
     Elf32_Off dynamic_string_table_offset=0;
     int sect_strings  = elf_hdr->e_shstrndx;
+    xed_uint64_t nsyms = 0;
     unsigned char* hard_limit = (unsigned char*)start + len;
 
     if ((void*)shp < start)
@@ -706,6 +972,16 @@ symbols_elf32(xed_disas_info_t* fi,
         }
     }
 
+    /* size the bulk symbol array from the section headers */
+    for( i=0;i<nsect;i++)  {
+        if (range_check(shp+i, sizeof(Elf32_Shdr), start, hard_limit))
+            break;
+        if (shp[i].sh_type == SHT_SYMTAB || shp[i].sh_type == SHT_DYNSYM)
+            nsyms += shp[i].sh_size / sizeof(Elf32_Sym);
+    }
+    if (nsyms < len / sizeof(Elf32_Sym))
+        xst_bulk_reserve(symtab, nsyms);
+
     /* now read the symbols */
     for( i=0;i<nsect;i++)  {
         if (range_check(shp+i, sizeof(Elf32_Shdr), start, hard_limit))
@@ -727,6 +1003,7 @@ symbols_elf32(xed_disas_info_t* fi,
                            dynamic_string_table_offset, symtab);
         }
     }
+    xst_bulk_finish(symtab, fi->cfg_threads);
 }
 
 
@@ -737,7 +1014,7 @@ xed_disas_elf(xed_disas_info_t* fi)
     unsigned int len = 0;
     xed_symbol_table_t symbol_table;
     
-    xed_disas_elf_init();
+    xed_disas_elf_init(fi);
     xed_map_region(fi->input_file_name, &region, &len);
     xed_symbol_table_init(&symbol_table);
 
@@ -66,7 +66,7 @@ xed_uint_t disas_filter(xed_decoded_inst_t *inst, char *prefix, xed_disas_info_t
     char line[LINELEN];
 
     di->symfn = get_symbol;
-    xed_register_disassembly_callback(xed_disassembly_callback_function);
+    xed_disas_info_set_formatter(di, xed_disassembly_callback_function);
     while (fgets(line, LINELEN, stdin)) {
         xed_error_enum_t err;
         char *insn = strstr(line, prefix), *ip;
@@ -22,6 +22,8 @@ END_LEGAL */
 #if defined(XED_DECODER)
 #include "xed-examples-util.h"
 #include "xed-disas-hex.h"
+#include "xed-disas-cfg.h"
+#include "xed-disas-index.h"
 
 #include <stdlib.h>
 #include <assert.h>
@@ -104,9 +106,16 @@ xed_disas_hex(xed_disas_info_t* fi)
     fi->runtime_vaddr = 0;
     fi->runtime_vaddr_disas_start = 0;
     fi->runtime_vaddr_disas_end = 0;
-    fi->symfn = 0;
-    fi->caller_symbol_data = 0;
+    // fi->symfn and fi->caller_symbol_data come from the caller (xed -S)
     fi->line_number_info_fn = 0;
+    if (fi->index_set) {
+        xed_disas_index_add(fi, 0);
+        return;
+    }
+    if (fi->cfg) {
+        xed_disas_cfg(fi, 0);
+        return;
+    }
     xed_disas_test(fi);
     if (fi->xml_format == 0)
         xed_print_decode_stats(fi);
@@ -0,0 +1,110 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-disas-index.c
+
+#include "xed/xed-interface.h"
+#if defined(XED_DECODER)
+#include "xed-disas-index.h"
+#include "xed-disas-cfg.h"
+#include <stdlib.h>
+
+void xed_disas_index_add(xed_disas_info_t* fi, xed_symbol_table_t* symtab)
+{
+    xed_uint64_t nbytes = XED_STATIC_CAST(xed_uint64_t, fi->q - fi->a);
+    xed_cfg_t* cfg = 0;
+    if (fi->index_recursive) {
+        cfg = (xed_cfg_t*) malloc(sizeof(xed_cfg_t));
+        if (!cfg)
+            xedex_derror("Could not malloc");
+        xed_cfg_init(cfg, &fi->dstate, fi->chip, fi->a, nbytes,
+                     fi->runtime_vaddr);
+        xed_disas_cfg_add_entries(fi, cfg, symtab);
+        xed_cfg_build(cfg, fi->cfg_threads);
+    }
+    xed_inst_index_set_add(fi->index_set, fi->a, nbytes,
+                           fi->runtime_vaddr, cfg);
+}
+
+static void print_addr(char const* label, xed_bool_t found, xed_uint64_t a)
+{
+    if (found)
+        printf(" %s 0x" XED_FMT_LX, label, a);
+    else
+        printf(" %s -", label);
+}
+
+static void answer_queries(xed_disas_info_t* fi,
+                           xed_inst_index_set_t const* set)
+{
+    unsigned int i;
+    for (i = 0; i < fi->index_nqueries; i++) {
+        xed_uint64_t addr = fi->index_queries[i];
+        xed_inst_index_t const* idx = xed_inst_index_set_find(set, addr);
+        xed_uint64_t a = 0;
+        xed_uint32_t len = 0;
+        xed_bool_t found;
+
+        printf("QUERY 0x" XED_FMT_LX, addr);
+        if (!idx) {
+            printf(" not indexed\n");
+            continue;
+        }
+        found = xed_inst_index_find(idx, addr, &a, &len);
+        print_addr("inst", found, a);
+        if (found)
+            printf(" len %u", len);
+        found = xed_inst_index_prev(idx, addr, &a);
+        print_addr("prev", found, a);
+        found = xed_inst_index_next(idx, addr, &a);
+        print_addr("next", found, a);
+        printf("\n");
+    }
+}
+
+void xed_disas_index_finish(xed_disas_info_t* fi)
+{
+    xed_inst_index_set_t* set = fi->index_set;
+    xed_uint32_t i;
+
+    xed_inst_index_set_build(set, &fi->dstate, fi->chip, fi->cfg_threads);
+    for (i = 0; i < set->nsections; i++) {
+        xed_inst_index_section_t* s = set->sections + i;
+        printf("# INDEX 0x" XED_FMT_LX " size " XED_FMT_LU
+               " instructions %u\n",
+               s->index.runtime_vaddr, s->index.len, s->index.ninst);
+        if (s->cfg) {
+            xed_cfg_free(s->cfg);
+            free(s->cfg);
+            s->cfg = 0;
+        }
+    }
+    if (fi->index_file &&
+        !xed_inst_index_set_write(set, fi->index_file))
+        xedex_derror("Could not write the instruction index");
+    answer_queries(fi, set);
+}
+
+void xed_disas_index_query_file(xed_disas_info_t* fi)
+{
+    xed_inst_index_set_t set;
+    if (!xed_inst_index_set_read(&set, fi->index_file))
+        xedex_derror("Could not read the instruction index");
+    answer_queries(fi, &set);
+    xed_inst_index_set_free(&set);
+}
+#endif
@@ -0,0 +1,41 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-disas-index.h
+
+#if !defined(XED_DISAS_INDEX_H)
+# define XED_DISAS_INDEX_H
+
+#include "xed/xed-interface.h"
+#include "xed-examples-util.h"
+#include "xed-symbol-table.h"
+#include "xed-inst-index.h"
+
+/* Add the region described by fi to fi->index_set. With
+   fi->index_recursive, the region's control flow graph is built now,
+   seeded as for -cfg; otherwise it is decoded linearly when the set is
+   built. symtab may be 0. */
+void xed_disas_index_add(xed_disas_info_t* fi, xed_symbol_table_t* symtab);
+
+/* Build fi->index_set, one section per thread, write it to
+   fi->index_file if given and answer the queries. */
+void xed_disas_index_finish(xed_disas_info_t* fi);
+
+/* Answer the queries from the index in fi->index_file */
+void xed_disas_index_query_file(xed_disas_info_t* fi);
+
+#endif
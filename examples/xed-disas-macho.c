@@ -29,6 +29,7 @@ END_LEGAL */
 #include "xed-disas-macho.h"
 #include "xed-examples-util.h"
 #include "xed-symbol-table.h"
+#include "xed-disas-index.h"
 
 #include <string.h>
 
@@ -142,7 +143,10 @@ process_segment32( xed_uint_t* sectoff,
           decode_info->input_file_name   = decode_info->input_file_name;
           decode_info->line_number_info_fn = 0;
           xst_set_current_table(symbol_table,i+1 + *sectoff);
-          xed_disas_test(decode_info);
+          if (decode_info->index_set)
+              xed_disas_index_add(decode_info, symbol_table);
+          else
+              xed_disas_test(decode_info);
 
         }
     }
@@ -192,7 +196,10 @@ process_segment64( xed_uint_t* sectoff,
           decode_info->input_file_name   = decode_info->input_file_name;
           decode_info->line_number_info_fn = 0;
           xst_set_current_table(symbol_table,i + 1 + *sectoff);
-          xed_disas_test(decode_info);
+          if (decode_info->index_set)
+              xed_disas_index_add(decode_info, symbol_table);
+          else
+              xed_disas_test(decode_info);
 
         }
 
@@ -437,8 +444,8 @@ process_macho(xed_uint8_t* start,
     (void) length;
 }
 
-void xed_disas_macho_init(void) {
-    xed_register_disassembly_callback(xed_disassembly_callback_function);
+void xed_disas_macho_init(xed_disas_info_t* fi) {
+    xed_disas_info_set_formatter(fi, xed_disassembly_callback_function);
 }
 
 
@@ -449,7 +456,7 @@ xed_disas_macho(xed_disas_info_t* fi)
     void* vregion = 0;
     unsigned int len = 0;
 
-    xed_disas_macho_init();
+    xed_disas_macho_init(fi);
     xed_map_region(fi->input_file_name, &vregion, &len);
 
     region = XED_CAST(xed_uint8_t*,vregion);
@@ -39,6 +39,7 @@ extern "C" {
 
 // This really must be after the windows.h include
 #include "xed-symbol-table.h"
+#include "xed-disas-index.h"
 }
 
 #if defined(XED_DBGHELP)
@@ -565,12 +566,15 @@ int xed_pecoff_callback_function(
 }
 #endif
 
-void xed_disas_pecoff_init() {
+void xed_disas_pecoff_init(xed_disas_info_t& decode_info) {
 #if defined(XED_USING_DEBUG_HELP)
     if (dbg_help.valid()) {
-        //xed_register_disassembly_callback(xed_pecoff_callback_function);
-        xed_register_disassembly_callback(xed_disassembly_callback_function);
+        //xed_disas_info_set_formatter(&decode_info, xed_pecoff_callback_function);
+        xed_disas_info_set_formatter(&decode_info,
+                                     xed_disassembly_callback_function);
     }
+#else
+    (void) decode_info;
 #endif
 }
 
@@ -614,7 +618,7 @@ process_pecoff(xed_uint8_t* start,
      }
   }
 #endif
-  xed_disas_pecoff_init();
+  xed_disas_pecoff_init(decode_info);
 
   while(okay) {
       okay = reader.module_section_info(decode_info.target_section,
@@ -650,7 +654,16 @@ process_pecoff(xed_uint8_t* start,
           }
 #endif
 
-          xed_disas_test(&decode_info);
+          if (decode_info.index_set) {
+              xed_symbol_table_t* symtab = 0;
+#if defined(XED_USING_DEBUG_HELP)
+              if (dbg_help.valid())
+                  symtab = &(dbg_help.sym_tab);
+#endif
+              xed_disas_index_add(&decode_info, symtab);
+          }
+          else
+              xed_disas_test(&decode_info);
       }
   }
   if (!found)
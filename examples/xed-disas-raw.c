@@ -21,6 +21,8 @@ END_LEGAL */
 #if defined(XED_DECODER)
 #include "xed-examples-util.h"
 #include "xed-disas-raw.h"
+#include "xed-disas-cfg.h"
+#include "xed-disas-index.h"
 
 void xed_disas_raw(xed_disas_info_t* fi)
 {
@@ -34,9 +36,16 @@ void xed_disas_raw(xed_disas_info_t* fi)
     fi->runtime_vaddr = fi->fake_base;
     fi->runtime_vaddr_disas_start = 0;
     fi->runtime_vaddr_disas_end = 0;
-    fi->symfn = 0;
-    fi->caller_symbol_data = 0;
+    // fi->symfn and fi->caller_symbol_data come from the caller (xed -S)
     fi->line_number_info_fn = 0;
+    if (fi->index_set) {
+        xed_disas_index_add(fi, 0);
+        return;
+    }
+    if (fi->cfg) {
+        xed_disas_cfg(fi, 0);
+        return;
+    }
     xed_disas_test(fi);
     if (fi->xml_format == 0)
         xed_print_decode_stats(fi);
@@ -0,0 +1,106 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-enc2-cpp.cpp
+/// Use the typed C++ wrappers for the enc2 encoder. Register operands
+/// of the wrong class are rejected at compile time.
+
+#include "xed/xed-cpp-enc2-m64-a64.h"
+#include <cstdio>
+
+namespace enc = xed::enc2::m64_a64;
+
+// Compile-time validated operands.
+static constexpr enc::gpr64_t rbx(XED_REG_RBX);
+static constexpr enc::gpr64_t r11(XED_REG_R11);
+static constexpr enc::gpr64_t r12(XED_REG_R12);
+static constexpr enc::gpr64_index_t r13(XED_REG_R13);
+static constexpr enc::gpr8_t ah(XED_REG_AH);
+static constexpr enc::scale_t scale1(1);
+
+static xed_uint32_t encode_lea(xed_uint8_t* output_buffer)
+{
+    xed_enc2_req_t request;
+    xed_enc2_req_t_init(&request, output_buffer);
+    enc::lea_r64_m_bisd32_a64(&request, r11, r12, r13, scale1, 0x11223344);
+    return xed_enc2_encoded_length(&request);
+}
+
+static xed_uint32_t encode_vpblendvb(xed_uint8_t* output_buffer)
+{
+    xed_enc2_req_t request;
+    xed_enc2_req_t_init(&request, output_buffer);
+    // registers chosen at run time are validated when the operand is built
+    enc::xmm_avx_t regs[4] = { enc::xmm_avx_t(XED_REG_XMM6),
+                               enc::xmm_avx_t(XED_REG_XMM7),
+                               enc::xmm_avx_t(XED_REG_XMM8),
+                               enc::xmm_avx_t(XED_REG_XMM9) };
+    enc::vpblendvb_x_x_x_x_128(&request, regs[0], regs[1], regs[2], regs[3]);
+    return xed_enc2_encoded_length(&request);
+}
+
+static xed_uint32_t encode_add_lock_byte(xed_uint8_t* output_buffer)
+{
+    xed_enc2_req_t request;
+    xed_enc2_req_t_init(&request, output_buffer);
+    enc::add_lock_m8_r8_b_a64(&request, rbx, ah);
+    // enc::add_lock_m8_r8_b_a64(&request, ah, rbx);  // does not compile
+    return xed_enc2_encoded_length(&request);
+}
+
+static int decode(xed_uint8_t* buf, xed_uint32_t len)
+{
+    xed_decoded_inst_t xedd;
+    xed_error_enum_t err;
+    char out[200];
+
+    xed_decoded_inst_zero(&xedd);
+    xed_decoded_inst_set_mode(&xedd, XED_MACHINE_MODE_LONG_64,
+                              XED_ADDRESS_WIDTH_64b);
+    err = xed_decode(&xedd, buf, len);
+    if (err != XED_ERROR_NONE) {
+        std::printf("ERROR: %s\n", xed_error_enum_t2str(err));
+        return 1;
+    }
+    if (xed_format_context(XED_SYNTAX_INTEL, &xedd, out, sizeof(out), 0, 0, 0))
+        std::printf("Disassembly: %s\n", out);
+    else
+        std::printf("Disassembly: %%ERROR%%\n");
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    typedef xed_uint32_t (*encode_fn_t)(xed_uint8_t* output_buffer);
+    static const encode_fn_t tests[] = { encode_lea,
+                                         encode_vpblendvb,
+                                         encode_add_lock_byte };
+    xed_uint8_t output_buffer[XED_MAX_INSTRUCTION_BYTES];
+    int retval = 0;
+
+    xed_tables_init();
+    for (encode_fn_t fn : tests) {
+        xed_uint32_t enclen = fn(output_buffer);
+        std::printf("Encoded:");
+        for (xed_uint32_t i = 0; i < enclen; i++)
+            std::printf(" %02x", output_buffer[i]);
+        std::printf("\n");
+        retval += decode(output_buffer, enclen);
+    }
+    (void)argc; (void)argv;
+    return retval;
+}
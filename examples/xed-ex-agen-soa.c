@@ -0,0 +1,272 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-ex-agen-soa.c
+
+// Compile the memory operands of one instruction into addressing
+// descriptors and evaluate them over a table of pseudo-random register
+// states, checking every address against xed_agen_snapshot(). Every
+// evaluation kernel the host supports is checked; -kernel picks the one
+// whose results are printed and timed. With -time it also reports cycles
+// per state for both methods.
+
+#include "xed/xed-interface.h"
+#include "xed/xed-get-time.h"
+#include "xed-examples-util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> //strcmp, strlen, memset
+#include <assert.h>
+
+int main(int argc, char** argv);
+
+static void usage(char const* prog) {
+    fprintf(stderr,
+            "Usage: %s [-16|-32|-64|-r] [-n states] "
+            "[-kernel auto|c|avx2|avx512] [-time] hex-bytes...\n",
+            prog);
+    exit(1);
+}
+
+#define NGPR (XED_REG_GPR64_LAST - XED_REG_GPR64_FIRST + 1)
+#define NSEG (XED_REG_SR_LAST - XED_REG_SR_FIRST + 1)
+
+static char const* kernel_names[XED_AGEN_KERNEL_LAST] = {
+    "auto", "c", "avx2", "avx512"
+};
+
+static xed_uint64_t lcg_state = 1;
+static xed_uint64_t lcg(void) {
+    lcg_state = lcg_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return lcg_state;
+}
+
+static xed_uint64_t* column(xed_uint32_t n) {
+    xed_uint64_t* p = (xed_uint64_t*)malloc(n * sizeof(xed_uint64_t));
+    assert(p != 0);
+    return p;
+}
+
+static void snapshot_row(xed_agen_soa_t const* soa, xed_uint32_t i,
+                         xed_agen_snapshot_t* snap)
+{
+    xed_uint_t r;
+    memset(snap, 0, sizeof(*snap));
+    for(r=0;r<NGPR;r++)
+        snap->gpr[r] = soa->gpr[r][i];
+    for(r=0;r<NSEG;r++)
+        if (soa->seg_base[r])
+            snap->seg_base[r] = soa->seg_base[r][i];
+    snap->rip = soa->rip[i];
+}
+
+int main(int argc, char** argv) {
+    xed_state_t dstate;
+    xed_decoded_inst_t xedd;
+    xed_agen_soa_t soa;
+    xed_agen_snapshot_t snap;
+    xed_uint64_t* out;
+    char buffer[200];
+    char const* hex_text = 0;
+    xed_uint8_t* bytes;
+    unsigned int len, nbytes;
+    xed_uint32_t nstates = 1000, i, r;
+    xed_uint_t memops, m;
+    xed_bool_t timing = 0;
+    xed_agen_kernel_enum_t kernel = XED_AGEN_KERNEL_AUTO, k;
+    xed_error_enum_t err;
+    int a;
+
+    xed_tables_init();
+    xed_state_zero(&dstate);
+    dstate.mmode = XED_MACHINE_MODE_LONG_64;
+    dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+
+    for(a=1;a<argc;a++) {
+        if (strcmp(argv[a],"-64") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LONG_64;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+        }
+        else if (strcmp(argv[a],"-32") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LEGACY_32;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_32b;
+        }
+        else if (strcmp(argv[a],"-16") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LEGACY_16;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_16b;
+        }
+        else if (strcmp(argv[a],"-r") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_REAL_16;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_16b;
+        }
+        else if (strcmp(argv[a],"-n") == 0) {
+            if (a+1 >= argc)
+                usage(argv[0]);
+            nstates = XED_STATIC_CAST(xed_uint32_t, strtoul(argv[++a],0,0));
+            if (nstates == 0)
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[a],"-kernel") == 0) {
+            if (a+1 >= argc)
+                usage(argv[0]);
+            a++;
+            for(k=XED_AGEN_KERNEL_AUTO;k<XED_AGEN_KERNEL_LAST;k++)
+                if (strcmp(argv[a], kernel_names[k]) == 0)
+                    break;
+            if (k == XED_AGEN_KERNEL_LAST)
+                usage(argv[0]);
+            kernel = k;
+        }
+        else if (strcmp(argv[a],"-time") == 0)
+            timing = 1;
+        else if (argv[a][0] == '-')
+            usage(argv[0]);
+        else
+            hex_text = xedex_append_string(hex_text, argv[a]);
+    }
+    if (!hex_text)
+        usage(argv[0]);
+    len = XED_STATIC_CAST(unsigned int, strlen(hex_text));
+    if (len & 1) {
+        fprintf(stderr, "Must supply even number of nibbles\n");
+        exit(1);
+    }
+    bytes = (xed_uint8_t*)malloc(len/2 + 1);
+    assert(bytes != 0);
+    nbytes = xed_convert_ascii_to_hex(hex_text, bytes, len/2);
+    if (!xed_agen_kernel_available(kernel)) {
+        fprintf(stderr, "Kernel %s is not available on this host\n",
+                kernel_names[kernel]);
+        exit(1);
+    }
+
+    xed_decoded_inst_zero_set_mode(&xedd, &dstate);
+    err = xed_decode(&xedd, bytes, nbytes);
+    if (err != XED_ERROR_NONE) {
+        fprintf(stderr, "Decode error: %s\n", xed_error_enum_t2str(err));
+        exit(1);
+    }
+    if (!xed_format_context(XED_SYNTAX_INTEL, &xedd, buffer,
+                            sizeof(buffer), 0, 0, 0))
+        strcpy(buffer, "???");
+    printf("%s\n", buffer);
+
+    // Build the structure-of-arrays register table. In 64b mode the
+    // ES/CS/SS/DS columns are left out: their bases are zero.
+    memset(&soa, 0, sizeof(soa));
+    for(r=0;r<NGPR;r++)
+        soa.gpr[r] = column(nstates);
+    for(r=0;r<NSEG;r++)
+        if (dstate.mmode != XED_MACHINE_MODE_LONG_64 ||
+            r + XED_REG_SR_FIRST == XED_REG_FS ||
+            r + XED_REG_SR_FIRST == XED_REG_GS)
+            soa.seg_base[r] = column(nstates);
+    soa.rip = column(nstates);
+    for(i=0;i<nstates;i++) {
+        for(r=0;r<NGPR;r++)
+            XED_CAST(xed_uint64_t*, soa.gpr[r])[i] = lcg();
+        for(r=0;r<NSEG;r++) {
+            xed_uint64_t v = lcg();
+            if (!soa.seg_base[r])
+                continue;
+            if (dstate.mmode == XED_MACHINE_MODE_LEGACY_32)
+                v &= 0xFFFFFFFF;
+            else if (dstate.mmode != XED_MACHINE_MODE_LONG_64)
+                v = (v & 0xFFFF) << 4; // selector * 16
+            XED_CAST(xed_uint64_t*, soa.seg_base[r])[i] = v;
+        }
+        XED_CAST(xed_uint64_t*, soa.rip)[i] = lcg();
+    }
+
+    out = column(nstates);
+    memops = xed_decoded_inst_number_of_memory_operands(&xedd);
+    printf("Number of memory operands: %u\n", memops);
+    for(m=0;m<memops && m<2;m++) {
+        xed_agen_desc_t desc;
+        xed_uint32_t bad = 0, kbad = 0;
+
+        err = xed_agen_desc_init(&xedd, m, &desc);
+        if (err != XED_ERROR_NONE) {
+            printf("memop%u: %s\n", m, xed_error_enum_t2str(err));
+            continue;
+        }
+
+        // Check the explicit kernels first and the selected one last, so
+        // that out holds its results. Only mismatches name a kernel: the
+        // output must not depend on which kernels the host has.
+        for(k=XED_AGEN_KERNEL_C;k<=XED_AGEN_KERNEL_LAST;k++) {
+            xed_agen_kernel_enum_t kk = k;
+            if (k == XED_AGEN_KERNEL_LAST)
+                kk = kernel;
+            if (k != XED_AGEN_KERNEL_LAST &&
+                (k == kernel || !xed_agen_kernel_available(k)))
+                continue;
+            err = xed_agen_desc_eval_kernel(&desc, &soa, nstates, out, kk);
+            if (err != XED_ERROR_NONE) {
+                printf("memop%u kernel %s: %s\n", m, kernel_names[kk],
+                       xed_error_enum_t2str(err));
+                exit(1);
+            }
+            bad = 0;
+            for(i=0;i<nstates;i++) {
+                xed_uint64_t expected = 0;
+                snapshot_row(&soa, i, &snap);
+                xed_agen_snapshot(&xedd, m, &snap, &expected);
+                if (out[i] != expected) {
+                    if (bad < 4)
+                        printf("memop%u kernel %s state %u: 0x" XED_FMT_LX16
+                               " expected 0x" XED_FMT_LX16 "\n",
+                               m, kernel_names[kk], i, out[i], expected);
+                    bad++;
+                }
+            }
+            if (k != XED_AGEN_KERNEL_LAST)
+                kbad += bad;
+        }
+        for(i=0;i<nstates && i<4;i++)
+            printf("memop%u state %u: 0x" XED_FMT_LX16 "\n", m, i, out[i]);
+        printf("memop%u: %u of %u states match xed_agen_snapshot\n",
+               m, nstates-bad, nstates);
+
+        if (timing) {
+            // repeat the (cheap) descriptor evaluation to get a stable
+            // number once the columns are cache resident.
+            xed_uint32_t reps = 1 + 10000000 / nstates;
+            xed_uint64_t t1, t2, t3;
+            xed_uint64_t sum = 0;
+            t1 = xed_get_time();
+            for(r=0;r<reps;r++)
+                xed_agen_desc_eval_kernel(&desc, &soa, nstates, out, kernel);
+            t2 = xed_get_time();
+            for(i=0;i<nstates;i++) {
+                xed_uint64_t x = 0;
+                snapshot_row(&soa, i, &snap);
+                xed_agen_snapshot(&xedd, m, &snap, &x);
+                sum += x;
+            }
+            t3 = xed_get_time();
+            printf("memop%u: desc_eval %.2f cycles/state, "
+                   "snapshot %.2f cycles/state (checksum "
+                   XED_FMT_LX16 ")\n", m,
+                   (double)(t2-t1) / ((double)nstates * reps),
+                   (double)(t3-t2) / nstates, sum);
+        }
+        if (bad || kbad)
+            exit(1);
+    }
+    return 0;
+}
@@ -313,5 +313,31 @@ main(int argc, char** argv)
         }
         printf("\tMemory agen%d: 0x" XED_FMT_LX16 "\n", (int)memop_index, out_addr);
     }
+
+    // The same computation against a register snapshot. No callbacks are
+    // involved so this is safe to use from many threads at once. The
+    // snapshot holds the same (fake) values the register callback
+    // returns.
+    if (memops) {
+        xed_agen_snapshot_t snap;
+        xed_uint64_t snap_addr[2];
+        memset(&snap, 0, sizeof(snap));
+        snap.gpr[XED_REG_RAX - XED_REG_GPR64_FIRST] = 0xAABBCC00;
+        snap.gpr[XED_REG_RCX - XED_REG_GPR64_FIRST] = 0xAABBCCDD;
+        snap.gpr[XED_REG_RBX - XED_REG_GPR64_FIRST] = 0x11223344;
+        snap.gpr[XED_REG_RSI - XED_REG_GPR64_FIRST] = 0x1122334455ULL;
+        snap.gpr[XED_REG_RDI - XED_REG_GPR64_FIRST] = 0x6655443322ULL;
+        snap.rip = 0x7990100020003000ULL;
+        
+        xed_error = xed_agen_snapshot_block(&xedd, 1, &snap, snap_addr);
+        if (xed_error != XED_ERROR_NONE) {
+            fprintf(stderr,"Snapshot agen error code %s\n",
+                    xed_error_enum_t2str(xed_error));
+            exit(1);
+        }
+        for(memop_index=0;memop_index<memops;memop_index++) 
+            printf("\tSnapshot agen%d: 0x" XED_FMT_LX16 "\n",
+                   (int)memop_index, snap_addr[memop_index]);
+    }
     return 0;
 }
@@ -0,0 +1,296 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-ex-decode-cache.c
+
+// Check the on-disk decode cache against a file. The file's bytes are
+// decoded as one region through a fresh cache directory: the first
+// xed_decode_cache_get() must miss and store the entry and the second
+// must hit it. Then the stored file is damaged in several ways --
+// truncated, emptied, its magic changed, bytes appended -- and each time
+// the next get must treat it as a miss and rewrite the same file. The
+// entries must always match a fresh decode of the bytes.
+
+#include "xed/xed-interface.h"
+#include "xed-examples-util.h"
+#include "xed-decode-cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> //strcmp, memcmp
+#include <assert.h>
+#if defined(_WIN32)
+# include <direct.h>
+# include <process.h>
+#else
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+int main(int argc, char** argv);
+
+static void usage(char const* prog) {
+    fprintf(stderr, "Usage: %s [-16|-32|-64] file\n", prog);
+    exit(1);
+}
+
+static unsigned int failures = 0;
+
+static void check(char const* what, xed_bool_t ok) {
+    printf("%s: %s\n", what, ok ? "OK" : "FAILED");
+    if (!ok)
+        failures++;
+}
+
+static xed_bool_t same_records(xed_decode_cache_t const* a,
+                               xed_decode_cache_t const* b) {
+    xed_uint32_t n = a->ninst;
+    return a->key == b->key && a->len == b->len && n == b->ninst &&
+        memcmp(a->offset, b->offset, n * sizeof(a->offset[0])) == 0 &&
+        memcmp(a->iform, b->iform, n * sizeof(a->iform[0])) == 0 &&
+        memcmp(a->length, b->length, n) == 0 &&
+        memcmp(a->summary, b->summary, n) == 0;
+}
+
+/* A new directory under the temporary directory. The caller frees the
+   name. */
+static char* make_scratch_dir(void) {
+    char const* tmp = getenv("TMPDIR");
+    char* dir;
+    unsigned int i;
+#if defined(_WIN32)
+    unsigned long pid = XED_STATIC_CAST(unsigned long, _getpid());
+    if (!tmp)
+        tmp = getenv("TEMP");
+    if (!tmp)
+        tmp = ".";
+#else
+    unsigned long pid = XED_STATIC_CAST(unsigned long, getpid());
+    if (!tmp)
+        tmp = "/tmp";
+#endif
+    dir = (char*)malloc(strlen(tmp) + 48);
+    assert(dir != 0);
+    for(i=0;i<100;i++) {
+        sprintf(dir, "%s/xed-decode-cache.%lu.%u", tmp, pid, i);
+#if defined(_WIN32)
+        if (_mkdir(dir) == 0)
+#else
+        if (mkdir(dir, 0700) == 0)
+#endif
+            return dir;
+    }
+    fprintf(stderr, "Could not make a directory under %s\n", tmp);
+    exit(1);
+}
+
+static void remove_dir(char const* dir) {
+#if defined(_WIN32)
+    _rmdir(dir);
+#else
+    rmdir(dir);
+#endif
+}
+
+/* The entry file for key, named as xed-decode-cache.c names them. The
+   caller frees it. */
+static char* entry_path(char const* dir, xed_uint64_t key) {
+    char* fn = (char*)malloc(strlen(dir) + 32);
+    assert(fn != 0);
+    sprintf(fn, "%s/%08x%08x.xdc", dir,
+            XED_STATIC_CAST(unsigned int, key >> 32),
+            XED_STATIC_CAST(unsigned int, key & 0xFFFFFFFFu));
+    return fn;
+}
+
+/* Read a whole file. Returns 0 if it cannot be read. */
+static xed_uint8_t* read_file(char const* fn, size_t* len) {
+    FILE* f = fopen(fn, "rb");
+    xed_uint8_t* p;
+    long n;
+    if (!f)
+        return 0;
+    if (fseek(f, 0, SEEK_END) != 0 || (n = ftell(f)) < 0 ||
+        fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return 0;
+    }
+    *len = XED_STATIC_CAST(size_t, n);
+    p = (xed_uint8_t*)malloc(*len + 1);
+    assert(p != 0);
+    if (fread(p, 1, *len, f) != *len) {
+        fclose(f);
+        free(p);
+        return 0;
+    }
+    fclose(f);
+    return p;
+}
+
+static void write_file(char const* fn, xed_uint8_t const* p, size_t len) {
+    FILE* f = fopen(fn, "wb");
+    if (!f || fwrite(p, 1, len, f) != len || fclose(f) != 0) {
+        fprintf(stderr, "Could not write %s\n", fn);
+        exit(1);
+    }
+}
+
+/* Load the region through the cache and compare with a fresh decode */
+static void get_and_check(char const* what,
+                          char const* dir,
+                          xed_state_t const* dstate,
+                          xed_uint8_t const* region,
+                          xed_uint64_t len,
+                          xed_decode_cache_t const* fresh,
+                          xed_bool_t expect_hit) {
+    xed_decode_cache_t c;
+    char buf[200];
+    xed_bool_t hit = xed_decode_cache_get(&c, dir, dstate, XED_CHIP_INVALID,
+                                          region, len);
+    sprintf(buf, "%s: %s, %u instructions", what, hit ? "hit" : "miss",
+            c.ninst);
+    check(buf, hit == expect_hit && same_records(&c, fresh));
+    xed_decode_cache_release(&c);
+}
+
+int main(int argc, char** argv) {
+    xed_state_t dstate;
+    xed_decode_cache_t fresh, other;
+    char const* input = 0;
+    void* region;
+    unsigned int len;
+    xed_uint8_t* copy;
+    xed_uint8_t* good;
+    xed_uint8_t* now;
+    size_t good_len, now_len;
+    char* dir;
+    char* fn;
+    char* other_fn;
+    unsigned int i;
+    int a;
+
+    xed_tables_init();
+    xed_state_zero(&dstate);
+    dstate.mmode = XED_MACHINE_MODE_LONG_64;
+    dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+
+    for(a=1;a<argc;a++) {
+        if (strcmp(argv[a],"-64") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LONG_64;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+        }
+        else if (strcmp(argv[a],"-32") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LEGACY_32;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_32b;
+        }
+        else if (strcmp(argv[a],"-16") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LEGACY_16;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_16b;
+        }
+        else if (argv[a][0] == '-' || input)
+            usage(argv[0]);
+        else
+            input = argv[a];
+    }
+    if (!input)
+        usage(argv[0]);
+    xed_map_region(input, &region, &len);
+    if (len == 0) {
+        fprintf(stderr, "Empty file %s\n", input);
+        exit(1);
+    }
+
+    xed_decode_cache_build(&fresh, &dstate, XED_CHIP_INVALID,
+                           XED_STATIC_CAST(xed_uint8_t const*, region), len);
+    dir = make_scratch_dir();
+    fn = entry_path(dir, fresh.key);
+
+    get_and_check("cold", dir, &dstate,
+                  XED_STATIC_CAST(xed_uint8_t const*, region), len,
+                  &fresh, 0);
+    good = read_file(fn, &good_len);
+    check("stored", good != 0 && good_len > 64);
+    if (!good) {
+        remove_dir(dir);
+        return 1;
+    }
+    get_and_check("warm", dir, &dstate,
+                  XED_STATIC_CAST(xed_uint8_t const*, region), len,
+                  &fresh, 1);
+
+    // damage the stored file; each time it must be rebuilt
+    for(i=0;i<5;i++) {
+        static char const* what[5] = { "truncated to half",
+                                       "truncated to the header",
+                                       "empty",
+                                       "bad magic",
+                                       "extra bytes" };
+        xed_uint8_t* bad = (xed_uint8_t*)malloc(good_len + 8);
+        size_t bad_len = good_len;
+        assert(bad != 0);
+        memcpy(bad, good, good_len);
+        if (i == 0)
+            bad_len = good_len / 2;
+        else if (i == 1)
+            bad_len = 64;
+        else if (i == 2)
+            bad_len = 0;
+        else if (i == 3)
+            bad[0] ^= 0xFF;
+        else {
+            memset(bad + good_len, 0, 8);
+            bad_len = good_len + 8;
+        }
+        write_file(fn, bad, bad_len);
+        free(bad);
+        get_and_check(what[i], dir, &dstate,
+                      XED_STATIC_CAST(xed_uint8_t const*, region), len,
+                      &fresh, 0);
+        now = read_file(fn, &now_len);
+        check("  rewritten", now != 0 && now_len == good_len &&
+              memcmp(now, good, good_len) == 0);
+        free(now);
+    }
+
+    // a changed byte is another key and another file
+    copy = (xed_uint8_t*)malloc(len);
+    assert(copy != 0);
+    memcpy(copy, region, len);
+    copy[len / 2] ^= 0xFF;
+    xed_decode_cache_build(&other, &dstate, XED_CHIP_INVALID, copy, len);
+    check("changed byte has another key", other.key != fresh.key);
+    get_and_check("changed byte", dir, &dstate, copy, len, &other, 0);
+    get_and_check("original again", dir, &dstate,
+                  XED_STATIC_CAST(xed_uint8_t const*, region), len,
+                  &fresh, 1);
+
+    other_fn = entry_path(dir, other.key);
+    remove(other_fn);
+    remove(fn);
+    remove_dir(dir);
+    free(other_fn);
+    free(fn);
+    free(dir);
+    free(copy);
+    free(good);
+    xed_decode_cache_release(&other);
+    xed_decode_cache_release(&fresh);
+    if (failures) {
+        printf("%u checks FAILED\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,154 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-ex-dep.c
+
+// Decode a straight-line sequence of instructions, build its dependence
+// graph and print the incoming edges of each instruction along with the
+// length of the longest chain of true dependences.
+
+#include "xed/xed-interface.h"
+#include "xed-examples-util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> //strcmp, strlen
+#include <assert.h>
+
+int main(int argc, char** argv);
+
+static void usage(char const* prog) {
+    fprintf(stderr, "Usage: %s [-16|-32|-64] hex-bytes...\n", prog);
+    exit(1);
+}
+
+static void print_kinds(xed_uint32_t k) {
+    static const struct {
+        xed_uint32_t bit;
+        char const* name;
+    } names[] = {
+        { XED_DEP_RAW_REG,   "RAW-REG" },
+        { XED_DEP_WAR_REG,   "WAR-REG" },
+        { XED_DEP_WAW_REG,   "WAW-REG" },
+        { XED_DEP_RAW_FLAGS, "RAW-FLAGS" },
+        { XED_DEP_WAR_FLAGS, "WAR-FLAGS" },
+        { XED_DEP_WAW_FLAGS, "WAW-FLAGS" },
+        { XED_DEP_RAW_MEM,   "RAW-MEM" },
+        { XED_DEP_WAR_MEM,   "WAR-MEM" },
+        { XED_DEP_WAW_MEM,   "WAW-MEM" },
+    };
+    xed_uint_t i;
+    for(i=0;i<sizeof(names)/sizeof(names[0]);i++)
+        if (k & names[i].bit)
+            printf(" %s", names[i].name);
+}
+
+#define MAX_INST 64
+
+int main(int argc, char** argv) {
+    xed_state_t dstate;
+    xed_decoded_inst_t xedd;
+    xed_dep_summary_t sum[MAX_INST];
+    xed_uint32_t first[MAX_INST+1];
+    xed_dep_edge_t edges[MAX_INST*(MAX_INST-1)/2];
+    xed_uint32_t depth[MAX_INST];
+    xed_dep_graph_t g;
+    char buffer[200];
+    char text[MAX_INST][200];
+    char const* hex_text = 0;
+    xed_uint8_t* bytes;
+    unsigned int len, nbytes, offset = 0;
+    xed_uint32_t ninst = 0, i, e, longest = 0;
+    int a;
+
+    xed_tables_init();
+    xed_state_zero(&dstate);
+    dstate.mmode = XED_MACHINE_MODE_LONG_64;
+    dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+
+    for(a=1;a<argc;a++) {
+        if (strcmp(argv[a],"-64") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LONG_64;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+        }
+        else if (strcmp(argv[a],"-32") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LEGACY_32;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_32b;
+        }
+        else if (strcmp(argv[a],"-16") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LEGACY_16;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_16b;
+        }
+        else if (argv[a][0] == '-')
+            usage(argv[0]);
+        else
+            hex_text = xedex_append_string(hex_text, argv[a]);
+    }
+    if (!hex_text)
+        usage(argv[0]);
+    len = XED_STATIC_CAST(unsigned int, strlen(hex_text));
+    if (len & 1) {
+        fprintf(stderr, "Must supply even number of nibbles\n");
+        exit(1);
+    }
+    bytes = (xed_uint8_t*)malloc(len/2 + 1);
+    assert(bytes != 0);
+    nbytes = xed_convert_ascii_to_hex(hex_text, bytes, len/2);
+
+    while (offset < nbytes && ninst < MAX_INST) {
+        xed_error_enum_t err;
+        xed_decoded_inst_zero_set_mode(&xedd, &dstate);
+        err = xed_decode(&xedd, bytes+offset, nbytes-offset);
+        if (err != XED_ERROR_NONE) {
+            fprintf(stderr, "Decode error at offset %u: %s\n",
+                    offset, xed_error_enum_t2str(err));
+            exit(1);
+        }
+        if (!xed_format_context(XED_SYNTAX_INTEL, &xedd, buffer,
+                                sizeof(buffer), 0, 0, 0))
+            strcpy(buffer, "???");
+        strcpy(text[ninst], buffer);
+        xed_decoded_inst_get_dep_summary(&xedd, sum+ninst);
+        offset += xed_decoded_inst_get_length(&xedd);
+        ninst++;
+    }
+
+    g.first = first;
+    g.edges = edges;
+    g.max_edges = sizeof(edges)/sizeof(edges[0]);
+    if (!xed_dep_graph_build(sum, ninst, &g)) {
+        fprintf(stderr, "Too many edges\n");
+        exit(1);
+    }
+
+    for(i=0;i<ninst;i++) {
+        depth[i] = 1;
+        printf("%u: %s\n", i, text[i]);
+        for(e=first[i];e<first[i+1];e++) {
+            printf("    <- %u", edges[e].src);
+            print_kinds(edges[e].kinds);
+            printf("\n");
+            if ((edges[e].kinds & XED_DEP_RAW) &&
+                depth[edges[e].src] + 1 > depth[i])
+                depth[i] = depth[edges[e].src] + 1;
+        }
+        if (depth[i] > longest)
+            longest = depth[i];
+    }
+    printf("EDGES %u\n", g.nedges);
+    printf("LONGEST RAW CHAIN %u\n", longest);
+    return 0;
+}
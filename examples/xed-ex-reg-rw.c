@@ -0,0 +1,126 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-ex-reg-rw.c
+
+// Decode a sequence of instructions and print the full registers that
+// each one reads, writes and conditionally writes, along with the
+// registers live on entry to the sequence.
+
+#include "xed/xed-interface.h"
+#include "xed-examples-util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> //strcmp, strlen
+#include <assert.h>
+
+int main(int argc, char** argv);
+
+static void usage(char const* prog) {
+    fprintf(stderr, "Usage: %s [-16|-32|-64] hex-bytes...\n", prog);
+    exit(1);
+}
+
+static void print_set(char const* label, const xed_reg_set_t* s) {
+    xed_uint_t r;
+    printf("    %-6s", label);
+    for(r=XED_REG_INVALID+1;r<XED_REG_LAST;r++)
+        if (xed_reg_set_test(s, XED_STATIC_CAST(xed_reg_enum_t,r)))
+            printf(" %s",
+                   xed_reg_enum_t2str(XED_STATIC_CAST(xed_reg_enum_t,r)));
+    printf("\n");
+}
+
+#define MAX_INST 64
+
+int main(int argc, char** argv) {
+    xed_state_t dstate;
+    xed_decoded_inst_t xedd;
+    xed_reg_rw_t rw[MAX_INST];
+    xed_reg_set_t live;
+    char const* hex_text = 0;
+    xed_uint8_t* bytes;
+    unsigned int len, nbytes, offset = 0;
+    xed_uint_t ninst = 0, i;
+    int a;
+    char buffer[200];
+
+    xed_tables_init();
+    xed_state_zero(&dstate);
+    dstate.mmode = XED_MACHINE_MODE_LONG_64;
+    dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+
+    for(a=1;a<argc;a++) {
+        if (strcmp(argv[a],"-64") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LONG_64;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+        }
+        else if (strcmp(argv[a],"-32") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LEGACY_32;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_32b;
+        }
+        else if (strcmp(argv[a],"-16") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LEGACY_16;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_16b;
+        }
+        else if (argv[a][0] == '-')
+            usage(argv[0]);
+        else
+            hex_text = xedex_append_string(hex_text, argv[a]);
+    }
+    if (!hex_text)
+        usage(argv[0]);
+    len = XED_STATIC_CAST(unsigned int, strlen(hex_text));
+    if (len & 1) {
+        fprintf(stderr, "Must supply even number of nibbles\n");
+        exit(1);
+    }
+    bytes = (xed_uint8_t*)malloc(len/2 + 1);
+    assert(bytes != 0);
+    nbytes = xed_convert_ascii_to_hex(hex_text, bytes, len/2);
+
+    while (offset < nbytes && ninst < MAX_INST) {
+        xed_error_enum_t err;
+        xed_decoded_inst_zero_set_mode(&xedd, &dstate);
+        err = xed_decode(&xedd, bytes+offset, nbytes-offset);
+        if (err != XED_ERROR_NONE) {
+            fprintf(stderr, "Decode error at offset %u: %s\n",
+                    offset, xed_error_enum_t2str(err));
+            exit(1);
+        }
+        if (!xed_format_context(XED_SYNTAX_INTEL, &xedd, buffer,
+                                sizeof(buffer), 0, 0, 0))
+            strcpy(buffer, "???");
+        printf("%s\n", buffer);
+
+        xed_decoded_inst_get_reg_rw(&xedd, rw+ninst);
+        print_set("READ", &rw[ninst].read);
+        print_set("WRITE", &rw[ninst].write);
+        print_set("CWRITE", &rw[ninst].cond_write);
+        offset += xed_decoded_inst_get_length(&xedd);
+        ninst++;
+    }
+
+    /* backwards liveness over the straight-line sequence */
+    xed_reg_set_zero(&live);
+    for(i=ninst;i>0;i--) {
+        xed_reg_set_subtract(&live, &rw[i-1].write);
+        xed_reg_set_union(&live, &rw[i-1].read);
+    }
+    print_set("LIVEIN", &live);
+    return 0;
+}
@@ -46,6 +46,7 @@ main(int argc, char** argv)
     xed_machine_mode_enum_t mmode;
     xed_address_width_enum_t stack_addr_width;
     xed_format_options_t format_options;
+    xed_formatter_t formatter[XED_SYNTAX_LAST];
 
     // one time initialization 
     xed_tables_init();
@@ -69,8 +70,17 @@ main(int argc, char** argv)
             break;
     }
 
+    // xed_decoded_inst_dump() uses the process wide options
     xed_format_set_options( format_options );
 
+    // Prepare one formatter per syntax. A formatter holds all the
+    // formatting configuration and is never modified after
+    // initialization, so it could be shared by many threads.
+    for(isyntax=  XED_SYNTAX_XED; isyntax < XED_SYNTAX_LAST; isyntax++)    {
+        syntax = XED_STATIC_CAST(xed_syntax_enum_t, isyntax);
+        xed_formatter_init(&formatter[isyntax], syntax, &format_options, 0);
+    }
+
     /// begin processing of instructions...
 
     if (long_mode) {
@@ -130,7 +140,7 @@ main(int argc, char** argv)
 
     for(isyntax=  XED_SYNTAX_XED; isyntax < XED_SYNTAX_LAST; isyntax++)    {
         syntax = XED_STATIC_CAST(xed_syntax_enum_t, isyntax);
-        ok = xed_format_context(syntax, &xedd, buffer, BUFLEN, 0, 0, 0);
+        ok = xed_formatter_format(&formatter[isyntax], &xedd, buffer, BUFLEN, 0, 0);
         if (ok)
             printf("%s syntax: %s\n", xed_syntax_enum_t2str(syntax), buffer);
         else
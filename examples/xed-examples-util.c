@@ -149,9 +149,12 @@ static xed_stats_t xed_enc_stats;
 void xed_disas_info_init(xed_disas_info_t* p)
 {
     memset(p,0,sizeof(xed_disas_info_t));
+    p->syntax = XED_SYNTAX_INTEL;
+#if defined(XED_DECODER)
+    xed_formatter_init(&p->formatter, p->syntax, 0, 0);
+#endif
 }
 
-xed_syntax_enum_t global_syntax = XED_SYNTAX_INTEL;
 int client_verbose=0; 
 
 ////////////////////////////////////////////////////////////////////////////
@@ -511,12 +514,14 @@ xed_map_region(const char* path,
 
 #if defined(XED_DECODER)
 
-static xed_disassembly_callback_fn_t registered_disasm_callback=0;
-
-void
-xed_register_disassembly_callback(xed_disassembly_callback_fn_t f)
+void xed_disas_info_set_formatter(xed_disas_info_t* p,
+                                  xed_disassembly_callback_fn_t symbolic_callback)
 {
-    registered_disasm_callback = f;
+    if (!xed_formatter_init(&p->formatter,
+                            p->syntax,
+                            &p->format_options,
+                            symbolic_callback))
+        xedex_derror("Unsupported disassembly syntax");
 }
 
 
@@ -527,35 +532,16 @@ void disassemble(xed_disas_info_t* di,
                  xed_uint64_t runtime_instruction_address,
                  void* caller_data) 
 {
-    xed_bool_t ok;
-    xed_print_info_t pi;
-    xed_init_print_info(&pi);
-    pi.p = xedd;
-    pi.blen = buflen;
-    pi.buf = buf;
-
-    // passed back to symbolic disassembly function
-    pi.context = caller_data;
-
-    // 0=use the default symbolic disassembly function registered via
-    // xed_register_disassembly_callback(). If nonzero, it would be a
-    // function pointer to a disassembly callback routine. See xed-disas.h
-    pi.disassembly_callback = registered_disasm_callback;
-    
-    pi.runtime_address = runtime_instruction_address;
-    pi.syntax = global_syntax;
-    pi.format_options_valid = 1;
-    pi.format_options = di->format_options;
-    pi.buf[0]=0; //allow use of strcat
-    
-    ok = xed_format_generic(&pi);
-    if (!ok)
+    // caller_data is passed back to the symbolic disassembly function
+    // set up by xed_disas_info_set_formatter().
+    if (!xed_formatter_format(&di->formatter, xedd, buf, buflen,
+                              runtime_instruction_address, caller_data))
     {
-        pi.blen = xed_strncpy(pi.buf,"Error disassembling ",pi.blen);
-        pi.blen = xed_strncat(pi.buf,
-                               xed_syntax_enum_t2str(pi.syntax),
-                               pi.blen);
-        pi.blen = xed_strncat(pi.buf," syntax.",pi.blen);
+        buflen = xed_strncpy(buf,"Error disassembling ",buflen);
+        buflen = xed_strncat(buf,
+                             xed_syntax_enum_t2str(di->formatter.syntax),
+                             buflen);
+        buflen = xed_strncat(buf," syntax.",buflen);
     }
 }
 
@@ -1088,7 +1074,7 @@ emit_disasm(xed_disas_info_t* di,
                     xedd,
                     runtime_instruction_address,
                     di->caller_symbol_data,
-                    registered_disasm_callback);
+                    di->formatter.disassembly_callback);
             }
             
             if (xed_error == XED_ERROR_INVALID_FOR_CHIP) {
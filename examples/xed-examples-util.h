@@ -24,7 +24,6 @@ END_LEGAL */
 #include <stdio.h>
 #include "xed/xed-interface.h"
 
-extern xed_syntax_enum_t global_syntax;
 extern int client_verbose;
 
 #define CLIENT_VERBOSE  (client_verbose > 1)
@@ -48,6 +47,8 @@ unsigned int xed_convert_ascii_to_hex(const char* src,
                                       unsigned int max_bytes);
 
 #define XED_MAX_INPUT_OPERNADS 4
+#define XED_MAX_CFG_ENTRIES 64
+#define XED_MAX_INDEX_QUERIES 64
 #define XED_HEX_BUFLEN 200
 void xed_print_hex_line(char* buf,
                         const xed_uint8_t* array,
@@ -78,12 +79,27 @@ typedef struct {
     xed_bool_t resync; /* turn on/off symbol-based resynchronization */
     xed_bool_t line_numbers; /* control for printing file/line info */
     FILE* dot_graph_output;
+    xed_bool_t cfg;            /* print a control flow graph */
+    FILE* cfg_dot_output;
+    unsigned int cfg_threads;  /* 0 = one per processor */
+    xed_uint64_t cfg_entries[XED_MAX_CFG_ENTRIES];
+    unsigned int cfg_nentries;
+    FILE* index_file;          /* -index: written with input, else read */
+    xed_bool_t index_recursive; /* index the -cfg traversal, not a sweep */
+    xed_uint64_t index_queries[XED_MAX_INDEX_QUERIES];
+    unsigned int index_nqueries;
+    /* sections collected for the instruction index, 0 if not indexing */
+    struct xed_inst_index_set_s* index_set;
     unsigned int perf_tail_start;
     xed_bool_t ast;
     xed_bool_t histo;
     xed_chip_enum_t chip;
     xed_bool_t emit_isa_set;    
+    xed_syntax_enum_t syntax;
     xed_format_options_t format_options;
+    // prepared from syntax and format_options by
+    // xed_disas_info_set_formatter(), used by disassemble().
+    xed_formatter_t formatter;
     xed_operand_enum_t operands[XED_MAX_INPUT_OPERNADS];
     xed_uint32_t operands_value[XED_MAX_INPUT_OPERNADS];
     xed_bool_t encode_force;
@@ -112,6 +128,11 @@ typedef struct {
 
 void xed_disas_info_init(xed_disas_info_t* p);
 
+// (re)prepare p->formatter from p->syntax and p->format_options. The
+// symbolic callback is zero if not used.
+void xed_disas_info_set_formatter(xed_disas_info_t* p,
+                                  xed_disassembly_callback_fn_t symbolic_callback);
+
 void xed_map_region(const char* path,
                     void** start,
                     unsigned int* length);
@@ -140,10 +161,6 @@ xed_uint_t disas_decode_encode_binary(xed_disas_info_t* di,
 void xed_print_decode_stats(xed_disas_info_t* di);
 void xed_print_encode_stats(xed_disas_info_t* di);
 
-void xed_register_disassembly_callback(
-                 xed_disassembly_callback_fn_t f);
-
-
 void disassemble(xed_disas_info_t* di,
                  char* buf,
                  int buflen,
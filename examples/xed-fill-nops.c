@@ -0,0 +1,160 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-fill-nops.c
+
+// Check xed_fill_nops() for a range of lengths. Each region is decoded
+// back; every instruction must be a NOP within the limits of the
+// policy, the NOPs must cover the region exactly, and their number must
+// be the fewest possible with the single NOP lengths the policy allows.
+// The lengths of the NOPs of each region are printed.
+
+#include "xed/xed-interface.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> //strcmp
+
+int main(int argc, char** argv);
+
+#define MAX_FILL 256
+
+static void usage(char const* prog) {
+    fprintf(stderr,
+            "Usage: %s [-16|-32|-64] [-fewest|-decoder-friendly|"
+            "-max-prefixes N] [max-length]\n", prog);
+    exit(1);
+}
+
+/* Decode the region, print the NOP lengths and return their number, or
+   0 after printing an error */
+static unsigned int check_region(xed_uint8_t const* p, unsigned int len,
+                                 xed_state_t const* dstate,
+                                 xed_nop_policy_t policy) {
+    xed_decoded_inst_t xedd;
+    unsigned int off = 0, n = 0;
+    printf("%3u:", len);
+    while (off < len) {
+        xed_category_enum_t cat;
+        unsigned int ilen, prefixes = 0;
+        xed_decoded_inst_zero_set_mode(&xedd, dstate);
+        if (xed_decode(&xedd, p + off, len - off) != XED_ERROR_NONE) {
+            printf(" ERROR: does not decode at %u\n", off);
+            return 0;
+        }
+        ilen = xed_decoded_inst_get_length(&xedd);
+        cat = xed_decoded_inst_get_category(&xedd);
+        while (prefixes < ilen && p[off + prefixes] == 0x66)
+            prefixes++;
+        if (cat != XED_CATEGORY_NOP && cat != XED_CATEGORY_WIDENOP) {
+            printf(" ERROR: not a NOP at %u\n", off);
+            return 0;
+        }
+        if (ilen > policy.max_length || prefixes > policy.max_prefixes) {
+            printf(" ERROR: NOP at %u breaks the policy\n", off);
+            return 0;
+        }
+        printf("%s%u", n ? "+" : " ", ilen);
+        off += ilen;
+        n++;
+    }
+    printf("\n");
+    return len ? n : 1;
+}
+
+int main(int argc, char** argv) {
+    xed_state_t dstate;
+    xed_machine_mode_enum_t mmode = XED_MACHINE_MODE_LONG_64;
+    xed_address_width_enum_t stack_addr_width = XED_ADDRESS_WIDTH_64b;
+    xed_nop_policy_t policy = xed_nop_policy_fewest_instructions();
+    xed_uint8_t buf[MAX_FILL];
+    xed_bool_t single[XED_MAX_INSTRUCTION_BYTES+1];
+    unsigned int fewest[MAX_FILL+1];
+    unsigned int max_len = 40, len, m, nbad = 0;
+    int a;
+
+    xed_tables_init();
+    for(a=1;a<argc;a++) {
+        if (strcmp(argv[a],"-64") == 0) {
+            mmode = XED_MACHINE_MODE_LONG_64;
+            stack_addr_width = XED_ADDRESS_WIDTH_64b;
+        }
+        else if (strcmp(argv[a],"-32") == 0) {
+            mmode = XED_MACHINE_MODE_LEGACY_32;
+            stack_addr_width = XED_ADDRESS_WIDTH_32b;
+        }
+        else if (strcmp(argv[a],"-16") == 0) {
+            mmode = XED_MACHINE_MODE_LEGACY_16;
+            stack_addr_width = XED_ADDRESS_WIDTH_16b;
+        }
+        else if (strcmp(argv[a],"-fewest") == 0)
+            policy = xed_nop_policy_fewest_instructions();
+        else if (strcmp(argv[a],"-decoder-friendly") == 0)
+            policy = xed_nop_policy_decoder_friendly();
+        else if (strcmp(argv[a],"-max-prefixes") == 0 && a+1 < argc)
+            policy = xed_nop_policy_max_prefixes(
+                XED_STATIC_CAST(xed_uint8_t, atoi(argv[++a])));
+        else if (argv[a][0] == '-')
+            usage(argv[0]);
+        else
+            max_len = XED_STATIC_CAST(unsigned int, atoi(argv[a]));
+    }
+    if (max_len >= MAX_FILL)
+        usage(argv[0]);
+    xed_state_init2(&dstate, mmode, stack_addr_width);
+
+    // the lengths the policy fills with a single NOP
+    for(m=1;m<=XED_MAX_INSTRUCTION_BYTES;m++) {
+        single[m] = 0;
+        if (xed_fill_nops(buf, m, mmode, policy) == XED_ERROR_NONE) {
+            xed_decoded_inst_t xedd;
+            xed_decoded_inst_zero_set_mode(&xedd, &dstate);
+            single[m] = xed_decode(&xedd, buf, m) == XED_ERROR_NONE &&
+                        xed_decoded_inst_get_length(&xedd) == m;
+        }
+    }
+    fewest[0] = 0;
+    for(len=1;len<=max_len;len++) {
+        fewest[len] = len; // all 1B NOPs
+        for(m=1;m<=len && m<=XED_MAX_INSTRUCTION_BYTES;m++)
+            if (single[m] && fewest[len-m] + 1 < fewest[len])
+                fewest[len] = fewest[len-m] + 1;
+    }
+
+    for(len=0;len<=max_len;len++) {
+        unsigned int n;
+        memset(buf, 0xCC, sizeof(buf));
+        if (xed_fill_nops(buf, len, mmode, policy) != XED_ERROR_NONE) {
+            printf("%3u: ERROR: fill failed\n", len);
+            nbad++;
+            continue;
+        }
+        if (buf[len] != 0xCC) {
+            printf("%3u: ERROR: wrote past the region\n", len);
+            nbad++;
+            continue;
+        }
+        n = check_region(buf, len, &dstate, policy);
+        if (n == 0)
+            nbad++;
+        else if (len && n != fewest[len]) {
+            printf("%3u: ERROR: %u NOPs, %u possible\n", len, n, fewest[len]);
+            nbad++;
+        }
+    }
+    printf("%s\n", nbad ? "FAILED" : "OK");
+    return nbad ? 1 : 0;
+}
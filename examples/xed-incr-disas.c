@@ -0,0 +1,194 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-incr-disas.c
+
+// Incremental re-disassembly after patching bytes in place.
+//
+// The hex bytes are decoded linearly into a decode cache entry. Each
+// -p offset hex-bytes patch then overwrites bytes of the buffer, and
+// xed_decode_cache_patch() redoes only the decodes that can see a
+// patched byte, up to where the instruction stream is back in sync with
+// the old one. The updated instructions are printed and checked against
+// a full decode of the patched buffer.
+
+#include "xed/xed-interface.h"
+#include "xed-examples-util.h"
+#include "xed-decode-cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> //strcmp, strlen
+#include <assert.h>
+
+int main(int argc, char** argv);
+
+#define MAX_PATCHES 64
+
+typedef struct {
+    xed_uint64_t offset;
+    char const* hex_text;
+} patch_t;
+
+static void usage(char const* prog) {
+    fprintf(stderr,
+            "Usage: %s [-16|-32|-64] [-p offset hex-bytes]... "
+            "hex-bytes...\n", prog);
+    exit(1);
+}
+
+/* Convert an even number of nibbles. The caller frees the bytes. */
+static xed_uint8_t* convert_hex(char const* hex_text, unsigned int* nbytes) {
+    unsigned int len = XED_STATIC_CAST(unsigned int, strlen(hex_text));
+    xed_uint8_t* bytes;
+    if (len & 1) {
+        fprintf(stderr, "Must supply even number of nibbles\n");
+        exit(1);
+    }
+    bytes = (xed_uint8_t*)malloc(len/2 + 1);
+    assert(bytes != 0);
+    *nbytes = xed_convert_ascii_to_hex(hex_text, bytes, len/2);
+    return bytes;
+}
+
+static void print_summary(xed_uint8_t s) {
+    xed_uint_t nmem = s & XED_DECODE_CACHE_NMEM;
+    printf("%c%c%c%c",
+           nmem ? XED_STATIC_CAST(char, '0' + nmem) : '-',
+           (s & XED_DECODE_CACHE_MEM_READ) ? 'r' : '-',
+           (s & XED_DECODE_CACHE_MEM_WRITE) ? 'w' : '-',
+           (s & XED_DECODE_CACHE_BRANCH) ? 'b' :
+           (s & XED_DECODE_CACHE_IMM) ? 'i' : '-');
+}
+
+static void print_cache(xed_decode_cache_t const* c,
+                        xed_state_t const* dstate,
+                        xed_uint8_t const* bytes) {
+    xed_decoded_inst_t xedd;
+    char text[128];
+    xed_uint64_t off = 0;
+    xed_uint32_t i;
+    for(i=0;i<c->ninst;i++) {
+        xed_uint32_t o = c->offset[i];
+        for( ; off < o; off++)
+            printf("%4u  %02x     (bad)\n",
+                   XED_STATIC_CAST(unsigned int, off), bytes[off]);
+        xed_decoded_inst_zero_set_mode(&xedd, dstate);
+        if (xed_decode(&xedd, bytes + o, c->length[i]) != XED_ERROR_NONE ||
+            !xed_format_context(XED_SYNTAX_INTEL, &xedd, text,
+                                sizeof(text), o, 0, 0))
+            strcpy(text, "???");
+        printf("%4u  %2u  ", o, c->length[i]);
+        print_summary(c->summary[i]);
+        printf("  %-28s %s\n",
+               xed_iform_enum_t2str(
+                   XED_STATIC_CAST(xed_iform_enum_t, c->iform[i])),
+               text);
+        off = o + c->length[i];
+    }
+    for( ; off < c->len; off++)
+        printf("%4u  %02x     (bad)\n",
+               XED_STATIC_CAST(unsigned int, off), bytes[off]);
+}
+
+static xed_bool_t same_cache(xed_decode_cache_t* a,
+                             xed_decode_cache_t const* b) {
+    xed_uint32_t n = a->ninst;
+    return xed_decode_cache_update_key(a) == b->key && n == b->ninst &&
+        memcmp(a->offset, b->offset, n * sizeof(a->offset[0])) == 0 &&
+        memcmp(a->iform, b->iform, n * sizeof(a->iform[0])) == 0 &&
+        memcmp(a->length, b->length, n) == 0 &&
+        memcmp(a->summary, b->summary, n) == 0;
+}
+
+int main(int argc, char** argv) {
+    xed_state_t dstate;
+    xed_decode_cache_t cache, full;
+    patch_t patches[MAX_PATCHES];
+    xed_decode_cache_range_t ranges[MAX_PATCHES];
+    char const* hex_text = 0;
+    xed_uint8_t* bytes;
+    unsigned int nbytes;
+    xed_uint32_t npatches = 0, i;
+    xed_uint64_t redecoded;
+    int a;
+
+    xed_tables_init();
+    xed_state_zero(&dstate);
+    dstate.mmode = XED_MACHINE_MODE_LONG_64;
+    dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+
+    for(a=1;a<argc;a++) {
+        if (strcmp(argv[a],"-64") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LONG_64;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+        }
+        else if (strcmp(argv[a],"-32") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LEGACY_32;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_32b;
+        }
+        else if (strcmp(argv[a],"-16") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LEGACY_16;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_16b;
+        }
+        else if (strcmp(argv[a],"-p") == 0 && a+2 < argc) {
+            if (npatches == MAX_PATCHES)
+                usage(argv[0]);
+            patches[npatches].offset = XED_STATIC_CAST(xed_uint64_t,
+                                         xed_atoi_general(argv[++a], 1000));
+            patches[npatches].hex_text = argv[++a];
+            npatches++;
+        }
+        else if (argv[a][0] == '-')
+            usage(argv[0]);
+        else
+            hex_text = xedex_append_string(hex_text, argv[a]);
+    }
+    if (!hex_text)
+        usage(argv[0]);
+    bytes = convert_hex(hex_text, &nbytes);
+
+    xed_decode_cache_build(&cache, &dstate, XED_CHIP_INVALID, bytes, nbytes);
+    printf("# %u bytes, %u instructions\n", nbytes, cache.ninst);
+
+    for(i=0;i<npatches;i++) {
+        unsigned int n;
+        xed_uint8_t* p = convert_hex(patches[i].hex_text, &n);
+        if (patches[i].offset + n > nbytes) {
+            fprintf(stderr, "Patch %u does not fit in the buffer\n", i);
+            exit(1);
+        }
+        memcpy(bytes + patches[i].offset, p, n);
+        ranges[i].offset = patches[i].offset;
+        ranges[i].len = n;
+        free(p);
+    }
+    redecoded = xed_decode_cache_patch(&cache, bytes, ranges, npatches);
+    printf("# %u patches, %u bytes decoded again, %u instructions\n",
+           npatches, XED_STATIC_CAST(unsigned int, redecoded), cache.ninst);
+    print_cache(&cache, &dstate, bytes);
+
+    xed_decode_cache_build(&full, &dstate, XED_CHIP_INVALID, bytes, nbytes);
+    if (!same_cache(&cache, &full)) {
+        printf("# MISMATCH with a full decode\n");
+        return 1;
+    }
+    printf("# same as a full decode\n");
+    xed_decode_cache_release(&cache);
+    xed_decode_cache_release(&full);
+    free(bytes);
+    return 0;
+}
@@ -0,0 +1,689 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-inst-index.c
+
+#include "xed/xed-interface.h"
+#if defined(XED_DECODER)
+#include "xed-inst-index.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+# include <windows.h>
+#else
+# include <pthread.h>
+# include <unistd.h>
+#endif
+
+#define IDX_BLOCK_WORDS 8      /* 512 bits per rank directory entry */
+#define IDX_BLOCK_SHIFT 9
+#define IDX_SELECT_SHIFT 9     /* one select sample per 512 starts */
+#define IDX_SELECT_MASK ((1u << IDX_SELECT_SHIFT) - 1)
+#define IDX_SPARSE_BLOCKS 64   /* wider samples store every start */
+#define IDX_DENSE 0xFFFFFFFFu
+#define IDX_MAX_THREADS 256
+
+static char const idx_magic[8] = { 'X','E','D','I','D','X','0','1' };
+
+////////////////////////////////////////////////////////////////////////////
+// bits
+
+static XED_INLINE xed_uint_t popcount64(xed_uint64_t x)
+{
+#if defined(__GNUC__)
+    return XED_STATIC_CAST(xed_uint_t, __builtin_popcountll(x));
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return XED_STATIC_CAST(xed_uint_t, (x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* index of the lowest set bit; x must not be 0 */
+static XED_INLINE xed_uint_t lowest_bit(xed_uint64_t x)
+{
+#if defined(__GNUC__)
+    return XED_STATIC_CAST(xed_uint_t, __builtin_ctzll(x));
+#else
+    return popcount64((x & (0 - x)) - 1);
+#endif
+}
+
+static XED_INLINE xed_uint64_t nwords(xed_inst_index_t const* idx)
+{
+    return (idx->len + 63) / 64;
+}
+
+static XED_INLINE xed_uint64_t nblocks(xed_inst_index_t const* idx)
+{
+    return (nwords(idx) + IDX_BLOCK_WORDS - 1) / IDX_BLOCK_WORDS;
+}
+
+static XED_INLINE xed_uint32_t nselect(xed_inst_index_t const* idx)
+{
+    return (idx->ninst >> IDX_SELECT_SHIFT) + 1;
+}
+
+/* starts in select sample k */
+static XED_INLINE xed_uint32_t sample_count(xed_inst_index_t const* idx,
+                                            xed_uint32_t k)
+{
+    xed_uint64_t lo = XED_STATIC_CAST(xed_uint64_t, k) << IDX_SELECT_SHIFT;
+    xed_uint64_t hi = lo + (1u << IDX_SELECT_SHIFT);
+    if (hi > idx->ninst)
+        hi = idx->ninst;
+    return hi > lo ? XED_STATIC_CAST(xed_uint32_t, hi - lo) : 0;
+}
+
+/* last block holding a start of select sample k, which must not be
+   empty */
+static XED_INLINE xed_uint64_t sample_last_block(xed_inst_index_t const* idx,
+                                                 xed_uint32_t k)
+{
+    if (sample_count(idx, k + 1))
+        return idx->select[k + 1];
+    return nblocks(idx) - 1;
+}
+
+static XED_INLINE xed_uint32_t get_nibble(xed_uint8_t const* a,
+                                          xed_uint64_t i)
+{
+    return (a[i >> 1] >> ((i & 1) * 4)) & 0xF;
+}
+
+static XED_INLINE void set_nibble(xed_uint8_t* a, xed_uint64_t i,
+                                  xed_uint32_t v)
+{
+    xed_uint_t sh = XED_STATIC_CAST(xed_uint_t, (i & 1) * 4);
+    a[i >> 1] = XED_STATIC_CAST(xed_uint8_t,
+                                (a[i >> 1] & ~(0xF << sh)) | (v << sh));
+}
+
+static void* idx_calloc(xed_uint64_t n, size_t size)
+{
+    void* p = calloc(XED_STATIC_CAST(size_t, n ? n : 1), size);
+    assert(p != 0);
+    return p;
+}
+
+/* rank and select directories, from the bit vector */
+static void build_directories(xed_inst_index_t* idx)
+{
+    xed_uint64_t w, nw = nwords(idx), nb = nblocks(idx);
+    xed_uint32_t r = 0, k, nsparse;
+
+    idx->rank = (xed_uint32_t*) idx_calloc(nb + 1, sizeof(xed_uint32_t));
+    for (w = 0; w < nw; w++) {
+        if (w % IDX_BLOCK_WORDS == 0)
+            idx->rank[w / IDX_BLOCK_WORDS] = r;
+        r += popcount64(idx->bits[w]);
+    }
+    idx->rank[nb] = r;
+    idx->ninst = r;
+
+    idx->select = (xed_uint32_t*) idx_calloc(nselect(idx),
+                                             sizeof(xed_uint32_t));
+    for (w = 0, r = 0; w < nw; w++) {
+        /* a word holds at most 64 starts, so at most one sample */
+        xed_uint32_t c = popcount64(idx->bits[w]);
+        k = (r + (1u << IDX_SELECT_SHIFT) - 1) >> IDX_SELECT_SHIFT;
+        if ((k << IDX_SELECT_SHIFT) < r + c)
+            idx->select[k] = XED_STATIC_CAST(xed_uint32_t,
+                                             w / IDX_BLOCK_WORDS);
+        r += c;
+    }
+
+    /* samples spread over more than IDX_SPARSE_BLOCKS blocks keep the
+       offset of each start. Such a sample covers more than 32KB, so the
+       offsets take about as much room as its part of the bit vector. */
+    idx->sparse = (xed_uint32_t*) idx_calloc(nselect(idx),
+                                             sizeof(xed_uint32_t));
+    for (k = 0, nsparse = 0; k < nselect(idx); k++) {
+        xed_uint32_t c = sample_count(idx, k);
+        idx->sparse[k] = IDX_DENSE;
+        if (c && sample_last_block(idx, k) - idx->select[k] >
+                 IDX_SPARSE_BLOCKS) {
+            idx->sparse[k] = nsparse;
+            nsparse += c;
+        }
+    }
+    idx->sparse_offs = (xed_uint64_t*) idx_calloc(nsparse,
+                                                  sizeof(xed_uint64_t));
+    if (nsparse == 0)
+        return;
+    for (w = 0, r = 0; w < nw; w++) {
+        xed_uint64_t x = idx->bits[w];
+        for ( ; x; x &= x - 1, r++) {
+            xed_uint32_t first = idx->sparse[r >> IDX_SELECT_SHIFT];
+            if (first != IDX_DENSE)
+                idx->sparse_offs[first + (r & IDX_SELECT_MASK)] =
+                    w * 64 + lowest_bit(x);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+// construction
+
+void xed_inst_index_init(xed_inst_index_t* idx,
+                         xed_uint64_t runtime_vaddr,
+                         xed_uint64_t len)
+{
+    memset(idx, 0, sizeof(xed_inst_index_t));
+    idx->runtime_vaddr = runtime_vaddr;
+    idx->len = len;
+    idx->bits = (xed_uint64_t*) idx_calloc(nwords(idx),
+                                           sizeof(xed_uint64_t));
+    idx->build_lens = (xed_uint8_t*) idx_calloc((len + 1) / 2, 1);
+}
+
+void xed_inst_index_add(xed_inst_index_t* idx,
+                        xed_uint64_t addr,
+                        xed_uint32_t length)
+{
+    xed_uint64_t off = addr - idx->runtime_vaddr;
+    if (addr < idx->runtime_vaddr || off >= idx->len ||
+        length == 0 || length > XED_MAX_INSTRUCTION_BYTES)
+        return;
+    idx->bits[off >> 6] |= 1ULL << (off & 63);
+    set_nibble(idx->build_lens, off, length);
+}
+
+void xed_inst_index_finish(xed_inst_index_t* idx)
+{
+    xed_uint64_t w, nw = nwords(idx);
+    xed_uint32_t r = 0;
+
+    build_directories(idx);
+    idx->lens = (xed_uint8_t*) idx_calloc((idx->ninst + 1) / 2, 1);
+    for (w = 0; w < nw; w++) {
+        xed_uint64_t x = idx->bits[w];
+        while (x) {
+            xed_uint64_t off = w * 64 + lowest_bit(x);
+            set_nibble(idx->lens, r++, get_nibble(idx->build_lens, off));
+            x &= x - 1;
+        }
+    }
+    free(idx->build_lens);
+    idx->build_lens = 0;
+}
+
+static xed_uint32_t decode_length(xed_state_t const* dstate,
+                                  xed_chip_enum_t chip,
+                                  xed_uint8_t const* p,
+                                  xed_uint64_t avail)
+{
+    xed_decoded_inst_t xedd;
+    unsigned int ilim = XED_MAX_INSTRUCTION_BYTES;
+    if (avail < ilim)
+        ilim = XED_STATIC_CAST(unsigned int, avail);
+    xed_decoded_inst_zero_set_mode(&xedd, dstate);
+    xed_decoded_inst_set_input_chip(&xedd, chip);
+    if (xed_decode(&xedd, p, ilim) != XED_ERROR_NONE)
+        return 0;
+    return xed_decoded_inst_get_length(&xedd);
+}
+
+void xed_inst_index_build_linear(xed_inst_index_t* idx,
+                                 xed_state_t const* dstate,
+                                 xed_chip_enum_t chip,
+                                 xed_uint8_t const* region,
+                                 xed_uint64_t len,
+                                 xed_uint64_t runtime_vaddr)
+{
+    xed_uint64_t off = 0;
+    xed_inst_index_init(idx, runtime_vaddr, len);
+    while (off < len) {
+        xed_uint32_t n = decode_length(dstate, chip, region + off,
+                                       len - off);
+        if (n) {
+            xed_inst_index_add(idx, runtime_vaddr + off, n);
+            off += n;
+        }
+        else
+            off++;
+    }
+    xed_inst_index_finish(idx);
+}
+
+void xed_inst_index_build_cache(xed_inst_index_t* idx,
+                                xed_decode_cache_t const* c,
+                                xed_uint64_t runtime_vaddr)
+{
+    xed_uint32_t i;
+    xed_inst_index_init(idx, runtime_vaddr, c->len);
+    for (i = 0; i < c->ninst; i++)
+        xed_inst_index_add(idx, runtime_vaddr + c->offset[i], c->length[i]);
+    xed_inst_index_finish(idx);
+}
+
+void xed_inst_index_build_cfg(xed_inst_index_t* idx, xed_cfg_t const* cfg)
+{
+    xed_uint32_t b;
+    xed_inst_index_init(idx, cfg->runtime_vaddr, cfg->region_len);
+    for (b = 0; b < cfg->nblocks; b++) {
+        xed_cfg_block_t const* blk = cfg->blocks + b;
+        xed_uint64_t off = blk->start - cfg->runtime_vaddr;
+        xed_uint64_t end = off + blk->length;
+        while (off < end) {
+            xed_uint32_t n = decode_length(&cfg->dstate, cfg->chip,
+                                           cfg->region + off,
+                                           cfg->region_len - off);
+            if (n == 0)
+                break;
+            xed_inst_index_add(idx, cfg->runtime_vaddr + off, n);
+            off += n;
+        }
+    }
+    xed_inst_index_finish(idx);
+}
+
+void xed_inst_index_free(xed_inst_index_t* idx)
+{
+    free(idx->bits);
+    free(idx->lens);
+    free(idx->rank);
+    free(idx->select);
+    free(idx->sparse);
+    free(idx->sparse_offs);
+    free(idx->build_lens);
+    memset(idx, 0, sizeof(xed_inst_index_t));
+}
+
+////////////////////////////////////////////////////////////////////////////
+// queries
+
+xed_uint32_t xed_inst_index_rank(xed_inst_index_t const* idx,
+                                 xed_uint64_t addr)
+{
+    xed_uint64_t off, w, lim;
+    xed_uint32_t r;
+    if (addr <= idx->runtime_vaddr)
+        return 0;
+    off = addr - idx->runtime_vaddr;
+    if (off >= idx->len)
+        return idx->ninst;
+    r = idx->rank[off >> IDX_BLOCK_SHIFT];
+    lim = off >> 6;
+    for (w = (off >> IDX_BLOCK_SHIFT) * IDX_BLOCK_WORDS; w < lim; w++)
+        r += popcount64(idx->bits[w]);
+    if (off & 63)
+        r += popcount64(idx->bits[lim] & ((1ULL << (off & 63)) - 1));
+    return r;
+}
+
+xed_bool_t xed_inst_index_select(xed_inst_index_t const* idx,
+                                 xed_uint32_t i,
+                                 xed_uint64_t* addr)
+{
+    xed_uint32_t k = i >> IDX_SELECT_SHIFT;
+    xed_uint64_t lo, hi, w, x;
+    xed_uint32_t r;
+    if (i >= idx->ninst)
+        return 0;
+    if (idx->sparse[k] != IDX_DENSE) {
+        *addr = idx->runtime_vaddr + idx->sparse_offs[
+            idx->sparse[k] + (i & IDX_SELECT_MASK)];
+        return 1;
+    }
+    /* last block whose rank is <= i, between two samples that are at
+       most IDX_SPARSE_BLOCKS apart */
+    lo = idx->select[k];
+    hi = sample_last_block(idx, k);
+    while (lo < hi) {
+        xed_uint64_t mid = lo + (hi - lo + 1) / 2;
+        if (idx->rank[mid] <= i)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    r = idx->rank[lo];
+    for (w = lo * IDX_BLOCK_WORDS; ; w++) {
+        xed_uint32_t c = popcount64(idx->bits[w]);
+        if (r + c > i)
+            break;
+        r += c;
+    }
+    for (x = idx->bits[w]; r < i; r++)
+        x &= x - 1;
+    *addr = idx->runtime_vaddr + w * 64 + lowest_bit(x);
+    return 1;
+}
+
+xed_bool_t xed_inst_index_find(xed_inst_index_t const* idx,
+                               xed_uint64_t addr,
+                               xed_uint64_t* start,
+                               xed_uint32_t* length)
+{
+    xed_uint32_t r, n;
+    xed_uint64_t s;
+    if (addr < idx->runtime_vaddr ||
+        addr - idx->runtime_vaddr >= idx->len)
+        return 0;
+    r = xed_inst_index_rank(idx, addr + 1);
+    if (r == 0 || !xed_inst_index_select(idx, r - 1, &s))
+        return 0;
+    n = get_nibble(idx->lens, r - 1);
+    if (addr >= s + n)
+        return 0;
+    *start = s;
+    if (length)
+        *length = n;
+    return 1;
+}
+
+xed_bool_t xed_inst_index_prev(xed_inst_index_t const* idx,
+                               xed_uint64_t addr,
+                               xed_uint64_t* start)
+{
+    xed_uint64_t s;
+    xed_uint32_t r;
+    if (addr < idx->runtime_vaddr)
+        return 0;
+    r = xed_inst_index_rank(idx, addr + 1);
+    if (xed_inst_index_find(idx, addr, &s, 0))
+        r--;
+    if (r == 0)
+        return 0;
+    return xed_inst_index_select(idx, r - 1, start);
+}
+
+xed_bool_t xed_inst_index_next(xed_inst_index_t const* idx,
+                               xed_uint64_t addr,
+                               xed_uint64_t* start)
+{
+    if (addr < idx->runtime_vaddr)
+        return xed_inst_index_select(idx, 0, start);
+    return xed_inst_index_select(idx, xed_inst_index_rank(idx, addr + 1),
+                                 start);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// sets of sections
+
+void xed_inst_index_set_init(xed_inst_index_set_t* set)
+{
+    set->sections = 0;
+    set->nsections = 0;
+    set->cap = 0;
+    set->cache_dir = 0;
+}
+
+static xed_inst_index_section_t* set_append(xed_inst_index_set_t* set)
+{
+    xed_inst_index_section_t* s;
+    if (set->nsections == set->cap) {
+        set->cap = set->cap ? 2 * set->cap : 8;
+        set->sections = (xed_inst_index_section_t*) realloc(
+            set->sections, set->cap * sizeof(xed_inst_index_section_t));
+        assert(set->sections != 0);
+    }
+    s = set->sections + set->nsections++;
+    memset(s, 0, sizeof(xed_inst_index_section_t));
+    return s;
+}
+
+void xed_inst_index_set_add(xed_inst_index_set_t* set,
+                            xed_uint8_t const* region,
+                            xed_uint64_t len,
+                            xed_uint64_t runtime_vaddr,
+                            xed_cfg_t* cfg)
+{
+    xed_inst_index_section_t* s = set_append(set);
+    s->region = region;
+    s->len = len;
+    s->runtime_vaddr = runtime_vaddr;
+    s->cfg = cfg;
+}
+
+typedef struct {
+    xed_inst_index_set_t* set;
+    xed_state_t const* dstate;
+    xed_chip_enum_t chip;
+    xed_uint32_t next;
+#if defined(_WIN32)
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t lock;
+#endif
+} idx_shared_t;
+
+static void build_loop(idx_shared_t* sh)
+{
+    while (1) {
+        xed_inst_index_section_t* s;
+        xed_uint32_t i;
+#if defined(_WIN32)
+        EnterCriticalSection(&sh->lock);
+        i = sh->next++;
+        LeaveCriticalSection(&sh->lock);
+#else
+        pthread_mutex_lock(&sh->lock);
+        i = sh->next++;
+        pthread_mutex_unlock(&sh->lock);
+#endif
+        if (i >= sh->set->nsections)
+            return;
+        s = sh->set->sections + i;
+        if (s->cfg)
+            xed_inst_index_build_cfg(&s->index, s->cfg);
+        else if (sh->set->cache_dir) {
+            xed_decode_cache_t c;
+            xed_decode_cache_get(&c, sh->set->cache_dir, sh->dstate,
+                                 sh->chip, s->region, s->len);
+            xed_inst_index_build_cache(&s->index, &c, s->runtime_vaddr);
+            xed_decode_cache_release(&c);
+        }
+        else
+            xed_inst_index_build_linear(&s->index, sh->dstate, sh->chip,
+                                        s->region, s->len, s->runtime_vaddr);
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI build_thread(LPVOID arg)
+{
+    build_loop((idx_shared_t*)arg);
+    return 0;
+}
+#else
+static void* build_thread(void* arg)
+{
+    build_loop((idx_shared_t*)arg);
+    return 0;
+}
+#endif
+
+void xed_inst_index_set_build(xed_inst_index_set_t* set,
+                              xed_state_t const* dstate,
+                              xed_chip_enum_t chip,
+                              xed_uint32_t nthreads)
+{
+    idx_shared_t sh;
+    xed_uint32_t i;
+
+    sh.set = set;
+    sh.dstate = dstate;
+    sh.chip = chip;
+    sh.next = 0;
+    if (nthreads == 0) {
+#if defined(_WIN32)
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        nthreads = XED_STATIC_CAST(xed_uint32_t, si.dwNumberOfProcessors);
+#else
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = n > 0 ? XED_STATIC_CAST(xed_uint32_t, n) : 1;
+#endif
+    }
+    if (nthreads > set->nsections)
+        nthreads = set->nsections;
+    if (nthreads > IDX_MAX_THREADS)
+        nthreads = IDX_MAX_THREADS;
+
+#if defined(_WIN32)
+    InitializeCriticalSection(&sh.lock);
+#else
+    pthread_mutex_init(&sh.lock, 0);
+#endif
+    if (nthreads <= 1)
+        build_loop(&sh);
+    else {
+#if defined(_WIN32)
+        HANDLE* tids = (HANDLE*)malloc(nthreads * sizeof(HANDLE));
+        assert(tids != 0);
+        for (i = 0; i < nthreads; i++) {
+            tids[i] = CreateThread(0, 0, build_thread, &sh, 0, 0);
+            assert(tids[i] != 0);
+        }
+        WaitForMultipleObjects(nthreads, tids, TRUE, INFINITE);
+        for (i = 0; i < nthreads; i++)
+            CloseHandle(tids[i]);
+#else
+        pthread_t* tids = (pthread_t*)malloc(nthreads * sizeof(pthread_t));
+        assert(tids != 0);
+        for (i = 0; i < nthreads; i++) {
+            int r = pthread_create(tids + i, 0, build_thread, &sh);
+            assert(r == 0);
+            (void)r;
+        }
+        for (i = 0; i < nthreads; i++)
+            pthread_join(tids[i], 0);
+#endif
+        free(tids);
+    }
+#if defined(_WIN32)
+    DeleteCriticalSection(&sh.lock);
+#else
+    pthread_mutex_destroy(&sh.lock);
+#endif
+}
+
+xed_inst_index_t const* xed_inst_index_set_find(
+    xed_inst_index_set_t const* set,
+    xed_uint64_t addr)
+{
+    xed_uint32_t i;
+    for (i = 0; i < set->nsections; i++) {
+        xed_inst_index_t const* idx = &set->sections[i].index;
+        if (addr >= idx->runtime_vaddr &&
+            addr - idx->runtime_vaddr < idx->len)
+            return idx;
+    }
+    return 0;
+}
+
+void xed_inst_index_set_free(xed_inst_index_set_t* set)
+{
+    xed_uint32_t i;
+    for (i = 0; i < set->nsections; i++)
+        xed_inst_index_free(&set->sections[i].index);
+    free(set->sections);
+    xed_inst_index_set_init(set);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// files
+//
+//   magic[8] nsections:u32 0:u32
+//   per section:
+//     runtime_vaddr:u64 len:u64 ninst:u32 0:u32
+//     bits[(len+63)/64]:u64  lens[(ninst+1)/2]:u8  padding to 8 bytes
+
+static xed_bool_t write_bytes(FILE* f, void const* p, xed_uint64_t n)
+{
+    return fwrite(p, 1, XED_STATIC_CAST(size_t, n), f) == n;
+}
+
+static xed_bool_t read_bytes(FILE* f, void* p, xed_uint64_t n)
+{
+    return fread(p, 1, XED_STATIC_CAST(size_t, n), f) == n;
+}
+
+xed_bool_t xed_inst_index_set_write(xed_inst_index_set_t const* set,
+                                    FILE* f)
+{
+    static xed_uint8_t const zeros[8] = { 0 };
+    xed_uint32_t hdr[2];
+    xed_uint32_t i;
+    hdr[0] = set->nsections;
+    hdr[1] = 0;
+    if (!write_bytes(f, idx_magic, sizeof(idx_magic)) ||
+        !write_bytes(f, hdr, sizeof(hdr)))
+        return 0;
+    for (i = 0; i < set->nsections; i++) {
+        xed_inst_index_t const* idx = &set->sections[i].index;
+        xed_uint64_t sec[2];
+        xed_uint64_t nlens = (idx->ninst + 1) / 2;
+        sec[0] = idx->runtime_vaddr;
+        sec[1] = idx->len;
+        hdr[0] = idx->ninst;
+        if (!write_bytes(f, sec, sizeof(sec)) ||
+            !write_bytes(f, hdr, sizeof(hdr)) ||
+            !write_bytes(f, idx->bits, nwords(idx) * 8) ||
+            !write_bytes(f, idx->lens, nlens) ||
+            !write_bytes(f, zeros, (8 - nlens % 8) % 8))
+            return 0;
+    }
+    return fflush(f) == 0;
+}
+
+xed_bool_t xed_inst_index_set_read(xed_inst_index_set_t* set, FILE* f)
+{
+    char magic[8];
+    xed_uint32_t hdr[2];
+    xed_uint32_t i, n;
+    xed_inst_index_set_init(set);
+    if (!read_bytes(f, magic, sizeof(magic)) ||
+        memcmp(magic, idx_magic, sizeof(magic)) != 0 ||
+        !read_bytes(f, hdr, sizeof(hdr)))
+        return 0;
+    n = hdr[0];
+    for (i = 0; i < n; i++) {
+        xed_inst_index_t* idx = &set_append(set)->index;
+        xed_uint64_t sec[2];
+        xed_uint8_t pad[8];
+        xed_uint32_t ninst;
+        xed_uint64_t nlens;
+        if (!read_bytes(f, sec, sizeof(sec)) ||
+            !read_bytes(f, hdr, sizeof(hdr)) ||
+            sec[1] >= (1ULL << 40))
+            goto fail;
+        idx->runtime_vaddr = sec[0];
+        idx->len = sec[1];
+        ninst = hdr[0];
+        nlens = (ninst + 1) / 2;
+        idx->bits = (xed_uint64_t*) idx_calloc(nwords(idx),
+                                               sizeof(xed_uint64_t));
+        idx->lens = (xed_uint8_t*) idx_calloc(nlens, 1);
+        if (!read_bytes(f, idx->bits, nwords(idx) * 8) ||
+            !read_bytes(f, idx->lens, nlens) ||
+            !read_bytes(f, pad, (8 - nlens % 8) % 8))
+            goto fail;
+        build_directories(idx);
+        if (idx->ninst != ninst)
+            goto fail;
+    }
+    return 1;
+  fail:
+    xed_inst_index_set_free(set);
+    return 0;
+}
+#endif
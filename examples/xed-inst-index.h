@@ -0,0 +1,169 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-inst-index.h
+
+/* Instruction-boundary index of a code region. The start of every
+   instruction found by a linear or recursive decode is one bit in a bit
+   vector with one bit per byte. A small rank directory (one count per
+   512 bits) and select samples (one per 512 instructions) answer "which
+   instruction contains this address", "previous instruction" and "next
+   instruction" in constant time, without decoding. A sample whose
+   instructions are spread over many blocks, as in a sparse recursive
+   index, keeps the offset of each of them instead, so that a lookup
+   never searches more than a few rank entries. The 4-bit length of
+   each instruction is stored by rank so that addresses in gaps between
+   recursively decoded code are not attributed to an instruction.
+
+   An index set holds the indices of several sections. Sets are built in
+   parallel, one section per thread, and can be written to and read back
+   from a file. */
+
+#if !defined(XED_INST_INDEX_H)
+# define XED_INST_INDEX_H
+
+#include "xed/xed-interface.h"
+#include "xed-cfg.h"
+#include "xed-decode-cache.h"
+#include <stdio.h>
+
+typedef struct {
+    xed_uint64_t runtime_vaddr;  /* address of byte 0 */
+    xed_uint64_t len;            /* bytes covered */
+    xed_uint32_t ninst;
+
+    xed_uint64_t* bits;          /* one bit per byte, set at starts */
+    xed_uint8_t* lens;           /* instruction length by rank, 4b each */
+    xed_uint32_t* rank;          /* starts before each 512b block */
+    xed_uint32_t* select;        /* block of every 512th start */
+    xed_uint32_t* sparse;        /* per sample: its first start in
+                                    sparse_offs, or ~0 if dense */
+    xed_uint64_t* sparse_offs;   /* starts of the sparse samples */
+
+    /* during construction: length by byte offset, 4b each */
+    xed_uint8_t* build_lens;
+} xed_inst_index_t;
+
+/* Start an index for len bytes at runtime_vaddr. Add instructions with
+   xed_inst_index_add() in any order and then call
+   xed_inst_index_finish(). */
+void xed_inst_index_init(xed_inst_index_t* idx,
+                         xed_uint64_t runtime_vaddr,
+                         xed_uint64_t len);
+void xed_inst_index_add(xed_inst_index_t* idx,
+                        xed_uint64_t addr,
+                        xed_uint32_t length);
+void xed_inst_index_finish(xed_inst_index_t* idx);
+
+/* Index the region by decoding it from the start. Bytes that do not
+   decode are skipped one at a time, as the disassembler does. */
+void xed_inst_index_build_linear(xed_inst_index_t* idx,
+                                 xed_state_t const* dstate,
+                                 xed_chip_enum_t chip,
+                                 xed_uint8_t const* region,
+                                 xed_uint64_t len,
+                                 xed_uint64_t runtime_vaddr);
+
+/* Index the instructions of a decode cache entry for the region */
+void xed_inst_index_build_cache(xed_inst_index_t* idx,
+                                xed_decode_cache_t const* c,
+                                xed_uint64_t runtime_vaddr);
+
+/* Index the instructions of the blocks of a built control flow graph */
+void xed_inst_index_build_cfg(xed_inst_index_t* idx, xed_cfg_t const* cfg);
+
+/* Number of instructions that start below addr */
+xed_uint32_t xed_inst_index_rank(xed_inst_index_t const* idx,
+                                 xed_uint64_t addr);
+
+/* Address of instruction i, counting from 0. Returns 0 if out of range. */
+xed_bool_t xed_inst_index_select(xed_inst_index_t const* idx,
+                                 xed_uint32_t i,
+                                 xed_uint64_t* addr);
+
+/* The instruction containing addr. Returns 0 if addr is outside the
+   region or in a gap between instructions. length may be 0. */
+xed_bool_t xed_inst_index_find(xed_inst_index_t const* idx,
+                               xed_uint64_t addr,
+                               xed_uint64_t* start,
+                               xed_uint32_t* length);
+
+/* The instruction before the one containing addr, or the last one before
+   addr if addr is in a gap. */
+xed_bool_t xed_inst_index_prev(xed_inst_index_t const* idx,
+                               xed_uint64_t addr,
+                               xed_uint64_t* start);
+
+/* The first instruction starting after addr */
+xed_bool_t xed_inst_index_next(xed_inst_index_t const* idx,
+                               xed_uint64_t addr,
+                               xed_uint64_t* start);
+
+void xed_inst_index_free(xed_inst_index_t* idx);
+
+////////////////////////////////////////////////////////////////////////////
+
+/* One code section. The inputs are only used while building. With a
+   cfg, the section is indexed from the graph (which must already be
+   built); otherwise it is decoded linearly, or read from the decode
+   cache when the set has a cache_dir. The cfg is not owned. */
+typedef struct {
+    xed_uint8_t const* region;
+    xed_uint64_t len;
+    xed_uint64_t runtime_vaddr;
+    xed_cfg_t* cfg;
+    xed_inst_index_t index;
+} xed_inst_index_section_t;
+
+typedef struct xed_inst_index_set_s {
+    xed_inst_index_section_t* sections;
+    xed_uint32_t nsections;
+    xed_uint32_t cap;
+    char const* cache_dir;  /* decode cache for linear sections, or 0 */
+} xed_inst_index_set_t;
+
+void xed_inst_index_set_init(xed_inst_index_set_t* set);
+
+/* Add a section to be built. The region is not copied. */
+void xed_inst_index_set_add(xed_inst_index_set_t* set,
+                            xed_uint8_t const* region,
+                            xed_uint64_t len,
+                            xed_uint64_t runtime_vaddr,
+                            xed_cfg_t* cfg);
+
+/* Build every section, nthreads sections at a time; 0 means one thread
+   per online processor. */
+void xed_inst_index_set_build(xed_inst_index_set_t* set,
+                              xed_state_t const* dstate,
+                              xed_chip_enum_t chip,
+                              xed_uint32_t nthreads);
+
+/* The index of the section containing addr, or 0 */
+xed_inst_index_t const* xed_inst_index_set_find(
+    xed_inst_index_set_t const* set,
+    xed_uint64_t addr);
+
+/* Write or read a built set. The file stores the bit vectors and
+   lengths in host byte order; the rank and select directories are
+   rebuilt when reading. Both return 0 on error. */
+xed_bool_t xed_inst_index_set_write(xed_inst_index_set_t const* set,
+                                    FILE* f);
+xed_bool_t xed_inst_index_set_read(xed_inst_index_set_t* set, FILE* f);
+
+void xed_inst_index_set_free(xed_inst_index_set_t* set);
+
+#endif
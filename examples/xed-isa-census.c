@@ -0,0 +1,968 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-isa-census.c
+
+// ISA census of many ELF files.
+//
+// The executable sections of each file are decoded on a pool of worker
+// threads. Instructions are decoded but never formatted; each one is
+// counted under the ISA set of its iform. For every file, and with
+// -symbols for every function symbol, the tool reports:
+//   - the ISA-set histogram,
+//   - the minimum chip: the chip with the fewest valid ISA sets in the
+//     intersection of the chip masks of the ISA sets seen,
+//   - the CPUID requirements. Each requirement lists the CPUID records
+//     of one ISA set joined with '+' (all needed); alternative CPUID
+//     groups are joined with '|'.
+//
+// The results are written as JSON (default) or CSV, in the order the
+// files were given, independent of the number of threads.
+//
+// With -cache DIR, the linear decode of each section is kept in DIR,
+// keyed by a hash of the section bytes and the mode, and later runs
+// count the cached iforms instead of decoding.
+
+#include "xed/xed-interface.h"
+#include "xed-examples-util.h"
+#include "xed-decode-cache.h"
+#include <elf.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int main(int argc, char** argv);
+
+#define MAX_THREADS 256
+#define MAX_PATH_LINE 4096
+
+#if !defined(EM_IAMCU)
+# define EM_IAMCU 3
+#endif
+#if !defined(EM_X86_64)
+# define EM_X86_64 62
+#endif
+
+typedef struct {
+    xed_uint16_t isa_set;
+    xed_uint64_t count;
+} hist_entry_t;
+
+// A scope is a whole file or one function symbol in it
+typedef struct {
+    char* name;  // symbol name, 0 for the whole file
+    xed_uint64_t ninst;
+    xed_uint64_t nerrors;
+    hist_entry_t* hist; // sorted by ISA set
+    xed_uint32_t nhist;
+    xed_chip_enum_t min_chip;
+} scope_t;
+
+typedef struct {
+    char const* name; // as given on the command line or in the list
+    char const* path; // for opening
+    char const* status;
+    int mode; // 32 or 64
+    scope_t total;
+    scope_t* syms;
+    xed_uint32_t nsyms;
+    xed_uint32_t syms_cap;
+} file_result_t;
+
+// per worker ISA-set counters that are cleared on each flush
+typedef struct {
+    xed_uint64_t counts[XED_ISA_SET_LAST];
+    xed_uint16_t touched[XED_ISA_SET_LAST];
+    xed_uint32_t ntouched;
+    xed_uint64_t ninst;
+    xed_uint64_t nerrors;
+} accum_t;
+
+typedef struct {
+    xed_uint64_t addr;
+    xed_uint64_t offset;
+    xed_uint64_t size;
+    xed_uint64_t flags;
+    xed_uint32_t type;
+    xed_uint32_t link;
+    xed_uint64_t entsize;
+} elf_sect_t;
+
+typedef struct {
+    xed_uint64_t addr;
+    xed_uint64_t end;
+    char const* name; // points into the mapped file
+    xed_uint32_t shndx;
+} elf_sym_t;
+
+typedef struct {
+    xed_uint8_t const* base;
+    size_t len;
+    xed_bool_t is64;
+    elf_sect_t* sects;
+    xed_uint32_t nsects;
+    elf_sym_t* syms;
+    xed_uint32_t nsyms;
+} elf_file_t;
+
+typedef struct {
+    accum_t file;
+    accum_t sym;
+} worker_t;
+
+static file_result_t* results;
+static xed_uint32_t nfiles;
+static xed_uint32_t next_file;
+static pthread_mutex_t next_file_lock = PTHREAD_MUTEX_INITIALIZER;
+static xed_bool_t per_symbol = 0;
+static char const* cache_dir = 0;
+
+static xed_uint32_t chip_nsets[XED_CHIP_LAST];
+static char* cpuid_req[XED_ISA_SET_LAST]; // 0 if no CPUID records
+
+static void* checked_malloc(size_t n) {
+    void* p = malloc(n ? n : 1);
+    if (!p) {
+        fprintf(stderr, "ERROR: out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+static void* checked_realloc(void* p, size_t n) {
+    void* q = realloc(p, n ? n : 1);
+    if (!q) {
+        fprintf(stderr, "ERROR: out of memory\n");
+        exit(1);
+    }
+    return q;
+}
+
+static char* checked_strdup(char const* s) {
+    size_t n = strlen(s) + 1;
+    char* p = XED_STATIC_CAST(char*, checked_malloc(n));
+    memcpy(p, s, n);
+    return p;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// chip and CPUID tables, computed once before the workers start
+
+static void append(char* buf, size_t* len, size_t cap, char const* s) {
+    size_t n = strlen(s);
+    if (*len + n + 1 > cap)
+        return;
+    memcpy(buf + *len, s, n + 1);
+    *len += n;
+}
+
+static void init_tables(void) {
+    xed_uint_t c, s, g, r;
+    for(s=1;s<XED_ISA_SET_LAST;s++) {
+        xed_chip_mask_t const* m =
+            xed_isa_set_chip_mask(XED_STATIC_CAST(xed_isa_set_enum_t, s));
+        for(c=1;c<XED_CHIP_LAST;c++)
+            if (xed_chip_mask_test(m, XED_STATIC_CAST(xed_chip_enum_t, c)))
+                chip_nsets[c]++;
+    }
+
+    for(s=1;s<XED_ISA_SET_LAST;s++) {
+        char buf[512];
+        size_t len = 0;
+        buf[0] = 0;
+        for(g=0;g<XED_MAX_CPUID_GROUPS_PER_ISA_SET;g++) {
+            xed_cpuid_group_enum_t group = xed_get_cpuid_group_enum_for_isa_set(
+                XED_STATIC_CAST(xed_isa_set_enum_t, s), g);
+            if (group == XED_CPUID_GROUP_INVALID)
+                break;
+            if (g)
+                append(buf, &len, sizeof(buf), "|");
+            for(r=0;r<XED_MAX_CPUID_RECS_PER_GROUP;r++) {
+                xed_cpuid_rec_enum_t rec =
+                    xed_get_cpuid_rec_enum_for_group(group, r);
+                if (rec == XED_CPUID_REC_INVALID)
+                    break;
+                if (r)
+                    append(buf, &len, sizeof(buf), "+");
+                append(buf, &len, sizeof(buf), xed_cpuid_rec_enum_t2str(rec));
+            }
+        }
+        if (len)
+            cpuid_req[s] = checked_strdup(buf);
+    }
+}
+
+static xed_chip_enum_t find_min_chip(hist_entry_t const* hist,
+                                     xed_uint32_t nhist) {
+    xed_chip_enum_t best = XED_CHIP_INVALID;
+    xed_chip_mask_t m;
+    xed_uint_t c, i;
+    xed_chip_mask_fill(&m);
+    for(i=0;i<nhist;i++)
+        xed_chip_mask_and(&m, xed_isa_set_chip_mask(
+                              XED_STATIC_CAST(xed_isa_set_enum_t, hist[i].isa_set)));
+    for(c=1;c<XED_CHIP_LAST;c++) {
+        if (!xed_chip_mask_test(&m, XED_STATIC_CAST(xed_chip_enum_t, c)))
+            continue;
+        if (best == XED_CHIP_INVALID || chip_nsets[c] < chip_nsets[best])
+            best = XED_STATIC_CAST(xed_chip_enum_t, c);
+    }
+    return best;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// accumulation
+
+static XED_INLINE void accum_add(accum_t* a, xed_uint_t isa_set,
+                                 xed_uint64_t n) {
+    if (a->counts[isa_set] == 0)
+        a->touched[a->ntouched++] = XED_STATIC_CAST(xed_uint16_t, isa_set);
+    a->counts[isa_set] += n;
+}
+
+static int cmp_u16(void const* a, void const* b) {
+    xed_uint16_t x = *XED_STATIC_CAST(xed_uint16_t const*, a);
+    xed_uint16_t y = *XED_STATIC_CAST(xed_uint16_t const*, b);
+    return (x > y) - (x < y);
+}
+
+// move the counters to the scope and clear them
+static void accum_flush(accum_t* a, scope_t* scope) {
+    xed_uint32_t i;
+    qsort(a->touched, a->ntouched, sizeof(a->touched[0]), cmp_u16);
+    scope->hist = XED_STATIC_CAST(hist_entry_t*,
+                                  checked_malloc(a->ntouched * sizeof(hist_entry_t)));
+    for(i=0;i<a->ntouched;i++) {
+        scope->hist[i].isa_set = a->touched[i];
+        scope->hist[i].count = a->counts[a->touched[i]];
+        a->counts[a->touched[i]] = 0;
+    }
+    scope->nhist = a->ntouched;
+    scope->ninst = a->ninst;
+    scope->nerrors = a->nerrors;
+    scope->min_chip = find_min_chip(scope->hist, scope->nhist);
+    a->ntouched = 0;
+    a->ninst = 0;
+    a->nerrors = 0;
+}
+
+static void flush_symbol(worker_t* w, file_result_t* fr, elf_sym_t const* sym) {
+    scope_t* scope;
+    if (w->sym.ninst == 0 && w->sym.nerrors == 0)
+        return;
+    if (fr->nsyms == fr->syms_cap) {
+        fr->syms_cap = fr->syms_cap ? 2 * fr->syms_cap : 64;
+        fr->syms = XED_STATIC_CAST(scope_t*,
+                    checked_realloc(fr->syms, fr->syms_cap * sizeof(scope_t)));
+    }
+    scope = fr->syms + fr->nsyms++;
+    scope->name = checked_strdup(sym->name);
+    accum_flush(&w->sym, scope);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ELF reading. Every offset read from the file is range checked.
+
+static xed_bool_t in_file(elf_file_t const* e, xed_uint64_t off,
+                          xed_uint64_t n) {
+    return off <= e->len && n <= e->len - off;
+}
+
+static char const* read_sections(elf_file_t* e) {
+    xed_uint64_t shoff;
+    xed_uint32_t shentsize, i;
+    if (e->is64) {
+        Elf64_Ehdr h;
+        memcpy(&h, e->base, sizeof(h));
+        shoff = h.e_shoff;
+        shentsize = h.e_shentsize;
+        e->nsects = h.e_shnum;
+        if (shentsize < sizeof(Elf64_Shdr))
+            return "bad section headers";
+    }
+    else {
+        Elf32_Ehdr h;
+        memcpy(&h, e->base, sizeof(h));
+        shoff = h.e_shoff;
+        shentsize = h.e_shentsize;
+        e->nsects = h.e_shnum;
+        if (shentsize < sizeof(Elf32_Shdr))
+            return "bad section headers";
+    }
+    if (shoff == 0 || e->nsects == 0)
+        return "no section headers";
+    if (!in_file(e, shoff, XED_STATIC_CAST(xed_uint64_t, shentsize) * e->nsects))
+        return "truncated section headers";
+
+    e->sects = XED_STATIC_CAST(elf_sect_t*,
+                               checked_malloc(e->nsects * sizeof(elf_sect_t)));
+    for(i=0;i<e->nsects;i++) {
+        xed_uint8_t const* p = e->base + shoff + i * shentsize;
+        elf_sect_t* s = e->sects + i;
+        if (e->is64) {
+            Elf64_Shdr sh;
+            memcpy(&sh, p, sizeof(sh));
+            s->addr = sh.sh_addr;
+            s->offset = sh.sh_offset;
+            s->size = sh.sh_size;
+            s->flags = sh.sh_flags;
+            s->type = sh.sh_type;
+            s->link = sh.sh_link;
+            s->entsize = sh.sh_entsize;
+        }
+        else {
+            Elf32_Shdr sh;
+            memcpy(&sh, p, sizeof(sh));
+            s->addr = sh.sh_addr;
+            s->offset = sh.sh_offset;
+            s->size = sh.sh_size;
+            s->flags = sh.sh_flags;
+            s->type = sh.sh_type;
+            s->link = sh.sh_link;
+            s->entsize = sh.sh_entsize;
+        }
+    }
+    return 0;
+}
+
+static int cmp_sym(void const* a, void const* b) {
+    elf_sym_t const* x = XED_STATIC_CAST(elf_sym_t const*, a);
+    elf_sym_t const* y = XED_STATIC_CAST(elf_sym_t const*, b);
+    if (x->shndx != y->shndx)
+        return x->shndx < y->shndx ? -1 : 1;
+    if (x->addr != y->addr)
+        return x->addr < y->addr ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+// function symbols from .symtab, or from .dynsym for stripped files,
+// sorted by section and address with aliases removed
+static void read_symbols(elf_file_t* e) {
+    elf_sect_t const* symtab = 0;
+    elf_sect_t const* strtab;
+    xed_uint64_t entsize, n, i;
+    xed_uint32_t k, j;
+
+    for(k=0;k<e->nsects;k++)
+        if (e->sects[k].type == SHT_SYMTAB) {
+            symtab = e->sects + k;
+            break;
+        }
+    if (!symtab)
+        for(k=0;k<e->nsects;k++)
+            if (e->sects[k].type == SHT_DYNSYM) {
+                symtab = e->sects + k;
+                break;
+            }
+    if (!symtab || symtab->link >= e->nsects)
+        return;
+    strtab = e->sects + symtab->link;
+    entsize = e->is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+    if (!in_file(e, symtab->offset, symtab->size) ||
+        !in_file(e, strtab->offset, strtab->size))
+        return;
+
+    n = symtab->size / entsize;
+    e->syms = XED_STATIC_CAST(elf_sym_t*, checked_malloc(n * sizeof(elf_sym_t)));
+    for(i=0;i<n;i++) {
+        xed_uint8_t const* p = e->base + symtab->offset + i * entsize;
+        xed_uint64_t name_off, value, size;
+        xed_uint32_t shndx;
+        unsigned int type;
+        char const* name;
+        if (e->is64) {
+            Elf64_Sym sym;
+            memcpy(&sym, p, sizeof(sym));
+            name_off = sym.st_name;
+            value = sym.st_value;
+            size = sym.st_size;
+            shndx = sym.st_shndx;
+            type = ELF64_ST_TYPE(sym.st_info);
+        }
+        else {
+            Elf32_Sym sym;
+            memcpy(&sym, p, sizeof(sym));
+            name_off = sym.st_name;
+            value = sym.st_value;
+            size = sym.st_size;
+            shndx = sym.st_shndx;
+            type = ELF32_ST_TYPE(sym.st_info);
+        }
+        if (type != STT_FUNC || shndx == SHN_UNDEF || shndx >= e->nsects)
+            continue;
+        if (name_off >= strtab->size)
+            continue;
+        name = XED_STATIC_CAST(char const*, e->base + strtab->offset + name_off);
+        if (name[0] == 0 || !memchr(name, 0, strtab->size - name_off))
+            continue;
+        e->syms[e->nsyms].addr = value;
+        e->syms[e->nsyms].end = value + size;
+        e->syms[e->nsyms].name = name;
+        e->syms[e->nsyms].shndx = shndx;
+        e->nsyms++;
+    }
+    qsort(e->syms, e->nsyms, sizeof(elf_sym_t), cmp_sym);
+
+    // drop aliases and extend symbols without a size to the next one
+    for(i=0, j=0;i<e->nsyms;i++) {
+        if (j && e->syms[j-1].shndx == e->syms[i].shndx &&
+            e->syms[j-1].addr == e->syms[i].addr)
+            continue;
+        e->syms[j++] = e->syms[i];
+    }
+    e->nsyms = j;
+    for(j=0;j<e->nsyms;j++) {
+        elf_sym_t* s = e->syms + j;
+        if (s->end != s->addr)
+            continue;
+        if (j+1 < e->nsyms && e->syms[j+1].shndx == s->shndx)
+            s->end = e->syms[j+1].addr;
+        else
+            s->end = e->sects[s->shndx].addr + e->sects[s->shndx].size;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// decoding
+
+static void census_section(worker_t* w, file_result_t* fr, elf_file_t const* e,
+                           xed_uint32_t sect, xed_state_t const* dstate,
+                           xed_decoded_inst_t* xedd) {
+    elf_sect_t const* s = e->sects + sect;
+    xed_uint8_t const* code = e->base + s->offset;
+    xed_uint64_t size = s->size, off = 0;
+    elf_sym_t const* sym = e->syms;
+    elf_sym_t const* sym_end = e->syms + e->nsyms;
+    elf_sym_t const* cur = 0;
+    xed_decode_cache_t cache;
+    xed_uint32_t next = 0; // next cached instruction
+
+    if (!in_file(e, s->offset, s->size))
+        size = s->offset < e->len ? e->len - s->offset : 0;
+    if (cache_dir)
+        xed_decode_cache_get(&cache, cache_dir, dstate, XED_CHIP_INVALID,
+                             code, size);
+    if (per_symbol) {
+        while (sym < sym_end && sym->shndx < sect)
+            sym++;
+        while (sym_end > sym && (sym_end-1)->shndx > sect)
+            sym_end--;
+    }
+
+    while (off < size) {
+        xed_uint64_t addr = s->addr + off;
+        xed_uint_t avail = XED_STATIC_CAST(xed_uint_t,
+                                size - off < XED_MAX_INSTRUCTION_BYTES ?
+                                size - off : XED_MAX_INSTRUCTION_BYTES);
+        xed_uint_t len = 0;
+        xed_iform_enum_t iform = XED_IFORM_INVALID;
+
+        if (per_symbol) {
+            elf_sym_t const* in;
+            while (sym < sym_end && sym->end <= addr)
+                sym++;
+            in = (sym < sym_end && sym->addr <= addr) ? sym : 0;
+            if (in != cur) {
+                if (cur)
+                    flush_symbol(w, fr, cur);
+                cur = in;
+            }
+        }
+
+        if (cache_dir) {
+            // bytes before the next cached start did not decode
+            if (next < cache.ninst && cache.offset[next] == off) {
+                iform = XED_STATIC_CAST(xed_iform_enum_t, cache.iform[next]);
+                len = cache.length[next++];
+            }
+        }
+        else {
+            xed_decoded_inst_zero_keep_mode(xedd);
+            if (xed_decode(xedd, code + off, avail) == XED_ERROR_NONE) {
+                iform = xed_decoded_inst_get_iform_enum(xedd);
+                len = xed_decoded_inst_get_length(xedd);
+            }
+        }
+        if (len) {
+            xed_isa_set_enum_t isa_set = xed_iform_to_isa_set(iform);
+            accum_add(&w->file, isa_set, 1);
+            w->file.ninst++;
+            if (cur) {
+                accum_add(&w->sym, isa_set, 1);
+                w->sym.ninst++;
+            }
+            off += len;
+        }
+        else {
+            w->file.nerrors++;
+            if (cur)
+                w->sym.nerrors++;
+            off++;
+        }
+    }
+    if (cur)
+        flush_symbol(w, fr, cur);
+    if (cache_dir)
+        xed_decode_cache_release(&cache);
+}
+
+static char const* census_elf(worker_t* w, file_result_t* fr, elf_file_t* e) {
+    xed_decoded_inst_t xedd;
+    xed_state_t dstate;
+    xed_uint16_t machine;
+    char const* status;
+    xed_uint32_t i;
+
+    if (e->len < EI_NIDENT || memcmp(e->base, ELFMAG, SELFMAG) != 0)
+        return "not ELF";
+    if (e->base[EI_DATA] != ELFDATA2LSB)
+        return "not little endian";
+    if (e->base[EI_CLASS] == ELFCLASS64 && e->len >= sizeof(Elf64_Ehdr))
+        e->is64 = 1;
+    else if (e->base[EI_CLASS] == ELFCLASS32 && e->len >= sizeof(Elf32_Ehdr))
+        e->is64 = 0;
+    else
+        return "bad ELF class";
+    // e_machine is at the same offset in both classes
+    memcpy(&machine, e->base + offsetof(Elf64_Ehdr, e_machine), sizeof(machine));
+    if (machine == EM_X86_64) // also the x32 ABI
+        fr->mode = 64;
+    else if (machine == EM_386 || machine == EM_IAMCU)
+        fr->mode = 32;
+    else
+        return "not x86";
+
+    status = read_sections(e);
+    if (status)
+        return status;
+    if (per_symbol)
+        read_symbols(e);
+
+    if (fr->mode == 64)
+        xed_state_init2(&dstate, XED_MACHINE_MODE_LONG_64,
+                        XED_ADDRESS_WIDTH_64b);
+    else
+        xed_state_init2(&dstate, XED_MACHINE_MODE_LEGACY_32,
+                        XED_ADDRESS_WIDTH_32b);
+    xed_decoded_inst_zero_set_mode(&xedd, &dstate);
+    for(i=0;i<e->nsects;i++)
+        if (e->sects[i].type == SHT_PROGBITS &&
+            (e->sects[i].flags & SHF_EXECINSTR))
+            census_section(w, fr, e, i, &dstate, &xedd);
+    return "ok";
+}
+
+static void census_file(worker_t* w, file_result_t* fr) {
+    elf_file_t e;
+    struct stat st;
+    void* p;
+    int fd;
+
+    memset(&e, 0, sizeof(e));
+    fd = open(fr->path, O_RDONLY);
+    if (fd < 0) {
+        fr->status = "cannot open";
+        return;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        fr->status = "empty";
+        return;
+    }
+    p = mmap(0, XED_STATIC_CAST(size_t, st.st_size), PROT_READ, MAP_PRIVATE,
+             fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        fr->status = "cannot map";
+        return;
+    }
+    e.base = XED_STATIC_CAST(xed_uint8_t const*, p);
+    e.len = XED_STATIC_CAST(size_t, st.st_size);
+    fr->status = census_elf(w, fr, &e);
+    accum_flush(&w->file, &fr->total);
+    if (strcmp(fr->status, "ok") != 0)
+        fr->total.min_chip = XED_CHIP_INVALID;
+    munmap(p, e.len);
+    free(e.sects);
+    free(e.syms);
+}
+
+static void* worker_thread(void* arg) {
+    worker_t* w = XED_STATIC_CAST(worker_t*, arg);
+    for(;;) {
+        xed_uint32_t i;
+        pthread_mutex_lock(&next_file_lock);
+        i = next_file++;
+        pthread_mutex_unlock(&next_file_lock);
+        if (i >= nfiles)
+            break;
+        census_file(w, results + i);
+    }
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// output
+
+static void print_json_string(FILE* out, char const* s) {
+    fputc('"', out);
+    for( ; *s ; s++) {
+        unsigned char c = XED_STATIC_CAST(unsigned char, *s);
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+static void print_csv_string(FILE* out, char const* s) {
+    if (!strpbrk(s, ",\"\n\r")) {
+        fputs(s, out);
+        return;
+    }
+    fputc('"', out);
+    for( ; *s ; s++) {
+        if (*s == '"')
+            fputc('"', out);
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static char const* chip_name(xed_chip_enum_t c) {
+    return c == XED_CHIP_INVALID ? "NONE" : xed_chip_enum_t2str(c);
+}
+
+static int cmp_str(void const* a, void const* b) {
+    return strcmp(*XED_STATIC_CAST(char const* const*, a),
+                  *XED_STATIC_CAST(char const* const*, b));
+}
+
+// the distinct CPUID requirements of a scope, sorted
+static xed_uint32_t scope_cpuid(scope_t const* scope, char const** reqs) {
+    xed_uint32_t i, n = 0, j;
+    for(i=0;i<scope->nhist;i++)
+        if (cpuid_req[scope->hist[i].isa_set])
+            reqs[n++] = cpuid_req[scope->hist[i].isa_set];
+    qsort(reqs, n, sizeof(reqs[0]), cmp_str);
+    for(i=0, j=0;i<n;i++)
+        if (j == 0 || strcmp(reqs[j-1], reqs[i]) != 0)
+            reqs[j++] = reqs[i];
+    return j;
+}
+
+static void print_json_scope(FILE* out, scope_t const* scope,
+                             char const* indent) {
+    char const* reqs[XED_ISA_SET_LAST];
+    xed_uint32_t i, n;
+    fprintf(out, "\"instructions\": %llu, \"decode_errors\": %llu, "
+            "\"min_chip\": \"%s\",\n",
+            XED_STATIC_CAST(unsigned long long, scope->ninst),
+            XED_STATIC_CAST(unsigned long long, scope->nerrors),
+            chip_name(scope->min_chip));
+    fprintf(out, "%s\"isa_sets\": {", indent);
+    for(i=0;i<scope->nhist;i++)
+        fprintf(out, "%s\"%s\": %llu", i ? ", " : "",
+                xed_isa_set_enum_t2str(
+                    XED_STATIC_CAST(xed_isa_set_enum_t, scope->hist[i].isa_set)),
+                XED_STATIC_CAST(unsigned long long, scope->hist[i].count));
+    fprintf(out, "},\n%s\"cpuid\": [", indent);
+    n = scope_cpuid(scope, reqs);
+    for(i=0;i<n;i++)
+        fprintf(out, "%s\"%s\"", i ? ", " : "", reqs[i]);
+    fprintf(out, "]");
+}
+
+static void print_json(FILE* out, scope_t const* totals, xed_uint32_t failed) {
+    xed_uint8_t used[XED_CPUID_REC_LAST];
+    xed_uint32_t i, j;
+    xed_uint_t g, r;
+    xed_bool_t first;
+
+    fprintf(out, "{\n  \"files\": [");
+    for(i=0;i<nfiles;i++) {
+        file_result_t const* fr = results + i;
+        fprintf(out, "%s\n    { \"file\": ", i ? "," : "");
+        print_json_string(out, fr->name);
+        fprintf(out, ", \"status\": ");
+        print_json_string(out, fr->status);
+        if (fr->mode)
+            fprintf(out, ", \"mode\": %d", fr->mode);
+        fprintf(out, ",\n      ");
+        print_json_scope(out, &fr->total, "      ");
+        if (per_symbol) {
+            fprintf(out, ",\n      \"symbols\": [");
+            for(j=0;j<fr->nsyms;j++) {
+                fprintf(out, "%s\n        { \"name\": ", j ? "," : "");
+                print_json_string(out, fr->syms[j].name);
+                fprintf(out, ", ");
+                print_json_scope(out, fr->syms + j, "          ");
+                fprintf(out, " }");
+            }
+            fprintf(out, "%s]", fr->nsyms ? "\n      " : "");
+        }
+        fprintf(out, " }");
+    }
+    fprintf(out, "\n  ],\n  \"totals\": { \"files\": %u, \"failed\": %u, ",
+            nfiles, failed);
+    print_json_scope(out, totals, "    ");
+    fprintf(out, " },\n");
+
+    // details of every CPUID record referenced above
+    memset(used, 0, sizeof(used));
+    for(i=0;i<totals->nhist;i++) {
+        xed_isa_set_enum_t s =
+            XED_STATIC_CAST(xed_isa_set_enum_t, totals->hist[i].isa_set);
+        for(g=0;g<XED_MAX_CPUID_GROUPS_PER_ISA_SET;g++) {
+            xed_cpuid_group_enum_t group =
+                xed_get_cpuid_group_enum_for_isa_set(s, g);
+            if (group == XED_CPUID_GROUP_INVALID)
+                break;
+            for(r=0;r<XED_MAX_CPUID_RECS_PER_GROUP;r++) {
+                xed_cpuid_rec_enum_t rec =
+                    xed_get_cpuid_rec_enum_for_group(group, r);
+                if (rec == XED_CPUID_REC_INVALID)
+                    break;
+                used[rec] = 1;
+            }
+        }
+    }
+    fprintf(out, "  \"cpuid_records\": {");
+    first = 1;
+    for(r=0;r<XED_CPUID_REC_LAST;r++) {
+        xed_cpuid_rec_t crec;
+        if (!used[r] ||
+            !xed_get_cpuid_rec(XED_STATIC_CAST(xed_cpuid_rec_enum_t, r), &crec))
+            continue;
+        fprintf(out, "%s\n    \"%s\": { \"leaf\": %u, \"subleaf\": %u, "
+                "\"reg\": \"%s\", \"bit_start\": %u, \"bit_end\": %u, "
+                "\"value\": %u }",
+                first ? "" : ",",
+                xed_cpuid_rec_enum_t2str(XED_STATIC_CAST(xed_cpuid_rec_enum_t, r)),
+                crec.leaf, crec.subleaf, xed_reg_enum_t2str(crec.reg),
+                crec.bit_start, crec.bit_end, crec.value);
+        first = 0;
+    }
+    fprintf(out, "%s}\n}\n", first ? "" : "\n  ");
+}
+
+static void print_csv_row(FILE* out, file_result_t const* fr,
+                          scope_t const* scope) {
+    char const* reqs[XED_ISA_SET_LAST];
+    xed_uint32_t i, n;
+    print_csv_string(out, fr->name);
+    fputc(',', out);
+    if (scope->name)
+        print_csv_string(out, scope->name);
+    fprintf(out, ",%s,%llu,%llu,%s,", fr->status,
+            XED_STATIC_CAST(unsigned long long, scope->ninst),
+            XED_STATIC_CAST(unsigned long long, scope->nerrors),
+            chip_name(scope->min_chip));
+    for(i=0;i<scope->nhist;i++)
+        fprintf(out, "%s%s=%llu", i ? ";" : "",
+                xed_isa_set_enum_t2str(
+                    XED_STATIC_CAST(xed_isa_set_enum_t, scope->hist[i].isa_set)),
+                XED_STATIC_CAST(unsigned long long, scope->hist[i].count));
+    fputc(',', out);
+    n = scope_cpuid(scope, reqs);
+    for(i=0;i<n;i++)
+        fprintf(out, "%s%s", i ? ";" : "", reqs[i]);
+    fputc('\n', out);
+}
+
+// one row per file, followed by one row per symbol with -symbols
+static void print_csv(FILE* out) {
+    xed_uint32_t i, j;
+    fprintf(out, "file,symbol,status,instructions,decode_errors,"
+            "min_chip,isa_sets,cpuid\n");
+    for(i=0;i<nfiles;i++) {
+        print_csv_row(out, results + i, &results[i].total);
+        for(j=0;j<results[i].nsyms;j++)
+            print_csv_row(out, results + i, results[i].syms + j);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void add_file(char const* name, char const* path) {
+    static xed_uint32_t cap = 0;
+    if (nfiles == cap) {
+        cap = cap ? 2 * cap : 256;
+        results = XED_STATIC_CAST(file_result_t*,
+                          checked_realloc(results, cap * sizeof(file_result_t)));
+    }
+    memset(results + nfiles, 0, sizeof(file_result_t));
+    results[nfiles].name = name;
+    results[nfiles].path = path;
+    nfiles++;
+}
+
+// Relative names in the list are relative to the directory of the
+// list. They are reported as written so that the output does not
+// depend on where the list lives.
+static void read_file_list(char const* fn) {
+    char line[MAX_PATH_LINE];
+    char const* slash = strrchr(fn, '/');
+    size_t dlen = slash ? XED_STATIC_CAST(size_t, slash - fn) + 1 : 0;
+    FILE* f = fopen(fn, "r");
+    if (!f) {
+        fprintf(stderr, "Could not open file list %s\n", fn);
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), f)) {
+        size_t n = strlen(line);
+        char* name;
+        char* path;
+        while (n && (line[n-1] == '\n' || line[n-1] == '\r'))
+            line[--n] = 0;
+        if (n == 0)
+            continue;
+        name = checked_strdup(line);
+        path = name;
+        if (line[0] != '/' && dlen) {
+            path = XED_STATIC_CAST(char*, checked_malloc(dlen + n + 1));
+            memcpy(path, fn, dlen);
+            memcpy(path + dlen, line, n + 1);
+        }
+        add_file(name, path);
+    }
+    fclose(f);
+}
+
+static void usage(char const* prog) {
+    fprintf(stderr,
+            "Usage: %s [-j N] [-symbols] [-csv] [-o output] "
+            "[-l file-list] [-cache dir] elf-file...\n"
+            "\t-j N        decode files on N threads (default 1)\n"
+            "\t-symbols    also report each function symbol\n"
+            "\t-csv        write CSV instead of JSON\n"
+            "\t-o output   write to a file instead of stdout\n"
+            "\t-l list     read more file names from list, one per line;\n"
+            "\t            relative names are relative to the list\n"
+            "\t-cache dir  keep the decode of each section in dir and\n"
+            "\t            reuse it on later runs\n",
+            prog);
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    pthread_t tids[MAX_THREADS];
+    worker_t* workers;
+    xed_uint_t nthreads = 1, t;
+    xed_bool_t csv = 0;
+    char const* out_fn = 0;
+    FILE* out = stdout;
+    accum_t* totals;
+    scope_t total_scope;
+    xed_uint32_t i, j, failed = 0;
+    int a;
+
+    xed_tables_init();
+    for(a=1;a<argc;a++) {
+        if (strcmp(argv[a], "-j") == 0) {
+            if (a+1 >= argc)
+                usage(argv[0]);
+            nthreads = XED_STATIC_CAST(xed_uint_t,
+                                       xed_atoi_general(argv[++a], 1000));
+            if (nthreads == 0 || nthreads > MAX_THREADS)
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[a], "-symbols") == 0)
+            per_symbol = 1;
+        else if (strcmp(argv[a], "-csv") == 0)
+            csv = 1;
+        else if (strcmp(argv[a], "-o") == 0) {
+            if (a+1 >= argc)
+                usage(argv[0]);
+            out_fn = argv[++a];
+        }
+        else if (strcmp(argv[a], "-l") == 0) {
+            if (a+1 >= argc)
+                usage(argv[0]);
+            read_file_list(argv[++a]);
+        }
+        else if (strcmp(argv[a], "-cache") == 0) {
+            if (a+1 >= argc)
+                usage(argv[0]);
+            cache_dir = argv[++a];
+        }
+        else if (argv[a][0] == '-')
+            usage(argv[0]);
+        else
+            add_file(argv[a], argv[a]);
+    }
+    if (nfiles == 0)
+        usage(argv[0]);
+    if (nthreads > nfiles)
+        nthreads = nfiles;
+
+    init_tables();
+    workers = XED_STATIC_CAST(worker_t*, calloc(nthreads, sizeof(worker_t)));
+    if (!workers) {
+        fprintf(stderr, "ERROR: out of memory\n");
+        exit(1);
+    }
+    if (nthreads == 1)
+        worker_thread(workers);
+    else {
+        for(t=0;t<nthreads;t++)
+            if (pthread_create(tids + t, 0, worker_thread, workers + t) != 0) {
+                fprintf(stderr, "ERROR: could not create thread\n");
+                exit(1);
+            }
+        for(t=0;t<nthreads;t++)
+            pthread_join(tids[t], 0);
+    }
+
+    // the totals reuse the first worker's cleared counters
+    totals = &workers[0].file;
+    for(i=0;i<nfiles;i++) {
+        scope_t const* s = &results[i].total;
+        if (strcmp(results[i].status, "ok") != 0)
+            failed++;
+        for(j=0;j<s->nhist;j++)
+            accum_add(totals, s->hist[j].isa_set, s->hist[j].count);
+        totals->ninst += s->ninst;
+        totals->nerrors += s->nerrors;
+    }
+    memset(&total_scope, 0, sizeof(total_scope));
+    accum_flush(totals, &total_scope);
+
+    if (out_fn) {
+        out = fopen(out_fn, "w");
+        if (!out) {
+            fprintf(stderr, "Could not open output file %s\n", out_fn);
+            exit(1);
+        }
+    }
+    if (csv)
+        print_csv(out);
+    else
+        print_json(out, &total_scope, failed);
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
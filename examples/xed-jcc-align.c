@@ -0,0 +1,580 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-jcc-align.c
+/// @brief Pad code so that branches and macro-fused compare+branch pairs
+/// do not cross or end on 32B (or 64B) boundaries.
+///
+/// Skylake-derived cores do not cache decoded uops for jumps that cross
+/// or end on a 32 byte boundary (the JCC erratum mitigation). This tool
+/// decodes a region, finds the affected branches and fused pairs and
+/// moves them to the next boundary, first by adding redundant CS segment
+/// prefixes to the preceding instructions and then by inserting NOPs.
+/// Relative branches and RIP-relative memory operands are retargeted;
+/// branches whose displacement no longer fits are re-encoded with a wider
+/// displacement.
+
+#include "xed/xed-interface.h"
+#include "xed-examples-util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define JA_MAX_PREFIXES        5  /* total legacy prefixes per instruction */
+#define JA_MAX_PREFIXED_INSTS  3  /* how far back to look for prefix room */
+#define JA_PAD_PREFIX          0x2E
+
+typedef struct {
+    xed_decoded_inst_t xedd;  /* decode of the current bytes */
+    xed_uint8_t itext[XED_MAX_INSTRUCTION_BYTES];
+    xed_uint_t len;           /* current length, grows if widened */
+    xed_uint64_t old_off;     /* offset in the input */
+    xed_uint64_t new_off;     /* offset in the output, includes the pads */
+    xed_uint_t nop_pad;       /* NOP bytes emitted before the instruction */
+    xed_uint_t prefix_pad;    /* redundant prefixes added to the instruction */
+
+    xed_uint64_t target;      /* runtime address referenced by a relative field */
+    xed_bool_t rel_branch;
+    xed_bool_t rip_relative;
+    xed_bool_t widened;
+
+    xed_bool_t candidate;     /* starts a branch or a fused pair */
+    xed_bool_t covered;       /* part of a branch or a fused pair */
+    xed_bool_t fused;         /* candidate is a cmp-like instruction + jcc */
+    xed_bool_t can_prefix;
+} ja_inst_t;
+
+typedef struct {
+    xed_state_t dstate;
+    xed_uint64_t runtime_base;
+    xed_uint_t boundary;
+    xed_bool_t nops_only;
+
+    const xed_uint8_t* input;
+    xed_uint64_t ilen;
+    ja_inst_t* insts;
+    xed_uint_t ninst;
+    xed_uint64_t new_len;
+
+    xed_uint_t npadded;
+    xed_uint_t nprefixes;
+    xed_uint_t nnops;
+    xed_uint_t nwidened;
+    xed_uint_t nunfixable;
+} ja_ctx_t;
+
+static xed_bool_t is_jcc_for_fusion(xed_iclass_enum_t ic) {
+    switch(ic) {
+      case XED_ICLASS_JCXZ:
+      case XED_ICLASS_JECXZ:
+      case XED_ICLASS_JRCXZ:
+      case XED_ICLASS_LOOP:
+      case XED_ICLASS_LOOPE:
+      case XED_ICLASS_LOOPNE:
+        return 0;
+      default:
+        return 1;
+    }
+}
+
+/* Instructions that can macro-fuse with a following jcc on some core. The
+   list is intentionally generous; padding a pair that does not fuse is
+   harmless. */
+static xed_bool_t is_fusible_first(xed_iclass_enum_t ic) {
+    switch(ic) {
+      case XED_ICLASS_CMP:
+      case XED_ICLASS_TEST:
+      case XED_ICLASS_ADD:
+      case XED_ICLASS_SUB:
+      case XED_ICLASS_AND:
+      case XED_ICLASS_INC:
+      case XED_ICLASS_DEC:
+        return 1;
+      default:
+        return 0;
+    }
+}
+
+static xed_bool_t is_branch(const xed_decoded_inst_t* xedd) {
+    switch(xed_decoded_inst_get_category(xedd)) {
+      case XED_CATEGORY_COND_BR:
+      case XED_CATEGORY_UNCOND_BR:
+      case XED_CATEGORY_CALL:
+      case XED_CATEGORY_RET:
+        return 1;
+      default:
+        return 0;
+    }
+}
+
+static xed_bool_t fits(xed_int64_t d, xed_uint_t bits) {
+    xed_int64_t lim;
+    if (bits >= 64)
+        return 1;
+    lim = XED_STATIC_CAST(xed_int64_t,1) << (bits-1);
+    return d >= -lim && d < lim;
+}
+
+static void decode_region(ja_ctx_t* c) {
+    xed_uint64_t off = 0;
+    xed_uint_t n = 0, cap = 0;
+    xed_bool_t mode64 = xed_state_long64_mode(&c->dstate);
+
+    c->insts = 0;
+    while (off < c->ilen) {
+        ja_inst_t* p;
+        xed_uint64_t avail = c->ilen - off;
+        xed_error_enum_t xed_error;
+        xed_decoded_inst_t* xedd;
+
+        if (n == cap) {
+            cap = cap ? 2*cap : 1024;
+            c->insts = (ja_inst_t*)realloc(c->insts, sizeof(ja_inst_t) * cap);
+            assert(c->insts != 0);
+        }
+        p = c->insts + n;
+        xedd = &p->xedd;
+        memset(p, 0, sizeof(ja_inst_t));
+        if (avail > XED_MAX_INSTRUCTION_BYTES)
+            avail = XED_MAX_INSTRUCTION_BYTES;
+        xed_decoded_inst_zero_set_mode(xedd, &c->dstate);
+        xed_error = xed_decode(xedd, c->input + off,
+                               XED_STATIC_CAST(unsigned int, avail));
+        if (xed_error != XED_ERROR_NONE) {
+            fprintf(stderr, "ERROR: %s Could not decode at offset 0x" XED_FMT_LX "\n",
+                    xed_error_enum_t2str(xed_error), off);
+            exit(1);
+        }
+        p->len = xed_decoded_inst_get_length(xedd);
+        memcpy(p->itext, c->input + off, p->len);
+        p->old_off = off;
+
+        if (xed_decoded_inst_get_branch_displacement_width(xedd)) {
+            p->rel_branch = 1;
+            p->target = c->runtime_base + off + p->len +
+                xed_decoded_inst_get_branch_displacement(xedd);
+        }
+        else if (xed_decoded_inst_get_base_reg(xedd,0) == XED_REG_RIP ||
+                 xed_decoded_inst_get_base_reg(xedd,0) == XED_REG_EIP) {
+            p->rip_relative = 1;
+            p->target = c->runtime_base + off + p->len +
+                xed_decoded_inst_get_memory_displacement(xedd,0);
+        }
+
+        if (is_branch(xedd)) {
+            ja_inst_t* prev = n ? p-1 : 0;
+            p->covered = 1;
+            if (prev && !prev->covered &&
+                xed_decoded_inst_get_category(xedd) == XED_CATEGORY_COND_BR &&
+                is_jcc_for_fusion(xed_decoded_inst_get_iclass(xedd)) &&
+                is_fusible_first(xed_decoded_inst_get_iclass(&prev->xedd)))
+            {
+                prev->candidate = 1;
+                prev->fused = 1;
+                prev->covered = 1;
+                prev->can_prefix = 0;
+            }
+            else
+                p->candidate = 1;
+        }
+        else if (!c->nops_only) {
+            /* A CS override is ignored in 64b mode. Elsewhere it is only
+               harmless if there are no memory operands. Existing segment
+               overrides are left alone. */
+            p->can_prefix =
+                (mode64 || xed_decoded_inst_number_of_memory_operands(xedd)==0) &&
+                !xed_operand_values_has_segment_prefix(
+                    xed_decoded_inst_operands_const(xedd));
+        }
+        off += p->len;
+        n++;
+    }
+    c->ninst = n;
+}
+
+/* Return the index of the instruction starting at runtime address a, or
+   -1 if a is outside the region. The end of the region is index ninst.
+   Exits if a is inside an instruction. */
+static xed_int64_t find_inst(ja_ctx_t* c, xed_uint64_t a) {
+    xed_uint_t lo = 0, hi = c->ninst;
+    xed_uint64_t off;
+    if (a < c->runtime_base || a > c->runtime_base + c->ilen)
+        return -1;
+    if (a == c->runtime_base + c->ilen)
+        return c->ninst;
+    off = a - c->runtime_base;
+    while (lo < hi) {
+        xed_uint_t mid = lo + (hi - lo) / 2;
+        if (c->insts[mid].old_off < off)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == c->ninst || c->insts[lo].old_off != off) {
+        fprintf(stderr, "ERROR: reference to 0x" XED_FMT_LX
+                " is not an instruction boundary\n", a);
+        exit(1);
+    }
+    return lo;
+}
+
+static xed_uint64_t new_target(ja_ctx_t* c, ja_inst_t* p) {
+    xed_int64_t k = find_inst(c, p->target);
+    if (k < 0)
+        return p->target;
+    if (k == c->ninst)
+        return c->runtime_base + c->new_len;
+    /* branch to the padding so the fall-through and taken paths agree */
+    return c->runtime_base + c->insts[k].new_off;
+}
+
+static xed_uint64_t next_ip(ja_ctx_t* c, ja_inst_t* p) {
+    return c->runtime_base + p->new_off + p->nop_pad + p->prefix_pad + p->len;
+}
+
+/* Re-encode a relative branch with a wider displacement. */
+static void widen_branch(ja_ctx_t* c, ja_inst_t* p) {
+    xed_encoder_request_t* req = &p->xedd;
+    xed_uint_t nbytes = xed_state_mode_width_16(&c->dstate) ? 2 : 4;
+    unsigned int olen = 0;
+    xed_error_enum_t xed_error;
+
+    xed_encoder_request_init_from_decode(req);
+    xed_encoder_request_set_branch_displacement(req, 0, nbytes);
+    xed_error = xed_encode(req, p->itext, XED_MAX_INSTRUCTION_BYTES, &olen);
+    if (xed_error != XED_ERROR_NONE) {
+        fprintf(stderr, "ERROR: %s Could not widen the branch at offset 0x"
+                XED_FMT_LX "\n", xed_error_enum_t2str(xed_error), p->old_off);
+        exit(1);
+    }
+    xed_decoded_inst_zero_set_mode(&p->xedd, &c->dstate);
+    xed_error = xed_decode(&p->xedd, p->itext, olen);
+    assert(xed_error == XED_ERROR_NONE);
+    p->len = olen;
+    p->widened = 1;
+    c->nwidened++;
+}
+
+/* Give the candidate at index i pad bytes, preferring prefixes on the
+   instructions just before it. Returns the number of prefix bytes. */
+static xed_uint_t pad_candidate(ja_ctx_t* c, xed_uint_t i, xed_uint_t pad) {
+    xed_uint_t j, k, added = 0;
+
+    for(j=i; j>0 && i-j < JA_MAX_PREFIXED_INSTS && added < pad; j--) {
+        ja_inst_t* q = c->insts + j - 1;
+        xed_uint_t np, room;
+        if (!q->can_prefix || q->covered)
+            break;
+        np = xed_decoded_inst_get_nprefixes(&q->xedd) + q->prefix_pad;
+        room = np < JA_MAX_PREFIXES ? JA_MAX_PREFIXES - np : 0;
+        if (q->len + q->prefix_pad + room > XED_MAX_INSTRUCTION_BYTES)
+            room = XED_MAX_INSTRUCTION_BYTES - q->len - q->prefix_pad;
+        if (room > pad - added)
+            room = pad - added;
+        q->prefix_pad += room;
+        added += room;
+        /* everything after q moves */
+        for(k=j;k<i;k++)
+            c->insts[k].new_off += room;
+    }
+    c->insts[i].nop_pad = pad - added;
+    return added;
+}
+
+static xed_uint_t candidate_length(ja_ctx_t* c, xed_uint_t i) {
+    ja_inst_t* p = c->insts + i;
+    return p->fused ? p->len + (p+1)->len : p->len;
+}
+
+/* One forward pass: lay out the instructions and pad each candidate that
+   crosses or ends on a boundary. Earlier instructions never move once a
+   later candidate has been placed. */
+static void layout(ja_ctx_t* c) {
+    xed_uint64_t off = 0;
+    xed_uint_t i, b = c->boundary;
+
+    c->npadded = c->nprefixes = c->nnops = c->nunfixable = 0;
+    for(i=0;i<c->ninst;i++) {
+        ja_inst_t* p = c->insts + i;
+        p->nop_pad = p->prefix_pad = 0;
+    }
+    for(i=0;i<c->ninst;i++) {
+        ja_inst_t* p = c->insts + i;
+        p->new_off = off;
+        if (p->candidate) {
+            xed_uint64_t start = c->runtime_base + off;
+            xed_uint64_t end = start + candidate_length(c,i);
+            if (start / b != end / b) {
+                if (end - start > b)
+                    c->nunfixable++;
+                else {
+                    xed_uint_t pad = XED_STATIC_CAST(xed_uint_t, b - start % b);
+                    xed_uint_t added = pad_candidate(c, i, pad);
+                    c->npadded++;
+                    c->nprefixes += added;
+                    c->nnops += pad - added;
+                    p->new_off += added;
+                }
+            }
+        }
+        off = p->new_off + p->nop_pad + p->len;
+    }
+    c->new_len = off;
+}
+
+/* Lay out the region until every relative field fits. Widening only
+   ever grows instructions, so this terminates. */
+static void relax(ja_ctx_t* c) {
+    xed_bool_t changed = 1;
+    while (changed) {
+        xed_uint_t i;
+        changed = 0;
+        layout(c);
+        for(i=0;i<c->ninst;i++) {
+            ja_inst_t* p = c->insts + i;
+            xed_int64_t d;
+            if (!p->rel_branch && !p->rip_relative)
+                continue;
+            d = XED_STATIC_CAST(xed_int64_t, new_target(c,p) - next_ip(c,p));
+            if (p->rel_branch && !fits(d,
+                       xed_decoded_inst_get_branch_displacement_width_bits(&p->xedd))) {
+                if (p->widened) {
+                    fprintf(stderr, "ERROR: branch at offset 0x" XED_FMT_LX
+                            " cannot reach its target\n", p->old_off);
+                    exit(1);
+                }
+                widen_branch(c,p);
+                changed = 1;
+            }
+            else if (p->rip_relative && !fits(d,32)) {
+                fprintf(stderr, "ERROR: RIP-relative reference at offset 0x"
+                        XED_FMT_LX " cannot reach its target\n", p->old_off);
+                exit(1);
+            }
+        }
+    }
+}
+
+static xed_uint64_t emit(ja_ctx_t* c, xed_uint8_t* out) {
+    xed_uint_t i;
+    xed_uint8_t* q = out;
+    for(i=0;i<c->ninst;i++) {
+        ja_inst_t* p = c->insts + i;
+        xed_uint_t bits;
+        xed_int64_t d;
+        xed_bool_t ok = 1;
+
+        if (p->nop_pad) {
+            xed_fill_nops(q, p->nop_pad,
+                          xed_state_get_machine_mode(&c->dstate),
+                          xed_nop_policy_decoder_friendly());
+            q += p->nop_pad;
+        }
+        memset(q, JA_PAD_PREFIX, p->prefix_pad);
+        q += p->prefix_pad;
+
+        d = XED_STATIC_CAST(xed_int64_t, new_target(c,p) - next_ip(c,p));
+        if (p->rel_branch) {
+            bits = xed_decoded_inst_get_branch_displacement_width_bits(&p->xedd);
+            ok = xed_patch_brdisp(&p->xedd, p->itext,
+                                  xed_relbr(XED_STATIC_CAST(xed_int32_t,d), bits));
+        }
+        else if (p->rip_relative) {
+            ok = xed_patch_disp(&p->xedd, p->itext, xed_disp(d, 32));
+        }
+        assert(ok);
+        memcpy(q, p->itext, p->len);
+        q += p->len;
+    }
+    return q - out;
+}
+
+/* Disassemble the emitted bytes of an instruction at its new address. */
+static void format_inst(ja_ctx_t* c, ja_inst_t* p, char* buf, int buflen) {
+    xed_decoded_inst_t xedd;
+    xed_decoded_inst_zero_set_mode(&xedd, &c->dstate);
+    if (xed_decode(&xedd, p->itext, p->len) != XED_ERROR_NONE ||
+        !xed_format_context(XED_SYNTAX_INTEL, &xedd, buf, buflen,
+                            c->runtime_base + p->new_off + p->nop_pad + p->prefix_pad,
+                            0, 0))
+        (void) xed_strncpy(buf, "???", buflen);
+}
+
+static void report(ja_ctx_t* c) {
+    xed_uint_t i;
+    char buf[XED_HEX_BUFLEN];
+    for(i=0;i<c->ninst;i++) {
+        ja_inst_t* p = c->insts + i;
+        xed_uint_t j, prefixes = 0;
+        if (p->widened) {
+            format_inst(c, p, buf, sizeof(buf));
+            printf("WIDEN  0x" XED_FMT_LX " -> 0x" XED_FMT_LX " %s\n",
+                   c->runtime_base + p->old_off,
+                   c->runtime_base + p->new_off, buf);
+        }
+        if (!p->candidate)
+            continue;
+        for(j=i; j>0 && i-j < JA_MAX_PREFIXED_INSTS; j--) {
+            if (c->insts[j-1].covered)
+                break;
+            prefixes += c->insts[j-1].prefix_pad;
+        }
+        if (p->nop_pad == 0 && prefixes == 0)
+            continue;
+        format_inst(c, p, buf, sizeof(buf));
+        printf("PAD    0x" XED_FMT_LX " -> 0x" XED_FMT_LX " %s",
+               c->runtime_base + p->old_off,
+               c->runtime_base + p->new_off + p->nop_pad, buf);
+        if (p->fused) {
+            format_inst(c, p+1, buf, sizeof(buf));
+            printf(" + %s (fused)", buf);
+        }
+        printf(": prefixes %u nops %u\n", prefixes, p->nop_pad);
+    }
+    printf("# boundary %u: %u instructions, %u padded (%u prefix bytes, "
+           "%u nop bytes), %u widened, %u too long to fix\n",
+           c->boundary, c->ninst, c->npadded, c->nprefixes, c->nnops,
+           c->nwidened, c->nunfixable);
+}
+
+static void usage(char* prog) {
+    fprintf(stderr,
+            "Usage: %s [-16|-32|-64] [-b 32|64] [-nops] [-base addr] "
+            "[-o output-file] (-i input-file | hex-bytes...)\n"
+            "\t-b        boundary, default 32\n"
+            "\t-nops     pad with NOPs only, no redundant prefixes\n"
+            "\t-base     runtime address of the first byte (hex)\n",
+            prog);
+    exit(1);
+}
+
+int main(int argc, char** argv);
+
+int main(int argc, char** argv) {
+    ja_ctx_t c;
+    int i;
+    char const* input_file = 0;
+    char const* output_file = 0;
+    char const* hex_text = 0;
+    xed_uint8_t* out;
+    xed_uint64_t olen, out_max;
+
+    memset(&c, 0, sizeof(c));
+    xed_tables_init();
+    xed_state_zero(&c.dstate);
+    c.dstate.mmode = XED_MACHINE_MODE_LONG_64;
+    c.dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+    c.boundary = 32;
+
+    for(i=1;i<argc;i++) {
+        if (strcmp(argv[i],"-64") == 0) {
+            c.dstate.mmode = XED_MACHINE_MODE_LONG_64;
+            c.dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+        }
+        else if (strcmp(argv[i],"-32") == 0) {
+            c.dstate.mmode = XED_MACHINE_MODE_LEGACY_32;
+            c.dstate.stack_addr_width = XED_ADDRESS_WIDTH_32b;
+        }
+        else if (strcmp(argv[i],"-16") == 0) {
+            c.dstate.mmode = XED_MACHINE_MODE_LEGACY_16;
+            c.dstate.stack_addr_width = XED_ADDRESS_WIDTH_16b;
+        }
+        else if (strcmp(argv[i],"-b") == 0) {
+            if (i+1 >= argc)
+                usage(argv[0]);
+            c.boundary = XED_STATIC_CAST(xed_uint_t, xed_atoi_general(argv[++i],1000));
+            if (c.boundary != 32 && c.boundary != 64)
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i],"-nops") == 0)
+            c.nops_only = 1;
+        else if (strcmp(argv[i],"-base") == 0) {
+            if (i+1 >= argc)
+                usage(argv[0]);
+            c.runtime_base = XED_STATIC_CAST(xed_uint64_t,xed_atoi_hex(argv[++i]));
+        }
+        else if (strcmp(argv[i],"-i") == 0) {
+            if (i+1 >= argc)
+                usage(argv[0]);
+            input_file = argv[++i];
+        }
+        else if (strcmp(argv[i],"-o") == 0) {
+            if (i+1 >= argc)
+                usage(argv[0]);
+            output_file = argv[++i];
+        }
+        else if (argv[i][0] == '-')
+            usage(argv[0]);
+        else
+            hex_text = xedex_append_string(hex_text, argv[i]);
+    }
+
+    if (input_file) {
+        void* start = 0;
+        unsigned int len = 0;
+        xed_map_region(input_file, &start, &len);
+        c.input = XED_REINTERPRET_CAST(const xed_uint8_t*, start);
+        c.ilen = len;
+    }
+    else if (hex_text) {
+        xed_uint8_t* bytes;
+        unsigned int len = XED_STATIC_CAST(unsigned int, strlen(hex_text));
+        if (len & 1) {
+            fprintf(stderr, "Must supply even number of nibbles\n");
+            exit(1);
+        }
+        bytes = (xed_uint8_t*)malloc(len/2 + 1);
+        assert(bytes != 0);
+        c.ilen = xed_convert_ascii_to_hex(hex_text, bytes, len/2);
+        c.input = bytes;
+    }
+    else
+        usage(argv[0]);
+
+    decode_region(&c);
+    relax(&c);
+
+    /* each candidate adds less than one boundary of padding and each
+       widened branch at most a few bytes */
+    out_max = c.ilen + (xed_uint64_t)c.ninst * (c.boundary + XED_MAX_INSTRUCTION_BYTES);
+    out = (xed_uint8_t*)malloc(out_max ? out_max : 1);
+    assert(out != 0);
+    olen = emit(&c, out);
+    assert(olen <= out_max);
+
+    report(&c);
+    if (output_file) {
+        FILE* f = fopen(output_file, "wb");
+        if (f == 0 || fwrite(out, 1, olen, f) != olen) {
+            fprintf(stderr, "ERROR: Could not write %s\n", output_file);
+            exit(1);
+        }
+        fclose(f);
+    }
+    else if (olen) {
+        char* hbuf = (char*)malloc(olen*2 + 1);
+        assert(hbuf != 0);
+        xed_print_hex_line(hbuf, out, XED_STATIC_CAST(unsigned int,olen),
+                           XED_STATIC_CAST(unsigned int,olen*2 + 1));
+        printf("%s\n", hbuf);
+        free(hbuf);
+    }
+    free(out);
+    free(c.insts);
+    return 0;
+}
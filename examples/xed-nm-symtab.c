@@ -19,36 +19,180 @@ END_LEGAL */
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "xed-symbol-table.h"
 #include "xed-nm-symtab.h"
 
 xed_symbol_table_t nm_symtab;
 xed_bool_t nm_symtab_init;
 
+/* The names are copied out of the mapped file into large blocks that
+   live as long as the symbol table. */
+#define NM_ARENA_BLOCK (1u<<20)
+
+typedef struct {
+    char* cur;
+    size_t left;
+} nm_arena_t;
+
+static char* nm_intern(nm_arena_t* a, char const* s, size_t n)
+{
+    char* p;
+    if (n + 1 > a->left) {
+        size_t sz = n + 1 > NM_ARENA_BLOCK ? n + 1 : NM_ARENA_BLOCK;
+        a->cur = (char*) malloc(sz);
+        if (!a->cur) {
+            a->left = 0;
+            return 0;
+        }
+        a->left = sz;
+    }
+    p = a->cur;
+    memcpy(p, s, n);
+    p[n] = 0;
+    a->cur += n + 1;
+    a->left -= n + 1;
+    return p;
+}
+
+static int nm_hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static int nm_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/* Read all of a pipe, FIFO or other file that cannot be mapped. The
+   caller frees the buffer. */
+static char* nm_read_all(int fd, size_t* len)
+{
+    size_t cap = 1u<<16, n = 0;
+    char* buf = (char*) malloc(cap);
+    if (!buf)
+        return 0;
+    for (;;) {
+        ssize_t r;
+        if (n == cap) {
+            char* nbuf = (char*) realloc(buf, 2*cap);
+            if (!nbuf) {
+                free(buf);
+                return 0;
+            }
+            buf = nbuf;
+            cap *= 2;
+        }
+        r = read(fd, buf + n, cap - n);
+        if (r == 0)
+            break;
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            free(buf);
+            return 0;
+        }
+        n += (size_t)r;
+    }
+    *len = n;
+    return buf;
+}
+
+/* Lines look like "ADDRESS TYPE NAME". Lines without an address, such
+   as undefined symbols, are skipped. */
+static void nm_parse(char const* base, char const* end)
+{
+    nm_arena_t arena;
+    char const* p;
+    size_t nlines = 0;
+
+    for (p = base; (p = memchr(p, '\n', (size_t)(end - p))) != 0; p++)
+        nlines++;
+    xst_bulk_reserve(&nm_symtab, nlines + 1);
+
+    arena.cur = 0;
+    arena.left = 0;
+    for (p = base; p < end; ) {
+        xed_uint64_t adr = 0;
+        char const* name;
+        char* s;
+        int d, ndigits = 0;
+
+        while (p < end && (nm_is_space(*p) || *p == '\n'))
+            p++;
+        if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') &&
+            nm_hex_digit(p[2]) >= 0)
+            p += 2;
+        for ( ; p < end && (d = nm_hex_digit(*p)) >= 0; p++, ndigits++)
+            adr = (adr << 4) | (xed_uint64_t)d;
+        while (p < end && nm_is_space(*p))
+            p++;
+        if (ndigits && p < end && *p != '\n') {
+            p++; /* symbol type */
+            while (p < end && nm_is_space(*p))
+                p++;
+            name = p;
+            while (p < end && *p != '\n' && !nm_is_space(*p))
+                p++;
+            if (p > name) {
+                s = nm_intern(&arena, name, (size_t)(p - name));
+                if (!s)
+                    break;
+                xst_bulk_add(&nm_symtab, adr, s, XST_BULK_GLOBAL);
+            }
+        }
+        while (p < end && *p != '\n')
+            p++;
+    }
+    xst_bulk_finish(&nm_symtab, 0);
+}
+
+/* Regular files are mapped. Pipes, FIFOs and files that cannot be
+   mapped, such as -S <(nm a.out), are read into a buffer. */
 void xed_read_nm_symtab(char *fn)
 {
-    char line[1024];
-    FILE *f = fopen(fn, "r");
-    if (!f)
-	    return;
+    struct stat st;
+    char* buf;
+    char const* base = MAP_FAILED;
+    size_t len = 0;
+    int fd = open(fn, O_RDONLY);
+    if (fd == -1)
+        return;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return;
+    }
 
     xed_symbol_table_init(&nm_symtab);
     nm_symtab_init = 1;
-    while (fgets(line, sizeof line, f)) {
-	unsigned long long adr;
-	char type, name[512+1];
-	char *s;
-
-	if (sscanf(line, "%llx %c %512s", &adr, &type, name) != 3)
-		continue;
-	s = malloc(strlen(name) + 1);
-	if (!s)
-		break;
-	strcpy(s, name);
-	xst_add_global_symbol(
-		&nm_symtab,
-		XED_STATIC_CAST(xed_uint64_t, adr),
-		s);
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        len = (size_t)st.st_size;
+        base = (char const*) mmap(0, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if (base != MAP_FAILED) {
+        close(fd);
+#if defined(MADV_SEQUENTIAL)
+        madvise((void*)base, len, MADV_SEQUENTIAL);
+#endif
+        nm_parse(base, base + len);
+        munmap((void*)base, len);
+        return;
     }
-    fclose(f);
+    buf = nm_read_all(fd, &len);
+    close(fd);
+    if (!buf)
+        return;
+    nm_parse(buf, buf + len);
+    free(buf);
 }
@@ -0,0 +1,379 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-startup.c
+
+// Startup and footprint benchmark for libxed.
+//
+// Measures, in this order, in a fresh process:
+//   - the cold (first) xed_tables_init() call and the warm (repeated)
+//     call, in cycles,
+//   - page faults and resident memory before and after init,
+//   - for each corpus file: decode cycles, page faults and resident
+//     memory after decoding it,
+//   - for each ISA extension seen: the cycles of the first decode of an
+//     instruction from that extension and of a warm re-decode of the
+//     same bytes.
+//
+// A corpus file uses the bulk test format of tests/bulk-tests:
+//
+//    DEC AVX   ; BUILDDIR/xed -64 -d C5EC58CB
+//    DEC       ; BUILDDIR/xed-ex1 -64 c4e2725cd0
+//
+// Only DEC lines for xed -d/-de and xed-ex1 are used. Lines that need
+// other options are skipped. The results are written to stdout as one
+// JSON object. Page faults and resident memory are reported as -1 where
+// the host does not provide them.
+
+#include "xed/xed-interface.h"
+#include "xed/xed-get-time.h"
+#include "xed-examples-util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__) || \
+    defined(__NetBSD__)
+# include <sys/resource.h>
+# include <unistd.h>
+# define XED_STARTUP_RUSAGE
+#endif
+
+int main(int argc, char** argv);
+
+#define MAX_CORPUS_INST 4096
+#define MAX_LINE 1024
+#define WARM_REPS 1000
+
+typedef struct {
+    xed_int64_t minflt;
+    xed_int64_t majflt;
+    xed_int64_t rss_kb;
+} mem_t;
+
+typedef struct {
+    xed_uint8_t itext[XED_MAX_INSTRUCTION_BYTES];
+    xed_uint8_t len;
+    xed_machine_mode_enum_t mmode;
+    xed_address_width_enum_t stack_addr_width;
+} corpus_inst_t;
+
+typedef struct {
+    corpus_inst_t first;
+    xed_uint64_t first_cycles;
+    xed_uint64_t warm_cycles;
+    xed_uint32_t count;
+} ext_stats_t;
+
+static corpus_inst_t corpus[MAX_CORPUS_INST];
+static ext_stats_t ext_stats[XED_EXTENSION_LAST];
+
+static void sample_mem(mem_t* m) {
+    m->minflt = m->majflt = m->rss_kb = -1;
+#if defined(XED_STARTUP_RUSAGE)
+    {
+        struct rusage ru;
+        if (getrusage(RUSAGE_SELF, &ru) == 0) {
+            m->minflt = ru.ru_minflt;
+            m->majflt = ru.ru_majflt;
+        }
+    }
+#endif
+#if defined(__linux__)
+    {
+        FILE* f = fopen("/proc/self/statm", "r");
+        if (f) {
+            long size, resident;
+            if (fscanf(f, "%ld %ld", &size, &resident) == 2)
+                m->rss_kb = XED_STATIC_CAST(xed_int64_t, resident) *
+                    (sysconf(_SC_PAGESIZE) / 1024);
+            fclose(f);
+        }
+    }
+#endif
+}
+
+static void print_mem(char const* indent, mem_t const* m, mem_t const* prev) {
+    printf("%s\"minflt\": %lld, \"majflt\": %lld, \"rss_kb\": %lld",
+           indent,
+           XED_STATIC_CAST(long long, m->minflt),
+           XED_STATIC_CAST(long long, m->majflt),
+           XED_STATIC_CAST(long long, m->rss_kb));
+    if (prev)
+        printf(", \"pages_touched\": %lld",
+               (m->minflt < 0) ? -1LL :
+               XED_STATIC_CAST(long long,
+                               (m->minflt + m->majflt) -
+                               (prev->minflt + prev->majflt)));
+}
+
+static void print_json_string(char const* s) {
+    putchar('"');
+    for( ; *s ; s++) {
+        if (*s == '"' || *s == '\\')
+            putchar('\\');
+        if (XED_STATIC_CAST(unsigned char, *s) >= 0x20)
+            putchar(*s);
+    }
+    putchar('"');
+}
+
+static xed_bool_t is_hex_string(char const* s) {
+    for( ; *s ; s++)
+        if (!((*s >= '0' && *s <= '9') ||
+              (*s >= 'a' && *s <= 'f') ||
+              (*s >= 'A' && *s <= 'F')))
+            return 0;
+    return 1;
+}
+
+// parse one bulk test line. Returns 1 if it is a simple decode.
+static xed_bool_t parse_line(char* line, corpus_inst_t* ci) {
+    char hex[2*XED_MAX_INSTRUCTION_BYTES+1];
+    char* p;
+    char* tok;
+    xed_bool_t ex1;
+    xed_bool_t bytes = 0;
+    unsigned int hlen = 0;
+
+    if (strncmp(line, "DEC", 3) != 0)
+        return 0;
+    p = strchr(line, ';');
+    if (!p)
+        return 0;
+    if (strchr(p, '#'))
+        *strchr(p, '#') = 0;
+
+    tok = strtok(p+1, " \t\r\n");
+    if (!tok)
+        return 0;
+    if (strcmp(tok, "BUILDDIR/xed") == 0)
+        ex1 = 0;
+    else if (strcmp(tok, "BUILDDIR/xed-ex1") == 0)
+        ex1 = 1;
+    else
+        return 0;
+
+    ci->mmode = XED_MACHINE_MODE_LEGACY_32;
+    ci->stack_addr_width = XED_ADDRESS_WIDTH_32b;
+    while ((tok = strtok(0, " \t\r\n")) != 0) {
+        if (bytes || (ex1 && tok[0] != '-')) {
+            unsigned int n = XED_STATIC_CAST(unsigned int, strlen(tok));
+            bytes = 1;
+            if (!is_hex_string(tok) || hlen + n >= sizeof(hex))
+                return 0;
+            memcpy(hex + hlen, tok, n);
+            hlen += n;
+        }
+        else if (strcmp(tok, "-64") == 0) {
+            ci->mmode = XED_MACHINE_MODE_LONG_64;
+            ci->stack_addr_width = XED_ADDRESS_WIDTH_64b;
+        }
+        else if (strcmp(tok, "-32") == 0) {
+            ci->mmode = XED_MACHINE_MODE_LEGACY_32;
+            ci->stack_addr_width = XED_ADDRESS_WIDTH_32b;
+        }
+        else if (strcmp(tok, "-16") == 0) {
+            ci->mmode = XED_MACHINE_MODE_LEGACY_16;
+            ci->stack_addr_width = XED_ADDRESS_WIDTH_16b;
+        }
+        else if (!ex1 && (strcmp(tok, "-d") == 0 || strcmp(tok, "-de") == 0))
+            bytes = 1;
+        else if (strcmp(tok, "-chip") == 0) {
+            if (!strtok(0, " \t\r\n"))
+                return 0;
+        }
+        else if (strcmp(tok, "-set") == 0) {
+            if (!strtok(0, " \t\r\n") || !strtok(0, " \t\r\n"))
+                return 0;
+        }
+        else
+            return 0; // not a simple decode
+    }
+    if (hlen == 0 || (hlen & 1))
+        return 0;
+    hex[hlen] = 0;
+    ci->len = XED_STATIC_CAST(xed_uint8_t,
+                              xed_convert_ascii_to_hex(hex, ci->itext,
+                                                       XED_MAX_INSTRUCTION_BYTES));
+    return 1;
+}
+
+static unsigned int read_corpus(char const* fn) {
+    char line[MAX_LINE];
+    unsigned int n = 0;
+    FILE* f = fopen(fn, "r");
+    if (!f) {
+        fprintf(stderr, "Could not open corpus file %s\n", fn);
+        exit(1);
+    }
+    while (n < MAX_CORPUS_INST && fgets(line, sizeof(line), f))
+        if (parse_line(line, corpus + n))
+            n++;
+    fclose(f);
+    return n;
+}
+
+static xed_error_enum_t decode(corpus_inst_t const* ci,
+                               xed_decoded_inst_t* xedd,
+                               xed_uint64_t* cycles) {
+    xed_uint64_t t1, t2;
+    xed_error_enum_t err;
+    xed_decoded_inst_zero(xedd);
+    xed_decoded_inst_set_mode(xedd, ci->mmode, ci->stack_addr_width);
+    t1 = xed_get_time();
+    err = xed_decode(xedd, ci->itext, ci->len);
+    t2 = xed_get_time();
+    *cycles = t2 - t1;
+    return err;
+}
+
+static void usage(char const* prog) {
+    fprintf(stderr,
+            "Usage: %s [-init-only] [-reps N] corpus-file...\n", prog);
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    mem_t m_start, m_init, m_prev, m;
+    xed_uint64_t t1, t2, cold_cycles, warm_total;
+    unsigned int reps = 1000000;
+    xed_bool_t init_only = 0;
+    int first_corpus = 0;
+    int i;
+    unsigned int r;
+    xed_uint_t e;
+    xed_bool_t first;
+
+    // nothing from libxed may run before the cold measurement
+    sample_mem(&m_start);
+    t1 = xed_get_time();
+    xed_tables_init();
+    t2 = xed_get_time();
+    cold_cycles = t2 - t1;
+    sample_mem(&m_init);
+
+    for(i=1;i<argc;i++) {
+        if (strcmp(argv[i], "-init-only") == 0)
+            init_only = 1;
+        else if (strcmp(argv[i], "-reps") == 0) {
+            if (i+1 >= argc)
+                usage(argv[0]);
+            reps = XED_STATIC_CAST(unsigned int,
+                                   xed_atoi_general(argv[++i], 1000));
+            if (reps == 0)
+                usage(argv[0]);
+        }
+        else if (argv[i][0] == '-')
+            usage(argv[0]);
+        else {
+            first_corpus = i;
+            break;
+        }
+    }
+
+    t1 = xed_get_time();
+    for(r=0;r<reps;r++)
+        xed_tables_init();
+    t2 = xed_get_time();
+    warm_total = t2 - t1;
+
+    printf("{\n");
+#if defined(XED_DLL)
+    printf("  \"linkage\": \"shared\",\n");
+#else
+    printf("  \"linkage\": \"static\",\n");
+#endif
+    printf("  \"version\": ");
+    print_json_string(xed_get_version());
+    printf(",\n  \"start\": {");
+    print_mem(" ", &m_start, 0);
+    printf(" },\n");
+    printf("  \"tables_init\": { \"cold_cycles\": %llu, "
+           "\"warm_cycles\": %.2f,",
+           XED_STATIC_CAST(unsigned long long, cold_cycles),
+           XED_STATIC_CAST(double, warm_total) / reps);
+    print_mem(" ", &m_init, &m_start);
+    printf(" }");
+
+    if (init_only || first_corpus == 0) {
+        printf("\n}\n");
+        return 0;
+    }
+
+    printf(",\n  \"corpora\": [");
+    m_prev = m_init;
+    for(i=first_corpus;i<argc;i++) {
+        xed_decoded_inst_t xedd;
+        unsigned int n = read_corpus(argv[i]);
+        unsigned int j, errors = 0;
+        xed_uint64_t total = 0;
+
+        for(j=0;j<n;j++) {
+            xed_uint64_t cycles;
+            if (decode(corpus + j, &xedd, &cycles) != XED_ERROR_NONE) {
+                errors++;
+                continue;
+            }
+            total += cycles;
+            e = xed_decoded_inst_get_extension(&xedd);
+            if (ext_stats[e].count++ == 0) {
+                ext_stats[e].first = corpus[j];
+                ext_stats[e].first_cycles = cycles;
+            }
+        }
+        sample_mem(&m);
+        printf("%s\n    { \"file\": ", i == first_corpus ? "" : ",");
+        print_json_string(argv[i]);
+        printf(", \"decoded\": %u, \"errors\": %u, \"cycles\": %llu,",
+               n - errors, errors,
+               XED_STATIC_CAST(unsigned long long, total));
+        print_mem(" ", &m, &m_prev);
+        printf(" }");
+        m_prev = m;
+    }
+    printf("\n  ],\n");
+
+    // warm decode of the first instruction seen for each extension
+    printf("  \"extensions\": [");
+    first = 1;
+    for(e=0;e<XED_EXTENSION_LAST;e++) {
+        xed_decoded_inst_t xedd;
+        xed_uint64_t best = ~XED_STATIC_CAST(xed_uint64_t, 0);
+        if (ext_stats[e].count == 0)
+            continue;
+        for(r=0;r<WARM_REPS;r++) {
+            xed_uint64_t cycles;
+            decode(&ext_stats[e].first, &xedd, &cycles);
+            if (cycles < best)
+                best = cycles;
+        }
+        ext_stats[e].warm_cycles = best;
+        printf("%s\n    { \"extension\": \"%s\", \"count\": %u, "
+               "\"first_cycles\": %llu, \"warm_cycles\": %llu }",
+               first ? "" : ",",
+               xed_extension_enum_t2str(XED_STATIC_CAST(xed_extension_enum_t, e)),
+               ext_stats[e].count,
+               XED_STATIC_CAST(unsigned long long, ext_stats[e].first_cycles),
+               XED_STATIC_CAST(unsigned long long, ext_stats[e].warm_cycles));
+        first = 0;
+    }
+    sample_mem(&m);
+    printf("\n  ],\n  \"end\": {");
+    print_mem(" ", &m, &m_init);
+    printf(" }\n}\n");
+    return 0;
+}
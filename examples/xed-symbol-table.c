@@ -17,20 +17,32 @@ Copyright (c) 2019 Intel Corporation
 END_LEGAL */
 
 #include <assert.h>
+#include <string.h>
 #include "xed/xed-interface.h"
 #include "xed-examples-util.h"
 #include "xed-symbol-table.h"
+#if defined(XED_DECODER) && !defined(_WIN32)
+# include <pthread.h>
+# include <unistd.h>
+# define XST_PARALLEL_SORT
+#endif
 
 //////////////////////////////////////////////////////////////////////
 void xed_local_symbol_table_init(xed_local_symbol_table_t* p)
 {
     avl_tree_init(&p->atree);
+    p->syms = 0;
+    p->nsyms = 0;
 }
 
 void xed_symbol_table_init(xed_symbol_table_t* p) {
     p->curtab = 0;
     xed_local_symbol_table_init(&p->gtab);
     avl_tree_init(&p->avl_lmap);
+    p->bulk = 0;
+    p->nbulk = 0;
+    p->bulk_cap = 0;
+    p->bulk_sorted = 0;
 }
 
 xed_local_symbol_table_t* xst_get_local_map(xed_symbol_table_t* p,
@@ -76,18 +88,226 @@ void xst_add_global_symbol(xed_symbol_table_t* p,
 
 
 //////////////////////////////////////////////////////////////////////
+// bulk loading
+
+void xst_bulk_reserve(xed_symbol_table_t* p, xed_uint64_t n)
+{
+    if (n <= p->bulk_cap)
+        return;
+    assert(n < 0xFFFFFFFFULL);
+    p->bulk = (xed_bulk_symbol_t*) realloc(p->bulk,
+                                           n * sizeof(xed_bulk_symbol_t));
+    assert(p->bulk != 0);
+    p->bulk_cap = (xed_uint32_t) n;
+}
+
+void xst_bulk_add(xed_symbol_table_t* p,
+                  xed_uint64_t addr, char* name,
+                  xed_uint32_t section)
+{
+    xed_bulk_symbol_t* b;
+    if (p->nbulk == p->bulk_cap)
+        xst_bulk_reserve(p, p->bulk_cap ? 2 * (xed_uint64_t)p->bulk_cap
+                                        : 1024);
+    b = p->bulk + p->nbulk;
+    b->addr = addr;
+    b->name = name;
+    b->section = section;
+    b->seq = p->nbulk++;
+}
+
+static int bulk_less(xed_bulk_symbol_t const* x, xed_bulk_symbol_t const* y)
+{
+    if (x->section != y->section)
+        return x->section < y->section;
+    if (x->addr != y->addr)
+        return x->addr < y->addr;
+    return x->seq < y->seq;
+}
+
+static int bulk_cmp(void const* a, void const* b)
+{
+    xed_bulk_symbol_t const* x = (xed_bulk_symbol_t const*)a;
+    xed_bulk_symbol_t const* y = (xed_bulk_symbol_t const*)b;
+    if (bulk_less(x, y))
+        return -1;
+    return bulk_less(y, x);
+}
+
+#if defined(XST_PARALLEL_SORT)
+/* below this many symbols a single qsort is faster than starting
+   threads */
+# define XST_PARALLEL_SORT_MIN (1u<<16)
+# define XST_MAX_SORT_THREADS 16
+
+typedef struct {
+    xed_bulk_symbol_t* base;
+    xed_uint32_t n;
+} sort_chunk_t;
+
+static void* sort_thread(void* arg)
+{
+    sort_chunk_t* c = (sort_chunk_t*)arg;
+    qsort(c->base, c->n, sizeof(xed_bulk_symbol_t), bulk_cmp);
+    return 0;
+}
+
+/* sort nthreads chunks in parallel and merge the sorted runs pairwise */
+static void parallel_sort(xed_bulk_symbol_t* a, xed_uint32_t n,
+                          unsigned int nthreads)
+{
+    pthread_t tids[XST_MAX_SORT_THREADS];
+    xed_bool_t started[XST_MAX_SORT_THREADS];
+    sort_chunk_t chunks[XST_MAX_SORT_THREADS];
+    xed_uint32_t bounds[XST_MAX_SORT_THREADS+1];
+    xed_bulk_symbol_t* tmp;
+    xed_bulk_symbol_t* src = a;
+    xed_bulk_symbol_t* dst;
+    unsigned int i, nruns = nthreads;
+
+    for (i = 0; i <= nthreads; i++)
+        bounds[i] = (xed_uint32_t)(((xed_uint64_t)n * i) / nthreads);
+    for (i = 0; i < nthreads; i++) {
+        chunks[i].base = a + bounds[i];
+        chunks[i].n = bounds[i+1] - bounds[i];
+        started[i] = pthread_create(tids + i, 0, sort_thread, chunks + i) == 0;
+        if (!started[i])
+            sort_thread(chunks + i);
+    }
+    for (i = 0; i < nthreads; i++)
+        if (started[i])
+            pthread_join(tids[i], 0);
+
+    tmp = (xed_bulk_symbol_t*) malloc(n * sizeof(xed_bulk_symbol_t));
+    assert(tmp != 0);
+    dst = tmp;
+    while (nruns > 1) {
+        unsigned int r, out = 0;
+        for (r = 0; r < nruns; r += 2) {
+            xed_uint32_t lo = bounds[r];
+            xed_uint32_t mid = bounds[r+1];
+            xed_uint32_t hi = (r+2 <= nruns) ? bounds[r+2] : mid;
+            xed_uint32_t i1 = lo, i2 = mid, k = lo;
+            while (i1 < mid && i2 < hi)
+                dst[k++] = bulk_less(src + i2, src + i1) ? src[i2++] : src[i1++];
+            while (i1 < mid)
+                dst[k++] = src[i1++];
+            while (i2 < hi)
+                dst[k++] = src[i2++];
+            bounds[out++] = lo;
+        }
+        bounds[out] = n;
+        nruns = out;
+        { xed_bulk_symbol_t* t = src; src = dst; dst = t; }
+    }
+    if (src != a)
+        memcpy(a, src, n * sizeof(xed_bulk_symbol_t));
+    free(tmp);
+}
+#endif
+
+void xst_bulk_finish(xed_symbol_table_t* p, unsigned int nthreads)
+{
+    xed_uint32_t i, out = 0;
+    xed_bulk_symbol_t* b = p->bulk;
+    xed_uint32_t n = p->nbulk;
+
+    assert(p->bulk_sorted == 0); /* only one bulk load per table */
+#if defined(XST_PARALLEL_SORT)
+    /* the default only pays for the threads on large tables; an
+       explicit count is honored whatever the size */
+    if (nthreads == 0 && n >= XST_PARALLEL_SORT_MIN) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = ncpu > 0 ? (unsigned int)ncpu : 1;
+    }
+    if (nthreads > XST_MAX_SORT_THREADS)
+        nthreads = XST_MAX_SORT_THREADS;
+    if (nthreads > n)
+        nthreads = n;
+    if (nthreads > 1)
+        parallel_sort(b, n, nthreads);
+    else
+#endif
+        qsort(b, n, sizeof(xed_bulk_symbol_t), bulk_cmp);
+    (void)nthreads;
+
+    /* one pass: carve the per-section arrays out of one allocation,
+       keeping the last symbol added at each address */
+    p->bulk_sorted = (xed_symbol_t*) malloc((n ? n : 1) * sizeof(xed_symbol_t));
+    assert(p->bulk_sorted != 0);
+    for (i = 0; i < n; ) {
+        xed_uint32_t section = b[i].section;
+        xed_local_symbol_table_t* ltab;
+        if (section == XST_BULK_GLOBAL)
+            ltab = &p->gtab;
+        else if ((ltab = xst_get_local_map(p, section)) == 0)
+            ltab = xst_make_local_map(p, section);
+        assert(ltab->syms == 0);
+        ltab->syms = p->bulk_sorted + out;
+        for ( ; i < n && b[i].section == section; i++) {
+            if (i+1 < n && b[i+1].section == section &&
+                b[i+1].addr == b[i].addr)
+                continue;
+            p->bulk_sorted[out].addr = b[i].addr;
+            p->bulk_sorted[out].name = b[i].name;
+            out++;
+        }
+        ltab->nsyms = (xed_uint32_t)(p->bulk_sorted + out - ltab->syms);
+    }
+    free(p->bulk);
+    p->bulk = 0;
+    p->nbulk = 0;
+    p->bulk_cap = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+/* index of the last bulk symbol with an address <= tgt, or -1 */
+static xed_int64_t sorted_lower_bound(xed_local_symbol_table_t const* ltab,
+                                      xed_uint64_t tgt)
+{
+    xed_uint32_t lo = 0, hi = ltab->nsyms;
+    while (lo < hi) {
+        xed_uint32_t mid = lo + (hi - lo) / 2;
+        if (ltab->syms[mid].addr <= tgt)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (xed_int64_t)lo - 1;
+}
+
+static char* local_find(xed_local_symbol_table_t* ltab, xed_uint64_t a)
+{
+    xed_int64_t i;
+    char* name = (char*)avl_find(&ltab->atree, a);
+    if (name)
+        return name;
+    i = sorted_lower_bound(ltab, a);
+    if (i >= 0 && ltab->syms[i].addr == a)
+        return ltab->syms[i].name;
+    return 0;
+}
+
 static xed_bool_t
 find_symbol_address(xed_local_symbol_table_t* ltab,
                     xed_uint64_t tgt,
                     xed_uint64_t* sym_addr)
 {
     uint64_t lbkey=0;
+    xed_bool_t found = 0;
+    xed_int64_t i;
     void* sym = avl_find_lower_bound(&ltab->atree, tgt, &lbkey);
     if (sym) {
         *sym_addr = lbkey;
-        return 1;
+        found = 1;
     }
-    return 0;
+    i = sorted_lower_bound(ltab, tgt);
+    if (i >= 0 && (!found || ltab->syms[i].addr > *sym_addr)) {
+        *sym_addr = ltab->syms[i].addr;
+        found = 1;
+    }
+    return found;
 }
 
 static xed_bool_t
@@ -110,14 +330,12 @@ find_symbol_address_global(xed_uint64_t tgt,
 char* get_symbol(xed_uint64_t a, void* caller_data) {
     xed_symbol_table_t* symbol_table = (xed_symbol_table_t*)caller_data;
     /* look in the global symbol table  first */
-    char* name = (char*)avl_find(&symbol_table->gtab.atree, a);
+    char* name = local_find(&symbol_table->gtab, a);
     if (name)
         return name;
     /* look in the local symbol table if present */
-    if (symbol_table->curtab) {
-        name = (char*)avl_find(&symbol_table->curtab->atree, a);
-        return name;
-    }
+    if (symbol_table->curtab)
+        return local_find(symbol_table->curtab, a);
     return 0;
 }
 
@@ -24,10 +24,26 @@ END_LEGAL */
 #include "avltree.h"
 #include <stdlib.h>
 
+typedef struct {
+    xed_uint64_t addr;
+    char* name;
+} xed_symbol_t;
+
 typedef struct  {
     avl_tree_t atree;
+    /* symbols from xst_bulk_finish(), sorted by address. They are
+       searched along with atree. */
+    xed_symbol_t* syms;
+    xed_uint32_t nsyms;
 } xed_local_symbol_table_t;
 
+typedef struct {
+    xed_uint64_t addr;
+    char* name;
+    xed_uint32_t section;
+    xed_uint32_t seq; /* order of addition */
+} xed_bulk_symbol_t;
+
 void xed_local_symbol_table_init(xed_local_symbol_table_t* p);
 
 typedef struct  {
@@ -37,6 +53,12 @@ typedef struct  {
     /* the symbol table for the current section */
     xed_local_symbol_table_t* curtab;
 
+    /* pending bulk symbols and the storage of the sorted arrays */
+    xed_bulk_symbol_t* bulk;
+    xed_uint32_t nbulk;
+    xed_uint32_t bulk_cap;
+    xed_symbol_t* bulk_sorted;
+
 } xed_symbol_table_t;
 
 void xed_symbol_table_init(xed_symbol_table_t* p);
@@ -57,6 +79,24 @@ void xst_add_local_symbol(xed_symbol_table_t* p,
 void xst_add_global_symbol(xed_symbol_table_t* p,
                            xed_uint64_t addr, char* name);
 
+/* Bulk loading of symbols, for files with many of them. Reserve
+   room for the expected number of symbols, add them in any order and
+   call xst_bulk_finish() once after the last one. Names are not
+   copied. As with xst_add_local_symbol(), the last symbol added for an
+   address in a section wins. Symbols added with section
+   XST_BULK_GLOBAL go to the global table. nthreads is the number of
+   threads used to sort the symbols; 0 means one per processor for
+   large tables and a plain sort otherwise. */
+#define XST_BULK_GLOBAL 0xFFFFFFFFu
+
+void xst_bulk_reserve(xed_symbol_table_t* p, xed_uint64_t n);
+
+void xst_bulk_add(xed_symbol_table_t* p,
+                  xed_uint64_t addr, char* name,
+                  xed_uint32_t section);
+
+void xst_bulk_finish(xed_symbol_table_t* p, unsigned int nthreads);
+
 ////////////////////////////////////////////////////////////////
 
 char* get_symbol(xed_uint64_t a, void* symbol_table);
@@ -0,0 +1,410 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-tput.c
+
+// Static throughput and latency estimate for a loop body.
+//
+// The loop body is given as hex bytes; the last instruction is normally
+// the backward branch. The cost of each instruction comes from a cost
+// table keyed by iform (or by iclass as a fallback), one row per line:
+//
+//    # key, uops, latency, reciprocal throughput, ports
+//    ADD_GPRv_GPRv_01, 1, 1, 0.25, 0156
+//    IMUL,             1, 3, 1,    1
+//    DEFAULT,          1, 1, 1,    0156
+//
+// Ports are a list of port digits. The DEFAULT row is used for
+// instructions that have no entry; without it they cost 1 uop with a
+// latency of 1 on any port.
+//
+// The estimate is the largest of these bounds, in cycles per iteration:
+//   - the loop carried chain of true dependences, from simulating the
+//     iterations over the xed_dep_graph_build() graph of two copies of
+//     the body,
+//   - the busiest port after spreading the uops over their ports,
+//   - the issue width,
+//   - the largest reciprocal throughput of a single instruction.
+
+#include "xed/xed-interface.h"
+#include "xed-examples-util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> //strcmp, strlen
+#include <assert.h>
+
+int main(int argc, char** argv);
+
+#define MAX_INST  64
+#define MAX_PORTS 10
+
+typedef struct {
+    xed_bool_t valid;
+    xed_uint32_t uops;
+    xed_uint32_t latency;
+    double rtput;
+    xed_uint32_t ports;  // bit mask
+} cost_t;
+
+typedef struct {
+    cost_t* iform;      // [XED_IFORM_LAST]
+    cost_t* iclass;     // [XED_ICLASS_LAST]
+    cost_t dflt;
+    xed_uint32_t nrows;
+} cost_table_t;
+
+static void usage(char const* prog) {
+    fprintf(stderr,
+            "Usage: %s [-16|-32|-64] -t cost-table.csv [-width N] "
+            "[-iters N] hex-bytes...\n", prog);
+    exit(1);
+}
+
+static xed_uint32_t parse_ports(char const* s) {
+    xed_uint32_t m = 0;
+    for( ; *s ; s++)
+        if (*s >= '0' && *s <= '9' && *s - '0' < MAX_PORTS)
+            m |= 1u << (*s - '0');
+    return m;
+}
+
+static void read_cost_table(char const* fn, cost_table_t* t) {
+    char line[1024];
+    unsigned int lineno = 0;
+    FILE* f = fopen(fn, "r");
+    if (!f) {
+        fprintf(stderr, "Could not open cost table %s\n", fn);
+        exit(1);
+    }
+    t->iform = (cost_t*)calloc(XED_IFORM_LAST, sizeof(cost_t));
+    t->iclass = (cost_t*)calloc(XED_ICLASS_LAST, sizeof(cost_t));
+    assert(t->iform != 0 && t->iclass != 0);
+    t->dflt.valid = 1;
+    t->dflt.uops = 1;
+    t->dflt.latency = 1;
+    t->dflt.rtput = 1.0;
+    t->dflt.ports = (1u << MAX_PORTS) - 1;
+    t->nrows = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        xed_str_list_t* tokens;
+        xed_str_list_t* p;
+        char* field[5];
+        xed_uint_t n = 0;
+        cost_t c;
+        char* hash = strchr(line, '#');
+
+        lineno++;
+        if (hash)
+            *hash = 0;
+        tokens = xed_tokenize(line, ", \t\r\n");
+        if (!tokens)
+            continue;
+        for(p=tokens; p && n<5; p=p->next)
+            field[n++] = p->s;
+        if (n != 5 || p) {
+            fprintf(stderr, "%s:%u: expected 5 fields\n", fn, lineno);
+            exit(1);
+        }
+        c.valid = 1;
+        c.uops = XED_STATIC_CAST(xed_uint32_t, atoi(field[1]));
+        c.latency = XED_STATIC_CAST(xed_uint32_t, atoi(field[2]));
+        c.rtput = atof(field[3]);
+        c.ports = parse_ports(field[4]);
+        if (c.ports == 0) {
+            fprintf(stderr, "%s:%u: no ports\n", fn, lineno);
+            exit(1);
+        }
+        if (strcmp(field[0], "DEFAULT") == 0)
+            t->dflt = c;
+        else {
+            xed_iform_enum_t iform = str2xed_iform_enum_t(field[0]);
+            xed_iclass_enum_t iclass = str2xed_iclass_enum_t(field[0]);
+            if (iform != XED_IFORM_INVALID)
+                t->iform[iform] = c;
+            else if (iclass != XED_ICLASS_INVALID)
+                t->iclass[iclass] = c;
+            else {
+                fprintf(stderr, "%s:%u: unknown iform or iclass %s\n",
+                        fn, lineno, field[0]);
+                exit(1);
+            }
+        }
+        t->nrows++;
+        xed_free_token_list(tokens);
+    }
+    fclose(f);
+}
+
+/* returns 1 if the cost came from an iform or iclass row */
+static xed_bool_t lookup(cost_table_t const* t,
+                         xed_decoded_inst_t const* xedd,
+                         cost_t* c) {
+    xed_iform_enum_t iform = xed_decoded_inst_get_iform_enum(xedd);
+    xed_iclass_enum_t iclass = xed_decoded_inst_get_iclass(xedd);
+    if (t->iform[iform].valid) {
+        *c = t->iform[iform];
+        return 1;
+    }
+    if (t->iclass[iclass].valid) {
+        *c = t->iclass[iclass];
+        return 1;
+    }
+    *c = t->dflt;
+    return 0;
+}
+
+static xed_uint_t popcount(xed_uint32_t x) {
+    xed_uint_t n = 0;
+    for( ; x ; x &= x-1)
+        n++;
+    return n;
+}
+
+int main(int argc, char** argv) {
+    xed_state_t dstate;
+    xed_decoded_inst_t xedd;
+    cost_table_t table;
+    cost_t cost[MAX_INST];
+    xed_bool_t known[MAX_INST];
+    char text[MAX_INST][128];
+    char iform_name[MAX_INST][64];
+    xed_dep_summary_t sum[2*MAX_INST];
+    xed_uint32_t first[2*MAX_INST+1];
+    xed_dep_edge_t* edges;
+    xed_dep_graph_t g;
+    xed_bool_t carried[MAX_INST];
+    double done[MAX_INST], prev[MAX_INST];
+    double start_half = 0, end = 0;
+    double pressure[MAX_PORTS];
+    xed_uint32_t order[MAX_INST];
+    double lat_bound, port_bound = 0, issue_bound, rtput_bound = 0;
+    double estimate;
+    char const* bottleneck;
+    xed_uint_t busiest = 0, total_uops = 0;
+    char const* table_fn = 0;
+    char const* hex_text = 0;
+    xed_uint8_t* bytes;
+    unsigned int len, nbytes, offset = 0;
+    xed_uint32_t n = 0, i, j, e, k, iters = 100, width = 4;
+    int a;
+
+    xed_tables_init();
+    xed_state_zero(&dstate);
+    dstate.mmode = XED_MACHINE_MODE_LONG_64;
+    dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+
+    for(a=1;a<argc;a++) {
+        if (strcmp(argv[a],"-64") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LONG_64;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_64b;
+        }
+        else if (strcmp(argv[a],"-32") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LEGACY_32;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_32b;
+        }
+        else if (strcmp(argv[a],"-16") == 0) {
+            dstate.mmode = XED_MACHINE_MODE_LEGACY_16;
+            dstate.stack_addr_width = XED_ADDRESS_WIDTH_16b;
+        }
+        else if (strcmp(argv[a],"-t") == 0 && a+1 < argc)
+            table_fn = argv[++a];
+        else if (strcmp(argv[a],"-width") == 0 && a+1 < argc)
+            width = XED_STATIC_CAST(xed_uint32_t, atoi(argv[++a]));
+        else if (strcmp(argv[a],"-iters") == 0 && a+1 < argc)
+            iters = XED_STATIC_CAST(xed_uint32_t, atoi(argv[++a]));
+        else if (argv[a][0] == '-')
+            usage(argv[0]);
+        else
+            hex_text = xedex_append_string(hex_text, argv[a]);
+    }
+    if (!hex_text || !table_fn || width == 0 || iters < 2)
+        usage(argv[0]);
+    read_cost_table(table_fn, &table);
+
+    len = XED_STATIC_CAST(unsigned int, strlen(hex_text));
+    if (len & 1) {
+        fprintf(stderr, "Must supply even number of nibbles\n");
+        exit(1);
+    }
+    bytes = (xed_uint8_t*)malloc(len/2 + 1);
+    assert(bytes != 0);
+    nbytes = xed_convert_ascii_to_hex(hex_text, bytes, len/2);
+
+    while (offset < nbytes) {
+        xed_error_enum_t err;
+        if (n == MAX_INST) {
+            fprintf(stderr, "Loop body too long, max %u instructions\n",
+                    MAX_INST);
+            exit(1);
+        }
+        xed_decoded_inst_zero_set_mode(&xedd, &dstate);
+        err = xed_decode(&xedd, bytes+offset, nbytes-offset);
+        if (err != XED_ERROR_NONE) {
+            fprintf(stderr, "Decode error at offset %u: %s\n",
+                    offset, xed_error_enum_t2str(err));
+            exit(1);
+        }
+        if (!xed_format_context(XED_SYNTAX_INTEL, &xedd, text[n],
+                                sizeof(text[n]), offset, 0, 0))
+            strcpy(text[n], "???");
+        xed_strncpy(iform_name[n],
+                    xed_iform_enum_t2str(xed_decoded_inst_get_iform_enum(&xedd)),
+                    sizeof(iform_name[n]));
+        known[n] = lookup(&table, &xedd, cost+n);
+        xed_decoded_inst_get_dep_summary(&xedd, sum+n);
+        /* the branch writing the instruction pointer is not a data
+           dependence of the next iteration */
+        xed_reg_set_remove(&sum[n].use, XED_REG_RIP);
+        xed_reg_set_remove(&sum[n].use, XED_REG_EIP);
+        xed_reg_set_remove(&sum[n].use, XED_REG_IP);
+        xed_reg_set_remove(&sum[n].def, XED_REG_RIP);
+        xed_reg_set_remove(&sum[n].def, XED_REG_EIP);
+        xed_reg_set_remove(&sum[n].def, XED_REG_IP);
+        offset += xed_decoded_inst_get_length(&xedd);
+        n++;
+    }
+
+    /* two copies of the body: edges from the first copy in to the second
+       are loop carried. */
+    for(i=0;i<n;i++)
+        sum[n+i] = sum[i];
+    g.first = first;
+    g.max_edges = n*(2*n-1);
+    g.edges = edges = (xed_dep_edge_t*)malloc(g.max_edges *
+                                              sizeof(xed_dep_edge_t));
+    assert(edges != 0);
+    if (!xed_dep_graph_build(sum, 2*n, &g)) {
+        fprintf(stderr, "Too many edges\n");
+        exit(1);
+    }
+    for(i=0;i<n;i++) {
+        carried[i] = 0;
+        for(e=first[n+i];e<first[n+i+1];e++)
+            if ((edges[e].kinds & XED_DEP_RAW) && edges[e].src < n)
+                carried[i] = 1;
+    }
+
+    /* latency: completion times over many iterations, ignoring
+       resources. The slope over the second half is the bound. */
+    for(i=0;i<n;i++)
+        prev[i] = 0;
+    for(k=0;k<iters;k++) {
+        for(i=0;i<n;i++) {
+            double t = 0;
+            for(e=first[n+i];e<first[n+i+1];e++) {
+                xed_uint32_t s = edges[e].src;
+                double r;
+                if (!(edges[e].kinds & XED_DEP_RAW))
+                    continue;
+                r = (s < n) ? prev[s] : done[s-n];
+                if (r > t)
+                    t = r;
+            }
+            done[i] = t + cost[i].latency;
+        }
+        end = 0;
+        for(i=0;i<n;i++) {
+            prev[i] = done[i];
+            if (done[i] > end)
+                end = done[i];
+        }
+        if (k+1 == iters/2)
+            start_half = end;
+    }
+    lat_bound = (end - start_half) / (iters - iters/2);
+
+    /* ports: place each uop on the least loaded of its ports, the
+       instructions with the fewest choices first. */
+    for(j=0;j<MAX_PORTS;j++)
+        pressure[j] = 0;
+    for(i=0;i<n;i++)
+        order[i] = i;
+    for(i=1;i<n;i++)
+        for(j=i;j>0 &&
+                popcount(cost[order[j]].ports) <
+                popcount(cost[order[j-1]].ports);j--) {
+            xed_uint32_t t = order[j];
+            order[j] = order[j-1];
+            order[j-1] = t;
+        }
+    for(i=0;i<n;i++) {
+        cost_t const* c = cost + order[i];
+        for(k=0;k<c->uops;k++) {
+            xed_uint_t best = MAX_PORTS;
+            for(j=0;j<MAX_PORTS;j++)
+                if ((c->ports >> j) & 1)
+                    if (best == MAX_PORTS || pressure[j] < pressure[best])
+                        best = j;
+            pressure[best] += 1;
+        }
+        total_uops += c->uops;
+        if (c->rtput > rtput_bound)
+            rtput_bound = c->rtput;
+    }
+    for(j=0;j<MAX_PORTS;j++)
+        if (pressure[j] > port_bound) {
+            port_bound = pressure[j];
+            busiest = j;
+        }
+    issue_bound = XED_STATIC_CAST(double, total_uops) / width;
+
+    estimate = lat_bound;
+    bottleneck = "dependency chain";
+    if (port_bound > estimate) {
+        estimate = port_bound;
+        bottleneck = "port";
+    }
+    if (issue_bound > estimate) {
+        estimate = issue_bound;
+        bottleneck = "issue width";
+    }
+    if (rtput_bound > estimate) {
+        estimate = rtput_bound;
+        bottleneck = "instruction throughput";
+    }
+
+    printf("Cost table rows: %u\n", table.nrows);
+    printf("  #  uops lat  rtput ports      iform / instruction\n");
+    for(i=0;i<n;i++) {
+        char ports[MAX_PORTS+1];
+        xed_uint_t np = 0;
+        for(j=0;j<MAX_PORTS;j++)
+            if ((cost[i].ports >> j) & 1)
+                ports[np++] = XED_STATIC_CAST(char, '0'+j);
+        ports[np] = 0;
+        printf("%3u %4u %4u %6.2f %-10s %s%s%s\n",
+               i, cost[i].uops, cost[i].latency, cost[i].rtput, ports,
+               iform_name[i],
+               known[i] ? "" : " (default cost)",
+               carried[i] ? " (loop carried)" : "");
+        printf("%37s%s\n", "", text[i]);
+    }
+    printf("Port pressure per iteration:");
+    for(j=0;j<MAX_PORTS;j++)
+        if (pressure[j] > 0)
+            printf(" p%u=%.2f", j, pressure[j]);
+    printf("\n");
+    printf("Bounds (cycles/iteration):\n");
+    printf("  dependency chain       %6.2f\n", lat_bound);
+    printf("  port p%u                %6.2f\n", busiest, port_bound);
+    printf("  issue width %-2u         %6.2f\n", width, issue_bound);
+    printf("  instruction throughput %6.2f\n", rtput_bound);
+    printf("Estimated cycles/iteration: %.2f (%s)\n", estimate, bottleneck);
+    free(edges);
+    return 0;
+}
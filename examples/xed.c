@@ -32,6 +32,7 @@ END_LEGAL */
 #include "xed-disas-hex.h"
 #include "xed-disas-pecoff.h"
 #include "xed-disas-filter.h"
+#include "xed-disas-index.h"
 #include "xed-symbol-table.h"
 #include "xed-nm-symtab.h"
 
@@ -276,11 +277,30 @@ static void usage(char* prog) {
       "\t-nwm          (Format AVX512 without curly braces for writemasks, include k0)",
       "\t-emit         (Output __emit statements for the Intel compiler)",
       "\t-S file       Read symbol table in \"nm\" format from file",
+      "\t              (with -F, -ir or -ih)",
 #if defined(XED_DWARF) 
       "\t-line         (Emit line number information, if present)",
 #endif
       "\t-dot FN       (Emit a register dependence graph file in dot format.",
       "\t               Best used with -as ADDR -ae ADDR to limit graph size.)",
+      "\t-cfg          (Print the control flow graph of -i, -ir or -ih input",
+      "\t               instead of a linear disassembly. Traversal starts",
+      "\t               at the ELF symbols or at the start of the input.)",
+      "\t-cfg-entry addr (Add a function entry point for -cfg. Repeatable.)",
+      "\t-cfg-threads N (Worker threads for -cfg and -index, and for",
+      "\t               sorting ELF symbols. Default: one per cpu)",
+      "\t-cfg-dot FN   (Implies -cfg. Also emit the graph in dot format)",
+      "\t-index FN     (Write an instruction-boundary index of the -i, -ir",
+      "\t               or -ih input to FN instead of disassembling it.",
+      "\t               Without input, read the index from FN for",
+      "\t               -index-query.)",
+      "\t-index-recursive (Index the instructions reached by the -cfg",
+      "\t               traversal instead of a linear decode)",
+      "\t-index-query addr (Print the instruction containing addr and the",
+      "\t               ones before and after it. Repeatable.)",
+      "\t-decode-cache DIR (Keep the linear decode of each -index section",
+      "\t               in DIR, keyed by a hash of its bytes and mode,",
+      "\t               and reuse it instead of decoding on later runs)",
       "",
       "\t-r            (for REAL_16 mode, 16b addressing (20b addresses),",
       "\t               16b default data size)",
@@ -419,11 +439,22 @@ main(int argc, char** argv)
 
     char* dot_output_file_name = 0;
     xed_bool_t dot = 0;
+    xed_bool_t cfg = 0;
+    char* cfg_dot_output_file_name = 0;
+    unsigned int cfg_threads = 0;
+    xed_uint64_t cfg_entries[XED_MAX_CFG_ENTRIES];
+    unsigned int cfg_nentries = 0;
+    char* index_file_name = 0;
+    xed_bool_t index_recursive = 0;
+    xed_uint64_t index_queries[XED_MAX_INDEX_QUERIES];
+    unsigned int index_nqueries = 0;
+    char* decode_cache_dir = 0;
     xed_decoded_inst_t xedd;
     xed_uint_t retval_okay = 1;
     unsigned int obytes=0;
 #if defined(XED_DECODER)
     xed_disas_info_t decode_info;
+    xed_inst_index_set_t index_set;
 #endif
 #if defined(XED_LINUX)
     char *nm_symtab_fn = NULL;
@@ -433,6 +464,7 @@ main(int argc, char** argv)
      * the XED formatting options, then you do not need to set this or call
      * xed_format_set_options() */
 
+    xed_syntax_enum_t syntax = XED_SYNTAX_INTEL;
     xed_format_options_t format_options;
     memset(&format_options,0,sizeof(xed_format_options_t));
 #if defined(XED_NO_HEX_BEFORE_SYMBOLIC_NAMES)
@@ -530,6 +562,50 @@ main(int argc, char** argv)
             dot = 1;
             i++;
         }
+        else if (strcmp(argv[i],"-cfg")==0)      {
+            cfg = 1;
+        }
+        else if (strcmp(argv[i],"-cfg-dot")==0)      {
+            test_argc(i,argc);
+            cfg_dot_output_file_name = argv[i+1];
+            cfg = 1;
+            i++;
+        }
+        else if (strcmp(argv[i],"-cfg-entry")==0)      {
+            test_argc(i,argc);
+            if (cfg_nentries >= XED_MAX_CFG_ENTRIES)
+                xedex_derror("Too many -cfg-entry arguments");
+            cfg_entries[cfg_nentries++] = XED_STATIC_CAST(xed_uint64_t,
+                                       xed_atoi_general(argv[i+1],1000));
+            i++;
+        }
+        else if (strcmp(argv[i],"-cfg-threads")==0)      {
+            test_argc(i,argc);
+            cfg_threads = XED_STATIC_CAST(unsigned int,
+                                          xed_atoi_general(argv[i+1],1000));
+            i++;
+        }
+        else if (strcmp(argv[i],"-index")==0)      {
+            test_argc(i,argc);
+            index_file_name = argv[i+1];
+            i++;
+        }
+        else if (strcmp(argv[i],"-index-recursive")==0)      {
+            index_recursive = 1;
+        }
+        else if (strcmp(argv[i],"-index-query")==0)      {
+            test_argc(i,argc);
+            if (index_nqueries >= XED_MAX_INDEX_QUERIES)
+                xedex_derror("Too many -index-query arguments");
+            index_queries[index_nqueries++] = XED_STATIC_CAST(xed_uint64_t,
+                                       xed_atoi_general(argv[i+1],1000));
+            i++;
+        }
+        else if (strcmp(argv[i],"-decode-cache")==0)      {
+            test_argc(i,argc);
+            decode_cache_dir = argv[i+1];
+            i++;
+        }
         else if (strcmp(argv[i],"-ir")==0)        {
             test_argc(i,argc);
             input_file_name = argv[i+1];
@@ -646,13 +722,13 @@ main(int argc, char** argv)
             exit(0);
         }
         else if (strcmp(argv[i],"-A")==0)        {
-            global_syntax = XED_SYNTAX_ATT;
+            syntax = XED_SYNTAX_ATT;
         }
         else if (strcmp(argv[i],"-I")==0)        {
-            global_syntax = XED_SYNTAX_INTEL;
+            syntax = XED_SYNTAX_INTEL;
         }
         else if (strcmp(argv[i],"-X")==0)        { // undocumented
-            global_syntax = XED_SYNTAX_XED;
+            syntax = XED_SYNTAX_XED;
         }
         else if (strcmp(argv[i],"-isa-set")==0)   {
             emit_isa_set = 1;
@@ -738,7 +814,8 @@ main(int argc, char** argv)
     if (!encode)     {
         if (input_file_name == 0 &&
             (decode_text == 0 ||
-             strlen(decode_text) == 0) && !filter)
+             strlen(decode_text) == 0) && !filter &&
+            (index_file_name == 0 || index_nqueries == 0))
         {
             printf("ERROR: required argument(s) were missing\n");
             usage(argv[0]);
@@ -748,8 +825,8 @@ main(int argc, char** argv)
 
 #if defined(XED_LINUX)
     if ((nm_symtab_fn != 0) && (nm_symtab_fn[0] != 0)) {
-        if (!filter) {
-            printf("ERROR: -S only support with -F for now\n");
+        if (!filter && !decode_raw && !decode_hex) {
+            printf("ERROR: -S only supported with -F, -ir or -ih\n");
             exit(1);
         }
         xed_read_nm_symtab(nm_symtab_fn);
@@ -802,11 +879,22 @@ main(int argc, char** argv)
     decode_info.mpx_mode         = mpx_mode;
     decode_info.cet_mode         = cet_mode;
     decode_info.emit_isa_set     = emit_isa_set;
+    decode_info.syntax           = syntax;
     decode_info.format_options   = format_options;
     decode_info.encode_force     = encode_force;
     decode_info.dot_graph_output = 0;
+    decode_info.cfg              = cfg;
+    decode_info.cfg_threads      = cfg_threads;
+    decode_info.cfg_nentries     = cfg_nentries;
+    memcpy(decode_info.cfg_entries, cfg_entries,
+           cfg_nentries * sizeof(xed_uint64_t));
+    decode_info.index_recursive  = index_recursive;
+    decode_info.index_nqueries   = index_nqueries;
+    memcpy(decode_info.index_queries, index_queries,
+           index_nqueries * sizeof(xed_uint64_t));
     memcpy(decode_info.operands, operands, sizeof(decode_info.operands));
     memcpy(decode_info.operands_value, operands_value, sizeof(decode_info.operands_value));
+    xed_disas_info_set_formatter(&decode_info, 0);
     
     if (dot)
     {
@@ -816,8 +904,41 @@ main(int argc, char** argv)
             xedex_derror("Dying");
         }
     }
+    if (cfg_dot_output_file_name)
+    {
+        decode_info.cfg_dot_output = fopen_portable(cfg_dot_output_file_name,
+                                                    "w");
+        if (!decode_info.cfg_dot_output) {
+            printf("Could not open %s\n", cfg_dot_output_file_name);
+            xedex_derror("Dying");
+        }
+    }
+    if (index_file_name)
+    {
+        decode_info.index_file = fopen_portable(index_file_name,
+                                                input_file_name ? "wb" : "rb");
+        if (!decode_info.index_file) {
+            printf("Could not open %s\n", index_file_name);
+            xedex_derror("Dying");
+        }
+    }
+    if (input_file_name && (index_file_name || index_nqueries))
+    {
+        decode_info.index_set = &index_set;
+        xed_inst_index_set_init(&index_set);
+        index_set.cache_dir = decode_cache_dir;
+    }
     
     init_xedd(&xedd, &decode_info);
+#if defined(XED_LINUX)
+    if (nm_symtab_init) {
+        // raw and hex images have no symbols of their own
+        decode_info.symfn = get_symbol;
+        decode_info.caller_symbol_data = &nm_symtab;
+        xed_disas_info_set_formatter(&decode_info,
+                                     xed_disassembly_callback_function);
+    }
+#endif
     
 #endif
 
@@ -902,7 +1023,10 @@ main(int argc, char** argv)
             printf("<XEDDISASM>\n");
             printf("<XEDFORMAT>1</XEDFORMAT>\n");
         }
-        if (decode_raw) {
+        if (decode_info.index_file && !input_file_name) {
+            xed_disas_index_query_file(&decode_info);
+        }
+        else if (decode_raw) {
             xed_disas_raw(&decode_info);
         }
         else if (decode_hex) {
@@ -924,6 +1048,10 @@ main(int argc, char** argv)
                 printf("# Total Chip Check Errors: " XED_FMT_LU "\n",
                        decode_info.errors_chip_check);
         }
+        if (decode_info.index_set) {
+            xed_disas_index_finish(&decode_info);
+            xed_inst_index_set_free(decode_info.index_set);
+        }
 #endif // XED_DECODER
     }
     
@@ -935,6 +1063,10 @@ main(int argc, char** argv)
         exit(1);
     if (decode_info.dot_graph_output)
         fclose(decode_info.dot_graph_output);
+    if (decode_info.cfg_dot_output)
+        fclose(decode_info.cfg_dot_output);
+    if (decode_info.index_file)
+        fclose(decode_info.index_file);
     if (decode_text)
         free((void*)decode_text);
 #if defined(XED_ENCODER)
@@ -965,6 +1097,16 @@ main(int argc, char** argv)
     (void) line_numbers;
     (void) dot_output_file_name;
     (void) dot;
+    (void) cfg;
+    (void) cfg_dot_output_file_name;
+    (void) cfg_threads;
+    (void) cfg_entries;
+    (void) cfg_nentries;
+    (void) index_file_name;
+    (void) index_recursive;
+    (void) index_queries;
+    (void) index_nqueries;
+    (void) decode_cache_dir;
     (void) use_binary_mode;
     (void) emit_isa_set;
 #endif
@@ -278,6 +278,9 @@ def _add_libxed_rpath(env):
 
 
 def build_asmparse(env, dag, otherobj):
+    if not env.on_windows() and '-lpthread' not in env['LIBS']:
+        env = copy.deepcopy(env)
+        env['LIBS'] += ' -lpthread' # for the -j knob
     srcs = env.src_dir_join(['xed-asmparse.c'])
     objs = env.compile(dag, srcs)
 
@@ -325,7 +328,8 @@ def build_examples(env, work_queue):
     if env['decoder']:
         cc_shared_files.extend(env.src_dir_join([ 
           'xed-dot.c',
-          'xed-dot-prep.c']))
+          'xed-dot-prep.c',
+          'xed-decode-cache.c']))
         
     if env['encoder']:
        cc_shared_files += env.src_dir_join([ 'xed-enc-lang.c'])
@@ -345,6 +349,10 @@ def build_examples(env, work_queue):
         
     extra_libs = []    
     if env['decoder']:
+        # control flow graph builder for -cfg
+        xed_cmdline_files.extend(['xed-cfg.c', 'xed-disas-cfg.c'])
+        # instruction-boundary index for -index
+        xed_cmdline_files.extend(['xed-inst-index.c', 'xed-disas-index.c'])
 
         if env.on_linux() or env.on_freebsd() or env.on_netbsd():
             xed_cmdline_files.append('xed-disas-filter.c')
@@ -373,6 +381,8 @@ def build_examples(env, work_queue):
         
     if env.on_linux():
         xbc.cond_add_elf_dwarf(cenv)
+    if env['decoder'] and not env.on_windows():
+        cenv['LIBS'] += ' -lpthread'
         
     if env.on_linux() or env.on_freebsd() or env.on_netbsd():
         src_elf = env.src_dir_join('xed-disas-elf.c')
@@ -396,32 +406,51 @@ def build_examples(env, work_queue):
     if env['encoder']:
         exe = build_asmparse(cenv, examples_dag, cc_shared_objs)
         example_exes.append(exe)
+
+    if env['decoder'] and (env.on_linux() or env.on_freebsd() or
+                           env.on_netbsd()):
+        # ELF ISA census, uses pthreads from cenv
+        example_exes.append(ex_compile_and_link(cenv, examples_dag,
+                                  env.src_dir_join('xed-isa-census.c'),
+                                  cc_shared_objs + [link_libxed]))
         
 
     ild_examples = []
     other_c_examples = []
     enc2_examples = []
+    enc2_cpp_examples = []
     small_examples = ['xed-size.c']
     if env['enc2']:
         enc2_examples += [ 'xed-enc2-1.c',
                            'xed-enc2-2.c',
                            'xed-enc2-3.c' ]
+        if env['build_cpp_examples']:
+            enc2_cpp_examples += [ 'xed-enc2-cpp.cpp' ]
     if env['encoder']:
        small_examples += ['xed-ex5-enc.c']
        other_c_examples += ['xed-ex3.c']
     if env['decoder'] and env['encoder']:
        other_c_examples += ['xed-ex6.c',
-                            'xed-ex9-patch.c' ]
+                            'xed-ex9-patch.c',
+                            'xed-fill-nops.c',
+                            'xed-jcc-align.c' ]
     if env['decoder']:
        ild_examples += [ 'xed-ex-ild.c' ]
        other_c_examples += ['xed-ex1.c',
                             'xed-ex-ild2.c',
                             'xed-min.c',
+                            'xed-startup.c',
                             'xed-reps.c',
                             'xed-ex4.c',
                             'xed-tester.c',
                             'xed-dec-print.c',           
                             'xed-ex-agen.c',
+                            'xed-ex-agen-soa.c',
+                            'xed-ex-reg-rw.c',
+                            'xed-ex-dep.c',
+                            'xed-tput.c',
+                            'xed-incr-disas.c',
+                            'xed-ex-decode-cache.c',
                             'xed-ex7.c',
                             'xed-ex8.c',
                             'xed-ex-cpuid.c',
@@ -456,6 +485,19 @@ def build_examples(env, work_queue):
                                                   example,
                                                   env['xed_enc2_libs'] + [link_libxed]  ))
 
+    # the typed enc2 wrappers need C++17
+    if enc2_cpp_examples:
+        env_cxx17 = copy.deepcopy(env)
+        if env_cxx17['compiler'] in ['gnu','clang','icc']:
+            env_cxx17.add_to_var('CXXFLAGS', '-std=c++17')
+        elif env_cxx17['compiler'] == 'ms':
+            env_cxx17.add_to_var('CXXFLAGS', '/std:c++17')
+        for example in env.src_dir_join(enc2_cpp_examples):
+            example_exes.append(ex_compile_and_link(env_cxx17,
+                                                    examples_dag,
+                                                    example,
+                                                    env['xed_enc2_libs'] + [link_libxed]))
+
     mbuild.vmsgb(4, "ALL EXAMPLES", "\n\t".join(example_exes))
 
     examples_to_build   = example_exes
@@ -21,6 +21,81 @@ END_LEGAL */
 #if !defined(XED_DECODE_PORTABILITY_PRIVATE_H)
 # define XED_DECODE_PORTABILITY_PRIVATE_H
 
+#include "xed-types.h"
+#include "xed-portability.h"
+#if defined(_MSC_VER)
+# include <intrin.h>
+#endif
+
+/* A once-flag for one-time initialization that may race between
+   threads. States: 0=not started, 1=running, 2=done. The first caller
+   of xed_once_begin() that sees 0 gets 1 back, runs the initialization
+   and calls xed_once_end(). Everybody else spins until the flag reads
+   2 and gets 0 back. After initialization the fast path is a single
+   acquire load. */
+typedef volatile long xed_once_t;
+
+#define XED_ONCE_DONE 2
+
+#if defined(__GNUC__)
+static XED_INLINE long xed_once_load(xed_once_t* once) {
+    return __atomic_load_n(once, __ATOMIC_ACQUIRE);
+}
+static XED_INLINE xed_bool_t xed_once_claim(xed_once_t* once) {
+    long expected = 0;
+    return __atomic_compare_exchange_n(once, &expected, 1, 0,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+static XED_INLINE void xed_once_end(xed_once_t* once) {
+    __atomic_store_n(once, XED_ONCE_DONE, __ATOMIC_RELEASE);
+}
+# if defined(__i386__) || defined(__x86_64__)
+#  define XED_ONCE_PAUSE() __builtin_ia32_pause()
+# endif
+#elif defined(_MSC_VER)
+static XED_INLINE long xed_once_load(xed_once_t* once) {
+    long v = *once;
+    _ReadWriteBarrier();
+    return v;
+}
+static XED_INLINE xed_bool_t xed_once_claim(xed_once_t* once) {
+    return _InterlockedCompareExchange(once, 1, 0) == 0;
+}
+static XED_INLINE void xed_once_end(xed_once_t* once) {
+    _InterlockedExchange(once, XED_ONCE_DONE);
+}
+# if defined(_M_IX86) || defined(_M_X64)
+#  define XED_ONCE_PAUSE() _mm_pause()
+# endif
+#else
+/* no atomics known for this compiler: single threaded init only */
+static XED_INLINE long xed_once_load(xed_once_t* once) {
+    return *once;
+}
+static XED_INLINE xed_bool_t xed_once_claim(xed_once_t* once) {
+    if (*once)
+        return 0;
+    *once = 1;
+    return 1;
+}
+static XED_INLINE void xed_once_end(xed_once_t* once) {
+    *once = XED_ONCE_DONE;
+}
+#endif
+#if !defined(XED_ONCE_PAUSE)
+# define XED_ONCE_PAUSE()
+#endif
 
+/* Returns 1 if the caller must run the initialization and then call
+   xed_once_end(). Returns 0 once the initialization is complete. */
+static XED_INLINE xed_bool_t xed_once_begin(xed_once_t* once) {
+    if (xed_once_load(once) == XED_ONCE_DONE)
+        return 0;
+    if (xed_once_claim(once))
+        return 1;
+    while (xed_once_load(once) != XED_ONCE_DONE)
+        XED_ONCE_PAUSE();
+    return 0;
+}
 
 #endif
@@ -62,5 +62,145 @@ XED_DLL_EXPORT xed_error_enum_t xed_agen(xed_decoded_inst_t* xedd,
                                          void* context,
                                          xed_uint64_t* out_address);
 
+/// A per-call table of agen callbacks. Use with #xed_agen_ctx when
+/// different threads need different callbacks.
+/// @ingroup AGEN
+typedef struct {
+    xed_register_callback_fn_t     register_fn;
+    xed_segment_base_callback_fn_t segment_fn;
+} xed_agen_callbacks_t;
+
+/// Like #xed_agen but uses the given callback table instead of the
+/// globally registered callbacks. Reentrant; no global state is used.
+/// @ingroup AGEN
+XED_DLL_EXPORT xed_error_enum_t
+xed_agen_ctx(const xed_decoded_inst_t* xedd,
+             unsigned int memop_index,
+             const xed_agen_callbacks_t* callbacks,
+             void* context,
+             xed_uint64_t* out_address);
+
+/// A snapshot of the register values needed for address generation.  The
+/// gpr array is indexed by (#xed_get_largest_enclosing_register(r) -
+/// XED_REG_GPR64_FIRST): RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8-R31.
+/// The seg_base array is indexed by (r - XED_REG_SR_FIRST): ES, CS, SS,
+/// DS, FS, GS. It holds segment bases in all modes; for real mode store
+/// the selector shifted left by 4. rip is the address of the instruction.
+/// @ingroup AGEN
+typedef struct {
+    xed_uint64_t gpr[XED_REG_GPR64_LAST - XED_REG_GPR64_FIRST + 1];
+    xed_uint64_t seg_base[XED_REG_SR_LAST - XED_REG_SR_FIRST + 1];
+    xed_uint64_t rip;
+} xed_agen_snapshot_t;
+
+/// Compute the memory address for a specified memop using register
+/// values from a snapshot rather than callbacks. memop_index is as for
+/// #xed_agen. Sub-registers are read from their enclosing 64b GPR and
+/// zero extended. Returns #XED_ERROR_CALLBACK_PROBLEM if the instruction
+/// uses a register the snapshot does not hold, such as the vector index
+/// of a gather or scatter. Reentrant; no global state is used.
+/// @ingroup AGEN
+XED_DLL_EXPORT xed_error_enum_t
+xed_agen_snapshot(const xed_decoded_inst_t* xedd,
+                  unsigned int memop_index,
+                  const xed_agen_snapshot_t* snapshot,
+                  xed_uint64_t* out_address);
+
+/// Compute the addresses of all the memops of ninst contiguous decoded
+/// instructions against one snapshot. snapshot->rip is the address of
+/// the first instruction; each later instruction's RIP is found by adding
+/// the lengths of the earlier instructions. The out_addresses array must
+/// have 2*ninst entries: entries 2*i and 2*i+1 get the addresses of memops
+/// 0 and 1 of instruction i. Entries for absent memops are set to 0.
+/// Returns the first error encountered, after processing every
+/// instruction; the entry for a failed memop is left as 0.
+/// @ingroup AGEN
+XED_DLL_EXPORT xed_error_enum_t
+xed_agen_snapshot_block(const xed_decoded_inst_t* xedd,
+                        xed_uint32_t ninst,
+                        const xed_agen_snapshot_t* snapshot,
+                        xed_uint64_t* out_addresses);
+
+/// A structure-of-arrays table of register states for
+/// #xed_agen_desc_eval. Each member points to a column holding one value
+/// per state; columns the descriptor does not use may be zero. A zero
+/// seg_base column means all bases are zero (flat 64b code). Indexing and
+/// real mode segment bases are as for #xed_agen_snapshot_t. The rip column
+/// holds the address of the instruction in each state.
+/// @ingroup AGEN
+typedef struct {
+    const xed_uint64_t* gpr[XED_REG_GPR64_LAST - XED_REG_GPR64_FIRST + 1];
+    const xed_uint64_t* seg_base[XED_REG_SR_LAST - XED_REG_SR_FIRST + 1];
+    const xed_uint64_t* rip;
+} xed_agen_soa_t;
+
+/// A memory operand compiled by #xed_agen_desc_init for repeated
+/// evaluation. The displacement, instruction length (for RIP-relative
+/// addressing) and stack push adjustment are folded into disp. The
+/// register fields are column numbers in #xed_agen_soa_t or -1 if
+/// unused. Treat as opaque.
+/// @ingroup AGEN
+typedef struct {
+    xed_uint64_t disp;
+    xed_uint64_t base_mask;
+    xed_uint64_t index_mask;
+    xed_uint64_t addr_mask;
+    xed_int8_t   base;
+    xed_int8_t   index;
+    xed_int8_t   seg;
+    xed_uint8_t  scale_shift;
+    xed_bool_t   rip_relative;
+} xed_agen_desc_t;
+
+/// Compile memop memop_index (as for #xed_agen) of a decoded instruction
+/// into an addressing descriptor. Returns #XED_ERROR_CALLBACK_PROBLEM if
+/// the operand uses a register a #xed_agen_soa_t cannot hold, such as
+/// the vector index of a gather or scatter.
+/// @ingroup AGEN
+XED_DLL_EXPORT xed_error_enum_t
+xed_agen_desc_init(const xed_decoded_inst_t* xedd,
+                   unsigned int memop_index,
+                   xed_agen_desc_t* desc);
+
+/// Evaluate an addressing descriptor against n register states, writing
+/// n addresses to out_addresses. Results match #xed_agen_snapshot for
+/// each state. With 16b addressing that includes its wrap: the sum of
+/// the segment base and the offset is truncated to 16 bits, as
+/// #xed_agen does, so the high bits of a real mode segment base are
+/// dropped. Uses AVX-512 or AVX2 kernels when the build compiler
+/// supports them and the running CPU has them, and portable C otherwise.
+/// Returns #XED_ERROR_CALLBACK_PROBLEM if a needed column is missing.
+/// @ingroup AGEN
+XED_DLL_EXPORT xed_error_enum_t
+xed_agen_desc_eval(const xed_agen_desc_t* desc,
+                   const xed_agen_soa_t* states,
+                   xed_uint32_t n,
+                   xed_uint64_t* out_addresses);
+
+/// The kernels of #xed_agen_desc_eval_kernel
+/// @ingroup AGEN
+typedef enum {
+    XED_AGEN_KERNEL_AUTO,   ///< the best available, as #xed_agen_desc_eval
+    XED_AGEN_KERNEL_C,      ///< portable C, always available
+    XED_AGEN_KERNEL_AVX2,
+    XED_AGEN_KERNEL_AVX512,
+    XED_AGEN_KERNEL_LAST
+} xed_agen_kernel_enum_t;
+
+/// Returns 1 if the kernel was built and the running CPU supports it
+/// @ingroup AGEN
+XED_DLL_EXPORT xed_bool_t
+xed_agen_kernel_available(xed_agen_kernel_enum_t kernel);
+
+/// #xed_agen_desc_eval with the given kernel, for testing and
+/// measuring the kernels against each other. Returns
+/// #XED_ERROR_GENERAL_ERROR if the kernel is not available.
+/// @ingroup AGEN
+XED_DLL_EXPORT xed_error_enum_t
+xed_agen_desc_eval_kernel(const xed_agen_desc_t* desc,
+                          const xed_agen_soa_t* states,
+                          xed_uint32_t n,
+                          xed_uint64_t* out_addresses,
+                          xed_agen_kernel_enum_t kernel);
 
 #endif
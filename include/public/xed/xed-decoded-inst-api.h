@@ -26,6 +26,7 @@ END_LEGAL */
 #include "xed-state.h"
 #include "xed-operand-values-interface.h"
 #include "xed-print-info.h"
+#include "xed-isa-set.h"
 
 ///////////////////////////////////////////////////////
 /// API
@@ -70,6 +71,12 @@ xed_decoded_inst_get_isa_set(xed_decoded_inst_t const* const p) {
     return xed_inst_isa_set(p->_inst);
 }
 /// @ingroup DEC
+/// Return the set of chips that support the ISA set of the instruction.
+static XED_INLINE const xed_chip_mask_t*
+xed_decoded_inst_chip_mask(xed_decoded_inst_t const* const p) {
+    return xed_isa_set_chip_mask(xed_decoded_inst_get_isa_set(p));
+}
+/// @ingroup DEC
 /// Return the instruction #xed_iclass_enum_t enumeration.
 static XED_INLINE xed_iclass_enum_t
 xed_decoded_inst_get_iclass( const xed_decoded_inst_t* p){
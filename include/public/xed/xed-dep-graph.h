@@ -0,0 +1,141 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-dep-graph.h
+/// 
+
+#ifndef XED_DEP_GRAPH_H
+# define  XED_DEP_GRAPH_H
+
+#include "xed-types.h"
+#include "xed-portability.h"
+#include "xed-decoded-inst.h"
+#include "xed-reg-rw.h"
+
+/// @name Dependence kinds
+/// Bits of #xed_dep_edge_t::kinds
+//@{
+/// @ingroup DEPGRAPH
+#define XED_DEP_RAW_REG   0x001
+/// @ingroup DEPGRAPH
+#define XED_DEP_WAR_REG   0x002
+/// @ingroup DEPGRAPH
+#define XED_DEP_WAW_REG   0x004
+/// @ingroup DEPGRAPH
+#define XED_DEP_RAW_FLAGS 0x008
+/// @ingroup DEPGRAPH
+#define XED_DEP_WAR_FLAGS 0x010
+/// @ingroup DEPGRAPH
+#define XED_DEP_WAW_FLAGS 0x020
+/// @ingroup DEPGRAPH
+#define XED_DEP_RAW_MEM   0x040
+/// @ingroup DEPGRAPH
+#define XED_DEP_WAR_MEM   0x080
+/// @ingroup DEPGRAPH
+#define XED_DEP_WAW_MEM   0x100
+
+/// @ingroup DEPGRAPH
+/// All true (read after write) dependences
+#define XED_DEP_RAW (XED_DEP_RAW_REG|XED_DEP_RAW_FLAGS|XED_DEP_RAW_MEM)
+/// @ingroup DEPGRAPH
+#define XED_DEP_WAR (XED_DEP_WAR_REG|XED_DEP_WAR_FLAGS|XED_DEP_WAR_MEM)
+/// @ingroup DEPGRAPH
+#define XED_DEP_WAW (XED_DEP_WAW_REG|XED_DEP_WAW_FLAGS|XED_DEP_WAW_MEM)
+//@}
+
+/// @name Memory access bits
+/// Bits of #xed_dep_summary_t::mem
+//@{
+/// @ingroup DEPGRAPH
+#define XED_DEP_MEM_READ  1
+/// @ingroup DEPGRAPH
+#define XED_DEP_MEM_WRITE 2
+//@}
+
+/// @ingroup DEPGRAPH
+/// What one instruction uses and defines, as seen by
+/// #xed_dep_graph_build(). Conditional writes appear in both sets
+/// because the old value of the register survives them.
+typedef struct {
+    /// registers read or conditionally written
+    xed_reg_set_t use;
+    /// registers written or conditionally written
+    xed_reg_set_t def;
+    /// XED_DEP_MEM_READ and/or XED_DEP_MEM_WRITE
+    xed_uint8_t mem;
+} xed_dep_summary_t;
+
+/// @ingroup DEPGRAPH
+/// An edge from an earlier instruction to the instruction whose edge
+/// list contains it.
+typedef struct {
+    /// index of the earlier instruction
+    xed_uint32_t src;
+    /// XED_DEP_* bits, one edge carries every dependence between a pair
+    xed_uint32_t kinds;
+} xed_dep_edge_t;
+
+/// @ingroup DEPGRAPH
+/// A dependence graph in compressed sparse row form. The caller provides
+/// the storage. The incoming edges of instruction i are
+/// edges[first[i]] through edges[first[i+1]-1], in increasing order of
+/// source.
+typedef struct {
+    /// ninst+1 entries
+    xed_uint32_t* first;
+    /// max_edges entries. A block of n instructions needs at most
+    /// n*(n-1)/2.
+    xed_dep_edge_t* edges;
+    xed_uint32_t max_edges;
+    /// output: the number of edges used
+    xed_uint32_t nedges;
+} xed_dep_graph_t;
+
+/// @name Dependence graphs
+//@{
+/// @ingroup DEPGRAPH
+/// Computes the dependence summary of one decoded instruction from
+/// #xed_decoded_inst_get_reg_rw() and its memory operands.
+/// @param xedd the decoded instruction
+/// @param s the output summary
+XED_DLL_EXPORT void
+xed_decoded_inst_get_dep_summary(const xed_decoded_inst_t* xedd,
+                                 xed_dep_summary_t* s);
+
+/// @ingroup DEPGRAPH
+/// Builds the dependence graph of a straight-line sequence of
+/// instructions in one pass. Each instruction gets edges from:
+///   - the nearest earlier writer of each register, the flags and
+///     memory that it reads (RAW),
+///   - every reader of what it writes since that was last written (WAR),
+///   - the nearest earlier writer of what it writes (WAW).
+///
+/// Registers are compared as full registers, so AL and RAX or XMM1 and
+/// ZMM1 depend on each other. Memory is a single location; there is no
+/// address disambiguation.
+///
+/// @param s the summaries of the instructions, in program order
+/// @param ninst the number of instructions
+/// @param g the graph storage; g->first and g->edges are filled in
+/// @return 1 on success, 0 if more than g->max_edges edges were needed
+XED_DLL_EXPORT xed_bool_t
+xed_dep_graph_build(const xed_dep_summary_t* s,
+                    xed_uint32_t ninst,
+                    xed_dep_graph_t* g);
+//@}
+
+#endif
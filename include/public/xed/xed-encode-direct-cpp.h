@@ -0,0 +1,262 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-encode-direct-cpp.h
+/// Typed operands for the C++ ENC2 wrappers.
+///
+/// The generated xed-cpp-enc2-mXX-aYY.h headers declare one inline
+/// function per ENC2 encoder function. Their register arguments are of
+/// the types defined here instead of #xed_reg_enum_t, so passing an
+/// operand of the wrong register class does not compile. The register
+/// value is validated once, when the operand object is constructed,
+/// rather than on every call as the checked (xed-chk-enc2) interface
+/// does. Operand constants declared \c constexpr are validated by the
+/// compiler:
+///
+/// @code
+///   namespace enc = xed::enc2::m64_a64;
+///   constexpr enc::gpr64_t rbx(XED_REG_RBX);
+///   constexpr enc::gpr64_t bad(XED_REG_XMM0);  // does not compile
+///   enc::add_lock_m8_r8_b_a64(&request, rbx, enc::gpr8_t(XED_REG_AH));
+/// @endcode
+///
+/// Operands built at run time from values that are not in their class
+/// are reported through xed_enc2_error().
+
+#if !defined(XED_ENCODE_DIRECT_CPP_H)
+# define XED_ENCODE_DIRECT_CPP_H
+
+#if !defined(__cplusplus) || __cplusplus < 201703L
+# error "xed-encode-direct-cpp.h requires C++17"
+#endif
+
+extern "C" {
+#include "xed-interface.h"
+}
+#include <type_traits>
+
+namespace xed::enc2 {
+
+/// Called when an operand is constructed from a value that is not in
+/// its class. This function is not constexpr so reaching it while
+/// evaluating a constant expression is a compile error.
+/// @ingroup ENC2
+inline void invalid_operand(const char* kind, xed_reg_enum_t reg) {
+    xed_enc2_error("Bad %s reg %s", kind, xed_reg_enum_t2str(reg));
+}
+
+/// @name Register classes
+/// These mirror the checks made by the xed-chk-enc2 libraries.
+//@{
+struct cr_class {
+    static constexpr const char* name = "cr";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned mode) {
+        return r == XED_REG_CR0 || r == XED_REG_CR2 || r == XED_REG_CR3 ||
+               r == XED_REG_CR4 || (r == XED_REG_CR8 && mode == 64);
+    }
+};
+struct dr_class {
+    static constexpr const char* name = "dr";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned) {
+        return r >= XED_REG_DR0 && r <= XED_REG_DR7;
+    }
+};
+struct seg_class {
+    static constexpr const char* name = "seg";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned) {
+        return r >= XED_REG_ES && r <= XED_REG_GS;
+    }
+};
+struct gpr8_class {
+    static constexpr const char* name = "gpr8";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned mode) {
+        if ((r < XED_REG_GPR8_FIRST || r > XED_REG_GPR8_LAST) &&
+            (r < XED_REG_GPR8h_FIRST || r > XED_REG_GPR8h_LAST))
+            return false;
+        return mode == 64 ||
+               (r < XED_REG_R8B && (r < XED_REG_SPL || r > XED_REG_DIL));
+    }
+};
+struct gpr16_class {
+    static constexpr const char* name = "gpr16";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned mode) {
+        return r >= XED_REG_GPR16_FIRST && r <= XED_REG_GPR16_LAST &&
+               (mode == 64 || r < XED_REG_R8W);
+    }
+};
+struct gpr32_class {
+    static constexpr const char* name = "gpr32";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned mode) {
+        return r >= XED_REG_GPR32_FIRST && r <= XED_REG_GPR32_LAST &&
+               (mode == 64 || r < XED_REG_R8D);
+    }
+};
+struct gpr64_class {
+    static constexpr const char* name = "gpr64";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned) {
+        return r >= XED_REG_GPR64_FIRST && r <= XED_REG_GPR64_LAST;
+    }
+};
+struct gpr16_index_class {
+    static constexpr const char* name = "gpr16 index";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned) {
+        return r == XED_REG_SI || r == XED_REG_DI;
+    }
+};
+struct gpr32_index_class {
+    static constexpr const char* name = "gpr32 index";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned mode) {
+        return gpr32_class::valid(r, mode) && r != XED_REG_ESP;
+    }
+};
+struct gpr64_index_class {
+    static constexpr const char* name = "gpr64 index";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned mode) {
+        return gpr64_class::valid(r, mode) && r != XED_REG_RSP;
+    }
+};
+struct kreg_class {
+    static constexpr const char* name = "mask";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned) {
+        return r >= XED_REG_K0 && r <= XED_REG_K7;
+    }
+};
+struct kreg_not0_class {
+    static constexpr const char* name = "(!k0) mask";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned) {
+        return r >= XED_REG_K1 && r <= XED_REG_K7;
+    }
+};
+struct mmx_class {
+    static constexpr const char* name = "mmx";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned) {
+        return r >= XED_REG_MMX_FIRST && r <= XED_REG_MMX_LAST;
+    }
+};
+struct x87_class {
+    static constexpr const char* name = "x87";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned) {
+        return r >= XED_REG_X87_FIRST && r <= XED_REG_X87_LAST;
+    }
+};
+struct xmm_class {
+    static constexpr const char* name = "xmm";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned mode) {
+        return r >= XED_REG_XMM_FIRST && r <= XED_REG_XMM_LAST &&
+               (mode == 64 || r < XED_REG_XMM8);
+    }
+};
+/// The VEX-encodable xmm registers, xmm0-xmm15.
+struct xmm_avx_class {
+    static constexpr const char* name = "xmm";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned mode) {
+        return xmm_class::valid(r, mode) && r <= XED_REG_XMM15;
+    }
+};
+struct ymm_class {
+    static constexpr const char* name = "ymm";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned mode) {
+        return r >= XED_REG_YMM_FIRST && r <= XED_REG_YMM_LAST &&
+               (mode == 64 || r < XED_REG_YMM8);
+    }
+};
+/// The VEX-encodable ymm registers, ymm0-ymm15.
+struct ymm_avx_class {
+    static constexpr const char* name = "ymm";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned mode) {
+        return ymm_class::valid(r, mode) && r <= XED_REG_YMM15;
+    }
+};
+struct zmm_class {
+    static constexpr const char* name = "zmm";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned mode) {
+        return r >= XED_REG_ZMM_FIRST && r <= XED_REG_ZMM_LAST &&
+               (mode == 64 || r < XED_REG_ZMM8);
+    }
+};
+#if defined(XED_REG_TREG_FIRST_DEFINED)
+struct tmm_class {
+    static constexpr const char* name = "TMM";
+    static constexpr bool valid(xed_reg_enum_t r, unsigned mode) {
+        return r >= XED_REG_TREG_FIRST && r <= XED_REG_TREG_LAST &&
+               mode == 64;
+    }
+};
+#endif
+//@}
+
+/// True when every register of class \a From is also a valid register
+/// of class \a To, allowing the implicit conversion of #reg_t operands.
+template <class From, class To>
+struct reg_class_subset : std::is_same<From, To> {};
+template <> struct reg_class_subset<gpr32_index_class, gpr32_class> : std::true_type {};
+template <> struct reg_class_subset<gpr64_index_class, gpr64_class> : std::true_type {};
+template <> struct reg_class_subset<kreg_not0_class, kreg_class> : std::true_type {};
+template <> struct reg_class_subset<xmm_avx_class, xmm_class> : std::true_type {};
+template <> struct reg_class_subset<ymm_avx_class, ymm_class> : std::true_type {};
+
+/// A register operand of class \a Class for machine mode \a Mode
+/// (16, 32 or 64).
+/// @ingroup ENC2
+template <class Class, unsigned Mode>
+class reg_t {
+  public:
+    explicit constexpr reg_t(xed_reg_enum_t r) : _reg(r) {
+        if (!Class::valid(r, Mode))
+            invalid_operand(Class::name, r);
+    }
+    template <class From,
+              class = std::enable_if_t<reg_class_subset<From, Class>::value>>
+    constexpr reg_t(reg_t<From, Mode> other) : _reg(other.reg()) {}
+
+    constexpr xed_reg_enum_t reg() const { return _reg; }
+
+  private:
+    xed_reg_enum_t _reg;
+};
+
+/// A memory operand scale factor: 1, 2, 4 or 8.
+/// @ingroup ENC2
+class scale_t {
+  public:
+    constexpr scale_t(xed_uint_t s) : _scale(s) {
+        if (s != 1 && s != 2 && s != 4 && s != 8)
+            xed_enc2_error("Bad scale value %d", s);
+    }
+    constexpr xed_uint_t value() const { return _scale; }
+
+  private:
+    xed_uint_t _scale;
+};
+
+/// An EVEX rounding control / suppress-all-exceptions value, 0 to 3.
+/// @ingroup ENC2
+class rcsae_t {
+  public:
+    constexpr rcsae_t(xed_uint_t rc) : _rcsae(rc) {
+        if (rc > 3)
+            xed_enc2_error("Bad RCSAE value %d", rc);
+    }
+    constexpr xed_uint_t value() const { return _rcsae; }
+
+  private:
+    xed_uint_t _rcsae;
+};
+
+} // namespace xed::enc2
+
+#endif
@@ -278,4 +278,69 @@ xed_encode_nop(xed_uint8_t* array,
                const unsigned int ilen);
 //@}
 
+/// @name Filling regions with NOPs
+//@{
+/// Limits on the NOPs emitted by #xed_fill_nops(). The NOPs are the
+/// 0x90 and 0F 1F /0 forms, lengthened with 0x66 prefixes as needed.
+/// @ingroup ENC
+typedef struct {
+    /// The longest single NOP to emit, 1...15 bytes.
+    xed_uint8_t max_length;
+    /// The maximum number of 0x66 prefixes on any one NOP.
+    xed_uint8_t max_prefixes;
+} xed_nop_policy_t;
+
+/// Use the fewest instructions: NOPs of up to 15 bytes.
+/// @ingroup ENC
+static XED_INLINE xed_nop_policy_t xed_nop_policy_fewest_instructions(void) {
+    xed_nop_policy_t p;
+    p.max_length = 15;
+    p.max_prefixes = 7;
+    return p;
+}
+
+/// Use the fewest instructions that have at most max_prefixes 0x66
+/// prefixes each. With max_prefixes=1, the NOPs are the ones produced by
+/// #xed_encode_nop().
+/// @ingroup ENC
+static XED_INLINE xed_nop_policy_t xed_nop_policy_max_prefixes(
+    xed_uint8_t max_prefixes)
+{
+    xed_nop_policy_t p;
+    p.max_length = 15;
+    p.max_prefixes = max_prefixes;
+    return p;
+}
+
+/// Avoid NOPs that are slow to decode on some cores: at most 3 prefixes
+/// and at most 11 bytes per NOP, matching what common assemblers emit.
+/// @ingroup ENC
+static XED_INLINE xed_nop_policy_t xed_nop_policy_decoder_friendly(void) {
+    xed_nop_policy_t p;
+    p.max_length = 11;
+    p.max_prefixes = 3;
+    return p;
+}
+
+/// Fill exactly ilen bytes of array with a sequence of NOPs suitable for
+/// the machine mode mmode, subject to the limits in policy. The region
+/// is filled with as few NOPs as the policy allows. Most of it is copies
+/// of the longest allowed NOP, replicated with memcpy so that large
+/// regions are filled quickly; the last one or two NOP lengths are split
+/// into the fewest NOPs of the lengths the policy allows.
+///
+/// @param array the NOP bytes are stored here
+/// @param ilen the number of bytes to fill
+/// @param mmode the machine mode, which selects 16b or 32/64b addressing forms
+/// @param policy the limits on each emitted NOP (#xed_nop_policy_t)
+/// @return #XED_ERROR_NONE on success, #XED_ERROR_GENERAL_ERROR
+///   if the policy does not allow any NOP.
+/// @ingroup ENC
+XED_DLL_EXPORT xed_error_enum_t
+xed_fill_nops(xed_uint8_t* array,
+              const unsigned int ilen,
+              xed_machine_mode_enum_t mmode,
+              xed_nop_policy_t policy);
+//@}
+
 #endif
@@ -465,6 +465,49 @@ XED_DLL_EXPORT xed_bool_t
 xed_convert_to_encoder_request(xed_encoder_request_t* out,
                                xed_encoder_instruction_t* in);
 
+/// @ingroup ENCHL
+/// Encode a #xed_encoder_instruction_t. This is equivalent to
+/// #xed_convert_to_encoder_request() followed by #xed_encode() on a
+/// request that is internal to this function.
+///
+/// @param in the instruction to encode
+/// @param array the encoded instruction bytes are stored here
+/// @param ilen the input length of array.
+/// @param olen the actual length of array used for encoding
+/// @return success/failure as a #xed_error_enum_t.
+///   #XED_ERROR_GENERAL_ERROR is returned if the instruction
+///   cannot be converted.
+XED_DLL_EXPORT xed_error_enum_t
+xed_encode_instruction(const xed_encoder_instruction_t* in,
+                       xed_uint8_t* array,
+                       const unsigned int ilen,
+                       unsigned int* olen);
+
+/// @ingroup ENCHL
+/// Encode an array of #xed_encoder_instruction_t back to back in to
+/// array. Encoding stops at the first instruction that fails.
+///
+/// @param in the instructions to encode
+/// @param ninst the number of elements of in
+/// @param array the encoded instruction bytes are stored here
+/// @param ilen the input length of array.
+/// @param olen the number of bytes of array used by the instructions
+///   that were encoded
+/// @param lengths optional (may be 0). If present, it must have ninst
+///   elements and the length of each encoded instruction is stored in it.
+/// @param nencoded optional (may be 0). The number of instructions that
+///   were encoded, which is the index of the failing instruction on error.
+/// @return success/failure as a #xed_error_enum_t for the first failing
+///   instruction.
+XED_DLL_EXPORT xed_error_enum_t
+xed_encode_instructions(const xed_encoder_instruction_t* in,
+                        xed_uint_t ninst,
+                        xed_uint8_t* array,
+                        const unsigned int ilen,
+                        unsigned int* olen,
+                        xed_uint8_t* lengths,
+                        xed_uint_t* nencoded);
+
 //@}
 
 /// @name Creating instructions from operands
@@ -27,7 +27,8 @@ END_LEGAL */
 //@{
 
 /// Options for the disasembly formatting functions. Set once during
-/// initialization by a calling #xed_format_set_options
+/// initialization by a calling #xed_format_set_options, or supply them
+/// to #xed_formatter_init.
 ///  @ingroup PRINT
 typedef struct {
     /// by default, XED prints the hex address before any symbolic name for
@@ -59,7 +60,10 @@ typedef struct {
 } xed_format_options_t;
 
 /// Optionally, customize the disassembly formatting options by passing 
-/// in a #xed_format_options_t structure.
+/// in a #xed_format_options_t structure. These options are process wide
+/// and are not synchronized; they are used by the formatting functions
+/// that are not given options explicitly. Use a #xed_formatter_t when
+/// threads need different options.
 /// @ingroup PRINT
 XED_DLL_EXPORT void
 xed_format_set_options(xed_format_options_t format_options);
@@ -0,0 +1,76 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-formatter.h 
+
+#if !defined(XED_FORMATTER_H)
+# define XED_FORMATTER_H
+
+#include "xed-types.h"
+#include "xed-decoded-inst.h"
+#include "xed-disas.h" // callback function type
+#include "xed-syntax-enum.h" 
+#include "xed-format-options.h"
+#include "xed-print-info.h"
+
+/// @ingroup PRINT
+/// A complete disassembly formatting configuration: syntax, formatting
+/// options and symbolic disassembly callback. Fill it in once with
+/// #xed_formatter_init. It is not modified afterwards, so one formatter
+/// can be shared by any number of threads, and threads may use different
+/// formatters at the same time. Formatting with a formatter never
+/// consults the process wide options set by #xed_format_set_options.
+typedef struct {
+    /// the syntax to print
+    xed_syntax_enum_t syntax;
+
+    /// the formatting options
+    xed_format_options_t format_options;
+
+    /// symbolic disassembly callback, zero if not used. The context
+    /// passed to it is supplied per call to #xed_formatter_format.
+    xed_disassembly_callback_fn_t disassembly_callback;
+
+    /// internal, do not use. The printer for the syntax.
+    xed_bool_t (*_printer)(xed_print_info_t* pi);
+} xed_formatter_t;
+
+/// @ingroup PRINT
+/// Initialize a formatter. If format_options is zero, XED's default
+/// options are used (not those set with #xed_format_set_options).
+/// symbolic_callback can be zero. Returns 0 if the syntax is not
+/// supported, 1 otherwise.
+XED_DLL_EXPORT xed_bool_t
+xed_formatter_init(xed_formatter_t* formatter,
+                   xed_syntax_enum_t syntax,
+                   const xed_format_options_t* format_options,
+                   xed_disassembly_callback_fn_t symbolic_callback);
+
+/// @ingroup PRINT
+/// Disassemble the decoded instruction with a prepared formatter. The
+/// other parameters are as for #xed_format_context. The context is
+/// passed to the formatter's symbolic disassembly callback.
+/// @return Returns 0 if the disassembly fails, 1 otherwise.
+XED_DLL_EXPORT xed_bool_t
+xed_formatter_format(const xed_formatter_t* formatter,
+                     const xed_decoded_inst_t* xedd,
+                     char* out_buffer,
+                     int  buffer_len,
+                     xed_uint64_t runtime_instruction_address,
+                     void* context);
+
+#endif
@@ -27,7 +27,9 @@ END_LEGAL */
 
 /// @ingroup INIT
 ///   This is the call to initialize the XED encode and decode tables. It
-///   must be called once before using XED.
+///   must be called once before using XED. It is safe to call from
+///   several threads at once; the first caller does the work and the
+///   others wait for it to finish. Later calls return immediately.
 void XED_DLL_EXPORT  xed_tables_init(void);
 
 ////////////////////////////////////////////////////////////////////////////
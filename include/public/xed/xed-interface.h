@@ -62,6 +62,8 @@ END_LEGAL */
 #include "xed-decoded-inst.h"
 #include "xed-decoded-inst-api.h"
 #include "xed-inst.h"
+#include "xed-reg-rw.h"
+#include "xed-dep-graph.h"
 #include "xed-iclass-enum.h"    /* generated */
 #include "xed-category-enum.h"  /* generated */
 #include "xed-extension-enum.h" /* generated */
@@ -72,6 +74,7 @@ END_LEGAL */
 
 #include "xed-disas.h"  // callbacks for disassembly
 #include "xed-format-options.h" /* options for disassembly  */
+#include "xed-formatter.h"      /* prepared formatting configuration */
 
 #include "xed-iform-enum.h"     /* generated */
 /* indicates the first and last index of each iform, for building tables */
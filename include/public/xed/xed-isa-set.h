@@ -23,8 +23,10 @@ END_LEGAL */
     
 #include "xed-common-hdrs.h"
 #include "xed-types.h"
+#include "xed-portability.h"
 #include "xed-isa-set-enum.h"     /* generated */
 #include "xed-chip-enum.h"        /* generated */
+#include "xed-iform-enum.h"       /* generated */
 
 /// @ingroup ISASET
 /// return 1 if the isa_set is part included in the specified chip, 0
@@ -33,5 +35,68 @@ XED_DLL_EXPORT xed_bool_t
 xed_isa_set_is_valid_for_chip(xed_isa_set_enum_t isa_set,
                               xed_chip_enum_t chip);
 
+/// @ingroup ISASET
+/// The number of 64b words in a #xed_chip_mask_t.
+#define XED_CHIP_MASK_WORDS ((XED_CHIP_LAST+63)/64)
+
+/// @ingroup ISASET
+/// A set of chips. Bit N is set if the #xed_chip_enum_t value N is in
+/// the set. The set of chips that can run some code is the
+/// intersection (#xed_chip_mask_and()) of the masks of its ISA sets.
+typedef struct {
+    xed_uint64_t w[XED_CHIP_MASK_WORDS];
+} xed_chip_mask_t;
+
+/// @ingroup ISASET
+/// Return the set of chips that support the isa_set. The mask of
+/// XED_ISA_SET_INVALID is empty.
+XED_DLL_EXPORT const xed_chip_mask_t*
+xed_isa_set_chip_mask(xed_isa_set_enum_t isa_set);
+
+/// @ingroup ISASET
+/// Return the set of chips that support the ISA set of the iform.
+XED_DLL_EXPORT const xed_chip_mask_t*
+xed_iform_chip_mask(xed_iform_enum_t iform);
+
+/// @ingroup ISASET
+/// Set m to every valid chip.
+static XED_INLINE void xed_chip_mask_fill(xed_chip_mask_t* m) {
+    const xed_uint64_t one = 1;
+    unsigned int i;
+    for(i=0;i<XED_CHIP_MASK_WORDS;i++)
+        m->w[i] = ~XED_STATIC_CAST(xed_uint64_t,0);
+    m->w[0] &= ~one; // XED_CHIP_INVALID
+    if (XED_CHIP_LAST % 64)
+        m->w[XED_CHIP_MASK_WORDS-1] &= (one << (XED_CHIP_LAST % 64)) - 1;
+}
+
+/// @ingroup ISASET
+/// Intersect m with other, in place.
+static XED_INLINE void xed_chip_mask_and(xed_chip_mask_t* m,
+                                         const xed_chip_mask_t* other) {
+    unsigned int i;
+    for(i=0;i<XED_CHIP_MASK_WORDS;i++)
+        m->w[i] &= other->w[i];
+}
+
+/// @ingroup ISASET
+/// Return 1 if chip is in m.
+static XED_INLINE xed_bool_t xed_chip_mask_test(const xed_chip_mask_t* m,
+                                                xed_chip_enum_t chip) {
+    const xed_uint64_t one = 1;
+    const unsigned int c = XED_STATIC_CAST(unsigned int,chip);
+    return XED_STATIC_CAST(xed_bool_t, (m->w[c/64] >> (c%64)) & one);
+}
+
+/// @ingroup ISASET
+/// Return 1 if m contains no chip.
+static XED_INLINE xed_bool_t xed_chip_mask_is_empty(const xed_chip_mask_t* m) {
+    unsigned int i;
+    for(i=0;i<XED_CHIP_MASK_WORDS;i++)
+        if (m->w[i])
+            return 0;
+    return 1;
+}
+
     
 #endif
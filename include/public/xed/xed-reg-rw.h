@@ -0,0 +1,146 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-reg-rw.h
+/// 
+
+#ifndef XED_REG_RW_H
+# define  XED_REG_RW_H
+
+#include "xed-types.h"
+#include "xed-portability.h"
+#include "xed-reg-enum.h" // a generated file
+#include "xed-decoded-inst.h"
+
+/// The number of 64b words in a #xed_reg_set_t
+/// @ingroup REGRW
+#define XED_REG_SET_WORDS ((XED_REG_LAST+63)/64)
+
+/// @ingroup REGRW
+/// A set of registers with one bit per #xed_reg_enum_t value.
+typedef struct {
+    xed_uint64_t w[XED_REG_SET_WORDS];
+} xed_reg_set_t;
+
+/// @ingroup REGRW
+/// The registers read, written and conditionally written by one
+/// instruction. See #xed_decoded_inst_get_reg_rw().
+typedef struct {
+    /// registers whose incoming value may be used
+    xed_reg_set_t read;
+    /// registers whose entire value is always replaced
+    xed_reg_set_t write;
+    /// registers that are written only under some condition (masking,
+    /// predicates, faults) or only partially, so that some of their
+    /// previous value survives
+    xed_reg_set_t cond_write;
+} xed_reg_rw_t;
+
+/// @name Register sets
+//@{
+/// @ingroup REGRW
+static XED_INLINE void xed_reg_set_zero(xed_reg_set_t* s) {
+    xed_uint_t i;
+    for(i=0;i<XED_REG_SET_WORDS;i++)
+        s->w[i] = 0;
+}
+/// @ingroup REGRW
+static XED_INLINE void xed_reg_set_add(xed_reg_set_t* s, xed_reg_enum_t r) {
+    s->w[r>>6] |= XED_STATIC_CAST(xed_uint64_t,1) << (r&63);
+}
+/// @ingroup REGRW
+static XED_INLINE void xed_reg_set_remove(xed_reg_set_t* s,
+                                          xed_reg_enum_t r) {
+    s->w[r>>6] &= ~(XED_STATIC_CAST(xed_uint64_t,1) << (r&63));
+}
+/// @ingroup REGRW
+/// @return 1 if r is in the set, 0 otherwise
+static XED_INLINE xed_bool_t xed_reg_set_test(const xed_reg_set_t* s,
+                                              xed_reg_enum_t r) {
+    return XED_STATIC_CAST(xed_bool_t,(s->w[r>>6] >> (r&63)) & 1);
+}
+/// @ingroup REGRW
+/// Adds all the registers in b to a.
+static XED_INLINE void xed_reg_set_union(xed_reg_set_t* a,
+                                         const xed_reg_set_t* b) {
+    xed_uint_t i;
+    for(i=0;i<XED_REG_SET_WORDS;i++)
+        a->w[i] |= b->w[i];
+}
+/// @ingroup REGRW
+/// Removes the registers in b from a.
+static XED_INLINE void xed_reg_set_subtract(xed_reg_set_t* a,
+                                            const xed_reg_set_t* b) {
+    xed_uint_t i;
+    for(i=0;i<XED_REG_SET_WORDS;i++)
+        a->w[i] &= ~b->w[i];
+}
+/// @ingroup REGRW
+/// @return 1 if a and b have a register in common, 0 otherwise
+static XED_INLINE xed_bool_t xed_reg_set_intersects(const xed_reg_set_t* a,
+                                                    const xed_reg_set_t* b) {
+    xed_uint_t i;
+    for(i=0;i<XED_REG_SET_WORDS;i++)
+        if (a->w[i] & b->w[i])
+            return 1;
+    return 0;
+}
+/// @ingroup REGRW
+/// @return 1 if the set is empty, 0 otherwise
+static XED_INLINE xed_bool_t xed_reg_set_is_empty(const xed_reg_set_t* s) {
+    xed_uint_t i;
+    for(i=0;i<XED_REG_SET_WORDS;i++)
+        if (s->w[i])
+            return 0;
+    return 1;
+}
+//@}
+
+/// @name Register dataflow
+//@{
+/// @ingroup REGRW
+/// Computes the full architectural registers that the decoded instruction
+/// reads, writes and conditionally writes, including suppressed operands,
+/// memory addressing registers and the flags register.
+///
+/// Every register is reported as its largest enclosing register for the
+/// machine mode of the decode: AL, AX and EAX become RAX in 64b mode and
+/// EAX otherwise; XMM and YMM registers become ZMM registers. A write to a
+/// part of a register is reported in cond_write because the rest of the
+/// register keeps its value. The exceptions follow the architecture:
+/// 32b GPR writes in 64b mode, VEX/EVEX writes to vector registers and
+/// APX zero-upper forms all clear the upper bits and so are reported in
+/// write. AVX512 merge-masked destinations are read and conditionally
+/// written.
+///
+/// The flags register is reported from #xed_decoded_inst_get_rflags_info()
+/// when that is available. It is read if any flag is read. It is written
+/// if all six status flags (OF SF ZF AF PF CF) are always written or left
+/// undefined, and conditionally written if only some flags are written,
+/// as with INC, or if the write depends on a REP count.
+///
+/// The stack push/pop pseudo registers of the implicit stack memory
+/// operands are not reported.
+///
+/// @param xedd the decoded instruction
+/// @param rw the output sets; they are cleared before being filled in.
+XED_DLL_EXPORT void
+xed_decoded_inst_get_reg_rw(const xed_decoded_inst_t* xedd,
+                            xed_reg_rw_t* rw);
+//@}
+
+#endif
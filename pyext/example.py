@@ -22,3 +22,14 @@ print(xed.dis32([0x67, 0x8b, 0x46, 0xff]))
 print(xed.dis32([0x75, 0x10]))
 print(xed.dis64([0x75, 0x10], 0xaaaabbbffff0000))
 
+
+# decode a whole buffer in one call; any bytes-like object works
+code = bytes([0x48, 0x89, 0xe5, 0x75, 0x10, 0xc5, 0xfc, 0x58, 0xc1, 0xc3])
+for inst in xed.decode(code, address=0x401000):
+    print(hex(inst.address), inst.length, inst.iclass, inst.iform,
+          inst.isa_set, inst.operands)
+
+# or get the fields back as packed arrays
+cols = xed.decode(memoryview(code), packed=True)
+iclass_names = xed.enum_names('iclass')
+print([iclass_names[v] for v in cols['iclass']])
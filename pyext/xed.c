@@ -18,6 +18,7 @@ END_LEGAL */
 #include <Python.h>
 
 #include <stdio.h>
+#include <string.h>
 #include "xed/xed-interface.h"
 
 #if defined(__GNUC__) || defined(__clang__)
@@ -89,12 +90,492 @@ dis32(PyObject *self, PyObject *args)
     return dis(self,args,XED_MACHINE_MODE_LEGACY_32,XED_ADDRESS_WIDTH_32b);
 }
 
+/* Bulk decode.  decode() takes any object that exports a buffer
+   (bytes, bytearray, memoryview, mmap) and decodes the whole range
+   with the GIL released.  The per-instruction fields are collected in
+   columns so they can either be handed back as array.array objects or
+   walked by a lightweight iterator of xed.Inst records. */
+
+#define PYXED_MAX_OPERANDS 8
+/* operand column values with this bit set are xed_reg_enum_t values,
+   otherwise they are xed_operand_enum_t values. */
+#define PYXED_REG_FLAG 0x8000
+
+typedef struct {
+    Py_ssize_t n;    /* number of instructions decoded */
+    Py_ssize_t cap;
+    uint64_t* address;
+    xed_uint8_t* length;
+    xed_uint16_t* iclass;
+    xed_uint16_t* iform;
+    xed_uint16_t* isa_set;
+    xed_uint8_t* noperands;
+    xed_uint16_t* operands; /* PYXED_MAX_OPERANDS per instruction */
+} pyxed_columns_t;
+
+static void columns_free(pyxed_columns_t* c)
+{
+    PyMem_RawFree(c->address);
+    PyMem_RawFree(c->length);
+    PyMem_RawFree(c->iclass);
+    PyMem_RawFree(c->iform);
+    PyMem_RawFree(c->isa_set);
+    PyMem_RawFree(c->noperands);
+    PyMem_RawFree(c->operands);
+    memset(c, 0, sizeof(*c));
+}
+
+static void* grow_column(void* p, Py_ssize_t cap, size_t elem, int* ok)
+{
+    void* q = PyMem_RawRealloc(p, XED_STATIC_CAST(size_t,cap) * elem);
+    if (q == NULL) {
+        *ok = 0;
+        return p;
+    }
+    return q;
+}
+
+/* Called without the GIL, so only the raw allocator is used. */
+static int columns_grow(pyxed_columns_t* c)
+{
+    int ok = 1;
+    Py_ssize_t cap = c->cap ? 2 * c->cap : 1024;
+    c->address = grow_column(c->address, cap, sizeof(uint64_t), &ok);
+    c->length = grow_column(c->length, cap, sizeof(xed_uint8_t), &ok);
+    c->iclass = grow_column(c->iclass, cap, sizeof(xed_uint16_t), &ok);
+    c->iform = grow_column(c->iform, cap, sizeof(xed_uint16_t), &ok);
+    c->isa_set = grow_column(c->isa_set, cap, sizeof(xed_uint16_t), &ok);
+    c->noperands = grow_column(c->noperands, cap, sizeof(xed_uint8_t), &ok);
+    c->operands = grow_column(c->operands, cap * PYXED_MAX_OPERANDS,
+                              sizeof(xed_uint16_t), &ok);
+    if (ok)
+        c->cap = cap;
+    return ok;
+}
+
+/* Undecodable bytes are recorded as one byte XED_ICLASS_INVALID
+   entries and decoding resumes at the next byte. Returns 0 if out of
+   memory. */
+static int decode_range(pyxed_columns_t* c,
+                        const xed_uint8_t* itext,
+                        Py_ssize_t len,
+                        uint64_t runtime_addr,
+                        xed_machine_mode_enum_t mmode,
+                        xed_address_width_enum_t stack_addr_width,
+                        Py_ssize_t limit)
+{
+    xed_decoded_inst_t xedd;
+    Py_ssize_t off = 0;
+
+    xed_decoded_inst_zero(&xedd);
+    xed_decoded_inst_set_mode(&xedd, mmode, stack_addr_width);
+    while (off < len && (limit == 0 || c->n < limit))
+    {
+        xed_error_enum_t xed_error;
+        xed_uint_t avail, ilen, j, nops = 0;
+        xed_uint16_t* ops;
+        Py_ssize_t i = c->n;
+
+        if (i == c->cap && !columns_grow(c))
+            return 0;
+        avail = XED_STATIC_CAST(xed_uint_t,
+                                len - off < XED_MAX_INSTRUCTION_BYTES
+                                ? len - off : XED_MAX_INSTRUCTION_BYTES);
+        xed_decoded_inst_zero_keep_mode(&xedd);
+        xed_error = xed_decode(&xedd, itext + off, avail);
+
+        ops = c->operands + i * PYXED_MAX_OPERANDS;
+        memset(ops, 0, PYXED_MAX_OPERANDS * sizeof(xed_uint16_t));
+        c->address[i] = runtime_addr + XED_STATIC_CAST(uint64_t,off);
+        if (xed_error == XED_ERROR_NONE)
+        {
+            const xed_inst_t* xi = xed_decoded_inst_inst(&xedd);
+            xed_uint_t noperands = xed_inst_noperands(xi);
+            ilen = xed_decoded_inst_get_length(&xedd);
+            c->iclass[i] = XED_STATIC_CAST(xed_uint16_t,
+                                       xed_decoded_inst_get_iclass(&xedd));
+            c->iform[i] = XED_STATIC_CAST(xed_uint16_t,
+                                       xed_decoded_inst_get_iform_enum(&xedd));
+            c->isa_set[i] = XED_STATIC_CAST(xed_uint16_t,
+                                       xed_decoded_inst_get_isa_set(&xedd));
+            for (j = 0; j < noperands && nops < PYXED_MAX_OPERANDS; j++)
+            {
+                const xed_operand_t* op = xed_inst_operand(xi, j);
+                xed_operand_enum_t name = xed_operand_name(op);
+                if (xed_operand_operand_visibility(op) != XED_OPVIS_EXPLICIT)
+                    continue;
+                if (xed_operand_is_register(name))
+                    ops[nops++] = XED_STATIC_CAST(xed_uint16_t,
+                          PYXED_REG_FLAG | xed_decoded_inst_get_reg(&xedd, name));
+                else
+                    ops[nops++] = XED_STATIC_CAST(xed_uint16_t, name);
+            }
+        }
+        else
+        {
+            ilen = 1;
+            c->iclass[i] = XED_ICLASS_INVALID;
+            c->iform[i] = XED_IFORM_INVALID;
+            c->isa_set[i] = XED_ISA_SET_INVALID;
+        }
+        c->length[i] = XED_STATIC_CAST(xed_uint8_t, ilen);
+        c->noperands[i] = XED_STATIC_CAST(xed_uint8_t, nops);
+        c->n++;
+        off += ilen;
+    }
+    return 1;
+}
+
+/* Interned name strings, created on first use and kept for the life
+   of the process. */
+typedef enum {
+    PYXED_ICLASS,
+    PYXED_IFORM,
+    PYXED_ISA_SET,
+    PYXED_REG,
+    PYXED_OPERAND,
+    PYXED_NKINDS
+} pyxed_kind_t;
+
+static char const* const kind_names[PYXED_NKINDS] = {
+    "iclass", "iform", "isa_set", "reg", "operand"
+};
+static unsigned int const kind_limit[PYXED_NKINDS] = {
+    XED_ICLASS_LAST, XED_IFORM_LAST, XED_ISA_SET_LAST,
+    XED_REG_LAST, XED_OPERAND_LAST
+};
+static PyObject** name_cache[PYXED_NKINDS];
+
+static char const* kind_enum2str(pyxed_kind_t k, unsigned int v)
+{
+    switch(k) {
+      case PYXED_ICLASS:
+        return xed_iclass_enum_t2str(XED_STATIC_CAST(xed_iclass_enum_t,v));
+      case PYXED_IFORM:
+        return xed_iform_enum_t2str(XED_STATIC_CAST(xed_iform_enum_t,v));
+      case PYXED_ISA_SET:
+        return xed_isa_set_enum_t2str(XED_STATIC_CAST(xed_isa_set_enum_t,v));
+      case PYXED_REG:
+        return xed_reg_enum_t2str(XED_STATIC_CAST(xed_reg_enum_t,v));
+      default:
+        return xed_operand_enum_t2str(XED_STATIC_CAST(xed_operand_enum_t,v));
+    }
+}
+
+/* returns a new reference */
+static PyObject* get_name(pyxed_kind_t k, unsigned int v)
+{
+    PyObject** cache = name_cache[k];
+    if (cache == NULL) {
+        cache = PyMem_Calloc(kind_limit[k], sizeof(PyObject*));
+        if (cache == NULL)
+            return PyErr_NoMemory();
+        name_cache[k] = cache;
+    }
+    if (v >= kind_limit[k])
+        v = 0; /* the INVALID value of every kind */
+    if (cache[v] == NULL) {
+        cache[v] = PyUnicode_InternFromString(kind_enum2str(k, v));
+        if (cache[v] == NULL)
+            return NULL;
+    }
+    Py_INCREF(cache[v]);
+    return cache[v];
+}
+
+static PyStructSequence_Field inst_fields[] = {
+    {"address",  "runtime address of the first byte"},
+    {"length",   "length in bytes; 1 for undecodable bytes"},
+    {"iclass",   "iclass name, INVALID for undecodable bytes"},
+    {"iform",    "iform name"},
+    {"isa_set",  "ISA set name"},
+    {"operands", "tuple of the explicit operands: register names or "
+                 "operand names such as MEM0, IMM0 or RELBR"},
+    {NULL, NULL}
+};
+
+static PyStructSequence_Desc inst_desc = {
+    "xed.Inst",
+    "A decoded instruction returned by the xed.decode() iterator.",
+    inst_fields,
+    6
+};
+
+static PyTypeObject InstType;
+
+typedef struct {
+    PyObject_HEAD
+    pyxed_columns_t c;
+    Py_ssize_t pos;
+} pyxed_iter_t;
+
+static void iter_dealloc(pyxed_iter_t* self)
+{
+    columns_free(&self->c);
+    Py_TYPE(self)->tp_free(XED_STATIC_CAST(PyObject*,self));
+}
+
+static PyObject* iter_next(pyxed_iter_t* self)
+{
+    pyxed_columns_t* c = &self->c;
+    Py_ssize_t i = self->pos;
+    xed_uint16_t const* ops;
+    PyObject* inst;
+    PyObject* opnds;
+    xed_uint_t j;
+
+    if (i >= c->n)
+        return NULL;
+    self->pos++;
+
+    opnds = PyTuple_New(c->noperands[i]);
+    if (opnds == NULL)
+        return NULL;
+    ops = c->operands + i * PYXED_MAX_OPERANDS;
+    for (j = 0; j < c->noperands[i]; j++) {
+        PyObject* name;
+        if (ops[j] & PYXED_REG_FLAG)
+            name = get_name(PYXED_REG, ops[j] & ~PYXED_REG_FLAG);
+        else
+            name = get_name(PYXED_OPERAND, ops[j]);
+        if (name == NULL) {
+            Py_DECREF(opnds);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(opnds, j, name);
+    }
+
+    inst = PyStructSequence_New(&InstType);
+    if (inst == NULL) {
+        Py_DECREF(opnds);
+        return NULL;
+    }
+    PyStructSequence_SET_ITEM(inst, 0,
+                              PyLong_FromUnsignedLongLong(c->address[i]));
+    PyStructSequence_SET_ITEM(inst, 1, PyLong_FromLong(c->length[i]));
+    PyStructSequence_SET_ITEM(inst, 2, get_name(PYXED_ICLASS, c->iclass[i]));
+    PyStructSequence_SET_ITEM(inst, 3, get_name(PYXED_IFORM, c->iform[i]));
+    PyStructSequence_SET_ITEM(inst, 4, get_name(PYXED_ISA_SET, c->isa_set[i]));
+    PyStructSequence_SET_ITEM(inst, 5, opnds);
+    for (j = 0; j < 5; j++)
+        if (PyStructSequence_GET_ITEM(inst, j) == NULL) {
+            Py_DECREF(inst);
+            return NULL;
+        }
+    return inst;
+}
+
+static PyObject* iter_length_hint(pyxed_iter_t* self, PyObject* unused)
+{
+    return PyLong_FromSsize_t(self->c.n - self->pos);
+}
+
+static PyMethodDef iter_methods[] = {
+    {"__length_hint__", (PyCFunction)(void(*)(void))iter_length_hint,
+     METH_NOARGS, NULL},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject DecodeIterType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "xed.DecodeIterator",
+    .tp_basicsize = sizeof(pyxed_iter_t),
+    .tp_dealloc = XED_STATIC_CAST(destructor,iter_dealloc),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Iterator over the xed.Inst records of a xed.decode() call.",
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = XED_STATIC_CAST(iternextfunc,iter_next),
+    .tp_methods = iter_methods,
+};
+
+/* Returns a new array.array of the given typecode holding a copy of
+   the nbytes bytes at p. */
+static PyObject* make_array(char const* typecode, void const* p,
+                            Py_ssize_t nbytes)
+{
+    static PyObject* array_type = NULL;
+    PyObject* arr;
+    PyObject* mv;
+    PyObject* r;
+
+    if (array_type == NULL) {
+        PyObject* mod = PyImport_ImportModule("array");
+        if (mod == NULL)
+            return NULL;
+        array_type = PyObject_GetAttrString(mod, "array");
+        Py_DECREF(mod);
+        if (array_type == NULL)
+            return NULL;
+    }
+    arr = PyObject_CallFunction(array_type, "s", typecode);
+    if (arr == NULL || nbytes == 0)
+        return arr;
+    mv = PyMemoryView_FromMemory(XED_CAST(char*,p), nbytes, PyBUF_READ);
+    if (mv == NULL) {
+        Py_DECREF(arr);
+        return NULL;
+    }
+    r = PyObject_CallMethod(arr, "frombytes", "O", mv);
+    Py_DECREF(mv);
+    if (r == NULL) {
+        Py_DECREF(arr);
+        return NULL;
+    }
+    Py_DECREF(r);
+    return arr;
+}
+
+static int add_column(PyObject* d, char const* key, char const* typecode,
+                      void const* p, Py_ssize_t nbytes)
+{
+    int r;
+    PyObject* arr = make_array(typecode, p, nbytes);
+    if (arr == NULL)
+        return -1;
+    r = PyDict_SetItemString(d, key, arr);
+    Py_DECREF(arr);
+    return r;
+}
+
+static PyObject* columns_to_dict(pyxed_columns_t* c)
+{
+    Py_ssize_t n = c->n;
+    PyObject* d = PyDict_New();
+    if (d == NULL)
+        return NULL;
+    if (add_column(d, "address", "Q", c->address,
+                   n * XED_STATIC_CAST(Py_ssize_t,sizeof(uint64_t))) < 0 ||
+        add_column(d, "length", "B", c->length, n) < 0 ||
+        add_column(d, "iclass", "H", c->iclass, 2 * n) < 0 ||
+        add_column(d, "iform", "H", c->iform, 2 * n) < 0 ||
+        add_column(d, "isa_set", "H", c->isa_set, 2 * n) < 0 ||
+        add_column(d, "noperands", "B", c->noperands, n) < 0 ||
+        add_column(d, "operands", "H", c->operands,
+                   2 * n * PYXED_MAX_OPERANDS) < 0)
+    {
+        Py_DECREF(d);
+        return NULL;
+    }
+    return d;
+}
+
+static PyObject *
+decode(PyObject *self, PyObject *args, PyObject *kwds)
+{
+    static char* kwlist[] = { "buffer", "mode", "address", "packed",
+                              "limit", NULL };
+    PyObject* obj = 0;
+    int mode = 64;
+    uint64_t runtime_addr = 0;
+    int packed = 0;
+    Py_ssize_t limit = 0;
+    xed_machine_mode_enum_t mmode;
+    xed_address_width_enum_t stack_addr_width;
+    Py_buffer view;
+    pyxed_columns_t c;
+    pyxed_iter_t* it;
+    PyObject* r;
+    int ok;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|iKpn", kwlist, &obj,
+                                     &mode, &runtime_addr, &packed, &limit))
+        return NULL;
+    switch(mode) {
+      case 64:
+        mmode = XED_MACHINE_MODE_LONG_64;
+        stack_addr_width = XED_ADDRESS_WIDTH_64b;
+        break;
+      case 32:
+        mmode = XED_MACHINE_MODE_LEGACY_32;
+        stack_addr_width = XED_ADDRESS_WIDTH_32b;
+        break;
+      case 16:
+        mmode = XED_MACHINE_MODE_LEGACY_16;
+        stack_addr_width = XED_ADDRESS_WIDTH_16b;
+        break;
+      default:
+        PyErr_SetString(PyExc_ValueError, "mode must be 16, 32 or 64");
+        return NULL;
+    }
+    if (limit < 0) {
+        PyErr_SetString(PyExc_ValueError, "limit must not be negative");
+        return NULL;
+    }
+    if (PyObject_GetBuffer(obj, &view, PyBUF_SIMPLE) < 0)
+        return NULL;
+
+    memset(&c, 0, sizeof(c));
+    Py_BEGIN_ALLOW_THREADS
+    ok = decode_range(&c, XED_STATIC_CAST(const xed_uint8_t*,view.buf),
+                      view.len, runtime_addr, mmode, stack_addr_width, limit);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+
+    if (!ok) {
+        columns_free(&c);
+        return PyErr_NoMemory();
+    }
+    if (packed) {
+        r = columns_to_dict(&c);
+        columns_free(&c);
+        return r;
+    }
+    it = PyObject_New(pyxed_iter_t, &DecodeIterType);
+    if (it == NULL) {
+        columns_free(&c);
+        return NULL;
+    }
+    it->c = c;
+    it->pos = 0;
+    return XED_STATIC_CAST(PyObject*,it);
+}
+
+static PyObject *
+enum_names(PyObject *self, PyObject *args)
+{
+    char const* kind;
+    unsigned int k, v;
+    PyObject* t;
+
+    if (!PyArg_ParseTuple(args, "s", &kind))
+        return NULL;
+    for (k = 0; k < PYXED_NKINDS; k++)
+        if (strcmp(kind, kind_names[k]) == 0)
+            break;
+    if (k == PYXED_NKINDS) {
+        PyErr_Format(PyExc_ValueError,
+                     "unknown kind %s: expected iclass, iform, isa_set, "
+                     "reg or operand", kind);
+        return NULL;
+    }
+    t = PyTuple_New(kind_limit[k]);
+    if (t == NULL)
+        return NULL;
+    for (v = 0; v < kind_limit[k]; v++) {
+        PyObject* name = get_name(XED_STATIC_CAST(pyxed_kind_t,k), v);
+        if (name == NULL) {
+            Py_DECREF(t);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(t, v, name);
+    }
+    return t;
+}
+
 
 #define HELPSTR  " Arguments are:\n\t(1) a list of integers representing the code to decode/disassemble,\n\t(2) an optional runtime address.\n\tReturns a disassembly string.\n"
-     
+
+#define DECODE_HELPSTR "Decode a whole range of bytes.\n Arguments are:\n\t(1) an object supporting the buffer protocol (bytes, bytearray,\n\t    memoryview, mmap); it is not copied,\n\t(2) mode=64: machine mode, 16, 32 or 64,\n\t(3) address=0: runtime address of the first byte,\n\t(4) packed=False: return array.array columns instead of an iterator,\n\t(5) limit=0: stop after this many instructions if nonzero.\n\tThe GIL is released while decoding. Undecodable bytes are\n\treported as one byte INVALID instructions. Returns an iterator of\n\txed.Inst(address, length, iclass, iform, isa_set, operands) or,\n\tif packed, a dict of arrays: address, length, iclass, iform,\n\tisa_set, noperands and operands (8 per instruction; values\n\twith bit 0x8000 set are registers). See enum_names().\n"
+
 static PyMethodDef xed_methods[] = {
     {"dis64",  dis64, METH_VARARGS, "Disassemble in 64b mode."  HELPSTR },
     {"dis32",  dis32, METH_VARARGS, "Disassemble in 32b mode."  HELPSTR },
+    {"decode", (PyCFunction)(void(*)(void))decode, METH_VARARGS | METH_KEYWORDS,
+     DECODE_HELPSTR },
+    {"enum_names", enum_names, METH_VARARGS,
+     "Arguments are:\n\t(1) one of 'iclass', 'iform', 'isa_set', 'reg' or "
+     "'operand'.\n\tReturns a tuple of names indexed by enumeration value,"
+     "\n\tfor interpreting the packed output of decode().\n" },
     {NULL, NULL, 0, NULL}
 };
 
@@ -117,6 +598,14 @@ PyInit_xed(void)
     if (m == NULL)
         return 0;
     xed_tables_init();
+
+    if (PyStructSequence_InitType2(&InstType, &inst_desc) < 0)
+        return 0;
+    if (PyType_Ready(&DecodeIterType) < 0)
+        return 0;
+    Py_INCREF(&InstType);
+    if (PyModule_AddObject(m, "Inst", XED_STATIC_CAST(PyObject*,&InstType)) < 0)
+        return 0;
     return m;
 }
 
@@ -234,6 +234,25 @@ def get_chip_supports_feature_dict(feature: str, chip2isa: dict) -> dict:
 
     return feature_support_table
 
+def _emit_isa_set_chip_masks(cfe, hfe, chips, chip_features_dict, isa_set):
+    """Emit the transpose of xed_chip_features: for each ISA set, a
+    bitmask with bit N set if XED_CHIP enumeration value N supports
+    it. chips is the XED_CHIP_ enum order without INVALID."""
+    nbits = len(chips) + 1
+    nwords = (nbits + 63) // 64
+    masks = [ [0]*nwords for x in isa_set ]
+    for ci,c in enumerate(chips, start=1):
+        for f in chip_features_dict[c]:
+            masks[_feature_index(isa_set,f)][ci // 64] |= 1 << (ci % 64)
+
+    decl = 'const xed_chip_mask_t xed_isa_set_chip_masks[XED_ISA_SET_LAST]'
+    hfe.write('extern {};\n'.format(decl))
+    cfe.write('{} = {{\n'.format(decl))
+    for f,m in zip(isa_set, masks):
+        words = ', '.join(['0x{:x}ULL'.format(w) for w in m])
+        cfe.write('    /* {} */ {{{{ {} }}}},\n'.format(f, words))
+    cfe.write('};\n')
+
 def work(arg):
     (chips,chip_features_dict) = read_database(arg.input_file_name) 
 
@@ -297,7 +316,8 @@ def work(arg):
                                      private_gendir,
                                      chip_features_hfn, 
                                      shell_file=False)
-    for header in [ 'xed-isa-set-enum.h', 'xed-chip-enum.h', 'xed-chip-features.h' ]:
+    for header in [ 'xed-isa-set-enum.h', 'xed-chip-enum.h', 'xed-chip-features.h',
+                    'xed-isa-set.h' ]:
         cfe.add_header(header)
         hfe.add_header(header)
     cfe.start()
@@ -363,6 +383,8 @@ def work(arg):
         for chip, is_supported in feature_support_table.items():
             fo.add_code_eol(f'xed_chip_supports_{feature.lower()}[XED_CHIP_{chip}]={is_supported}')
 
+    _emit_isa_set_chip_masks(cfe, hfe, chips, chip_features_dict, isa_set)
+
     cfe.write(fo.emit())
     hfe.write(fo.emit_header())
     cfe.close()    
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+# -*- python -*-
+#BEGIN_LEGAL
+#
+#Copyright (c) 2023 Intel Corporation
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#  
+#END_LEGAL
+"""Emit a C++17 header of inline wrappers around the enc2 encoder
+functions. The wrappers take the typed operands defined in
+xed-encode-direct-cpp.h so that register class errors are caught by
+the compiler instead of by the checked interface."""
+
+from __future__ import print_function
+import os
+import codegen
+import enc2argcheck
+from enc2common import *
+
+# Argument kinds (after enc2argcheck.fixup_arg_type) that become
+# xed::enc2::reg_t operands.
+_reg_kinds = [ 'cr', 'dr', 'seg',
+               'gpr8', 'gpr16', 'gpr32', 'gpr64',
+               'gpr16_index', 'gpr32_index', 'gpr64_index',
+               'kreg', 'kreg_not0', 'mmx', 'x87',
+               'xmm', 'xmm_avx', 'ymm', 'ymm_avx', 'zmm', 'tmm' ]
+
+# Argument kinds with a checked value type.
+_value_kinds = [ 'scale', 'rcsae' ]
+
+
+def _make_cpp_wrapper_function_object(env, enc_fn):
+    encoder_fn = enc_fn.get_function_name()
+    fname = encoder_fn[len('xed_enc_'):]
+    fo = codegen.function_object_t(fname, return_type='void', inline=True)
+    return fo
+
+
+def _create_cpp_wrapper_function(env, ii, encfn):
+    fo = _make_cpp_wrapper_function_object(env, encfn)
+    call_args = []
+    for arg,arginfo in encfn.get_args():
+        arg_chunks = arg.split(' ')
+        argtype = " ".join(arg_chunks[:-1])
+        argname = arg_chunks[-1]
+        kind = enc2argcheck.fixup_arg_type(ii, arginfo)
+        if kind in _reg_kinds:
+            fo.add_arg('{}_t {}'.format(kind, argname), arginfo)
+            call_args.append('{}.reg()'.format(argname))
+        elif kind in _value_kinds:
+            fo.add_arg('{}_t {}'.format(kind, argname), arginfo)
+            call_args.append('{}.value()'.format(argname))
+        elif kind == 'zeroing':
+            fo.add_arg('bool {}'.format(argname), arginfo)
+            call_args.append(argname)
+        else: # request, displacements and immediates
+            fo.add_arg('{} {}'.format(argtype, argname), arginfo)
+            call_args.append(argname)
+    fo.add_code_eol('{}({})'.format(encfn.get_function_name(),
+                                    ', '.join(call_args)))
+    ii.enc_cpp_wrapper_functions.append(fo)
+
+
+def create_cpp_wrapper_fn_main(env, ii):
+    '''sets ii.enc_cpp_wrapper_functions'''
+    ii.enc_cpp_wrapper_functions = []
+    for encfn in ii.encoder_functions:
+        _create_cpp_wrapper_function(env, ii, encfn)
+
+
+def emit_cpp_wrapper_header(args, env, xeddb):
+    '''Write xed-cpp-enc2-mXX-aYY.h next to the C enc2 header for
+       this configuration and return its file emitter.'''
+    msge("Writing encoder 'c++ wrapper' functions to .h file")
+    config_descriptor = 'enc2-m{}-a{}'.format(env.mode, env.asz)
+    gen_hdr_dir = os.path.join(args.gendir, config_descriptor, 'hdr', 'xed')
+    fe = codegen.xed_file_emitter_t(args.xeddir,
+                                    gen_hdr_dir,
+                                    'xed-cpp-{}.h'.format(config_descriptor),
+                                    namespace='xed::enc2::m{}_a{}'.format(env.mode,
+                                                                          env.asz),
+                                    is_private=False)
+    fe.add_header('xed/xed-encode-direct-cpp.h')
+    fe.add_misc_header(['extern "C" {',
+                        '#include "xed/xed-{}.h"'.format(config_descriptor),
+                        '}'])
+    fe.start()
+
+    for kind in _reg_kinds:
+        line = 'typedef reg_t<{}_class, {}> {}_t;'.format(kind, env.mode, kind)
+        if kind == 'tmm':
+            fe.add_code('#if defined(XED_REG_TREG_FIRST_DEFINED)')
+            fe.add_code(line)
+            fe.add_code('#endif')
+        else:
+            fe.add_code(line)
+    for kind in _value_kinds:
+        fe.add_code_eol('using xed::enc2::{}_t'.format(kind))
+
+    for ii in xeddb.recs:
+        for fo in ii.enc_cpp_wrapper_functions:
+            fo.emit_file_emitter(fe)
+    fe.close()
+    return fe
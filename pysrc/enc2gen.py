@@ -38,6 +38,7 @@ import read_xed_db
 import gen_setup
 import enc2test
 import enc2argcheck
+import enc2cpp
 
 from enc2common import *
 
@@ -5635,6 +5636,8 @@ def work():
                 enc2test.create_test_fn_main(env, ii)
                 # create arg checkers.  sets ii.enc_arg_check_functions
                 enc2argcheck.create_arg_check_fn_main(env, ii) 
+                # create c++ wrappers.  sets ii.enc_cpp_wrapper_functions
+                enc2cpp.create_cpp_wrapper_fn_main(env, ii)
 
             fel = emit_encode_functions(args,
                                         env,
@@ -5655,6 +5658,9 @@ def work():
                                         extra_headers = [ 'xed/xed-enc2-m{}-a{}.h'.format(env.mode, env.asz) ])
             output_file_emitters.extend(fel)
 
+            fe = enc2cpp.emit_cpp_wrapper_header(args, env, xeddb)
+            output_file_emitters.append(fe)
+
 
             msge("Writing encoder 'test' functions to .c and .h files")
             func_list = []
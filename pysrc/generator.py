@@ -274,6 +274,13 @@ def setup_arg_parser():
                           dest="add_orphan_inst_to_future_chip",
                           default=False,
                           help="Add orphan isa-sets to future chip definition.")
+    arg_parser.add_option("--target-chips", 
+                          action="store",
+                          dest="target_chips",
+                          default='',
+                          help="Comma separated list of chips. Drop the " +
+                          "instructions whose ISA set none of these chips " +
+                          "support.")
     return arg_parser
 
 #####################################################################
@@ -1618,6 +1625,108 @@ def remove_instructions(agi):
         if field_check(ii,'iclass'):
             g.parser_output = remove_overridden_versions(g.parser_output)
 
+# short chip names as used by the build knobs (--no-spr, ...)
+_target_chip_aliases = { 'SNB' : 'SANDYBRIDGE',
+                         'IVB' : 'IVYBRIDGE',
+                         'HSW' : 'HASWELL',
+                         'BDW' : 'BROADWELL',
+                         'SKL' : 'SKYLAKE',
+                         'SKX' : 'SKYLAKE_SERVER',
+                         'CLX' : 'CASCADE_LAKE',
+                         'CPX' : 'COOPER_LAKE',
+                         'CNL' : 'CANNONLAKE',
+                         'ICL' : 'ICE_LAKE',
+                         'TGL' : 'TIGER_LAKE',
+                         'ADL' : 'ALDER_LAKE',
+                         'SPR' : 'SAPPHIRE_RAPIDS',
+                         'EMR' : 'EMERALD_RAPIDS',
+                         'GNR' : 'GRANITE_RAPIDS',
+                         'SRF' : 'SIERRA_FOREST',
+                         'ARL' : 'ARROW_LAKE',
+                         'LNL' : 'LUNAR_LAKE',
+                         'CWF' : 'CLEARWATER_FOREST',
+                         'PTL' : 'PANTHER_LAKE' }
+
+def filter_instructions_for_chips(agi):
+    """Keep only the instructions whose isa_set is supported by one of
+    the chips named in --target-chips. The iclass and isa_set
+    enumerations still cover everything that was read so that the
+    public enumerations and the encoder do not change."""
+    chips_option = agi.common.options.target_chips
+    agi.dropped_instructions = []
+    agi.unfiltered_isa_sets = set()
+    if not chips_option:
+        return
+    (chips, chip_features_dict) = chipmodel.read_database(
+        agi.common.options.chip_models_input_fn)
+    all_chip_isa_sets = set()
+    for chip in chips:
+        all_chip_isa_sets.update(chip_features_dict[chip])
+
+    targets = [ x.strip().upper() for x in chips_option.split(',') ]
+    targets = [ _target_chip_aliases.get(x,x) for x in targets ]
+    keep = set()
+    for chip in targets:
+        if chip not in chip_features_dict:
+            die("Unknown chip in --target-chips: {}. Valid chips: {}".format(
+                chip, " ".join(chips)))
+        keep.update(chip_features_dict[chip])
+
+    for g in agi.generator_list:
+        if not g.parser_output.instructions:
+            continue
+        if not field_check(g.parser_output.instructions[0],'iclass'):
+            continue
+        iis = []
+        for ii in g.parser_output.instructions:
+            isa_set = ii.isa_set.upper()
+            agi.unfiltered_isa_sets.add(isa_set)
+            # orphans become part of FUTURE, see chipmodel.work()
+            orphan = isa_set not in all_chip_isa_sets
+            if (isa_set in keep or
+                (orphan and 'FUTURE' in targets and
+                 agi.common.options.add_orphan_inst_to_future_chip)):
+                iis.append(ii)
+            else:
+                agi.dropped_instructions.append(ii)
+        g.parser_output.instructions = iis
+    # an instruction table nonterminal (EVEX_INSTRUCTIONS, ...) can end
+    # up with nothing in it. Drop it; the static decoder never reaches
+    # it because the phash tables have no entries for its opcodes.
+    for g in agi.generator_list:
+        if not g.parser_output.instructions:
+            nt_name = g.parser_output.nonterminal_name
+            msgb("TARGET CHIPS", "dropping empty nonterminal " + nt_name)
+            del agi.generator_dict[nt_name]
+            if nt_name in agi.nonterminal_dict.nonterminal_info:
+                del agi.nonterminal_dict.nonterminal_info[nt_name]
+    agi.generator_list = [ g for g in agi.generator_list
+                           if g.parser_output.instructions ]
+    msgb("TARGET CHIPS", "{}: dropped {} instruction records".format(
+        ",".join(targets), len(agi.dropped_instructions)))
+
+    # the test runner uses this list to skip tests for dropped isa-sets
+    retained = sorted(agi.unfiltered_isa_sets -
+                      set([ x.isa_set.upper()
+                            for x in agi.dropped_instructions ]))
+    fn = os.path.join(agi.common.options.gendir, 'xed-isa-sets-retained.txt')
+    f = open(fn,'w')
+    for isa_set in retained:
+        f.write(isa_set + '\n')
+    f.close()
+
+def collect_dropped_enum_info(agi):
+    """Add the iclasses, categories, extensions and attributes of the
+    instructions dropped by --target-chips to the enumerations."""
+    if not agi.dropped_instructions:
+        return
+    node = graph_node('TARGET_CHIPS_DROPPED', 0)
+    node.instructions.extend(agi.dropped_instructions)
+    collect_ifield(agi.common.options, node, 'iclass', agi.iclasses)
+    collect_ifield(agi.common.options, node, 'category', agi.categories)
+    collect_ifield(agi.common.options, node, 'extension', agi.extensions)
+    collect_attributes(agi.common.options, node, agi.attributes)
+
 def remove_overridden_versions(parser):
    """Remove instructions that have newer versions using a dictionary
    of lists."""
@@ -5459,6 +5568,7 @@ def gen_everything_else(agi):
     #removed for all parsers, that have instructions.
     #Also all instructions with old versions will be dropped. 
     remove_instructions(agi)
+    filter_instructions_for_chips(agi)
     
     # first pass on the input, build the graph, collect information
     for gi in agi.generator_list:
@@ -5503,6 +5613,7 @@ def gen_everything_else(agi):
        if agi.common.options.print_graph:
           print_graph(agi.common.options,gi.graph)
           
+    collect_dropped_enum_info(agi)
     print_resource_usage('everything.2')
     if print_structured_output:
        sout.close()
@@ -5652,7 +5763,7 @@ def call_chipmodel(agi):
     args.gendir = agi.common.options.gendir
     args.add_orphans_to_future = agi.common.options.add_orphan_inst_to_future_chip
 
-    args.isa_sets_from_instr = agi.isa_sets
+    args.isa_sets_from_instr = agi.isa_sets.union(agi.unfiltered_isa_sets)
 
     # isaset_ch is a list of the ISA_SETs mentioned in the chip hierarchy.
     # we need to check that all of those are used/mentioned by some chip.
@@ -5834,37 +5945,54 @@ def emit_reg_class_enum(options, regs_list):
    return (reg_enum.src_full_file_name,reg_enum.hdr_full_file_name)
 
 def emit_reg_class_mappings(options, regs_list):
-   """Emit code to map any reg to its regclass. Also emit code to map
-   GPRs to a more specific GPR regclass (GPR8,16,32,64)"""
-   
-   fo = function_object_t('xed_init_reg_mappings', 'void')
-   for ri in regs_list:
-      s = 'xed_reg_class_array[XED_REG_%s]= XED_REG_CLASS_%s' % (ri.name, 
-                                                                 ri.type)
-      fo.add_code_eol(s)
+   """Emit const tables mapping any reg to its regclass, its largest
+   enclosing register and its width. Also map GPRs to a more specific
+   GPR regclass (GPR8,16,32,64). The rows follow the xed_reg_enum_t
+   order so the tables need no runtime initialization."""
+
+   # the enumeration order: INVALID first (see enumer_t), then the
+   # regs as rearranged for the enum, skipping the *_FIRST/*_LAST
+   # pseudo values.
+   regs_by_name = dict( (ri.name, ri) for ri in regs_list )
+   names = [ ev.name for ev in refine_regs.rearrange_regs(regs_list)
+             if ev.value is None and ev.name != 'INVALID' ]
+   ordered = [ regs_by_name[n] for n in ['INVALID'] + names ]
 
-   for ri in regs_list:
-      s = 'xed_largest_enclosing_register_array[XED_REG_%s]= XED_REG_%s' % (
-          ri.name, ri.max_enclosing_reg)
-      fo.add_code_eol(s)
+   fp = xed_file_emitter_t(options.xeddir,
+                           options.gendir,
+                           'xed-init-reg-class.c')
+   fp.start()
+
+   fp.add_code('const xed_reg_class_enum_t xed_reg_class_array[XED_REG_LAST] = {')
+   for ri in ordered:
+      fp.add_code('/* %s */ XED_REG_CLASS_%s,' % (ri.name, ri.type))
+   fp.add_code_eol('}')
+
+   fp.add_code('const xed_reg_class_enum_t xed_gpr_reg_class_array[XED_REG_LAST] = {')
+   for ri in ordered:
+      if ri.type == 'GPR':
+         rclass = ri.type + ri.width
+      else:
+         rclass = 'INVALID'
+      fp.add_code('/* %s */ XED_REG_CLASS_%s,' % (ri.name, rclass))
+   fp.add_code_eol('}')
+
+   fp.add_code('const xed_reg_enum_t xed_largest_enclosing_register_array[XED_REG_LAST] = {')
+   for ri in ordered:
+      fp.add_code('/* %s */ XED_REG_%s,' % (ri.name, ri.max_enclosing_reg))
+   fp.add_code_eol('}')
 
+   fp.add_code('const xed_reg_enum_t xed_largest_enclosing_register_array_32[XED_REG_LAST] = {')
+   for ri in ordered:
       if ri.max_enclosing_reg_32:
           m32 = ri.max_enclosing_reg_32
       else:
           m32 = 'INVALID' # used for 64b GPRs
+      fp.add_code('/* %s */ XED_REG_%s,' % (ri.name, m32))
+   fp.add_code_eol('}')
 
-      s = 'xed_largest_enclosing_register_array_32[XED_REG_%s]= XED_REG_%s' % (
-          ri.name, m32)
-      fo.add_code_eol(s)
-      
-   for ri in regs_list:
-      if ri.type == 'GPR':
-         s = 'xed_gpr_reg_class_array[XED_REG_%s]= XED_REG_CLASS_%s%s' % (
-             ri.name, ri.type, ri.width)
-         fo.add_code_eol(s)
-
-
-   for ri in regs_list:
+   fp.add_code('const xed_uint_t xed_reg_width_bits[XED_REG_LAST][2] = {')
+   for ri in ordered:
       if 'NA' == ri.width:
          width   = '0'
          width64 = '0'
@@ -5875,18 +6003,9 @@ def emit_reg_class_mappings(options, regs_list):
       else:
          width   = ri.width
          width64 = ri.width
-      
-      s = 'xed_reg_width_bits[XED_REG_%s][0] = %s' % (ri.name, width)
-      fo.add_code_eol(s)
-      s = 'xed_reg_width_bits[XED_REG_%s][1] = %s' % (ri.name, width64)
-      fo.add_code_eol(s)
+      fp.add_code('/* %s */ { %s, %s },' % (ri.name, width, width64))
+   fp.add_code_eol('}')
 
-   # write the file in our customized way
-   fp = xed_file_emitter_t(options.xeddir,
-                           options.gendir,
-                           'xed-init-reg-class.c')
-   fp.start()
-   fp.write(fo.emit())
    fp.close()
    return fp.full_file_name
 
@@ -5983,30 +6102,27 @@ def emit_widths_enum(options, widths_list):
 
 
 def emit_width_lookup(options, widths_list):
-   """Emit code to map XED_OPERAND_WIDTH_* and an effective operand size to a
-   number of bytes. """
+   """Emit a const table mapping XED_OPERAND_WIDTH_* and an effective
+   operand size to a number of bits. The rows follow the
+   xed_operand_width_enum_t order."""
 
-   fo = function_object_t('xed_init_width_mappings', 'void')
-   for ri in widths_list:
-      for i,w in enumerate(ri.widths):
-         s = 'xed_width_bits[XED_OPERAND_WIDTH_%s][%d] = %s' % (ri.name, i, w)
-         fo.add_code_eol(s)
-         
-         if 0: # DISABLED!!!
-            if int(w) % 8  == 0:
-               multiple = '1'
-            else:
-               multiple = '0'
-            s = 'xed_width_is_bytes[XED_OPERAND_WIDTH_%s][%d] = %s' % (
-                ri.name, i, multiple)
-            fo.add_code_eol(s)
-
-   # write the file in our customized way
    fp = xed_file_emitter_t(options.xeddir,
                            options.gendir,
                            'xed-init-width.c')
    fp.start()
-   fp.write(fo.emit())
+   # a width may be listed more than once. The enumeration keeps the
+   # first position and the last definition supplies the values.
+   names = []
+   widths = {}
+   for ri in widths_list:
+      if ri.name not in widths:
+         names.append(ri.name)
+      widths[ri.name] = ri.widths
+
+   fp.add_code('const xed_uint16_t xed_width_bits[XED_OPERAND_WIDTH_LAST][4] = {')
+   for name in names:
+      fp.add_code('/* %s */ { %s },' % (name, ', '.join(widths[name])))
+   fp.add_code_eol('}')
    fp.close()
    return fp.full_file_name
 
@@ -0,0 +1,139 @@
+#!/usr/bin/env python
+#-*- python -*-
+#BEGIN_LEGAL
+#
+#Copyright (c) 2023 Intel Corporation
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#  
+#END_LEGAL
+"""Startup and footprint benchmark. Runs the xed-startup example in
+fresh processes and writes the results as JSON.
+
+The report has the xed-startup output for one run over the decode
+corpora plus a "process" section with the median and minimum over
+several short-lived "xed-startup -init-only" processes: wall time of
+the whole process (exec, dynamic loading, init, exit), cold
+xed_tables_init() cycles and pages touched by the init."""
+
+from __future__ import print_function
+import os
+import sys
+import glob
+import json
+import time
+import argparse
+import subprocess
+
+def _median(lst):
+    s = sorted(lst)
+    n = len(s)
+    if n == 0:
+        return 0
+    if n % 2:
+        return s[n//2]
+    return (s[n//2-1] + s[n//2]) / 2.0
+
+def _run(cmd):
+    p = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    (out, err) = p.communicate()
+    if p.returncode:
+        sys.stderr.write(err.decode('utf-8', 'replace'))
+        return None
+    return json.loads(out.decode('utf-8'))
+
+def work(args):
+    print("Testing startup and footprint...")
+    if not os.path.exists(args.xed_startup):
+        print("Startup test executable not found: {}".format(args.xed_startup))
+        return 2
+
+    corpora = sorted(glob.glob(os.path.join(args.corpus, '*.txt')))
+
+    wall_ms = []
+    cold = []
+    touched = []
+    for sample in range(0, args.skip + args.samples):
+        t0 = time.time()
+        r = _run([args.xed_startup, '-init-only'])
+        t1 = time.time()
+        if r is None:
+            return 1
+        if sample < args.skip:
+            continue
+        wall_ms.append((t1-t0)*1000.0)
+        cold.append(r['tables_init']['cold_cycles'])
+        touched.append(r['tables_init']['pages_touched'])
+
+    report = _run([args.xed_startup] + corpora)
+    if report is None:
+        return 1
+    report['process'] = {
+        'samples': args.samples,
+        'wall_ms_median': _median(wall_ms),
+        'wall_ms_min': min(wall_ms),
+        'cold_init_cycles_median': _median(cold),
+        'cold_init_cycles_min': min(cold),
+        'init_pages_touched_median': _median(touched) }
+
+    with open(args.output, 'w') as f:
+        json.dump(report, f, indent=2)
+        f.write('\n')
+
+    p = report['process']
+    print("Linkage          : {}".format(report['linkage']))
+    print("Process wall ms  : {0:.3f} (min {1:.3f})".format(
+        p['wall_ms_median'], p['wall_ms_min']))
+    print("Cold init cycles : {0} (min {1})".format(
+        p['cold_init_cycles_median'], p['cold_init_cycles_min']))
+    print("Warm init cycles : {0:.2f}".format(
+        report['tables_init']['warm_cycles']))
+    print("Init pages       : {}".format(p['init_pages_touched_median']))
+    print("RSS after corpus : {} KB".format(report['end']['rss_kb']))
+    print("Wrote {}".format(args.output))
+    return 0
+
+def setup(defaults):
+    parser = argparse.ArgumentParser(
+        description='XED startup and footprint benchmark.')
+    parser.add_argument("--xed-startup", help='xed-startup executable',
+                        default=defaults.xed_startup)
+    parser.add_argument("--corpus", help='directory of bulk test files',
+                        default=defaults.corpus)
+    parser.add_argument("--output", help='output JSON file name',
+                        default=defaults.output)
+    parser.add_argument("--samples", help='number of -init-only processes',
+                        type=int, default=defaults.samples)
+    parser.add_argument("--skip", help='number of processes to skip',
+                        type=int, default=defaults.skip)
+    args = parser.parse_args()
+    return args
+
+class args_t:
+    pass
+
+def mkargs():
+    args = args_t()
+    args.xed_startup = 'obj/wkit/bin/xed-startup'
+    args.corpus = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                               '..', 'tests', 'bulk-tests')
+    args.output = 'startup.json'
+    args.samples = 20
+    args.skip = 2
+    return args
+
+if __name__ == "__main__":
+    defaults = mkargs()
+    args = setup(defaults)
+    r = work(args)
+    sys.exit(r)
@@ -25,12 +25,11 @@ END_LEGAL */
 #include "xed-internal-header.h"
 
 #include "xed-init.h"
+#include "xed-portability-private.h"
 
 extern void xed_init_inst_table(void);
 extern void xed_init_pointer_names(void);
 extern void xed_init_operand_ctypes(void);
-extern void xed_init_width_mappings(void);
-extern void xed_init_reg_mappings(void);
 extern void xed_init_chip_model_info(void);
 extern void xed_init_convert_tables(void);
 extern void xed_ild_init(void);
@@ -59,8 +58,6 @@ xed_decode_init(void)
 	return;
     first_time = 0;
     xed_common_init();
-    xed_init_width_mappings();
-    xed_init_reg_mappings();
 
     xed_init_pointer_names(); // generated function
     xed_init_operand_ctypes(); // generated function
@@ -94,10 +91,10 @@ extern void xed_table_sizes(void);
 XED_DLL_EXPORT void 
 xed_tables_init(void)
 {
-    static int first_time = 1;
-    if (first_time == 0)
-	return;
-    first_time = 0;
+    // safe to call concurrently; later calls return after one load
+    static xed_once_t once = 0;
+    if (!xed_once_begin(&once))
+        return;
 
     xed_table_sizes();
 
@@ -109,6 +106,7 @@ xed_tables_init(void)
 #if defined(XED_DECODER)
     xed_ild_init();
 #endif
+    xed_once_end(&once);
 }
 
 
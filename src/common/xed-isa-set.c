@@ -19,6 +19,7 @@ END_LEGAL */
 
 #include "xed-isa-set.h"
 #include "xed-util.h"
+#include "xed-iform-map.h"
 #include "xed-chip-features-table.h"
 xed_bool_t
 xed_isa_set_is_valid_for_chip(xed_isa_set_enum_t isa_set,
@@ -35,3 +36,14 @@ xed_isa_set_is_valid_for_chip(xed_isa_set_enum_t isa_set,
         return 1;
     return 0;
 }
+
+const xed_chip_mask_t*
+xed_isa_set_chip_mask(xed_isa_set_enum_t isa_set) {
+    xed_assert(isa_set < XED_ISA_SET_LAST);
+    return xed_isa_set_chip_masks + isa_set;
+}
+
+const xed_chip_mask_t*
+xed_iform_chip_mask(xed_iform_enum_t iform) {
+    return xed_isa_set_chip_mask(xed_iform_to_isa_set(iform));
+}
@@ -0,0 +1,327 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-agen-soa.c
+
+// Address generation for one memory operand over many register states.
+// xed_agen_desc_init() resolves everything about the operand that does
+// not depend on register values; xed_agen_desc_eval() then streams over
+// structure-of-arrays register columns.
+
+#include "xed-agen.h"
+#include "xed-decoded-inst-api.h"
+#include "xed-reg-class.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    !defined(XED_AGEN_NO_SIMD)
+# define XED_AGEN_SIMD 1
+# include <immintrin.h>
+#endif
+
+static xed_uint64_t reg_mask(xed_reg_enum_t r) {
+    xed_uint32_t width = xed_get_register_width_bits64(r);
+    if (width < 64) // AL for XLAT, 16b and 32b registers
+        return (1ULL << width) - 1;
+    return ~0ULL;
+}
+
+/* Returns the column for a base or index register, -1 if the register is
+   not held in the SoA table.  RIP-like registers are handled by the
+   caller. */
+static xed_int8_t gpr_column(xed_reg_enum_t r) {
+    xed_reg_enum_t big = xed_get_largest_enclosing_register(r);
+    if (big < XED_REG_GPR64_FIRST || big > XED_REG_GPR64_LAST)
+        return -1;
+    return XED_STATIC_CAST(xed_int8_t, big - XED_REG_GPR64_FIRST);
+}
+
+xed_error_enum_t xed_agen_desc_init(const xed_decoded_inst_t* xedd,
+                                    unsigned int memop_index,
+                                    xed_agen_desc_t* desc)
+{
+    const xed_operand_values_t* xedv;
+    xed_uint32_t addr_width;
+    xed_uint32_t opnd_width;
+    xed_bool_t real_mode;
+    xed_reg_enum_t base_reg, seg_reg;
+    xed_attribute_enum_t attr;
+
+    if (xedd == 0)
+        return XED_ERROR_GENERAL_ERROR;
+    if (memop_index != 0 &&  memop_index != 1)
+        return XED_ERROR_BAD_MEMOP_INDEX;
+    if (desc == 0)
+        return XED_ERROR_NO_OUTPUT_POINTER;
+
+    xedv = xed_decoded_inst_operands_const(xedd);
+    addr_width =  xed_operand_values_get_effective_address_width(xedv);
+    opnd_width =  xed_operand_values_get_effective_operand_width(xedv); 
+    real_mode  =  xed_operand_values_get_real_mode(xedv);
+
+    desc->disp = 0;
+    desc->base = desc->index = desc->seg = -1;
+    desc->base_mask = desc->index_mask = 0;
+    desc->scale_shift = 0;
+    desc->rip_relative = 0;
+
+    base_reg = xed_decoded_inst_get_base_reg(xedd,memop_index);
+    switch(base_reg) {
+      case XED_REG_INVALID:
+        break;
+      case XED_REG_RIP:
+        desc->disp += xed_decoded_inst_get_length(xedd);
+        /* fall through */
+      case XED_REG_EIP:
+      case XED_REG_IP:
+        desc->rip_relative = 1;
+        desc->base_mask = ~0ULL;
+        break;
+      default:
+        desc->base = gpr_column(base_reg);
+        if (desc->base < 0)
+            return XED_ERROR_CALLBACK_PROBLEM;
+        desc->base_mask = reg_mask(base_reg);
+        break;
+    }
+
+    if (memop_index == 1) 
+        attr = XED_ATTRIBUTE_STACKPUSH1;
+    else
+        attr = XED_ATTRIBUTE_STACKPUSH0;
+    if (xed_decoded_inst_get_attribute(xedd,attr))
+        desc->disp -= opnd_width>>3;
+
+    if (memop_index == 0) {
+        xed_reg_enum_t index_reg = xed_decoded_inst_get_index_reg(xedd,0);
+        if (index_reg != XED_REG_INVALID) {
+            xed_uint_t scale = xed_decoded_inst_get_scale(xedd,0);
+            desc->index = gpr_column(index_reg);
+            if (desc->index < 0)
+                return XED_ERROR_CALLBACK_PROBLEM;
+            desc->index_mask = reg_mask(index_reg);
+            while (scale > 1) {
+                desc->scale_shift++;
+                scale >>= 1;
+            }
+        }
+        desc->disp += XED_STATIC_CAST(xed_uint64_t,
+                           xed_decoded_inst_get_memory_displacement(xedd,0));
+    }
+
+    // 64b RIP-relative addressing ignores the segment, see xed_agen().
+    seg_reg  = xed_decoded_inst_get_seg_reg(xedd,memop_index);
+    if (seg_reg != XED_REG_INVALID &&
+        !(addr_width == 64 && base_reg == XED_REG_RIP))
+        desc->seg = XED_STATIC_CAST(xed_int8_t, seg_reg - XED_REG_SR_FIRST);
+
+    if (addr_width == 64) {
+        if (base_reg == XED_REG_RIP && xed3_operand_get_asz(xedd))
+            desc->addr_mask = (1ULL<<32)-1; // 67 prefix
+        else
+            desc->addr_mask = ~0ULL;
+    }
+    else if (addr_width == 32)
+        desc->addr_mask = (1ULL<<32)-1;
+    else {
+        // xed_agen() wraps the sum to 16b before the 20b real mode mask
+        desc->addr_mask = 0xFFFF;
+        if (real_mode)
+            desc->addr_mask &= 0x000FFFFF;
+    }
+    return XED_ERROR_NONE;
+}
+
+typedef void (*xed_agen_kernel_t)(const xed_agen_desc_t* d,
+                                  const xed_uint64_t* base,
+                                  const xed_uint64_t* index,
+                                  const xed_uint64_t* seg,
+                                  xed_uint32_t n,
+                                  xed_uint64_t* out);
+
+static void agen_eval_c(const xed_agen_desc_t* d,
+                        const xed_uint64_t* base,
+                        const xed_uint64_t* index,
+                        const xed_uint64_t* seg,
+                        xed_uint32_t n,
+                        xed_uint64_t* out)
+{
+    xed_uint32_t i;
+    for(i=0;i<n;i++) {
+        xed_uint64_t a = d->disp;
+        if (base)
+            a += base[i] & d->base_mask;
+        if (index)
+            a += (index[i] & d->index_mask) << d->scale_shift;
+        if (seg)
+            a += seg[i];
+        out[i] = a & d->addr_mask;
+    }
+}
+
+#if defined(XED_AGEN_SIMD)
+__attribute__((target("avx2")))
+static void agen_eval_avx2(const xed_agen_desc_t* d,
+                           const xed_uint64_t* base,
+                           const xed_uint64_t* index,
+                           const xed_uint64_t* seg,
+                           xed_uint32_t n,
+                           xed_uint64_t* out)
+{
+    const __m256i disp  = _mm256_set1_epi64x(XED_STATIC_CAST(long long,d->disp));
+    const __m256i bmask = _mm256_set1_epi64x(XED_STATIC_CAST(long long,d->base_mask));
+    const __m256i imask = _mm256_set1_epi64x(XED_STATIC_CAST(long long,d->index_mask));
+    const __m256i amask = _mm256_set1_epi64x(XED_STATIC_CAST(long long,d->addr_mask));
+    const __m128i shift = _mm_cvtsi32_si128(d->scale_shift);
+    xed_uint32_t i = 0;
+
+    for( ; i+4 <= n; i += 4) {
+        __m256i a = disp;
+        if (base) {
+            __m256i b = _mm256_loadu_si256(XED_CAST(const __m256i*, base+i));
+            a = _mm256_add_epi64(a, _mm256_and_si256(b, bmask));
+        }
+        if (index) {
+            __m256i x = _mm256_loadu_si256(XED_CAST(const __m256i*, index+i));
+            x = _mm256_sll_epi64(_mm256_and_si256(x, imask), shift);
+            a = _mm256_add_epi64(a, x);
+        }
+        if (seg) {
+            __m256i s = _mm256_loadu_si256(XED_CAST(const __m256i*, seg+i));
+            a = _mm256_add_epi64(a, s);
+        }
+        _mm256_storeu_si256(XED_CAST(__m256i*, out+i),
+                            _mm256_and_si256(a, amask));
+    }
+    if (i < n)
+        agen_eval_c(d, base ? base+i : 0, index ? index+i : 0,
+                    seg ? seg+i : 0, n-i, out+i);
+}
+
+__attribute__((target("avx512f")))
+static void agen_eval_avx512(const xed_agen_desc_t* d,
+                             const xed_uint64_t* base,
+                             const xed_uint64_t* index,
+                             const xed_uint64_t* seg,
+                             xed_uint32_t n,
+                             xed_uint64_t* out)
+{
+    const __m512i disp  = _mm512_set1_epi64(XED_STATIC_CAST(long long,d->disp));
+    const __m512i bmask = _mm512_set1_epi64(XED_STATIC_CAST(long long,d->base_mask));
+    const __m512i imask = _mm512_set1_epi64(XED_STATIC_CAST(long long,d->index_mask));
+    const __m512i amask = _mm512_set1_epi64(XED_STATIC_CAST(long long,d->addr_mask));
+    const __m128i shift = _mm_cvtsi32_si128(d->scale_shift);
+    xed_uint32_t i;
+
+    for(i=0; i < n; i += 8) {
+        // the last group of fewer than 8 states uses masked loads/stores
+        __mmask8 m = 0xFF;
+        __m512i a = disp;
+        if (n-i < 8)
+            m = XED_STATIC_CAST(__mmask8, (1u << (n-i)) - 1);
+        if (base) {
+            __m512i b = _mm512_maskz_loadu_epi64(m, base+i);
+            a = _mm512_add_epi64(a, _mm512_and_si512(b, bmask));
+        }
+        if (index) {
+            __m512i x = _mm512_maskz_loadu_epi64(m, index+i);
+            x = _mm512_sll_epi64(_mm512_and_si512(x, imask), shift);
+            a = _mm512_add_epi64(a, x);
+        }
+        if (seg) {
+            __m512i s = _mm512_maskz_loadu_epi64(m, seg+i);
+            a = _mm512_add_epi64(a, s);
+        }
+        _mm512_mask_storeu_epi64(out+i, m, _mm512_and_si512(a, amask));
+    }
+}
+#endif
+
+xed_bool_t xed_agen_kernel_available(xed_agen_kernel_enum_t kernel) {
+    switch(kernel) {
+      case XED_AGEN_KERNEL_AUTO:
+      case XED_AGEN_KERNEL_C:
+        return 1;
+#if defined(XED_AGEN_SIMD)
+      case XED_AGEN_KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2") != 0;
+      case XED_AGEN_KERNEL_AVX512:
+        return __builtin_cpu_supports("avx512f") != 0;
+#endif
+      default:
+        return 0;
+    }
+}
+
+static xed_agen_kernel_t agen_kernel(xed_agen_kernel_enum_t kernel) {
+#if defined(XED_AGEN_SIMD)
+    if (kernel == XED_AGEN_KERNEL_AUTO) {
+        if (__builtin_cpu_supports("avx512f"))
+            return agen_eval_avx512;
+        if (__builtin_cpu_supports("avx2"))
+            return agen_eval_avx2;
+    }
+    else if (kernel == XED_AGEN_KERNEL_AVX512)
+        return agen_eval_avx512;
+    else if (kernel == XED_AGEN_KERNEL_AVX2)
+        return agen_eval_avx2;
+#endif
+    return agen_eval_c;
+}
+
+xed_error_enum_t xed_agen_desc_eval(const xed_agen_desc_t* desc,
+                                    const xed_agen_soa_t* states,
+                                    xed_uint32_t n,
+                                    xed_uint64_t* out_addresses)
+{
+    return xed_agen_desc_eval_kernel(desc, states, n, out_addresses,
+                                     XED_AGEN_KERNEL_AUTO);
+}
+
+xed_error_enum_t xed_agen_desc_eval_kernel(const xed_agen_desc_t* desc,
+                                           const xed_agen_soa_t* states,
+                                           xed_uint32_t n,
+                                           xed_uint64_t* out_addresses,
+                                           xed_agen_kernel_enum_t kernel)
+{
+    const xed_uint64_t* base = 0;
+    const xed_uint64_t* index = 0;
+    const xed_uint64_t* seg = 0;
+
+    if (desc == 0 || states == 0 || !xed_agen_kernel_available(kernel))
+        return XED_ERROR_GENERAL_ERROR;
+    if (out_addresses == 0)
+        return XED_ERROR_NO_OUTPUT_POINTER;
+    if (n == 0)
+        return XED_ERROR_NONE;
+
+    if (desc->rip_relative)
+        base = states->rip;
+    else if (desc->base >= 0)
+        base = states->gpr[desc->base];
+    if ((desc->rip_relative || desc->base >= 0) && base == 0)
+        return XED_ERROR_CALLBACK_PROBLEM;
+    if (desc->index >= 0) {
+        index = states->gpr[desc->index];
+        if (index == 0)
+            return XED_ERROR_CALLBACK_PROBLEM;
+    }
+    if (desc->seg >= 0)
+        seg = states->seg_base[desc->seg]; // zero column: flat, base 0
+
+    (*agen_kernel(kernel))(desc, base, index, seg, n, out_addresses);
+    return XED_ERROR_NONE;
+}
@@ -19,6 +19,8 @@ END_LEGAL */
 #include "xed-agen.h"
 #include "xed-decoded-inst-api.h"
 
+#include "xed-reg-class.h"
+
 static xed_register_callback_fn_t     register_callback = 0;
 static xed_segment_base_callback_fn_t segment_callback = 0;
 
@@ -28,10 +30,76 @@ void xed_agen_register_callback(xed_register_callback_fn_t register_fn,
     segment_callback = segment_fn;
 }
 
-xed_error_enum_t xed_agen(xed_decoded_inst_t* xedd,
-                          unsigned int memop_index,
-                          void* context,
-                          xed_uint64_t* out_address) {
+/* Where the agen core gets its register values: either a callback table
+   plus the user's context, or a register snapshot. Exactly one of cb and
+   snap is nonzero. Testing the pointer is a well-predicted branch; the
+   snapshot path makes no indirect calls at all. */
+typedef struct {
+    const xed_agen_callbacks_t* cb;
+    const xed_agen_snapshot_t* snap;
+    void* context;
+    xed_uint64_t rip;  // snapshot only: address of the current instruction
+} xed_agen_src_t;
+
+static XED_INLINE xed_uint64_t
+snapshot_reg(const xed_agen_src_t* src, xed_reg_enum_t reg, xed_bool_t* error)
+{
+    xed_reg_enum_t big;
+    xed_uint64_t v;
+    xed_uint32_t width;
+    
+    switch(reg) {
+      case XED_REG_RIP:
+      case XED_REG_EIP:
+      case XED_REG_IP:
+        return src->rip;
+      default:
+        break;
+    }
+    if (reg >= XED_REG_SR_FIRST && reg <= XED_REG_SR_LAST)
+        return src->snap->seg_base[reg - XED_REG_SR_FIRST];
+    
+    big = xed_get_largest_enclosing_register(reg);
+    if (big < XED_REG_GPR64_FIRST || big > XED_REG_GPR64_LAST) {
+        // vector index registers for gathers/scatters are not in the snapshot
+        *error = 1;
+        return 0;
+    }
+    v = src->snap->gpr[big - XED_REG_GPR64_FIRST];
+    width = xed_get_register_width_bits64(reg);
+    if (width < 64) // AL for XLAT, 16b and 32b bases
+        v &= (1ULL << width) - 1;
+    return v;
+}
+
+static XED_INLINE xed_uint64_t
+agen_reg(const xed_agen_src_t* src, xed_reg_enum_t reg, xed_bool_t* error)
+{
+    if (src->snap)
+        return snapshot_reg(src, reg, error);
+    return (*src->cb->register_fn)(reg, src->context, error);
+}
+
+static XED_INLINE xed_uint64_t
+agen_segment(const xed_agen_src_t* src, xed_reg_enum_t reg,
+             xed_bool_t real_mode, xed_bool_t* error)
+{
+    xed_uint64_t segment_base;
+    if (src->snap) // bases are stored directly, even in real mode
+        return src->snap->seg_base[reg - XED_REG_SR_FIRST];
+    if (real_mode) {
+        // selectors are values in real mode 
+        segment_base = (*src->cb->register_fn)(reg, src->context, error);
+        segment_base <<= 4;
+        return segment_base;
+    }
+    return (*src->cb->segment_fn)(reg, src->context, error); 
+}
+
+static xed_error_enum_t xed_agen_core(const xed_decoded_inst_t* xedd,
+                                      unsigned int memop_index,
+                                      const xed_agen_src_t* src,
+                                      xed_uint64_t* out_address) {
     xed_uint64_t out = 0;
     // Normal memops: BASE+INDEX*SCALE+DISPLACMENT
     xed_uint64_t base_value = 0;
@@ -39,7 +107,7 @@ xed_error_enum_t xed_agen(xed_decoded_inst_t* xedd,
     xed_uint64_t segment_base = 0;
     xed_uint64_t scale  = 0;
     xed_int64_t displacement = 0;
-    xed_operand_values_t* xedv =  0;
+    const xed_operand_values_t* xedv =  0;
     xed_uint32_t addr_width =  0;
     xed_uint32_t opnd_width =  0;
     xed_bool_t real_mode = 0;
@@ -48,17 +116,7 @@ xed_error_enum_t xed_agen(xed_decoded_inst_t* xedd,
     xed_reg_enum_t seg_reg = XED_REG_INVALID;
     xed_attribute_enum_t attr;
 
-    if (xedd == 0)
-        return XED_ERROR_GENERAL_ERROR;
-    if (memop_index != 0 &&  memop_index != 1)
-        return XED_ERROR_BAD_MEMOP_INDEX;
-    if (register_callback == 0) 
-        return XED_ERROR_NO_AGEN_CALL_BACK_REGISTERED;
-    if (segment_callback == 0) 
-        return XED_ERROR_NO_AGEN_CALL_BACK_REGISTERED;
-
-
-    xedv = xed_decoded_inst_operands(xedd);
+    xedv = xed_decoded_inst_operands_const(xedd);
 
     addr_width =  xed_operand_values_get_effective_address_width(xedv);
 
@@ -68,7 +126,7 @@ xed_error_enum_t xed_agen(xed_decoded_inst_t* xedd,
 
     base_reg = xed_decoded_inst_get_base_reg(xedd,memop_index);
     if (base_reg != XED_REG_INVALID)
-        base_value = (*register_callback)(base_reg, context, &error);
+        base_value = agen_reg(src, base_reg, &error);
     if (error)
         return XED_ERROR_CALLBACK_PROBLEM;
 
@@ -82,14 +140,7 @@ xed_error_enum_t xed_agen(xed_decoded_inst_t* xedd,
 
     seg_reg  = xed_decoded_inst_get_seg_reg(xedd,memop_index);
     if (seg_reg != XED_REG_INVALID) {
-        if (real_mode) {
-            // selectors are values in real mode 
-            segment_base = (*register_callback)(seg_reg, context, &error);
-            segment_base <<= 4;
-        }
-        else {
-            segment_base = (*segment_callback)(seg_reg, context, &error); 
-        }
+        segment_base = agen_segment(src, seg_reg, real_mode, &error);
         if (error)
             return XED_ERROR_CALLBACK_PROBLEM;
     }
@@ -98,7 +149,7 @@ xed_error_enum_t xed_agen(xed_decoded_inst_t* xedd,
         xed_reg_enum_t index_reg;
         index_reg = xed_decoded_inst_get_index_reg(xedd,memop_index);
         if (index_reg != XED_REG_INVALID) {
-            index_value = (*register_callback)(index_reg, context, &error);
+            index_value = agen_reg(src, index_reg, &error);
             if (error)
                 return XED_ERROR_CALLBACK_PROBLEM;
 
@@ -157,3 +208,84 @@ xed_error_enum_t xed_agen(xed_decoded_inst_t* xedd,
     return XED_ERROR_NONE;
 }
 
+xed_error_enum_t xed_agen_ctx(const xed_decoded_inst_t* xedd,
+                              unsigned int memop_index,
+                              const xed_agen_callbacks_t* callbacks,
+                              void* context,
+                              xed_uint64_t* out_address) {
+    xed_agen_src_t src;
+    if (xedd == 0)
+        return XED_ERROR_GENERAL_ERROR;
+    if (memop_index != 0 &&  memop_index != 1)
+        return XED_ERROR_BAD_MEMOP_INDEX;
+    if (callbacks == 0 || callbacks->register_fn == 0 ||
+        callbacks->segment_fn == 0) 
+        return XED_ERROR_NO_AGEN_CALL_BACK_REGISTERED;
+    src.cb = callbacks;
+    src.snap = 0;
+    src.context = context;
+    src.rip = 0;
+    return xed_agen_core(xedd, memop_index, &src, out_address);
+}
+
+xed_error_enum_t xed_agen(xed_decoded_inst_t* xedd,
+                          unsigned int memop_index,
+                          void* context,
+                          xed_uint64_t* out_address) {
+    xed_agen_callbacks_t callbacks;
+    callbacks.register_fn = register_callback;
+    callbacks.segment_fn = segment_callback;
+    return xed_agen_ctx(xedd, memop_index, &callbacks, context, out_address);
+}
+
+xed_error_enum_t xed_agen_snapshot(const xed_decoded_inst_t* xedd,
+                                   unsigned int memop_index,
+                                   const xed_agen_snapshot_t* snapshot,
+                                   xed_uint64_t* out_address) {
+    xed_agen_src_t src;
+    if (xedd == 0 || snapshot == 0)
+        return XED_ERROR_GENERAL_ERROR;
+    if (memop_index != 0 &&  memop_index != 1)
+        return XED_ERROR_BAD_MEMOP_INDEX;
+    src.cb = 0;
+    src.snap = snapshot;
+    src.context = 0;
+    src.rip = snapshot->rip;
+    return xed_agen_core(xedd, memop_index, &src, out_address);
+}
+
+xed_error_enum_t xed_agen_snapshot_block(const xed_decoded_inst_t* xedd,
+                                         xed_uint32_t ninst,
+                                         const xed_agen_snapshot_t* snapshot,
+                                         xed_uint64_t* out_addresses) {
+    xed_agen_src_t src;
+    xed_error_enum_t first_error = XED_ERROR_NONE;
+    xed_uint32_t i;
+    
+    if (ninst == 0)
+        return XED_ERROR_NONE;
+    if (xedd == 0 || snapshot == 0)
+        return XED_ERROR_GENERAL_ERROR;
+    if (out_addresses == 0)
+        return XED_ERROR_NO_OUTPUT_POINTER;
+    src.cb = 0;
+    src.snap = snapshot;
+    src.context = 0;
+    src.rip = snapshot->rip;
+
+    for(i=0;i<ninst;i++) {
+        const xed_decoded_inst_t* p = xedd + i;
+        xed_uint64_t* out = out_addresses + 2*i;
+        xed_uint_t memops = xed_decoded_inst_number_of_memory_operands(p);
+        xed_uint_t m;
+        
+        out[0] = out[1] = 0;
+        for(m=0;m<memops && m<2;m++) {
+            xed_error_enum_t err = xed_agen_core(p, m, &src, out+m);
+            if (err != XED_ERROR_NONE && first_error == XED_ERROR_NONE)
+                first_error = err;
+        }
+        src.rip += xed_decoded_inst_get_length(p);
+    }
+    return first_error;
+}
@@ -0,0 +1,142 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-dep-graph.c
+
+#include "xed-internal-header.h"
+#include "xed-dep-graph.h"
+#include "xed-decoded-inst-api.h"
+
+void
+xed_decoded_inst_get_dep_summary(const xed_decoded_inst_t* xedd,
+                                 xed_dep_summary_t* s)
+{
+    xed_reg_rw_t rw;
+    xed_uint_t i, nmem;
+
+    xed_decoded_inst_get_reg_rw(xedd, &rw);
+    s->use = rw.read;
+    xed_reg_set_union(&s->use, &rw.cond_write);
+    s->def = rw.write;
+    xed_reg_set_union(&s->def, &rw.cond_write);
+
+    s->mem = 0;
+    nmem = xed_decoded_inst_number_of_memory_operands(xedd);
+    for(i=0;i<nmem;i++) {
+        if (xed_decoded_inst_mem_read(xedd, i))
+            s->mem |= XED_DEP_MEM_READ;
+        if (xed_decoded_inst_mem_written(xedd, i))
+            s->mem |= XED_DEP_MEM_WRITE;
+    }
+}
+
+/* Returns reg_bit if a and b share a register other than the flags and
+   flags_bit if they share the flags register. */
+static XED_INLINE xed_uint32_t dep_bits(const xed_reg_set_t* a,
+                                        const xed_reg_set_t* b,
+                                        const xed_reg_set_t* flags,
+                                        xed_uint32_t reg_bit,
+                                        xed_uint32_t flags_bit)
+{
+    xed_uint_t i;
+    xed_uint32_t kinds = 0;
+    for(i=0;i<XED_REG_SET_WORDS;i++) {
+        xed_uint64_t x = a->w[i] & b->w[i];
+        if (x & flags->w[i])
+            kinds |= flags_bit;
+        if (x & ~flags->w[i])
+            kinds |= reg_bit;
+    }
+    return kinds;
+}
+
+xed_bool_t
+xed_dep_graph_build(const xed_dep_summary_t* s,
+                    xed_uint32_t ninst,
+                    xed_dep_graph_t* g)
+{
+    xed_reg_set_t flags;
+    xed_uint32_t i, j, k, ne = 0;
+
+    xed_reg_set_zero(&flags);
+    xed_reg_set_add(&flags, XED_REG_FLAGS);
+    xed_reg_set_add(&flags, XED_REG_EFLAGS);
+    xed_reg_set_add(&flags, XED_REG_RFLAGS);
+
+    for(j=0;j<ninst;j++) {
+        /* what j still looks for while walking backwards */
+        xed_reg_set_t raw = s[j].use;
+        xed_reg_set_t waw = s[j].def;
+        xed_reg_set_t war = s[j].def;
+        xed_bool_t mem_raw = (s[j].mem & XED_DEP_MEM_READ) != 0;
+        xed_bool_t mem_waw = (s[j].mem & XED_DEP_MEM_WRITE) != 0;
+        xed_bool_t mem_war = mem_waw;
+        xed_uint32_t row = ne;
+
+        g->first[j] = row;
+        for(i=j;i>0;i--) {
+            const xed_dep_summary_t* p = s + i - 1;
+            xed_uint32_t kinds;
+
+            kinds  = dep_bits(&raw, &p->def, &flags,
+                              XED_DEP_RAW_REG, XED_DEP_RAW_FLAGS);
+            kinds |= dep_bits(&waw, &p->def, &flags,
+                              XED_DEP_WAW_REG, XED_DEP_WAW_FLAGS);
+            kinds |= dep_bits(&war, &p->use, &flags,
+                              XED_DEP_WAR_REG, XED_DEP_WAR_FLAGS);
+            if (p->mem & XED_DEP_MEM_READ) {
+                if (mem_war)
+                    kinds |= XED_DEP_WAR_MEM;
+            }
+            if (p->mem & XED_DEP_MEM_WRITE) {
+                if (mem_raw)
+                    kinds |= XED_DEP_RAW_MEM;
+                if (mem_waw)
+                    kinds |= XED_DEP_WAW_MEM;
+                mem_raw = mem_waw = mem_war = 0;
+            }
+            /* anything p writes hides the earlier writers and readers */
+            xed_reg_set_subtract(&raw, &p->def);
+            xed_reg_set_subtract(&waw, &p->def);
+            xed_reg_set_subtract(&war, &p->def);
+
+            if (kinds) {
+                if (ne >= g->max_edges)
+                    return 0;
+                g->edges[ne].src = i - 1;
+                g->edges[ne].kinds = kinds;
+                ne++;
+            }
+            if (!mem_raw && !mem_waw && !mem_war &&
+                xed_reg_set_is_empty(&raw) &&
+                xed_reg_set_is_empty(&waw) &&
+                xed_reg_set_is_empty(&war))
+                break;
+        }
+
+        /* the walk found the sources nearest first; reverse the row */
+        for(i=row, k=ne; i+1<k; i++) {
+            xed_dep_edge_t t = g->edges[i];
+            k--;
+            g->edges[i] = g->edges[k];
+            g->edges[k] = t;
+        }
+    }
+    g->first[ninst] = ne;
+    g->nedges = ne;
+    return 1;
+}
@@ -29,6 +29,7 @@ END_LEGAL */
 #include "xed-util.h"
 #include "xed-util-private.h"
 #include "xed-format-options.h"
+#include "xed-formatter.h"
 #include "xed-reg-class.h"
 
 #include "xed-operand-ctype-enum.h"
@@ -223,16 +224,20 @@ static const char* instruction_suffix_att(const xed_decoded_inst_t* p) {
     return 0;
 }
 
-static xed_format_options_t xed_format_options = { 
-    1, /* symblic names with hex address */
-    0, /* xml_a */
-    0, /* xml_f flags */
-    0, /* omit scale */
-    0, /* no_sign_extend_signed_immediates */
-    1, /* writemask with curly brackets, omit k0 */
-    1, /* lowercase hexadecimal */
-    0, /* 0=allow negative memory displacements */
-};
+#define XED_DEFAULT_FORMAT_OPTIONS { \
+    1, /* symblic names with hex address */ \
+    0, /* xml_a */ \
+    0, /* xml_f flags */ \
+    0, /* omit scale */ \
+    0, /* no_sign_extend_signed_immediates */ \
+    1, /* writemask with curly brackets, omit k0 */ \
+    1, /* lowercase hexadecimal */ \
+    0, /* 0=allow negative memory displacements */ \
+}
+
+static const xed_format_options_t xed_default_format_options =
+    XED_DEFAULT_FORMAT_OPTIONS;
+static xed_format_options_t xed_format_options = XED_DEFAULT_FORMAT_OPTIONS;
 
 void xed_format_set_options(xed_format_options_t format_options) {
     xed_format_options = format_options;
@@ -1562,21 +1567,87 @@ xed_format_context(xed_syntax_enum_t syntax,
 }
 
 
+static xed_bool_t
+xed_decoded_inst_dump_xed_format_internal(xed_print_info_t* pi)
+{
+    return xed_decoded_inst_dump_xed_format(pi->p,
+                                            pi->buf,
+                                            pi->blen,
+                                            pi->runtime_address);
+}
+
+typedef xed_bool_t (*xed_printer_fn_t)(xed_print_info_t* pi);
+
+static xed_printer_fn_t xed_syntax_printer(xed_syntax_enum_t syntax)
+{
+    switch(syntax) {
+      case XED_SYNTAX_INTEL:
+        return xed_decoded_inst_dump_intel_format_internal;
+      case XED_SYNTAX_ATT:
+        return xed_decoded_inst_dump_att_format_internal;
+      case XED_SYNTAX_XED:
+        return xed_decoded_inst_dump_xed_format_internal;
+      default:
+        return 0;
+    }
+}
+
 // preferred interface (fewer parameters, most flexible)
 
 xed_bool_t xed_format_generic( xed_print_info_t* pi )
 {
+    xed_printer_fn_t printer;
     if (validate_print_info(pi))
         return 0;
 
-    if (pi->syntax == XED_SYNTAX_INTEL)
-        return xed_decoded_inst_dump_intel_format_internal(pi);
-    else if (pi->syntax == XED_SYNTAX_ATT)
-        return xed_decoded_inst_dump_att_format_internal(pi);
-    else if (pi->syntax == XED_SYNTAX_XED)
-        return xed_decoded_inst_dump_xed_format(pi->p,
-                                                pi->buf,
-                                                pi->blen,
-                                                pi->runtime_address);
+    printer = xed_syntax_printer(pi->syntax);
+    if (printer)
+        return (*printer)(pi);
     return 0;
 }
+
+
+xed_bool_t
+xed_formatter_init(xed_formatter_t* formatter,
+                   xed_syntax_enum_t syntax,
+                   const xed_format_options_t* format_options,
+                   xed_disassembly_callback_fn_t symbolic_callback)
+{
+    if (formatter == 0)
+        return 0;
+    formatter->syntax = syntax;
+    if (format_options)
+        formatter->format_options = *format_options;
+    else
+        formatter->format_options = xed_default_format_options;
+    formatter->disassembly_callback = symbolic_callback;
+    formatter->_printer = xed_syntax_printer(syntax);
+    return formatter->_printer != 0;
+}
+
+xed_bool_t
+xed_formatter_format(const xed_formatter_t* formatter,
+                     const xed_decoded_inst_t* xedd,
+                     char* out_buffer,
+                     int  buffer_len,
+                     xed_uint64_t runtime_instruction_address,
+                     void* context)
+{
+    xed_print_info_t pi;
+    if (formatter == 0 || formatter->_printer == 0)
+        return 0;
+    xed_init_print_info(&pi);
+    pi.p = xedd;
+    pi.blen = buffer_len;
+    pi.buf = out_buffer;
+    pi.context = context;
+    pi.disassembly_callback = formatter->disassembly_callback;
+    pi.runtime_address = runtime_instruction_address;
+    pi.syntax = formatter->syntax;
+    pi.format_options_valid = 1; // never read the process wide options
+    pi.format_options = formatter->format_options;
+    if (validate_print_info(&pi))
+        return 0;
+    pi.buf[0]=0; //allow use of strcat
+    return (*formatter->_printer)(&pi);
+}
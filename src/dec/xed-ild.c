@@ -79,15 +79,31 @@ static  XED_INLINE void clear_hint(xed_decoded_inst_t* d) {
 // Could use 2x the space and the 64b mode thing to pick the right table.
 // That would speed up 32b prefix decodes.
 
-#define XED_PREFIX_TABLE_SIZE 8
-static xed_uint32_t prefix_table[XED_PREFIX_TABLE_SIZE];  // 32B=256b 32*8=2^5*2^3
+/* Fails to compile when c is false. The constant tables below are
+   written out by position and depend on these sizes and values. */
+#define XED_ILD_CT_ASSERT(name, c) \
+    typedef char xed_ild_ct_assert_##name[(c) ? 1 : -1]
 
-static void set_prefix_table_bit(xed_uint8_t a)
-{
-    xed_uint32_t x = a >> 5;
-    xed_uint32_t y = a & 0x1F;
-    prefix_table[x] |= (1<<y);
-}
+XED_ILD_CT_ASSERT(grammar_mode_16, XED_GRAMMAR_MODE_16 == 0);
+XED_ILD_CT_ASSERT(grammar_mode_32, XED_GRAMMAR_MODE_32 == 1);
+XED_ILD_CT_ASSERT(grammar_mode_64, XED_GRAMMAR_MODE_64 == 2);
+
+#define XED_PREFIX_TABLE_SIZE 8
+// 32B=256b 32*8=2^5*2^3. Byte a is bit (a&0x1F) of word (a>>5).
+static const xed_uint32_t prefix_table[XED_PREFIX_TABLE_SIZE] = {
+    0x00000000,
+    0x40404040, // 0x26, 0x2E, 0x36, 0x3E segment prefixes
+    0x0000FFFF, // 0x40-0x4F the 16 REX prefixes, even for 32b mode
+    0x000000F0, // 0x64, 0x65 segment prefixes, 0x66 osz, 0x67 asz
+    0x00000000,
+    0x00000000,
+    0x00000000,
+    0x000D0000  // 0xF0 lock, 0xF2/0xF3 rep/repne
+};
+// one bit for each of the 256 byte values
+XED_ILD_CT_ASSERT(prefix_table_size,
+                  sizeof(prefix_table) == XED_PREFIX_TABLE_SIZE * 4 &&
+                  XED_PREFIX_TABLE_SIZE * 32 == 256);
 
 static XED_INLINE xed_uint_t get_prefix_table_bit(xed_uint8_t a)
 {
@@ -97,34 +113,6 @@ static XED_INLINE xed_uint_t get_prefix_table_bit(xed_uint8_t a)
     return (prefix_table[x] >> y ) & 1;
 }
 
-static void init_prefix_table(void)
-{
-    xed_uint_t i;
-    static xed_uint8_t legacy_prefixes[] = {
-        0xF0, // lock
-        0x66, // osz
-        0x67, // asz
-        
-        0xF2, 0xF3, // rep/repne
-        
-        0x2E, 0x3E, // 6 segment prefixes
-        0x26, 0x36,
-        0x64, 0x65,
-        
-        0 // sentinel
-    };
-
-    for (i=0;i<XED_PREFIX_TABLE_SIZE;i++)
-        prefix_table[i]=0;
-    
-    for (i=0;legacy_prefixes[i];i++)
-        set_prefix_table_bit(legacy_prefixes[i]);
-
-    // add the 16 values of the REX prefixes even for 32b mode
-    for(i=0x40;i<0x50;i++)
-        set_prefix_table_bit(XED_CAST(xed_uint8_t,i));
-}
-
 #if defined(XED_SUPPORTS_AVX512)
 static void XED_NOINLINE bad_v4(xed_decoded_inst_t* d)
 {
@@ -667,79 +655,55 @@ static void get_next_as_opcode(xed_decoded_inst_t* d) {
 }
 
 
-// has_disp_regular[eamode][modrm.mod][modrm.rm]
-static xed_uint8_t has_disp_regular[3][4][8];
-
-static void init_has_disp_regular_table(void) {
-    xed_uint8_t eamode;
-    xed_uint8_t rm;
-    xed_uint8_t mod;
-
-    for (eamode = 0; eamode <3; eamode++)
-        for (mod=0; mod < 4; mod++)
-            for (rm=0; rm<8; rm++)
-                has_disp_regular[eamode][mod][rm] = 0;
-    
-    //fill the eamode16
-    has_disp_regular[0][0][6] = 2;
-    for (rm = 0; rm < 8; rm++) {
-        for (mod = 1; mod <= 2; mod++)
-            has_disp_regular[0][mod][rm] = mod;
-    }
-
-    //fill eamode32/64
-    for(eamode = 1; eamode <= 2; eamode++) {
-        for (rm = 0; rm < 8; rm++) {
-            has_disp_regular[eamode][1][rm] = 1;
-            has_disp_regular[eamode][2][rm] = 4;
-        };
-        has_disp_regular[eamode][0][5] = 4;
-
-    }
-}
+// has_disp_regular[eamode][modrm.mod][modrm.rm], in bytes
+static const xed_uint8_t has_disp_regular[3][4][8] = {
+    { // eamode16: disp16 for mod=0,rm=6
+        { 0, 0, 0, 0, 0, 0, 2, 0 },
+        { 1, 1, 1, 1, 1, 1, 1, 1 },
+        { 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 0, 0, 0, 0 } },
+    { // eamode32: disp32 for mod=0,rm=5
+        { 0, 0, 0, 0, 0, 4, 0, 0 },
+        { 1, 1, 1, 1, 1, 1, 1, 1 },
+        { 4, 4, 4, 4, 4, 4, 4, 4 },
+        { 0, 0, 0, 0, 0, 0, 0, 0 } },
+    { // eamode64: same as eamode32
+        { 0, 0, 0, 0, 0, 4, 0, 0 },
+        { 1, 1, 1, 1, 1, 1, 1, 1 },
+        { 4, 4, 4, 4, 4, 4, 4, 4 },
+        { 0, 0, 0, 0, 0, 0, 0, 0 } }
+};
+XED_ILD_CT_ASSERT(has_disp_regular_modes,
+                  sizeof(has_disp_regular) / sizeof(has_disp_regular[0]) ==
+                  XED_GRAMMAR_MODE_64 + 1);
 
 // eamode_table[asz][mmode]
-static xed_uint8_t eamode_table[2][XED_GRAMMAR_MODE_64+1];
-
-static void init_eamode_table(void) {
-    xed_uint8_t mode;
-    xed_uint8_t asz;
-
-    for (asz=0; asz<2; asz++)
-        for (mode=0; mode<XED_GRAMMAR_MODE_64+1; mode++)
-            eamode_table[asz][mode] = 0;
-    
-
-    for (mode = XED_GRAMMAR_MODE_16; mode <= XED_GRAMMAR_MODE_64; mode ++) {
-        eamode_table[0][mode] = mode;
-    }
-
-    eamode_table[1][XED_GRAMMAR_MODE_16] = XED_GRAMMAR_MODE_32;
-    eamode_table[1][XED_GRAMMAR_MODE_32] = XED_GRAMMAR_MODE_16;
-    eamode_table[1][XED_GRAMMAR_MODE_64] = XED_GRAMMAR_MODE_32;
-}
-
+static const xed_uint8_t eamode_table[2][XED_GRAMMAR_MODE_64+1] = {
+    // no 67 prefix: the machine mode
+    { XED_GRAMMAR_MODE_16, XED_GRAMMAR_MODE_32, XED_GRAMMAR_MODE_64 },
+    // 67 prefix
+    { XED_GRAMMAR_MODE_32, XED_GRAMMAR_MODE_16, XED_GRAMMAR_MODE_32 }
+};
 
 // has_sib_table[eamode][modrm.mod][modrm.rm]
-static xed_uint8_t has_sib_table[3][4][8];
-
-static void init_has_sib_table(void) {
-    xed_uint8_t eamode;
-    xed_uint8_t mod;
-    xed_uint8_t rm;
-    
-    for (eamode = 0; eamode <3; eamode++)
-        for (mod=0; mod < 4; mod++)
-            for (rm=0; rm<8; rm++)
-                has_sib_table[eamode][mod][rm] = 0;
-
-    //for eamode32/64 there is sib byte for mod!=3 and rm==4
-    for(eamode = 1; eamode <= 2; eamode++) {
-        for (mod = 0; mod <= 2; mod++) {
-            has_sib_table[eamode][mod][4] = 1;
-        }
-    }
-}
+// for eamode32/64 there is sib byte for mod!=3 and rm==4
+static const xed_uint8_t has_sib_table[3][4][8] = {
+    { { 0, 0, 0, 0, 0, 0, 0, 0 },
+      { 0, 0, 0, 0, 0, 0, 0, 0 },
+      { 0, 0, 0, 0, 0, 0, 0, 0 },
+      { 0, 0, 0, 0, 0, 0, 0, 0 } },
+    { { 0, 0, 0, 0, 1, 0, 0, 0 },
+      { 0, 0, 0, 0, 1, 0, 0, 0 },
+      { 0, 0, 0, 0, 1, 0, 0, 0 },
+      { 0, 0, 0, 0, 0, 0, 0, 0 } },
+    { { 0, 0, 0, 0, 1, 0, 0, 0 },
+      { 0, 0, 0, 0, 1, 0, 0, 0 },
+      { 0, 0, 0, 0, 1, 0, 0, 0 },
+      { 0, 0, 0, 0, 0, 0, 0, 0 } }
+};
+XED_ILD_CT_ASSERT(has_sib_table_modes,
+                  sizeof(has_sib_table) / sizeof(has_sib_table[0]) ==
+                  XED_GRAMMAR_MODE_64 + 1);
 
 
 #if defined(XED_SUPPORTS_AVX512)
@@ -1529,15 +1493,11 @@ void xed_ild_lookup_init(void) {
     xed_ild_imm_l3_init();
     xed_ild_disp_l3_init();
 
-    init_has_disp_regular_table();
-    init_eamode_table();
-    init_has_sib_table();
 
 }
 
 
 void xed_ild_init(void) {
-    init_prefix_table();
     xed_ild_lookup_init();
     xed_init_chip_model_info();
 #if defined(XED_EXTENSION_XOP_DEFINED) 
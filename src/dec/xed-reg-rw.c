@@ -0,0 +1,192 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-reg-rw.c
+
+#include "xed-internal-header.h"
+#include "xed-reg-rw.h"
+#include "xed-decoded-inst-api.h"
+#include "xed-operand-accessors.h"
+#include "xed-reg-class.h"
+#include "xed-flags.h"
+
+/* Per-instruction state for filling in the sets */
+typedef struct {
+    xed_reg_rw_t* rw;
+    xed_bool_t mode64;
+    xed_bool_t zero_upper_vec; /* VEX or EVEX encoded */
+    xed_bool_t zero_upper_gpr; /* APX ZU */
+} reg_rw_ctx_t;
+
+/* OF SF ZF AF PF CF */
+#define XED_REG_RW_STATUS_FLAGS 0x8D5
+
+static XED_INLINE xed_reg_enum_t reg_rw_full(const reg_rw_ctx_t* c,
+                                             xed_reg_enum_t r)
+{
+    if (c->mode64)
+        return xed_get_largest_enclosing_register(r);
+    return xed_get_largest_enclosing_register32(r);
+}
+
+/* Returns 1 if writing r replaces all of its enclosing register full. */
+static xed_bool_t reg_rw_full_write(const reg_rw_ctx_t* c,
+                                    xed_reg_enum_t r,
+                                    xed_reg_enum_t full)
+{
+    xed_reg_class_enum_t rc;
+    if (r == full)
+        return 1;
+    rc = xed_reg_class(r);
+    switch(rc) {
+      case XED_REG_CLASS_GPR:
+        if (c->zero_upper_gpr)
+            return 1;
+        return c->mode64 && xed_gpr_reg_class(r) == XED_REG_CLASS_GPR32;
+      case XED_REG_CLASS_XMM:
+      case XED_REG_CLASS_YMM:
+        return c->zero_upper_vec;
+      default:
+        break;
+    }
+    return xed_get_register_width_bits64(r) ==
+           xed_get_register_width_bits64(full);
+}
+
+static void reg_rw_add(reg_rw_ctx_t* c,
+                       xed_reg_enum_t r,
+                       xed_operand_action_enum_t action)
+{
+    xed_reg_enum_t full;
+    xed_bool_t read = 0, write = 0, cond_write = 0;
+    
+    if (r == XED_REG_INVALID || r >= XED_REG_LAST ||
+        r == XED_REG_STACKPUSH || r == XED_REG_STACKPOP)
+        return;
+    full = reg_rw_full(c, r);
+    if (full == XED_REG_INVALID)
+        full = r;
+
+    switch(action) {
+      case XED_OPERAND_ACTION_R:
+      case XED_OPERAND_ACTION_CR:
+        read = 1;
+        break;
+      case XED_OPERAND_ACTION_W:
+        write = 1;
+        break;
+      case XED_OPERAND_ACTION_RW:
+      case XED_OPERAND_ACTION_CRW:
+        read = write = 1;
+        break;
+      case XED_OPERAND_ACTION_CW:
+        cond_write = 1;
+        break;
+      case XED_OPERAND_ACTION_RCW:
+        read = cond_write = 1;
+        break;
+      default:
+        break;
+    }
+    if (write && !reg_rw_full_write(c, r, full)) {
+        write = 0;
+        cond_write = 1;
+    }
+    if (read)
+        xed_reg_set_add(&c->rw->read, full);
+    if (write)
+        xed_reg_set_add(&c->rw->write, full);
+    if (cond_write)
+        xed_reg_set_add(&c->rw->cond_write, full);
+}
+
+void
+xed_decoded_inst_get_reg_rw(const xed_decoded_inst_t* xedd,
+                            xed_reg_rw_t* rw)
+{
+    const xed_inst_t* xi = xed_decoded_inst_inst(xedd);
+    const xed_simple_flag_t* rfi;
+    xed_uint_t i, noperands;
+    reg_rw_ctx_t c;
+    xed_reg_enum_t flags_reg;
+
+    xed_reg_set_zero(&rw->read);
+    xed_reg_set_zero(&rw->write);
+    xed_reg_set_zero(&rw->cond_write);
+    if (!xi)
+        return;
+
+    c.rw = rw;
+    c.mode64 = xed3_operand_get_mode(xedd) == 2;
+    c.zero_upper_vec = xed3_operand_get_vexvalid(xedd) != 0;
+    c.zero_upper_gpr = xed_decoded_inst_is_apx_zu(xedd);
+
+    noperands = xed_inst_noperands(xi);
+    for(i=0;i<noperands;i++) {
+        const xed_operand_t* op = xed_inst_operand(xi, i);
+        xed_operand_enum_t name = xed_operand_name(op);
+        xed_operand_action_enum_t action;
+
+        switch(name) {
+          case XED_OPERAND_AGEN:
+            reg_rw_add(&c, xed3_operand_get_base0(xedd), XED_OPERAND_ACTION_R);
+            reg_rw_add(&c, xed3_operand_get_index(xedd), XED_OPERAND_ACTION_R);
+            break;
+          case XED_OPERAND_MEM0:
+            reg_rw_add(&c, xed3_operand_get_base0(xedd), XED_OPERAND_ACTION_R);
+            reg_rw_add(&c, xed3_operand_get_index(xedd), XED_OPERAND_ACTION_R);
+            reg_rw_add(&c, xed3_operand_get_seg0(xedd), XED_OPERAND_ACTION_R);
+            break;
+          case XED_OPERAND_MEM1:
+            reg_rw_add(&c, xed3_operand_get_base1(xedd), XED_OPERAND_ACTION_R);
+            reg_rw_add(&c, xed3_operand_get_seg1(xedd), XED_OPERAND_ACTION_R);
+            break;
+          default:
+            if (xed_operand_is_register(name) ||
+                xed_operand_is_memory_addressing_register(name))
+            {
+                /* the operand action accounts for AVX512 merging */
+                action = xed_decoded_inst_operand_action(xedd, i);
+                reg_rw_add(&c, xed_decoded_inst_get_reg(xedd, name), action);
+            }
+            break;
+        }
+    }
+
+    /* The flags operand only says that some flag is read or written. The
+     * flags info says which flags are written and whether always. */
+    rfi = xed_decoded_inst_get_rflags_info(xedd);
+    if (rfi) {
+        xed_uint32_t written =
+            xed_simple_flag_get_written_flag_set(rfi)->flat |
+            xed_simple_flag_get_undefined_flag_set(rfi)->flat;
+        flags_reg = c.mode64 ? XED_REG_RFLAGS : XED_REG_EFLAGS;
+        xed_reg_set_remove(&rw->read, flags_reg);
+        xed_reg_set_remove(&rw->write, flags_reg);
+        xed_reg_set_remove(&rw->cond_write, flags_reg);
+        if (xed_simple_flag_reads_flags(rfi))
+            xed_reg_set_add(&rw->read, flags_reg);
+        if (written) {
+            if (xed_simple_flag_get_must_write(rfi) &&
+                !xed_simple_flag_get_may_write(rfi) &&
+                (written & XED_REG_RW_STATUS_FLAGS) == XED_REG_RW_STATUS_FLAGS)
+                xed_reg_set_add(&rw->write, flags_reg);
+            else
+                xed_reg_set_add(&rw->cond_write, flags_reg);
+        }
+    }
+}
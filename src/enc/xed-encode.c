@@ -433,6 +433,155 @@ xed_encode_nop(xed_uint8_t* array,
 }
 
 
+/* NOP bodies for xed_fill_nops(), indexed by length. Zero-length rows are
+ * not available as a body and must be formed by adding 0x66 prefixes to
+ * a shorter body. The 16b addressing forms avoid the SIB byte, which
+ * does not exist with 16b addressing. */
+#define XED_MAX_NOP_BODY 8
+static const xed_uint8_t xed_nop_body_len_a32[XED_MAX_NOP_BODY+1] = {
+    0, 1, 0, 3, 4, 5, 0, 7, 8 };
+static const xed_uint8_t xed_nop_body_a32[XED_MAX_NOP_BODY+1][XED_MAX_NOP_BODY] = {
+    /*0B*/  { 0 },
+    /*1B*/  { 0x90 },
+    /*2B*/  { 0 },
+    /*3B*/  { 0x0F, 0x1F, 0x00},                           /* [eax]        */
+    /*4B*/  { 0x0F, 0x1F, 0x40, 0x00},                     /* [eax+d8]     */
+    /*5B*/  { 0x0F, 0x1F, 0x44, 0x00, 0x00},               /* [eax+eax+d8] */
+    /*6B*/  { 0 },
+    /*7B*/  { 0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00},   /* [eax+d32]    */
+    /*8B*/  { 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+};
+static const xed_uint8_t xed_nop_body_len_a16[XED_MAX_NOP_BODY+1] = {
+    0, 1, 0, 3, 4, 5, 0, 0, 0 };
+static const xed_uint8_t xed_nop_body_a16[XED_MAX_NOP_BODY+1][XED_MAX_NOP_BODY] = {
+    /*0B*/  { 0 },
+    /*1B*/  { 0x90 },
+    /*2B*/  { 0 },
+    /*3B*/  { 0x0F, 0x1F, 0x00},                           /* [bx+si]      */
+    /*4B*/  { 0x0F, 0x1F, 0x40, 0x00},                     /* [bx+si+d8]   */
+    /*5B*/  { 0x0F, 0x1F, 0x80, 0x00, 0x00},               /* [bx+si+d16]  */
+    /*6B*/  { 0 },
+    /*7B*/  { 0 },
+    /*8B*/  { 0 },
+};
+
+typedef struct {
+    const xed_uint8_t* body_len;
+    const xed_uint8_t (*body)[XED_MAX_NOP_BODY];
+    xed_uint_t max_prefixes;
+    xed_uint_t max_length;
+} xed_nop_filler_t;
+
+/* Return the prefix count to use for a NOP of exactly len bytes and set
+ * *body_len, or return -1 if the policy does not allow that length. The
+ * longest body is preferred so that the fewest prefixes are used. */
+static xed_int_t xed_nop_split(const xed_nop_filler_t* f,
+                               xed_uint_t len,
+                               xed_uint_t* body_len)
+{
+    xed_uint_t b = len < XED_MAX_NOP_BODY ? len : XED_MAX_NOP_BODY;
+    if (len > f->max_length)
+        return -1;
+    for( ; b >= 1 ; b--) {
+        if (f->body_len[b] && len - b <= f->max_prefixes) {
+            *body_len = b;
+            return XED_STATIC_CAST(xed_int_t, len - b);
+        }
+        if (len - b >= f->max_prefixes)
+            break;
+    }
+    return -1;
+}
+
+static void xed_nop_emit(const xed_nop_filler_t* f,
+                         xed_uint8_t* array,
+                         xed_uint_t prefixes,
+                         xed_uint_t body_len)
+{
+    memset(array, 0x66, prefixes);
+    memcpy(array + prefixes, f->body[body_len], body_len);
+}
+
+XED_DLL_EXPORT xed_error_enum_t
+xed_fill_nops(xed_uint8_t* array,
+              const unsigned int ilen,
+              xed_machine_mode_enum_t mmode,
+              xed_nop_policy_t policy)
+{
+    xed_nop_filler_t f;
+    xed_uint_t len, body_len=0, longest=0, full, done, tail, m;
+    xed_int_t prefixes;
+    /* count[n] is the fewest NOPs that fill n bytes and pick[n] the
+       length of the first of them */
+    xed_uint8_t count[2*XED_MAX_INSTRUCTION_BYTES];
+    xed_uint8_t pick[2*XED_MAX_INSTRUCTION_BYTES];
+
+    if (mmode == XED_MACHINE_MODE_LEGACY_16 ||
+        mmode == XED_MACHINE_MODE_LONG_COMPAT_16 ||
+        mmode == XED_MACHINE_MODE_REAL_16) {
+        f.body_len = xed_nop_body_len_a16;
+        f.body = xed_nop_body_a16;
+    }
+    else {
+        f.body_len = xed_nop_body_len_a32;
+        f.body = xed_nop_body_a32;
+    }
+    f.max_prefixes = policy.max_prefixes;
+    f.max_length = policy.max_length < XED_MAX_INSTRUCTION_BYTES ?
+                   policy.max_length : XED_MAX_INSTRUCTION_BYTES;
+
+    for(len=f.max_length; len >= 1 ; len--) {
+        if (xed_nop_split(&f, len, &body_len) >= 0) {
+            longest = len;
+            break;
+        }
+    }
+    if (longest == 0)
+        return XED_ERROR_GENERAL_ERROR;
+
+    /* All but the last one or two NOP lengths of the region are copies of
+       the longest NOP. The tail is split into the fewest NOPs the policy
+       allows, which can be fewer than a longest NOP plus a greedy
+       remainder when some lengths are not available. */
+    tail = ilen < longest ? ilen : longest + ilen % longest;
+    full = ilen - tail;
+
+    /* Emit one copy of the longest NOP and replicate it by doubling the
+       filled prefix of the region. */
+    if (full) {
+        prefixes = xed_nop_split(&f, longest, &body_len);
+        xed_nop_emit(&f, array, XED_STATIC_CAST(xed_uint_t,prefixes), body_len);
+        done = longest;
+        while (2 * done <= full) {
+            memcpy(array + done, array, done);
+            done = 2 * done;
+        }
+        if (done < full)
+            memcpy(array + done, array, full - done);
+    }
+
+    /* The 1B NOP is always available so every tail length is reached.
+       Longer first NOPs win ties. */
+    count[0] = 0;
+    for(len=1; len <= tail; len++) {
+        count[len] = 0xFF;
+        for(m = len < longest ? len : longest; m >= 1; m--)
+            if (count[len-m] + 1 < count[len] &&
+                xed_nop_split(&f, m, &body_len) >= 0) {
+                count[len] = XED_STATIC_CAST(xed_uint8_t, count[len-m] + 1);
+                pick[len] = XED_STATIC_CAST(xed_uint8_t, m);
+            }
+    }
+    array += full;
+    for(len=tail; len; len -= pick[len]) {
+        prefixes = xed_nop_split(&f, pick[len], &body_len);
+        xed_nop_emit(&f, array, XED_STATIC_CAST(xed_uint_t,prefixes), body_len);
+        array += pick[len];
+    }
+    return XED_ERROR_NONE;
+}
+
+
 #if defined(XED_AVX) || defined(XED_SUPPORTS_AVX512)        
 static void set_vl(xed_reg_enum_t reg, xed_uint_t* vl)
 {
@@ -21,95 +21,142 @@ END_LEGAL */
 #include "xed-reg-class-enum.h"
 #include "xed-reg-class.h"
 #include "xed-operand-accessors.h"
+#include <string.h>  // memset
 
-/// convert a #xed_encoder_instruction_t to a #xed_encoder_request_t for encoding
-xed_bool_t xed_convert_to_encoder_request(xed_encoder_request_t* out,
-                                          xed_encoder_instruction_t* in) {
+/* The conversion below is on the per-instruction path of users that
+ * generate code with the xed_inst*() functions, so it writes the operand
+ * storage with the inline xed3 accessors rather than going through the
+ * exported xed_encoder_request_set_*() functions one field at a time. */
+
+static XED_INLINE void set_reg(xed_encoder_request_t* out,
+                               xed_uint_t regs,
+                               xed_reg_enum_t reg)
+{
+    /* regs < XED_ENCODER_OPERANDS_MAX so REG0...REG7 suffice */
+    switch(regs) {
+      case 0: xed3_operand_set_reg0(out, reg); break;
+      case 1: xed3_operand_set_reg1(out, reg); break;
+      case 2: xed3_operand_set_reg2(out, reg); break;
+      case 3: xed3_operand_set_reg3(out, reg); break;
+      case 4: xed3_operand_set_reg4(out, reg); break;
+      case 5: xed3_operand_set_reg5(out, reg); break;
+      case 6: xed3_operand_set_reg6(out, reg); break;
+      default: xed3_operand_set_reg7(out, reg); break;
+    }
+}
+
+static XED_INLINE void set_easz(xed_encoder_request_t* out,
+                                xed_uint_t width_bits)
+{
+    switch(width_bits) {
+      case 16: xed3_operand_set_easz(out, 1); break;
+      case 32: xed3_operand_set_easz(out, 2); break;
+      case 64: xed3_operand_set_easz(out, 3); break;
+      default: break;
+    }
+}
+
+static XED_INLINE void set_eosz(xed_encoder_request_t* out,
+                                xed_uint_t width_bits)
+{
+    switch(width_bits) {
+      case 8:  xed3_operand_set_eosz(out, 0); break;
+      case 16: xed3_operand_set_eosz(out, 1); break;
+      case 32: xed3_operand_set_eosz(out, 2); break;
+      case 64: xed3_operand_set_eosz(out, 3); break;
+      default: break;
+    }
+}
 
+static xed_bool_t fill_encoder_request(xed_encoder_request_t* out,
+                                       const xed_encoder_instruction_t* in)
+{
     /* this is basically what the encoder language example code does but in
      * a more uniform way. */
     xed_uint_t real_operands =  0;
     xed_uint_t i=0;
     xed_uint_t memops = 0;
     xed_uint_t regs = 0;
-    xed_encoder_request_zero_set_mode(out, &(in->mode));
-    xed_encoder_request_set_iclass(out, in->iclass );
+
+    /* The encoder only reads the operand storage and the operand order.
+     * Everything else in the request is set up by xed_encode(). */
+    memset(&out->_operands, 0, sizeof(out->_operands));
+    out->_decoded_length = 0;
+    out->_inst = 0;
+    xed_operand_values_set_mode(out, &(in->mode));
+    xed3_operand_set_iclass(out, in->iclass);
     if (in->effective_operand_width)
-        xed_encoder_request_set_effective_operand_width(out, in->effective_operand_width);
+        set_eosz(out, in->effective_operand_width);
     if (in->effective_address_width)
-        xed_encoder_request_set_effective_address_size(out, in->effective_address_width);
-
+        set_easz(out, in->effective_address_width);
 
     for(; i< in->noperands ; i++ ) {
-        xed_encoder_operand_t* op = in->operands + i;
+        const xed_encoder_operand_t* op = in->operands + i;
+        xed_operand_enum_t name = XED_OPERAND_INVALID;
         switch(op->type) {
           case XED_ENCODER_OPERAND_TYPE_PTR: 
-            xed_encoder_request_set_branch_displacement(out,
-                                                        op->u.brdisp,
-                                                        op->width_bits/8); //FIXME: bits interface
-            xed_encoder_request_set_operand_order(out, real_operands, XED_OPERAND_PTR);
-            xed_encoder_request_set_ptr(out);
-            real_operands++;
-            break;
-
           case XED_ENCODER_OPERAND_TYPE_REL_BRDISP:
-            xed_encoder_request_set_branch_displacement(out,
-                                                        op->u.brdisp,
-                                                        op->width_bits/8); //FIXME: bits interface
-            xed_encoder_request_set_operand_order(out, real_operands, XED_OPERAND_RELBR);
-            xed_encoder_request_set_relbr(out);
-            real_operands++;
-            break;
-          
           case XED_ENCODER_OPERAND_TYPE_ABS_BRDISP:
-            xed_encoder_request_set_branch_displacement(out,
-                                                        op->u.brdisp,
-                                                        op->width_bits/8); //FIXME: bits interface
-            xed_encoder_request_set_operand_order(out, real_operands, XED_OPERAND_ABSBR);
-            xed_encoder_request_set_absbr(out);
-            real_operands++;
+            if (op->width_bits >= 8) {
+                xed3_operand_set_disp(out, op->u.brdisp);
+                xed3_operand_set_brdisp_width(out,
+                      XED_STATIC_CAST(xed_uint8_t,op->width_bits & ~7));
+            }
+            if (op->type == XED_ENCODER_OPERAND_TYPE_PTR) {
+                xed3_operand_set_ptr(out, 1);
+                name = XED_OPERAND_PTR;
+            }
+            else if (op->type == XED_ENCODER_OPERAND_TYPE_REL_BRDISP) {
+                xed3_operand_set_relbr(out, 1);
+                name = XED_OPERAND_RELBR;
+            }
+            else {
+                xed3_operand_set_absbr(out, 1);
+                name = XED_OPERAND_ABSBR;
+            }
             break;
 
           case XED_ENCODER_OPERAND_TYPE_SEG0:
-            xed_encoder_request_set_seg0(out, op->u.reg);
+            xed3_operand_set_seg0(out, op->u.reg);
             break;
 
           case XED_ENCODER_OPERAND_TYPE_SEG1:
-            xed_encoder_request_set_seg1(out, op->u.reg);
+            xed3_operand_set_seg1(out, op->u.reg);
             break;
 
-          case XED_ENCODER_OPERAND_TYPE_REG: {
-              xed_operand_enum_t r = XED_STATIC_CAST(xed_operand_enum_t,XED_OPERAND_REG0 + regs);
-              xed_encoder_request_set_reg(out, r, op->u.reg);
-              xed_encoder_request_set_operand_order(out, real_operands, r);
-              real_operands++;
-              regs++;
-              break;
-          }
-
+          case XED_ENCODER_OPERAND_TYPE_REG:
+            if (regs >= XED_ENCODER_OPERANDS_MAX)
+                return 0;
+            set_reg(out, regs, op->u.reg);
+            name = XED_STATIC_CAST(xed_operand_enum_t,XED_OPERAND_REG0 + regs);
+            regs++;
+            break;
 
           case XED_ENCODER_OPERAND_TYPE_IMM0:
-
-            xed_encoder_request_set_uimm0_bits(out,
-                                               op->u.imm0,
-                                               op->width_bits);
-            xed_encoder_request_set_operand_order(out, real_operands , XED_OPERAND_IMM0);
-            real_operands++;
+            xed3_operand_set_uimm0(out, op->width_bits ? op->u.imm0 : 0);
+            xed3_operand_set_imm_width(out,
+                                XED_STATIC_CAST(xed_uint8_t,op->width_bits));
+            xed3_operand_set_imm0(out, 1);
+            name = XED_OPERAND_IMM0;
             break;
 
-          case XED_ENCODER_OPERAND_TYPE_SIMM0:
+          case XED_ENCODER_OPERAND_TYPE_SIMM0: {
             /* the max width of a signed immediate is 32b. */
-            xed_encoder_request_set_simm(out,
-                                         XED_STATIC_CAST(xed_int32_t,op->u.imm0),
-                                         op->width_bits/8); //FIXME: bits interface
-            xed_encoder_request_set_operand_order(out, real_operands , XED_OPERAND_IMM0);
-            real_operands++;
+            xed_int64_t simm = XED_STATIC_CAST(xed_int32_t,op->u.imm0);
+            xed_uint_t bits = op->width_bits & ~7;
+            xed3_operand_set_uimm0(out,
+                           bits ? XED_STATIC_CAST(xed_uint64_t,simm) : 0);
+            xed3_operand_set_imm_width(out, XED_STATIC_CAST(xed_uint8_t,bits));
+            xed3_operand_set_imm0signed(out, 1);
+            xed3_operand_set_imm0(out, 1);
+            name = XED_OPERAND_IMM0;
             break;
+          }
 
           case XED_ENCODER_OPERAND_TYPE_IMM1:
-            xed_encoder_request_set_uimm1(out, op->u.imm1);
-            xed_encoder_request_set_operand_order(out, real_operands, XED_OPERAND_IMM1);
-            real_operands++;
+            xed3_operand_set_imm1(out, 1);
+            xed3_operand_set_uimm1(out, op->u.imm1);
+            name = XED_OPERAND_IMM1;
             break;
 
           case XED_ENCODER_OPERAND_TYPE_OTHER:
@@ -124,42 +171,45 @@ xed_bool_t xed_convert_to_encoder_request(xed_encoder_request_t* out,
                 xed_reg_class_enum_t rc = xed_gpr_reg_class(op->u.mem.base);
                 xed_reg_class_enum_t rci = xed_gpr_reg_class(op->u.mem.index);
                 if (rc == XED_REG_CLASS_GPR32 || rci == XED_REG_CLASS_GPR32) 
-                    xed_encoder_request_set_effective_address_size(out, 32);
+                    xed3_operand_set_easz(out, 2);
                 if (rc == XED_REG_CLASS_GPR16 || rci == XED_REG_CLASS_GPR16) 
-                  xed_encoder_request_set_effective_address_size(out, 16);
+                    xed3_operand_set_easz(out, 1);
             }
             
             if (in->iclass == XED_ICLASS_LEA) {
-                xed_encoder_request_set_agen(out);
-                xed_encoder_request_set_operand_order(out, real_operands, XED_OPERAND_AGEN);
+                xed3_operand_set_agen(out, 1);
+                name = XED_OPERAND_AGEN;
             }
             else if (memops == 0) {
-                xed_encoder_request_set_mem0(out);
-                xed_encoder_request_set_operand_order(out, real_operands, XED_OPERAND_MEM0);
+                xed3_operand_set_mem0(out, 1);
+                name = XED_OPERAND_MEM0;
             }
             else {
-                xed_encoder_request_set_mem1(out);
-                xed_encoder_request_set_operand_order(out, real_operands, XED_OPERAND_MEM1);
+                xed3_operand_set_mem1(out, 1);
+                name = XED_OPERAND_MEM1;
             }
-            real_operands++;
 
             if (memops == 0) {
-                xed_encoder_request_set_base0(out, op->u.mem.base);
-                xed_encoder_request_set_index(out, op->u.mem.index);
-                xed_encoder_request_set_scale(out, op->u.mem.scale);
-                xed_encoder_request_set_seg0(out, op->u.mem.seg);
+                xed3_operand_set_base0(out, op->u.mem.base);
+                xed3_operand_set_index(out, op->u.mem.index);
+                xed3_operand_set_scale(out, op->u.mem.scale);
+                xed3_operand_set_seg0(out, op->u.mem.seg);
             }
             else {
-                xed_encoder_request_set_base1(out, op->u.mem.base);
-                xed_encoder_request_set_seg1(out, op->u.mem.seg);
+                xed3_operand_set_base1(out, op->u.mem.base);
+                xed3_operand_set_seg1(out, op->u.mem.seg);
             }
 
-            xed_encoder_request_set_memory_operand_length(out, op->width_bits>>3 ); // CVT TO BYTES --  FIXME make bits interface
+            // CVT TO BYTES --  FIXME make bits interface
+            xed3_operand_set_mem_width(out,
+                          XED_STATIC_CAST(xed_uint16_t,op->width_bits>>3));
 
-            if (op->u.mem.disp.displacement_bits)
-                xed_encoder_request_set_memory_displacement(out,
-                                                            op->u.mem.disp.displacement,
-                                                            op->u.mem.disp.displacement_bits/8); //FIXME: make bits interface
+            if (op->u.mem.disp.displacement_bits >= 8) {
+                xed3_operand_set_disp(out, op->u.mem.disp.displacement);
+                xed3_operand_set_disp_width(out,
+                   XED_STATIC_CAST(xed_uint8_t,
+                                   op->u.mem.disp.displacement_bits & ~7));
+            }
 
             memops++;
             break;
@@ -167,8 +217,68 @@ xed_bool_t xed_convert_to_encoder_request(xed_encoder_request_t* out,
           default:
             return 0;
         }
+
+        if (name != XED_OPERAND_INVALID) {
+            if (real_operands >= XED_ENCODE_ORDER_MAX_OPERANDS)
+                return 0;
+            out->_operand_order[real_operands++] = 
+                XED_STATIC_CAST(xed_uint8_t,name);
+        }
     }
+    out->_n_operand_order = XED_STATIC_CAST(xed_uint8_t,real_operands);
         
     return 1;
 }
 
+/// convert a #xed_encoder_instruction_t to a #xed_encoder_request_t for encoding
+xed_bool_t xed_convert_to_encoder_request(xed_encoder_request_t* out,
+                                          xed_encoder_instruction_t* in) {
+    return fill_encoder_request(out, in);
+}
+
+xed_error_enum_t xed_encode_instruction(const xed_encoder_instruction_t* in,
+                                        xed_uint8_t* array,
+                                        const unsigned int ilen,
+                                        unsigned int* olen)
+{
+    xed_encoder_request_t req;
+    if (!fill_encoder_request(&req, in))
+        return XED_ERROR_GENERAL_ERROR;
+    return xed_encode(&req, array, ilen, olen);
+}
+
+xed_error_enum_t xed_encode_instructions(const xed_encoder_instruction_t* in,
+                                         xed_uint_t ninst,
+                                         xed_uint8_t* array,
+                                         const unsigned int ilen,
+                                         unsigned int* olen,
+                                         xed_uint8_t* lengths,
+                                         xed_uint_t* nencoded)
+{
+    xed_encoder_request_t req;
+    xed_error_enum_t err = XED_ERROR_NONE;
+    unsigned int used = 0;
+    xed_uint_t i;
+
+    for(i=0;i<ninst;i++) {
+        unsigned int len = 0;
+        if (!fill_encoder_request(&req, in+i)) {
+            err = XED_ERROR_GENERAL_ERROR;
+            break;
+        }
+        if (used >= ilen) {
+            err = XED_ERROR_BUFFER_TOO_SHORT;
+            break;
+        }
+        err = xed_encode(&req, array + used, ilen - used, &len);
+        if (err != XED_ERROR_NONE)
+            break;
+        if (lengths)
+            lengths[i] = XED_STATIC_CAST(xed_uint8_t,len);
+        used += len;
+    }
+    *olen = used;
+    if (nencoded)
+        *nencoded = i;
+    return err;
+}
@@ -28,6 +28,7 @@ END_LEGAL */
 #include <string.h>
 #include <assert.h>
 #include "xed-histogram.h"
+#include "xed-enc2-bench.h"
 
 typedef xed_uint32_t (*test_func_t)(xed_uint8_t* output_buffer);
 #if defined(XED_ENC2_CONFIG_M64_A64)
@@ -203,6 +204,8 @@ int test_all(test_func_t* base, const char** str_table, const xed_iclass_enum_t*
 
 int main(int argc, char** argv) {
     int i=0, m=0, test_id=0, errors=0,specific_tests=0, enable_histogram=0;
+    int enable_bench=0;
+    xed_enc2_bench_options_t bench_opts;
 #if defined(XED_ENC2_CONFIG_M64_A64)
     test_func_t* base = test_functions_m64_a64;
     const char** str_table = test_functions_m64_a64_str;
@@ -225,6 +228,8 @@ int main(int argc, char** argv) {
     //dstate.stack_addr_width=XED_ADDRESS_WIDTH_16b;
     
     xed_histogram_initialize(&histo);
+    memset(&bench_opts, 0, sizeof(bench_opts));
+    bench_opts.tolerance = 10.0;
 
     // count tests
     test_func_t* p = base;
@@ -245,6 +250,24 @@ int main(int argc, char** argv) {
         else if (strcmp(argv[i],"--histo")==0) {
             enable_histogram = 1;
         }
+        else if (strcmp(argv[i],"--bench")==0) {
+            enable_bench = 1;
+        }
+        else if (strcmp(argv[i],"--save")==0) {
+            assert( i+1 < argc );
+            bench_opts.save_file = argv[i+1];
+            i = i + 1;
+        }
+        else if (strcmp(argv[i],"--baseline")==0) {
+            assert( i+1 < argc );
+            bench_opts.baseline_file = argv[i+1];
+            i = i + 1;
+        }
+        else if (strcmp(argv[i],"--tolerance")==0) {
+            assert( i+1 < argc );
+            bench_opts.tolerance = atof(argv[i+1]);
+            i = i + 1;
+        }
         else if (strcmp(argv[i],"--emit")==0) {
             enable_emit = 1;
         }
@@ -266,6 +289,8 @@ int main(int argc, char** argv) {
                   strcmp(argv[i],"--help")==0 )  {
             fprintf(stderr,"%s [-h|--help] [--histo] [--info] [--byte|--emit] [--main] [--gnuasm] [--reps N] [test_id ...]\n",
                     argv[0]);
+            fprintf(stderr,"%s --bench [--histo] [--reps N] [--save FILE] [--baseline FILE [--tolerance PCT]]\n",
+                    argv[0]);
             exit(0);
         }
         else {
@@ -288,6 +313,13 @@ int main(int argc, char** argv) {
         }
     }
 
+    if (enable_bench) {
+        // compare the xed_encode(), encoder-hl and enc2 encoding paths
+        bench_opts.reps = reps;
+        bench_opts.iform_histograms = enable_histogram;
+        errors = xed_enc2_bench(base, &dstate, &bench_opts);
+        return errors != 0;
+    }
     if (enable_emit_byte && enable_emit) {
         printf("Cannot specify --byte and --emit in the same run\n");
         exit(1);
@@ -0,0 +1,535 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-enc2-bench.c
+/// Encoder throughput comparison between xed_encode(), the
+/// high-level encoder and enc2.
+///
+/// Each enc2 test function is run once and its output decoded. The
+/// decoded instruction is then turned into an encoder request (for
+/// timing xed_encode() alone) and into a xed_encoder_instruction_t (for
+/// timing xed_encode_instruction()), so
+/// all three paths encode the same instructions. Results are grouped by
+/// the iform of the enc2 output.
+
+#include "xed-interface.h"
+#include "xed-get-time.h"
+#include "xed-enc2-bench.h"
+#include "xed-histogram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    BENCH_ENC2,
+    BENCH_ENCODE,
+    BENCH_ENC_HL,
+    BENCH_PATHS
+} bench_path_t;
+
+static const char* bench_path_names[BENCH_PATHS] = {
+    "enc2", "encode", "enc-hl"
+};
+
+typedef struct {
+    xed_uint32_t test_id;
+    xed_iform_enum_t iform;
+} bench_test_t;
+
+typedef struct {
+    xed_encoder_request_t req;     /* for xed_encode() */
+    xed_encoder_instruction_t hl;  /* for xed_encode_instruction() */
+    xed_bool_t ok[BENCH_PATHS];
+} bench_prep_t;
+
+typedef struct {
+    xed_uint32_t* v;
+    xed_uint32_t n;
+    xed_uint32_t cap;
+} bench_samples_t;
+
+typedef struct {
+    xed_uint32_t median[BENCH_PATHS]; /* 0 means no data */
+    xed_uint32_t p99[BENCH_PATHS];
+} bench_result_t;
+
+static xed_histogram_t bench_histo[BENCH_PATHS];
+static xed_uint64_t bench_unsupported[BENCH_PATHS];
+static xed_uint64_t bench_timed[BENCH_PATHS];
+
+static void bench_decode_init(xed_decoded_inst_t* xedd, xed_state_t* dstate)
+{
+    xed_decoded_inst_zero_set_mode(xedd, dstate);
+    xed3_operand_set_cet(xedd, 1);
+    xed3_operand_set_cldemote(xedd, 1);
+    xed3_operand_set_wbnoinvd(xedd, 1);
+}
+
+/* Decode buf and return its iclass, or XED_ICLASS_INVALID. */
+static xed_iclass_enum_t bench_iclass(xed_state_t* dstate,
+                                      const xed_uint8_t* buf,
+                                      xed_uint_t len)
+{
+    xed_decoded_inst_t xedd;
+    bench_decode_init(&xedd, dstate);
+    if (xed_decode(&xedd, buf, len) != XED_ERROR_NONE)
+        return XED_ICLASS_INVALID;
+    if (xed_decoded_inst_get_length(&xedd) != len)
+        return XED_ICLASS_INVALID;
+    return xed_decoded_inst_get_iclass(&xedd);
+}
+
+/* Append a non-operand encoder field, failing if ops is full. */
+static xed_bool_t bench_add_other(xed_encoder_operand_t* ops,
+                                  xed_uint_t* n,
+                                  xed_operand_enum_t name,
+                                  xed_int32_t value)
+{
+    if (*n >= XED_ENCODER_OPERANDS_MAX)
+        return 0;
+    ops[(*n)++] = xed_other(name, value);
+    return 1;
+}
+
+/* Describe a decoded instruction with the high-level encoder
+ * operands, the way a code generator using xed_inst*() would. */
+static xed_bool_t bench_make_hl(xed_decoded_inst_t* xedd,
+                                xed_state_t* dstate,
+                                xed_encoder_instruction_t* x)
+{
+    const xed_inst_t* xi = xed_decoded_inst_inst(xedd);
+    xed_encoder_operand_t ops[XED_ENCODER_OPERANDS_MAX];
+    xed_uint_t i, n = 0;
+    xed_uint_t bits;
+
+    for(i=0;i<xed_inst_noperands(xi);i++) {
+        const xed_operand_t* op = xed_inst_operand(xi,i);
+        xed_operand_enum_t name = xed_operand_name(op);
+        if (xed_operand_operand_visibility(op) == XED_OPVIS_SUPPRESSED)
+            continue;
+        if (n >= XED_ENCODER_OPERANDS_MAX)
+            return 0;
+        if (xed_operand_is_register(name)) {
+            ops[n++] = xed_reg(xed_decoded_inst_get_reg(xedd, name));
+            continue;
+        }
+        switch(name) {
+          case XED_OPERAND_AGEN:
+          case XED_OPERAND_MEM0:
+            ops[n++] = xed_mem_gbisd(
+                xed_decoded_inst_get_seg_reg(xedd,0),
+                xed_decoded_inst_get_base_reg(xedd,0),
+                xed_decoded_inst_get_index_reg(xedd,0),
+                xed_decoded_inst_get_scale(xedd,0),
+                xed_disp(xed_decoded_inst_get_memory_displacement(xedd,0),
+                         xed_decoded_inst_get_memory_displacement_width_bits(xedd,0)),
+                8*xed_decoded_inst_get_memory_operand_length(xedd,0));
+            break;
+          case XED_OPERAND_MEM1:
+            ops[n++] = xed_mem_gb(xed_decoded_inst_get_seg_reg(xedd,1),
+                                  xed_decoded_inst_get_base_reg(xedd,1),
+                                  8*xed_decoded_inst_get_memory_operand_length(xedd,1));
+            break;
+          case XED_OPERAND_IMM0:
+            bits = xed_decoded_inst_get_immediate_width_bits(xedd);
+            if (xed_decoded_inst_get_immediate_is_signed(xedd))
+                ops[n++] = xed_simm0(xed_decoded_inst_get_signed_immediate(xedd), bits);
+            else
+                ops[n++] = xed_imm0(xed_decoded_inst_get_unsigned_immediate(xedd), bits);
+            break;
+          case XED_OPERAND_IMM1:
+            ops[n++] = xed_imm1(xed_decoded_inst_get_second_immediate(xedd));
+            break;
+          case XED_OPERAND_RELBR:
+            ops[n++] = xed_relbr(xed_decoded_inst_get_branch_displacement(xedd),
+                                 xed_decoded_inst_get_branch_displacement_width_bits(xedd));
+            break;
+          case XED_OPERAND_ABSBR:
+            ops[n++] = xed_absbr(xed_decoded_inst_get_branch_displacement(xedd),
+                                 xed_decoded_inst_get_branch_displacement_width_bits(xedd));
+            break;
+          case XED_OPERAND_PTR:
+            ops[n++] = xed_ptr(xed_decoded_inst_get_branch_displacement(xedd),
+                               xed_decoded_inst_get_branch_displacement_width_bits(xedd));
+            break;
+          default:
+            return 0;
+        }
+    }
+
+    /* AVX512 encoding parameters that are not operands */
+    if (xed3_operand_get_zeroing(xedd) &&
+        !bench_add_other(ops, &n, XED_OPERAND_ZEROING, 1))
+        return 0;
+    if (xed3_operand_get_bcast(xedd) &&
+        !bench_add_other(ops, &n, XED_OPERAND_BCAST, 1))
+        return 0;
+    if (xed3_operand_get_sae(xedd) &&
+        !bench_add_other(ops, &n, XED_OPERAND_SAE, 1))
+        return 0;
+    if (xed3_operand_get_roundc(xedd) &&
+        !bench_add_other(ops, &n, XED_OPERAND_ROUNDC,
+                         xed3_operand_get_roundc(xedd)))
+        return 0;
+
+    xed_inst(x, *dstate, xed_decoded_inst_get_iclass(xedd),
+             xed_decoded_inst_get_operand_width(xedd), n, ops);
+    if (xed_decoded_inst_number_of_memory_operands(xedd))
+        xed_addr(x, xed_decoded_inst_get_memop_address_width(xedd,0));
+    return 1;
+}
+
+/* Build the inputs for the xed_encode() and high-level paths and check
+ * that each of them reproduces the instruction the enc2 test encodes.
+ * Either may legitimately pick an alternative encoding, so only the
+ * iclass is compared. Returns the iform of the enc2 output. */
+static xed_iform_enum_t bench_prepare(xed_enc2_bench_func_t fn,
+                                      xed_state_t* dstate,
+                                      bench_prep_t* prep)
+{
+    xed_uint8_t buf[2*XED_MAX_INSTRUCTION_BYTES];
+    xed_uint_t len, olen;
+    xed_decoded_inst_t xedd;
+    xed_encoder_request_t req;
+    xed_iform_enum_t iform;
+    xed_iclass_enum_t iclass;
+
+    memset(prep->ok, 0, sizeof(prep->ok));
+    len = (*fn)(buf);
+    if (len > XED_MAX_INSTRUCTION_BYTES)
+        return XED_IFORM_INVALID;
+    bench_decode_init(&xedd, dstate);
+    if (xed_decode(&xedd, buf, len) != XED_ERROR_NONE ||
+        xed_decoded_inst_get_length(&xedd) != len)
+        return XED_IFORM_INVALID;
+    iform = xed_decoded_inst_get_iform_enum(&xedd);
+    iclass = xed_decoded_inst_get_iclass(&xedd);
+    prep->ok[BENCH_ENC2] = 1;
+
+    prep->req = xedd;
+    xed_encoder_request_init_from_decode(&prep->req);
+    req = prep->req;
+    if (xed_encode(&req, buf, XED_MAX_INSTRUCTION_BYTES, &olen) == XED_ERROR_NONE)
+        prep->ok[BENCH_ENCODE] = bench_iclass(dstate, buf, olen) == iclass;
+
+    if (bench_make_hl(&xedd, dstate, &prep->hl) &&
+        xed_encode_instruction(&prep->hl, buf, XED_MAX_INSTRUCTION_BYTES,
+                               &olen) == XED_ERROR_NONE)
+        prep->ok[BENCH_ENC_HL] = bench_iclass(dstate, buf, olen) == iclass;
+    return iform;
+}
+
+static void bench_record(bench_samples_t* s, bench_path_t path,
+                         xed_uint64_t t1, xed_uint64_t t2)
+{
+    xed_histogram_update(&bench_histo[path], t1, t2);
+    if (t2 < t1)
+        return;
+    if (s->n == s->cap) {
+        s->cap = s->cap ? 2*s->cap : 1024;
+        s->v = (xed_uint32_t*)realloc(s->v, s->cap*sizeof(xed_uint32_t));
+        if (!s->v) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+    s->v[s->n++] = XED_STATIC_CAST(xed_uint32_t, t2-t1);
+}
+
+static int bench_cmp_u32(const void* a, const void* b)
+{
+    xed_uint32_t x = *(const xed_uint32_t*)a;
+    xed_uint32_t y = *(const xed_uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int bench_cmp_test(const void* a, const void* b)
+{
+    const bench_test_t* x = (const bench_test_t*)a;
+    const bench_test_t* y = (const bench_test_t*)b;
+    if (x->iform != y->iform)
+        return (x->iform > y->iform) - (x->iform < y->iform);
+    return (x->test_id > y->test_id) - (x->test_id < y->test_id);
+}
+
+/* Time every test of one iform on all paths, interleaving the paths so
+ * that frequency changes affect them alike. */
+static void bench_run_group(xed_enc2_bench_func_t* tests,
+                            bench_test_t* group, xed_uint32_t ngroup,
+                            bench_prep_t* prep, xed_uint_t reps,
+                            bench_samples_t* samples)
+{
+    const xed_uint_t warmup = 3;
+    xed_uint8_t buf[2*XED_MAX_INSTRUCTION_BYTES];
+    xed_encoder_request_t req;
+    xed_uint_t olen;
+    xed_uint64_t t1, t2;
+    xed_uint_t r;
+    xed_uint32_t j;
+
+    for(r=0;r<reps+warmup;r++) {
+        for(j=0;j<ngroup;j++) {
+            bench_prep_t* p = prep + j;
+            if (p->ok[BENCH_ENC2]) {
+                t1 = xed_get_time();
+                (*tests[group[j].test_id])(buf);
+                t2 = xed_get_time();
+                if (r >= warmup)
+                    bench_record(samples+BENCH_ENC2, BENCH_ENC2, t1, t2);
+            }
+            if (p->ok[BENCH_ENCODE]) {
+                req = p->req;
+                t1 = xed_get_time();
+                xed_encode(&req, buf, XED_MAX_INSTRUCTION_BYTES, &olen);
+                t2 = xed_get_time();
+                if (r >= warmup)
+                    bench_record(samples+BENCH_ENCODE, BENCH_ENCODE, t1, t2);
+            }
+            if (p->ok[BENCH_ENC_HL]) {
+                t1 = xed_get_time();
+                xed_encode_instruction(&p->hl, buf, XED_MAX_INSTRUCTION_BYTES, &olen);
+                t2 = xed_get_time();
+                if (r >= warmup)
+                    bench_record(samples+BENCH_ENC_HL, BENCH_ENC_HL, t1, t2);
+            }
+        }
+    }
+}
+
+static void bench_iform_histogram(xed_iform_enum_t iform, bench_path_t path,
+                                  bench_samples_t* s)
+{
+    static xed_histogram_t h;
+    xed_uint32_t i;
+    xed_histogram_initialize(&h);
+    for(i=0;i<s->n;i++)
+        xed_histogram_update(&h, 0, s->v[i]);
+    printf("//HISTOGRAM %s %s\n", xed_iform_enum_t2str(iform),
+           bench_path_names[path]);
+    xed_histogram_dump(&h, 0);
+}
+
+static void bench_emit(FILE* f, const char* iform, xed_uint32_t variants,
+                       bench_result_t* res)
+{
+    xed_uint_t k;
+    fprintf(f, "%s,%u", iform, variants);
+    for(k=0;k<BENCH_PATHS;k++) {
+        if (res->median[k])
+            fprintf(f, ",%u,%u", res->median[k], res->p99[k]);
+        else
+            fprintf(f, ",-,-");
+    }
+    fprintf(f, "\n");
+}
+
+static void bench_emit_header(FILE* f)
+{
+    xed_uint_t k;
+    fprintf(f, "iform,variants");
+    for(k=0;k<BENCH_PATHS;k++)
+        fprintf(f, ",%s-median,%s-p99", bench_path_names[k], bench_path_names[k]);
+    fprintf(f, "\n");
+}
+
+/* Read the medians of a file written with the save option. Returns an
+ * array indexed by iform, or 0 on error. */
+static bench_result_t* bench_read_baseline(const char* fn)
+{
+    char line[1024];
+    bench_result_t* base;
+    FILE* f = fopen(fn, "r");
+    if (!f) {
+        fprintf(stderr, "Could not open baseline file %s\n", fn);
+        return 0;
+    }
+    base = (bench_result_t*)calloc(XED_IFORM_LAST, sizeof(bench_result_t));
+    if (!base) {
+        fclose(f);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char* tok[2+2*BENCH_PATHS];
+        xed_uint_t ntok = 0, k;
+        xed_iform_enum_t iform;
+        char* p = strtok(line, ",\r\n");
+        while (p && ntok < 2+2*BENCH_PATHS) {
+            tok[ntok++] = p;
+            p = strtok(0, ",\r\n");
+        }
+        if (ntok != 2+2*BENCH_PATHS)
+            continue; /* comments and the column header */
+        iform = str2xed_iform_enum_t(tok[0]);
+        if (iform == XED_IFORM_INVALID)
+            continue;
+        for(k=0;k<BENCH_PATHS;k++) {
+            base[iform].median[k] = XED_STATIC_CAST(xed_uint32_t,
+                                                    strtoul(tok[2+2*k],0,10));
+            base[iform].p99[k] = XED_STATIC_CAST(xed_uint32_t,
+                                                 strtoul(tok[3+2*k],0,10));
+        }
+    }
+    fclose(f);
+    return base;
+}
+
+int xed_enc2_bench(xed_enc2_bench_func_t* tests,
+                   xed_state_t* dstate,
+                   xed_enc2_bench_options_t* opts)
+{
+    bench_test_t* order;
+    bench_prep_t* prep;
+    bench_result_t* baseline = 0;
+    bench_samples_t samples[BENCH_PATHS];
+    xed_uint32_t ntests = 0, nvalid = 0, max_group = 0, i, j, start;
+    xed_uint_t k;
+    FILE* save = 0;
+    int regressions = 0;
+
+    if (opts->baseline_file) {
+        baseline = bench_read_baseline(opts->baseline_file);
+        if (!baseline)
+            return -1;
+    }
+    if (opts->save_file) {
+        save = fopen(opts->save_file, "w");
+        if (!save) {
+            fprintf(stderr, "Could not open %s for writing\n", opts->save_file);
+            free(baseline);
+            return -1;
+        }
+        bench_emit_header(save);
+    }
+
+    while (tests[ntests])
+        ntests++;
+    order = (bench_test_t*)malloc((ntests+1)*sizeof(bench_test_t));
+    if (!order) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    memset(samples, 0, sizeof(samples));
+    for(k=0;k<BENCH_PATHS;k++) {
+        xed_histogram_initialize(&bench_histo[k]);
+        bench_unsupported[k] = 0;
+        bench_timed[k] = 0;
+    }
+
+    /* group the tests by the iform of what they encode */
+    for(i=0;i<ntests;i++) {
+        bench_prep_t scratch;
+        xed_iform_enum_t iform = bench_prepare(tests[i], dstate, &scratch);
+        if (iform == XED_IFORM_INVALID) {
+            bench_unsupported[BENCH_ENC2]++;
+            continue;
+        }
+        order[nvalid].test_id = i;
+        order[nvalid].iform = iform;
+        nvalid++;
+    }
+    qsort(order, nvalid, sizeof(bench_test_t), bench_cmp_test);
+    for(start=0;start<nvalid;start=i) {
+        for(i=start;i<nvalid && order[i].iform == order[start].iform;i++)
+            ;
+        if (i-start > max_group)
+            max_group = i-start;
+    }
+    prep = (bench_prep_t*)malloc((max_group+1)*sizeof(bench_prep_t));
+    if (!prep) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    printf("//Benchmarking %u encoder tests, %u repetitions\n", nvalid, opts->reps);
+    printf("//Cycles per encode, per iform. '-' means the path could not\n"
+           "//encode the instruction.\n");
+    bench_emit_header(stdout);
+    for(start=0;start<nvalid;start=i) {
+        xed_iform_enum_t iform = order[start].iform;
+        bench_result_t res;
+        for(i=start;i<nvalid && order[i].iform == iform;i++)
+            bench_prepare(tests[order[i].test_id], dstate, prep+i-start);
+        for(j=start;j<i;j++)
+            for(k=0;k<BENCH_PATHS;k++)
+                if (prep[j-start].ok[k])
+                    bench_timed[k]++;
+                else
+                    bench_unsupported[k]++;
+
+        for(k=0;k<BENCH_PATHS;k++)
+            samples[k].n = 0;
+        bench_run_group(tests, order+start, i-start, prep, opts->reps, samples);
+
+        memset(&res, 0, sizeof(res));
+        for(k=0;k<BENCH_PATHS;k++) {
+            bench_samples_t* s = samples+k;
+            if (s->n == 0)
+                continue;
+            qsort(s->v, s->n, sizeof(xed_uint32_t), bench_cmp_u32);
+            /* keep 0 for "no data" */
+            res.median[k] = s->v[(s->n-1)/2] ? s->v[(s->n-1)/2] : 1;
+            res.p99[k] = s->v[(xed_uint32_t)((s->n-1)*0.99)];
+            if (opts->iform_histograms)
+                bench_iform_histogram(iform, XED_STATIC_CAST(bench_path_t,k), s);
+        }
+        bench_emit(stdout, xed_iform_enum_t2str(iform), i-start, &res);
+        if (save)
+            bench_emit(save, xed_iform_enum_t2str(iform), i-start, &res);
+
+        if (baseline) {
+            for(k=0;k<BENCH_PATHS;k++) {
+                double old = baseline[iform].median[k];
+                double cur = res.median[k];
+                if (old == 0 || cur == 0)
+                    continue;
+                if (cur > old*(1.0+opts->tolerance/100.0)) {
+                    printf("//REGRESSION %s %s median %u -> %u (%+.1lf%%)\n",
+                           xed_iform_enum_t2str(iform), bench_path_names[k],
+                           baseline[iform].median[k], res.median[k],
+                           100.0*(cur-old)/old);
+                    regressions++;
+                }
+            }
+        }
+    }
+
+    printf("//SUMMARY path tests unsupported median p99 (cycles, %u-cycle bins)\n",
+           XED_HISTO_CYCLES_PER_BIN);
+    for(k=0;k<BENCH_PATHS;k++) {
+        printf("//SUMMARY %-8s " XED_FMT_LU " " XED_FMT_LU " %u %u\n",
+               bench_path_names[k],
+               bench_timed[k], bench_unsupported[k],
+               xed_histogram_percentile(&bench_histo[k], 50),
+               xed_histogram_percentile(&bench_histo[k], 99));
+        if (opts->iform_histograms) {
+            printf("//HISTOGRAM all %s\n", bench_path_names[k]);
+            xed_histogram_dump(&bench_histo[k], 0);
+        }
+    }
+    if (baseline)
+        printf("//Regressions: %d (tolerance %.1lf%%)\n",
+               regressions, opts->tolerance);
+
+    for(k=0;k<BENCH_PATHS;k++)
+        free(samples[k].v);
+    free(order);
+    free(prep);
+    free(baseline);
+    if (save)
+        fclose(save);
+    return regressions;
+}
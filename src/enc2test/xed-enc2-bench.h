@@ -0,0 +1,47 @@
+/* BEGIN_LEGAL 
+
+Copyright (c) 2023 Intel Corporation
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+  
+END_LEGAL */
+/// @file xed-enc2-bench.h
+/// Encoder throughput comparison between xed_encode(), the
+/// high-level encoder and enc2, driven by the enc2 test functions.
+
+#if !defined(XED_ENC2_BENCH_H)
+# define XED_ENC2_BENCH_H
+#include "xed-interface.h"
+
+typedef xed_uint32_t (*xed_enc2_bench_func_t)(xed_uint8_t* output_buffer);
+
+typedef struct {
+    /* number of timed repetitions of each test */
+    xed_uint_t reps;
+    /* print a cycle histogram for every iform and encoder path */
+    xed_bool_t iform_histograms;
+    /* if non-null, write the per-iform results here for later use as
+     * a baseline */
+    const char* save_file;
+    /* if non-null, compare the per-iform medians against this baseline */
+    const char* baseline_file;
+    /* percent slowdown of a median allowed before reporting a regression */
+    double tolerance;
+} xed_enc2_bench_options_t;
+
+/* Returns the number of regressions found relative to the baseline, or
+ * -1 on error. */
+int xed_enc2_bench(xed_enc2_bench_func_t* tests,
+                   xed_state_t* dstate,
+                   xed_enc2_bench_options_t* opts);
+#endif
@@ -95,3 +95,26 @@ xed_histogram_dump(xed_histogram_t* p, int include_zero_bins)
     }
 }
 
+
+/* Returns the upper bound, in cycles, of the bin holding the pct'th
+ * percentile sample. Samples past the last bin report XED_HISTO_MAX_CYCLES. */
+static XED_INLINE xed_uint32_t
+xed_histogram_percentile(xed_histogram_t* p, double pct)
+{
+    xed_uint32_t i=0;
+    xed_uint64_t total=0, seen=0;
+    double target;
+    for(i=0;i<XED_HISTO_BINS;i++) 
+        total += p->histo[i];
+    if (total == 0)
+        return 0;
+    target = DCAST(total)*pct/100.0;
+    for(i=0;i<XED_HISTO_BINS;i++)  {
+        seen += p->histo[i];
+        if (DCAST(seen) >= target)
+            break;
+    }
+    if (i >= XED_HISTO_BINS-1)
+        return XED_HISTO_MAX_CYCLES;
+    return (i+1)*XED_HISTO_CYCLES_PER_BIN-1;
+}
@@ -16,6 +16,7 @@ Copyright (c) 2019 Intel Corporation
   
 END_LEGAL */
 #include "xed-internal-header.h"
+#include "xed-portability-private.h"
 #if defined(XED_MESSAGES)
 # include <stdio.h>
 #endif
@@ -25,12 +26,12 @@ extern void xed_ild_init(void);
 XED_DLL_EXPORT void 
 xed_tables_init(void)
 {
-    static int first_time = 1;
-    if (first_time == 0)
-	return;
-    first_time = 0;
+    static xed_once_t once = 0;
+    if (!xed_once_begin(&once))
+        return;
 #if defined(XED_MESSAGES)
     xed_log_file = stdout;
 #endif
     xed_ild_init();
+    xed_once_end(&once);
 }
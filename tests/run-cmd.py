@@ -141,6 +141,47 @@ def all_codes_present(specified_codes, test_codes):
             return False
     return True 
 
+# test codes that only make sense if some isa-set with the given prefix
+# survived a --target-chips build
+_code_isa_set_prefixes = { 'AVX'       : 'AVX',
+                           'AVX512X'   : 'AVX512',
+                           'AVX512PF'  : 'AVX512PF',
+                           'AMX'       : 'AMX',
+                           'AVX10'     : 'AVX10',
+                           'APX'       : 'APX',
+                           'IPREFETCH' : 'ICACHE_PREFETCH',
+                           'XOP'       : 'XOP' }
+
+_isa_set_pattern = re.compile(r'ISA(?:_SET:|-set)\s+([A-Z0-9_]+)')
+
+def read_isa_sets(fn):
+    """Read the list of isa-sets retained by a --target-chips build"""
+    return set([ x.strip() for x in open(fn,'r').readlines() if x.strip() ])
+
+def restrict_codes(codes, isa_sets):
+    """Remove the codes for instruction families that were not built"""
+    out = []
+    for c in codes:
+        if c in _code_isa_set_prefixes:
+            pfx = _code_isa_set_prefixes[c]
+            if not any(x.startswith(pfx) for x in isa_sets):
+                mbuild.msgb("DROPPING TEST CODE", c)
+                continue
+        out.append(c)
+    return out
+
+def isa_sets_present(isa_sets, test_dir):
+    """The isa-sets named in the reference output must all be built"""
+    fn = os.path.join(test_dir,"stdout.reference")
+    if not isa_sets or not os.path.exists(fn):
+        return True
+    # xed -d prints "ISA_SET: X", xed-ex1 prints "ISA-set X"
+    for line in open(fn,'r').readlines():
+        m = _isa_set_pattern.search(line)
+        if m and m.group(1) not in isa_sets:
+            return False
+    return True
+
 def _prep_stream(strm,name):
     if len(strm) == 1:
         strm= strm[0].split("\n")
@@ -211,6 +252,10 @@ def run_tests(env):
     test_dirs = find_tests(env)
     errors = 0
     skipped = 0
+    isa_sets = None
+    if env['isa_sets']:
+        isa_sets = read_isa_sets(env['isa_sets'])
+        env['codes'] = restrict_codes(env['codes'], isa_sets)
     for tdir in test_dirs:
         #if env.on_windows():
         #    time.sleep(1) # try to avoid a bug on windows running commands to quickly
@@ -220,7 +265,11 @@ def run_tests(env):
         codes_fn = os.path.join(tdir,"codes")
         codes = open(codes_fn,'r').readlines()[0].strip().split()
 
-        if all_codes_present(env['codes'],codes):
+        if not isa_sets_present(isa_sets, tdir):
+            mbuild.msgb("SKIPPING DUE TO ISA-SET RESTRICTION")
+            print('-'*40 + "\n\n\n")
+            skipped += 1
+        elif all_codes_present(env['codes'],codes):
             okay = one_test(env,tdir)
             if not okay:
                 failing_tests.append(tdir)
@@ -274,8 +323,15 @@ def work():
                           action="append",
                           default=[], 
                           help="Codes for test subsetting (DEC, ENC, AVX, " 
-                             + "AVX512X, AVX512PF, AMX, APX, AVX10, IPREFETCH, HSW, AMD, XOP, VIA)." 
+                             + "AVX512X, AVX512PF, AMX, APX, AVX10, IPREFETCH, HSW, AMD, XOP, VIA, "
+                             + "DWARF, LINUX)." 
                              + " Only used for running tests, not creating them.")
+    env.parser.add_option("--isa-sets", 
+                          dest="isa_sets", 
+                          action="store",
+                          default='', 
+                          help="File listing the isa-sets in a --target-chips" 
+                             + " build. Skip tests that use other isa-sets.")
     env.parse_args()
 
     if not env['tests']:
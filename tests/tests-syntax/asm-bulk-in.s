@@ -0,0 +1,10 @@
+# xed-asmparse-main -f input: one or more instructions per line
+nop
+mov eax, 0x00000000
+vaddpd ymm1{k2}{z}, ymm2, ymmword ptr [ebx]   # trailing comment
+lock cmpxchg dword ptr [ebx], esi ; rep cmpsb
+
+bogus eax
+call far 0x1234:0x10dedead
+xchg eax, ebx, ecx, edx, eax, edx, edx, edx, eax, r12, r13
+jmp 0x70
@@ -326,6 +326,8 @@ def run_decode_generator(gc, env):
         gen_extra_args += " --compress-operands" 
     if env['add_orphan_inst_to_future_chip']:
         gen_extra_args += " --add-orphan-inst-to-future-chip"
+    if env['target_chips']:
+        gen_extra_args += " --target-chips %s" % (env['target_chips'])
         
     cmd = env.expand(gc.decode_command(xedsrc, gen_extra_args))
 
@@ -660,7 +662,9 @@ def mkenv():
                                  verbose = 1,
                                  compress_operands=False,
                                  add_orphan_inst_to_future_chip=False,
+                                 target_chips='',
                                  test_perf=False,
+                                 test_startup=False,
                                  example_linkflags='',
                                  example_flags='',
                                  example_rpaths=[],
@@ -982,11 +986,24 @@ def xed_args(env):
                           action="store_true",
                           dest="add_orphan_inst_to_future_chip",
                           help="Add orphan isa-sets to future chip definition.")
+    env.parser.add_option("--target-chips", 
+                          action="store",
+                          dest="target_chips",
+                          help="Comma separated list of chips (for example" +
+                          " SPR,GNR). The decoder tables only contain the" +
+                          " instructions whose ISA set one of these chips" +
+                          " supports. Tests for other ISA sets are skipped.")
     env.parser.add_option("--test-perf", 
                           action="store_true",
                           dest="test_perf",
                           help="Do performance test (on linux). Requires" + 
                           " specific external test binary.")
+    env.parser.add_option("--test-startup", 
+                          action="store_true",
+                          dest="test_startup",
+                          help="Run the startup and footprint benchmark" +
+                          " (xed-startup) and write startup-static.json or" +
+                          " startup-shared.json in the build directory.")
     env.parser.add_option("--pin-crt", 
                           action="store",
                           dest="pin_crt",
@@ -1671,7 +1688,8 @@ def add_encoder2_command(env, dag, input_files, config):
               'pysrc/gen_setup.py',              
               'pysrc/enc2gen.py',
               'pysrc/enc2test.py',
-              'pysrc/enc2argcheck.py' ]
+              'pysrc/enc2argcheck.py',
+              'pysrc/enc2cpp.py' ]
 
     enc2args = dummy_obj_t()
     enc_py = env.src_dir_join(enc_py)
@@ -2071,6 +2089,30 @@ def _test_perf(env):
         # mbuild hash state and causes rebuilds.
         xbc.cdie( "perf test failed") 
 
+def _test_startup(env):
+    """Startup and footprint benchmark: tables init time, pages touched
+    and resident memory after init and after decoding the bulk test
+    corpora. Run once per build flavor (static and --shared)."""
+    if not env['test_startup']:
+        return
+    wkit = env['wkit']
+    xed_startup = None
+    for exe in mbuild.glob(wkit.bin, '*'):
+        if os.path.basename(exe) in ['xed-startup', 'xed-startup.exe']:
+            xed_startup = exe
+    if not xed_startup:
+        xbc.cdie("Could not find xed-startup for the startup test")
+
+    import startupbench
+    args = startupbench.mkargs()
+    args.xed_startup = xed_startup
+    args.corpus = mbuild.join(env['src_dir'], 'tests', 'bulk-tests')
+    args.output = mbuild.join(env['build_dir'], 'startup-%s.json' %
+                              ('shared' if env['shared'] else 'static'))
+    r = startupbench.work(args)
+    if r != 0:
+        xbc.cdie("startup test failed")
+
 def _get_xed_min_size(env):
     if not env.on_linux():
         return
@@ -2110,6 +2152,7 @@ def _copy_examples_to_bin(env,xkit):
 def _test_examples(env):
     _get_xed_min_size(env)
     _test_perf(env)
+    _test_startup(env)
 
 
 def build_examples(env):
@@ -2686,8 +2729,14 @@ def _run_canned_tests(env,osenv):
         codes.append('AMD')
     if env['future']:
         codes.append('APX')
+    if env['use_elf_dwarf']:
+        codes.append('DWARF')
+    if env.on_linux():
+        codes.append('LINUX')
     for c in codes:
         cmd += ' -c ' + c
+    if env['target_chips']:
+        cmd += ' --isa-sets ' + aq(env.build_dir_join('xed-isa-sets-retained.txt'))
 
     output_file = env.build_dir_join('TEST.OUT.txt')
     cmd  = env.expand_string(cmd)